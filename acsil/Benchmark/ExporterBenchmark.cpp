@@ -0,0 +1,665 @@
+// Exporter benchmark
+// Drives scsf_TimeAndSalesToSocket outside Sierra Chart through the mock
+// sierrachart.h in Mock\, feeding it bursts of Time & Sales records and
+// sending to a local sink: a TCP listener that discards what it receives, a
+// shared-memory reader, or a WebSocket client of the exporter's own server.
+// Reports ticks/sec, ns/tick and bytes/tick for each wire format and transport,
+// and for the I/O thread's send backends the sends per thousand ticks. First
+// it times the record conversion alone, per record and with each batch
+// kernel this processor supports.
+// Build: see "Benchmark Build.txt".
+// Run: ExporterBenchmark [ticks] [ticks per call] [csv file or -] [ticks/sec]
+// With a csv file (timestamp,price,volume,side, as sample-data.csv) its rows
+// are repeated to make up the tick count; otherwise ticks are synthetic.
+// With ticks/sec the study calls are paced to that rate (e.g. 100000, to
+// compare the send backends at a steady live rate) instead of run flat out.
+
+#include "../TradeFlowDataExporter.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int BENCHMARK_PORT = 9990;
+static const int BENCHMARK_WS_PORT = 9991;
+
+// The chart's Time & Sales array is trimmed to about this many records
+static const size_t MAX_CHART_RECORDS = 100000;
+
+// Sequence of the record the study sees first; exported ticks follow it
+static const int64_t SEED_SEQUENCE = 1;
+
+static s_TimeAndSales MakeRecord(int64_t Sequence, int64_t TimestampMs, double Price, unsigned int Volume, bool IsAsk)
+{
+    s_TimeAndSales Record = s_TimeAndSales();
+    Record.Type = IsAsk ? SC_TS_ASK : SC_TS_BID;
+    Record.Price = static_cast<float>(Price);
+    Record.Volume = Volume;
+    Record.DateTime = SCDateTime::FromUnixMilliseconds(TimestampMs);
+    Record.Sequence = Sequence;
+    return Record;
+}
+
+static std::vector<s_TimeAndSales> MakeSyntheticTicks(int Count, double BasePrice, double TickSize)
+{
+    std::vector<s_TimeAndSales> Ticks;
+    Ticks.reserve(Count);
+
+    uint32_t Seed = 12345;
+    int64_t PriceTicks = static_cast<int64_t>(BasePrice / TickSize);
+    int64_t TimestampMs = 1703001600000LL;
+
+    for (int i = 0; i < Count; i++)
+    {
+        Seed = Seed * 1664525u + 1013904223u;
+        PriceTicks += static_cast<int>((Seed >> 16) % 3) - 1;
+        TimestampMs += (Seed >> 8) % 4;
+        Ticks.push_back(MakeRecord(SEED_SEQUENCE + 1 + i, TimestampMs, PriceTicks * TickSize, 1 + (Seed >> 4) % 40, (Seed & 1) != 0));
+    }
+
+    return Ticks;
+}
+
+// Repeats the file's rows until Count ticks, shifting time forward each lap
+static std::vector<s_TimeAndSales> LoadCsvTicks(const char* Path, int Count)
+{
+    struct Row
+    {
+        int64_t TimestampMs;
+        double Price;
+        unsigned int Volume;
+        bool IsAsk;
+    };
+
+    std::vector<Row> Rows;
+    std::ifstream File(Path);
+    std::string Line;
+    while (std::getline(File, Line))
+    {
+        long long TimestampMs = 0;
+        double Price = 0.0;
+        unsigned int Volume = 0;
+        char Side[8] = "";
+        if (sscanf(Line.c_str(), "%lld,%lf,%u,%7s", &TimestampMs, &Price, &Volume, Side) == 4)
+            Rows.push_back({ TimestampMs, Price, Volume, Side[0] == 'A' });
+    }
+
+    std::vector<s_TimeAndSales> Ticks;
+    if (Rows.empty())
+        return Ticks;
+
+    const int64_t LapMs = Rows.back().TimestampMs - Rows.front().TimestampMs + 1;
+    Ticks.reserve(Count);
+    for (int i = 0; i < Count; i++)
+    {
+        const Row& Source = Rows[i % Rows.size()];
+        const int64_t Lap = i / static_cast<int64_t>(Rows.size());
+        Ticks.push_back(MakeRecord(SEED_SEQUENCE + 1 + i, Source.TimestampMs + Lap * LapMs, Source.Price, Source.Volume, Source.IsAsk));
+    }
+
+    return Ticks;
+}
+
+// Accepts one connection at a time and discards everything it receives
+class TcpSink
+{
+public:
+    TcpSink() : ListenSocket(INVALID_SOCKET), StopRequested(false), BytesReceived(0) {}
+
+    bool Start(int Port)
+    {
+        ListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (ListenSocket == INVALID_SOCKET)
+            return false;
+
+        sockaddr_in Address;
+        memset(&Address, 0, sizeof(Address));
+        Address.sin_family = AF_INET;
+        Address.sin_port = htons(static_cast<u_short>(Port));
+        Address.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+        if (bind(ListenSocket, reinterpret_cast<SOCKADDR*>(&Address), sizeof(Address)) == SOCKET_ERROR
+            || listen(ListenSocket, 4) == SOCKET_ERROR)
+            return false;
+
+        Thread = std::thread(&TcpSink::Run, this);
+        return true;
+    }
+
+    void Stop()
+    {
+        StopRequested = true;
+        closesocket(ListenSocket);
+        if (Thread.joinable())
+            Thread.join();
+    }
+
+    uint64_t Bytes() const { return BytesReceived; }
+    void ResetBytes() { BytesReceived = 0; }
+
+private:
+    void Run()
+    {
+        std::vector<char> Buffer(1024 * 1024);
+
+        while (!StopRequested)
+        {
+            SOCKET Client = accept(ListenSocket, NULL, NULL);
+            if (Client == INVALID_SOCKET)
+                continue;
+
+            // Nothing to resume; the exporter can go live at once
+            const char Ready[] = "{\"type\":\"ready\"}\n";
+            send(Client, Ready, static_cast<int>(sizeof(Ready) - 1), 0);
+
+            for (;;)
+            {
+                const int Received = recv(Client, Buffer.data(), static_cast<int>(Buffer.size()), 0);
+                if (Received <= 0)
+                    break;
+                BytesReceived += Received;
+            }
+
+            closesocket(Client);
+        }
+    }
+
+    SOCKET ListenSocket;
+    std::thread Thread;
+    std::atomic<bool> StopRequested;
+    std::atomic<uint64_t> BytesReceived;
+};
+
+// Follows the exporter's shared-memory ring from its current end
+class ShmSink
+{
+public:
+    ShmSink() : Mapping(NULL), View(NULL), StopRequested(false), BytesReceived(0), Overruns(0) {}
+
+    bool Start(int Port)
+    {
+        char Name[64];
+        snprintf(Name, sizeof(Name), "%s%d", SHM_NAME_PREFIX, Port);
+
+        Mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, Name);
+        if (Mapping == NULL)
+            return false;
+
+        View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+        if (View == NULL || !Reader.Attach(View))
+            return false;
+
+        Thread = std::thread(&ShmSink::Run, this);
+        return true;
+    }
+
+    void Stop()
+    {
+        StopRequested = true;
+        if (Thread.joinable())
+            Thread.join();
+        if (View != NULL)
+            UnmapViewOfFile(View);
+        if (Mapping != NULL)
+            CloseHandle(Mapping);
+    }
+
+    uint64_t Bytes() const { return BytesReceived; }
+    uint64_t OverrunCount() const { return Overruns; }
+
+private:
+    void Run()
+    {
+        std::vector<char> Buffer(1024 * 1024);
+
+        while (!StopRequested)
+        {
+            size_t Length = 0;
+            const int Result = Reader.Read(Buffer.data(), Buffer.size(), Length);
+            if (Result == SHM_READ_DATA)
+                BytesReceived += Length;
+            else if (Result == SHM_READ_OVERRUN)
+                Overruns++;
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    HANDLE Mapping;
+    void* View;
+    ShmRingReader Reader;
+    std::thread Thread;
+    std::atomic<bool> StopRequested;
+    std::atomic<uint64_t> BytesReceived;
+    std::atomic<uint64_t> Overruns;
+};
+
+// Connects to the exporter's WebSocket server, completes the handshake and
+// then counts and discards everything it receives (frame headers included)
+class WsSink
+{
+public:
+    WsSink() : Socket(INVALID_SOCKET), StopRequested(false), BytesReceived(0) {}
+
+    bool Start(int Port)
+    {
+        Socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (Socket == INVALID_SOCKET)
+            return false;
+
+        sockaddr_in Address;
+        memset(&Address, 0, sizeof(Address));
+        Address.sin_family = AF_INET;
+        Address.sin_port = htons(static_cast<u_short>(Port));
+        Address.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+        if (connect(Socket, reinterpret_cast<SOCKADDR*>(&Address), sizeof(Address)) == SOCKET_ERROR)
+            return false;
+
+        static const char Request[] =
+            "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+        if (send(Socket, Request, static_cast<int>(sizeof(Request) - 1), 0) == SOCKET_ERROR)
+            return false;
+
+        // Read the reply byte by byte so no frame bytes are taken with it
+        std::string Reply;
+        char c;
+        while (Reply.size() < 4 || Reply.compare(Reply.size() - 4, 4, "\r\n\r\n") != 0)
+        {
+            if (recv(Socket, &c, 1, 0) != 1)
+                return false;
+            Reply += c;
+        }
+        if (Reply.compare(0, 12, "HTTP/1.1 101") != 0)
+            return false;
+
+        Thread = std::thread(&WsSink::Run, this);
+        return true;
+    }
+
+    void Stop()
+    {
+        StopRequested = true;
+        if (Socket != INVALID_SOCKET)
+            closesocket(Socket);
+        if (Thread.joinable())
+            Thread.join();
+    }
+
+    uint64_t Bytes() const { return BytesReceived; }
+
+private:
+    void Run()
+    {
+        std::vector<char> Buffer(1024 * 1024);
+
+        while (!StopRequested)
+        {
+            const int Received = recv(Socket, Buffer.data(), static_cast<int>(Buffer.size()), 0);
+            if (Received <= 0)
+                break;
+            BytesReceived += Received;
+        }
+    }
+
+    SOCKET Socket;
+    std::thread Thread;
+    std::atomic<bool> StopRequested;
+    std::atomic<uint64_t> BytesReceived;
+};
+
+static const int CONVERSION_ROUNDS = 5;
+
+// The conversion the study did before RecordBatch, one record at a time
+static double PerRecordConversionNanos(const std::vector<s_TimeAndSales>& Ticks, double TickSize, int64_t& Checksum)
+{
+    UnixTimeConverter Converter;
+    const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+    for (int Round = 0; Round < CONVERSION_ROUNDS; Round++)
+    {
+        for (size_t i = 0; i < Ticks.size(); i++)
+        {
+            const s_TimeAndSales& Record = Ticks[i];
+            if (Record.Type != SC_TS_BID && Record.Type != SC_TS_ASK)
+                continue;
+            Checksum += Converter.Microseconds(Record.DateTime) + PriceToTicks(Record.Price, TickSize) + (Record.Type == SC_TS_ASK);
+        }
+    }
+
+    const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+    return Seconds * 1e9 / (static_cast<double>(Ticks.size()) * CONVERSION_ROUNDS);
+}
+
+// Gather and convert through ConvertRecords, as the study does; ConvertOnly
+// is the kernels alone, run again over the last batch gathered
+static double BatchConversionNanos(const std::vector<s_TimeAndSales>& Ticks, double TickSize, int Kernel, int64_t& Checksum, double& ConvertOnly)
+{
+    SocketState* pState = new SocketState();
+    pState->TickSize = TickSize;
+    pState->ConversionKernel = Kernel;
+
+    c_SCTimeAndSalesArray TimeSales;
+    TimeSales.Records = &Ticks;
+    const int NumRecords = TimeSales.Size();
+    const RecordBatch& Batch = pState->Batch;
+
+    const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    for (int Round = 0; Round < CONVERSION_ROUNDS; Round++)
+    {
+        for (int i = 0; i < NumRecords; )
+        {
+            const int End = ConvertRecords(pState, TimeSales, i, NumRecords);
+            for (int j = 0; j < End - i; j++)
+            {
+                if (Batch.Flags[j] & RECORD_TRADE)
+                    Checksum += Batch.Micros[j] + Batch.PriceTicks[j] + ((Batch.Flags[j] & RECORD_ASK) != 0);
+            }
+            i = End;
+        }
+    }
+    const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+    const int Repeats = static_cast<int>(CONVERSION_ROUNDS * Ticks.size() / RecordBatch::CAPACITY) + 1;
+    const std::chrono::steady_clock::time_point ConvertStart = std::chrono::steady_clock::now();
+    for (int r = 0; r < Repeats; r++)
+    {
+        pState->Batch.Convert(Kernel, TickSize, SC_TS_BID, SC_TS_ASK);
+        Checksum += Batch.Micros[r % Batch.Count];
+    }
+    ConvertOnly = std::chrono::duration<double>(std::chrono::steady_clock::now() - ConvertStart).count() * 1e9
+        / (static_cast<double>(Repeats) * Batch.Count);
+
+    delete pState;
+    return Seconds * 1e9 / (static_cast<double>(Ticks.size()) * CONVERSION_ROUNDS);
+}
+
+static void RunConversionBenchmark(const std::vector<s_TimeAndSales>& Ticks, double TickSize)
+{
+    int64_t Checksum = 0;
+    printf("Record conversion (ns/tick)\n  %-24s %14s %13s\n", "Kernels", "gather+convert", "convert only");
+    printf("  %-24s %14.2f %13s\n", "Per record", PerRecordConversionNanos(Ticks, TickSize, Checksum), "-");
+
+    const int Kernels[] = { CONVERSION_KERNEL_SCALAR, CONVERSION_KERNEL_SSE2, CONVERSION_KERNEL_AVX2, CONVERSION_KERNEL_NEON };
+    for (size_t i = 0; i < sizeof(Kernels) / sizeof(Kernels[0]); i++)
+    {
+        if (ResolveConversionKernel(Kernels[i]) != Kernels[i])
+            continue;
+
+        double ConvertOnly = 0.0;
+        const double Nanos = BatchConversionNanos(Ticks, TickSize, Kernels[i], Checksum, ConvertOnly);
+        printf("  %-24s %14.2f %13.2f\n", ConversionKernelName(Kernels[i]), Nanos, ConvertOnly);
+    }
+
+    // Printed so the conversions cannot be optimized away
+    printf("  (checksum %lld)\n\n", static_cast<long long>(Checksum));
+}
+
+struct BenchmarkMode
+{
+    const char* Name;
+    int WireFormat;
+    int Transport;
+    bool BackgroundIo;
+    int TickCompression;
+    int SendBackend;
+};
+
+struct BenchmarkResult
+{
+    double StudySeconds;    // Time spent inside the study function
+    double TotalSeconds;    // Until the sink had received everything
+    uint64_t Bytes;
+    int64_t DroppedTicks;
+    uint64_t Overruns;
+    int64_t SendCalls;      // I/O thread only
+};
+
+static SocketState* GetState(s_sc& sc)
+{
+    return reinterpret_cast<SocketState*>(sc.GetPersistentPointer(1));
+}
+
+static bool IsConnected(s_sc& sc)
+{
+    SocketState* pState = GetState(sc);
+    if (pState == NULL)
+        return false;
+
+    return pState->Shm != NULL
+        || pState->Ws != NULL
+        || (pState->Worker != NULL && pState->Worker->Connected)
+        || pState->Connected;
+}
+
+static size_t QueuedBytes(s_sc& sc)
+{
+    SocketState* pState = GetState(sc);
+    if (pState->Channel != NULL)
+        return pState->Channel->QueuedBytes();
+    if (pState->Ws != NULL)
+        return static_cast<size_t>(pState->Ws->BacklogBytes);
+    return pState->SendQueue.SizeBytes();
+}
+
+// Bytes received so far by the mode's sink
+static uint64_t SinkBytes(int Transport, const TcpSink& Tcp, const ShmSink& Shm, const WsSink& Ws)
+{
+    if (Transport == TRANSPORT_SHARED_MEMORY)
+        return Shm.Bytes();
+    if (Transport == TRANSPORT_WEBSOCKET)
+        return Ws.Bytes();
+    return Tcp.Bytes();
+}
+
+static bool RunMode(const BenchmarkMode& Mode, const std::vector<s_TimeAndSales>& Ticks, int TicksPerCall, int TicksPerSecond,
+    TcpSink& Tcp, BenchmarkResult& Result)
+{
+    memset(&Result, 0, sizeof(Result));
+
+    s_sc sc;
+    sc.Symbol = "NQH6.CME";
+    sc.TickSize = 0.25f;
+
+    sc.SetDefaults = 1;
+    scsf_TimeAndSalesToSocket(sc);
+    sc.SetDefaults = 0;
+
+    sc.Input[0].SetYesNo(1);
+    sc.Input[1].SetInt(BENCHMARK_PORT);
+    sc.Input[7].SetInt(64 * 1024);              // Send ring large enough not to drop
+    sc.Input[9].SetCustomInputIndex(Mode.WireFormat);
+    sc.Input[10].SetYesNo(Mode.BackgroundIo ? 1 : 0);
+    sc.Input[12].SetCustomInputIndex(Mode.Transport);
+    sc.Input[20].SetInt(0);                     // No stats frames in the numbers
+    sc.Input[34].SetInt(0);                     // Nor heartbeats
+    sc.Input[36].SetCustomInputIndex(Mode.TickCompression);
+    sc.Input[29].SetInt(BENCHMARK_WS_PORT);
+    sc.Input[43].SetCustomInputIndex(Mode.SendBackend);
+
+    // The study starts real-time export after the last record it first sees
+    sc.TimeAndSales.push_back(MakeRecord(SEED_SEQUENCE, 1703001600000LL, Ticks[0].Price, 1, false));
+
+    Tcp.ResetBytes();
+    const std::chrono::steady_clock::time_point ConnectDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!IsConnected(sc) && std::chrono::steady_clock::now() < ConnectDeadline)
+    {
+        scsf_TimeAndSalesToSocket(sc);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    scsf_TimeAndSalesToSocket(sc);
+
+    if (!IsConnected(sc))
+    {
+        sc.LastCallToFunction = 1;
+        scsf_TimeAndSalesToSocket(sc);
+        return false;
+    }
+
+    ShmSink Shm;
+    if (Mode.Transport == TRANSPORT_SHARED_MEMORY && !Shm.Start(BENCHMARK_PORT))
+    {
+        sc.LastCallToFunction = 1;
+        scsf_TimeAndSalesToSocket(sc);
+        return false;
+    }
+
+    // Ticks published before the client's handshake completes are not sent to it
+    WsSink Ws;
+    if (Mode.Transport == TRANSPORT_WEBSOCKET)
+    {
+        const std::chrono::steady_clock::time_point OpenDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        bool Open = Ws.Start(BENCHMARK_WS_PORT);
+        while (Open && GetState(sc)->Ws->ClientCount == 0 && std::chrono::steady_clock::now() < OpenDeadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (!Open || GetState(sc)->Ws->ClientCount == 0)
+        {
+            Ws.Stop();
+            sc.LastCallToFunction = 1;
+            scsf_TimeAndSalesToSocket(sc);
+            return false;
+        }
+    }
+
+    const uint64_t StartBytes = SinkBytes(Mode.Transport, Tcp, Shm, Ws);
+    std::chrono::steady_clock::duration StudyTime(0);
+    const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+    for (size_t Offset = 0; Offset < Ticks.size(); Offset += TicksPerCall)
+    {
+        if (TicksPerSecond > 0)
+            std::this_thread::sleep_until(Start + std::chrono::microseconds(static_cast<int64_t>(Offset) * 1000000 / TicksPerSecond));
+
+        const size_t End = (Offset + TicksPerCall < Ticks.size()) ? Offset + TicksPerCall : Ticks.size();
+        sc.TimeAndSales.insert(sc.TimeAndSales.end(), Ticks.begin() + Offset, Ticks.begin() + End);
+        if (sc.TimeAndSales.size() > 2 * MAX_CHART_RECORDS)
+            sc.TimeAndSales.erase(sc.TimeAndSales.begin(), sc.TimeAndSales.end() - MAX_CHART_RECORDS);
+
+        const std::chrono::steady_clock::time_point CallStart = std::chrono::steady_clock::now();
+        scsf_TimeAndSalesToSocket(sc);
+        StudyTime += std::chrono::steady_clock::now() - CallStart;
+    }
+
+    // Let the queues drain, then wait until the sink has stopped growing
+    uint64_t LastBytes = 0;
+    int StableRounds = 0;
+    const std::chrono::steady_clock::time_point DrainDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (StableRounds < 20 && std::chrono::steady_clock::now() < DrainDeadline)
+    {
+        if (Mode.Transport != TRANSPORT_SHARED_MEMORY && QueuedBytes(sc) > 0)
+            scsf_TimeAndSalesToSocket(sc);
+
+        const uint64_t Bytes = SinkBytes(Mode.Transport, Tcp, Shm, Ws);
+        StableRounds = (Bytes == LastBytes && QueuedBytes(sc) == 0) ? StableRounds + 1 : 0;
+        LastBytes = Bytes;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const std::chrono::steady_clock::time_point Finish = std::chrono::steady_clock::now() - std::chrono::milliseconds(StableRounds);
+
+    Result.StudySeconds = std::chrono::duration<double>(StudyTime).count();
+    Result.TotalSeconds = std::chrono::duration<double>(Finish - Start).count();
+    Result.Bytes = LastBytes - StartBytes;
+    Result.DroppedTicks = GetState(sc)->DroppedTicks;
+    Result.Overruns = Shm.OverrunCount();
+    if (GetState(sc)->Worker != NULL)
+        Result.SendCalls = GetState(sc)->Worker->SendCalls;
+
+    Shm.Stop();
+    Ws.Stop();
+    sc.LastCallToFunction = 1;
+    scsf_TimeAndSalesToSocket(sc);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const int NumTicks = (argc > 1) ? atoi(argv[1]) : 1000000;
+    const int TicksPerCall = (argc > 2) ? atoi(argv[2]) : 500;
+    const char* CsvPath = (argc > 3 && strcmp(argv[3], "-") != 0) ? argv[3] : NULL;
+    const int TicksPerSecond = (argc > 4) ? atoi(argv[4]) : 0;
+
+    if (NumTicks <= 0 || TicksPerCall <= 0 || TicksPerSecond < 0)
+    {
+        printf("Usage: ExporterBenchmark [ticks] [ticks per call] [csv file or -] [ticks/sec]\n");
+        return 2;
+    }
+
+    const std::vector<s_TimeAndSales> Ticks = (CsvPath != NULL)
+        ? LoadCsvTicks(CsvPath, NumTicks)
+        : MakeSyntheticTicks(NumTicks, 25293.25, 0.25);
+    if (Ticks.empty())
+    {
+        printf("No ticks loaded from %s\n", CsvPath);
+        return 2;
+    }
+
+    RunConversionBenchmark(Ticks, 0.25);
+
+    WSADATA WsaData;
+    WSAStartup(MAKEWORD(2, 2), &WsaData);
+
+    TcpSink Tcp;
+    if (!Tcp.Start(BENCHMARK_PORT))
+    {
+        printf("Cannot listen on port %d\n", BENCHMARK_PORT);
+        return 2;
+    }
+
+    const BenchmarkMode Modes[] =
+    {
+        { "JSON   / TCP",           WIRE_FORMAT_JSON,   TRANSPORT_TCP,           false, TICK_COMPRESSION_NONE,   SEND_BACKEND_WINSOCK },
+        { "JSON   / TCP I/O thread", WIRE_FORMAT_JSON,  TRANSPORT_TCP,           true,  TICK_COMPRESSION_NONE,   SEND_BACKEND_WINSOCK },
+        { "Binary / TCP",           WIRE_FORMAT_BINARY, TRANSPORT_TCP,           false, TICK_COMPRESSION_NONE,   SEND_BACKEND_WINSOCK },
+        { "Binary / TCP I/O thread", WIRE_FORMAT_BINARY, TRANSPORT_TCP,          true,  TICK_COMPRESSION_NONE,   SEND_BACKEND_WINSOCK },
+        { "Binary / I/O thread IOCP", WIRE_FORMAT_BINARY, TRANSPORT_TCP,         true,  TICK_COMPRESSION_NONE,   SEND_BACKEND_IOCP },
+        { "Binary / I/O thread RIO", WIRE_FORMAT_BINARY, TRANSPORT_TCP,          true,  TICK_COMPRESSION_NONE,   SEND_BACKEND_RIO },
+        { "Varint / TCP",           WIRE_FORMAT_BINARY, TRANSPORT_TCP,           false, TICK_COMPRESSION_VARINT, SEND_BACKEND_WINSOCK },
+        { "Varint + LZ4 / TCP",     WIRE_FORMAT_BINARY, TRANSPORT_TCP,           false, TICK_COMPRESSION_LZ4,    SEND_BACKEND_WINSOCK },
+        { "Binary / shared memory", WIRE_FORMAT_BINARY, TRANSPORT_SHARED_MEMORY, false, TICK_COMPRESSION_NONE,   SEND_BACKEND_WINSOCK },
+        { "Binary / WebSocket",     WIRE_FORMAT_BINARY, TRANSPORT_WEBSOCKET,     false, TICK_COMPRESSION_NONE,   SEND_BACKEND_WINSOCK }
+    };
+
+    printf("Ticks: %d (%s), %d per study call", static_cast<int>(Ticks.size()), CsvPath != NULL ? CsvPath : "synthetic", TicksPerCall);
+    if (TicksPerSecond > 0)
+        printf(", paced at %d ticks/sec", TicksPerSecond);
+    printf("\n  %-24s %12s %10s %12s %11s %8s %9s\n", "Mode", "ticks/sec", "ns/tick", "end-to-end/s", "bytes/tick", "dropped", "sends/1k");
+
+    int Failures = 0;
+    for (size_t i = 0; i < sizeof(Modes) / sizeof(Modes[0]); i++)
+    {
+        BenchmarkResult Result;
+        if (!RunMode(Modes[i], Ticks, TicksPerCall, TicksPerSecond, Tcp, Result))
+        {
+            printf("  %-24s failed to connect\n", Modes[i].Name);
+            Failures++;
+            continue;
+        }
+
+        const double Count = static_cast<double>(Ticks.size());
+        char Sends[16] = "-";
+        if (Modes[i].BackgroundIo)
+            snprintf(Sends, sizeof(Sends), "%.2f", Result.SendCalls * 1000.0 / Count);
+
+        printf("  %-24s %12.0f %10.1f %12.0f %11.1f %8lld %9s%s\n",
+            Modes[i].Name,
+            Count / Result.StudySeconds,
+            Result.StudySeconds * 1e9 / Count,
+            Count / Result.TotalSeconds,
+            Result.Bytes / Count,
+            static_cast<long long>(Result.DroppedTicks),
+            Sends,
+            Result.Overruns > 0 ? "  (reader overrun)" : "");
+    }
+
+    Tcp.Stop();
+    WSACleanup();
+    return (Failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+// Mock sierrachart.h for the exporter benchmark
+// Stands in for the ACSIL header with just the parts TradeFlowDataExporter.cpp
+// uses, so the study function can be driven from a console program. Only the
+// behavior the exporter relies on is modelled: inputs hold their values,
+// persistent pointers persist, and log messages go to stdout when enabled.
+// Winsock and the Win32 calls are the real ones.
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#pragma comment(lib, "ws2_32.lib")
+
+#define SCDLLName(Name)
+#define SCSFExport extern "C" void
+
+enum TimeAndSalesTypeEnum
+{
+    SC_TS_MARKER = 0,
+    SC_TS_BID = 1,
+    SC_TS_ASK = 2,
+    SC_TS_BIDASK = 3
+};
+
+enum DrawStyleEnum
+{
+    DRAWSTYLE_IGNORE = 0,
+    DRAWSTYLE_LINE = 1
+};
+
+class SCString
+{
+public:
+    SCString() {}
+    SCString(const char* Text) : Value(Text != NULL ? Text : "") {}
+
+    const char* GetChars() const { return Value.c_str(); }
+    int GetLength() const { return static_cast<int>(Value.size()); }
+    operator const char*() const { return Value.c_str(); }
+
+    SCString& Format(const char* FormatString, ...)
+    {
+        char Buffer[2048];
+        va_list Args;
+        va_start(Args, FormatString);
+        vsnprintf(Buffer, sizeof(Buffer), FormatString, Args);
+        va_end(Args);
+        Value = Buffer;
+        return *this;
+    }
+
+private:
+    std::string Value;
+};
+
+// Days since 1899-12-30, as in Sierra Chart
+// Held as whole microseconds, like the real class
+class SCDateTime
+{
+public:
+    SCDateTime() : Microseconds(0) {}
+    SCDateTime(double NewDays) : Microseconds(std::llround(NewDays * 86400000000.0)) {}
+
+    static SCDateTime FromUnixMilliseconds(int64_t Milliseconds)
+    {
+        SCDateTime DateTime;
+        DateTime.Microseconds = (25569LL * 86400000LL + Milliseconds) * 1000;
+        return DateTime;
+    }
+
+    double GetAsDouble() const { return Microseconds / 86400000000.0; }
+
+    int GetDate() const { return static_cast<int>(Microseconds / 86400000000LL); }
+    int GetTimeInSeconds() const { return static_cast<int>(Microseconds % 86400000000LL / 1000000); }
+    int GetMillisecond() const { return static_cast<int>(Microseconds % 1000000 / 1000); }
+    int GetMicrosecond() const { return static_cast<int>(Microseconds % 1000); }
+
+private:
+    int64_t Microseconds;
+};
+
+struct s_TimeAndSales
+{
+    int Type;
+    float Price;
+    unsigned int Volume;
+    SCDateTime DateTime;
+    int64_t Sequence;
+    float Bid;
+    float Ask;
+    unsigned int BidSize;
+    unsigned int AskSize;
+};
+
+// A view of the chart's records, like the real array (no copy)
+class c_SCTimeAndSalesArray
+{
+public:
+    c_SCTimeAndSalesArray() : Records(NULL) {}
+
+    int Size() const { return (Records != NULL) ? static_cast<int>(Records->size()) : 0; }
+    const s_TimeAndSales& operator[](int Index) const { return (*Records)[Index]; }
+
+    const std::vector<s_TimeAndSales>* Records;
+};
+
+class s_SCInput
+{
+public:
+    s_SCInput() : IntValue(0), FloatValue(0.0f) {}
+
+    SCString Name;
+
+    void SetYesNo(int Value) { IntValue = Value; }
+    int GetYesNo() const { return IntValue; }
+    void SetInt(int Value) { IntValue = Value; }
+    int GetInt() const { return IntValue; }
+    void SetIntLimits(int, int) {}
+    void SetFloat(float Value) { FloatValue = Value; }
+    float GetFloat() const { return FloatValue; }
+    void SetString(const char* Value) { StringValue = Value; }
+    const char* GetString() const { return StringValue.c_str(); }
+    void SetCustomInputStrings(const char*) {}
+    void SetCustomInputIndex(int Index) { IntValue = Index; }
+    int GetIndex() const { return IntValue; }
+    void SetDescription(const char*) {}
+
+private:
+    int IntValue;
+    float FloatValue;
+    std::string StringValue;
+};
+
+typedef s_SCInput& SCInputRef;
+
+class s_SCSubgraph
+{
+public:
+    s_SCSubgraph() : DrawStyle(DRAWSTYLE_LINE) {}
+
+    SCString Name;
+    int DrawStyle;
+
+    float& operator[](int Index)
+    {
+        if (Index >= static_cast<int>(Data.size()))
+            Data.resize(Index + 1, 0.0f);
+        return Data[Index];
+    }
+
+private:
+    std::vector<float> Data;
+};
+
+typedef s_SCSubgraph& SCSubgraphRef;
+
+class s_sc
+{
+public:
+    s_sc()
+        : SetDefaults(0), LastCallToFunction(0), GraphRegion(0), AutoLoop(1), UpdateAlways(0), FreeDLL(0)
+        , ReplayStatus(0), TickSize(0.25f), ValueFormat(2), ArraySize(1), LogMessages(false)
+    {
+        for (int i = 0; i < 64; i++)
+            PersistentPointers[i] = NULL;
+    }
+
+    int SetDefaults;
+    int LastCallToFunction;
+    SCString GraphName;
+    SCString StudyDescription;
+    int GraphRegion;
+    int AutoLoop;
+    int UpdateAlways;
+    int FreeDLL;
+    int ReplayStatus;
+    float TickSize;
+    int ValueFormat;
+    int ArraySize;
+    SCDateTime CurrentDateTimeForReplay;
+
+    s_SCInput Input[64];
+    s_SCSubgraph Subgraph[64];
+
+    // Benchmark side: what the study sees
+    SCString Symbol;
+    std::vector<s_TimeAndSales> TimeAndSales;
+    bool LogMessages;
+
+    SCString GetRealTimeSymbol() const { return Symbol; }
+    void GetTimeAndSales(c_SCTimeAndSalesArray& Out) const { Out.Records = &TimeAndSales; }
+
+    // Sessions run midnight to midnight
+    int GetTradingDayDate(const SCDateTime& DateTime) const { return DateTime.GetDate(); }
+    SCDateTime GetStartDateTimeForTradingDate(int TradingDate) const { return SCDateTime(static_cast<double>(TradingDate)); }
+
+    void* GetPersistentPointer(int Key) const { return PersistentPointers[Key]; }
+    void SetPersistentPointer(int Key, void* Pointer) { PersistentPointers[Key] = Pointer; }
+
+    void AddMessageToLog(const char* Message, int ShowLog)
+    {
+        if (LogMessages)
+            printf("  [log%s] %s\n", ShowLog ? " !" : "", Message);
+    }
+
+private:
+    void* PersistentPointers[64];
+};
+
+typedef s_sc& SCStudyInterfaceRef;
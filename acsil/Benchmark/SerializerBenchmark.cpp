@@ -0,0 +1,120 @@
+// Serializer benchmark
+// Compares the TickJsonSerializer hot path against the sprintf_s formatting it
+// replaced, writing synthetic ticks into a reused batch buffer.
+// Build: see "Benchmark Build.txt". Run: SerializerBenchmark [ticks]
+
+#include "../TradeFlowSerializer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifndef _MSC_VER
+#define sprintf_s snprintf
+#endif
+
+struct SyntheticTick
+{
+    int64_t Sequence;
+    int64_t TimestampMs;
+    double Price;
+    uint32_t Volume;
+    bool IsAsk;
+};
+
+static std::vector<SyntheticTick> MakeTicks(int Count, double BasePrice, double TickSize)
+{
+    std::vector<SyntheticTick> Ticks(Count);
+    uint32_t Seed = 12345;
+    int64_t PriceTicks = static_cast<int64_t>(BasePrice / TickSize);
+    int64_t TimestampMs = 1703001600000LL;
+
+    for (int i = 0; i < Count; i++)
+    {
+        Seed = Seed * 1664525u + 1013904223u;
+        PriceTicks += static_cast<int>((Seed >> 16) % 3) - 1;
+        TimestampMs += (Seed >> 8) % 4;
+
+        Ticks[i].Sequence = i + 1;
+        Ticks[i].TimestampMs = TimestampMs;
+        Ticks[i].Price = PriceTicks * TickSize;
+        Ticks[i].Volume = 1 + (Seed >> 4) % 40;
+        Ticks[i].IsAsk = (Seed & 1) != 0;
+    }
+
+    return Ticks;
+}
+
+// The formatting used by the exporter before TickJsonSerializer
+static int FormatWithSprintf(char* Buffer, int BufferSize, const SyntheticTick& Tick, const char* Symbol)
+{
+    int len = sprintf_s(Buffer, BufferSize,
+                       "{\"seq\":%d,\"ts\":%lld,\"p\":%.2f,\"v\":%u,\"s\":\"%s\",\"sym\":\"%s\"}\n",
+                       static_cast<int>(Tick.Sequence),
+                       static_cast<long long>(Tick.TimestampMs),
+                       Tick.Price,
+                       Tick.Volume,
+                       Tick.IsAsk ? "ASK" : "BID",
+                       Symbol);
+
+    return (len > 0) ? len : 0;
+}
+
+template <typename FormatFn>
+static double MeasureNsPerTick(const std::vector<SyntheticTick>& Ticks, int Passes, std::vector<char>& Batch, size_t& BytesOut, FormatFn Format)
+{
+    double Best = 1e30;
+
+    for (int Pass = 0; Pass < Passes; Pass++)
+    {
+        size_t Length = 0;
+        const auto Start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < Ticks.size(); i++)
+            Length += Format(Batch.data() + Length, Ticks[i]);
+
+        const auto End = std::chrono::steady_clock::now();
+        const double Ns = std::chrono::duration<double, std::nano>(End - Start).count() / Ticks.size();
+        if (Ns < Best)
+            Best = Ns;
+
+        BytesOut = Length;
+    }
+
+    return Best;
+}
+
+int main(int argc, char** argv)
+{
+    const int NumTicks = (argc > 1) ? atoi(argv[1]) : 1000000;
+    const int Passes = 5;
+    const char* Symbol = "NQH6.CME";
+    const double TickSize = 0.25;
+
+    const std::vector<SyntheticTick> Ticks = MakeTicks(NumTicks, 25293.25, TickSize);
+    std::vector<char> Batch(static_cast<size_t>(NumTicks) * MAX_JSON_TICK_LENGTH);
+    std::vector<char> Reference(Batch.size());
+
+    TickJsonSerializer Serializer;
+    Serializer.Configure(Symbol, TickSize, 2);
+
+    size_t SprintfBytes = 0;
+    const double SprintfNs = MeasureNsPerTick(Ticks, Passes, Reference, SprintfBytes,
+        [&](char* Out, const SyntheticTick& Tick) { return FormatWithSprintf(Out, MAX_JSON_TICK_LENGTH, Tick, Symbol); });
+
+    size_t SerializerBytes = 0;
+    const double SerializerNs = MeasureNsPerTick(Ticks, Passes, Batch, SerializerBytes,
+        [&](char* Out, const SyntheticTick& Tick) { return Serializer.Write(Out, Tick.Sequence, Tick.TimestampMs * 1000, Tick.Price, Tick.Volume, Tick.IsAsk, 1); });
+
+    // With 2 decimals both paths must produce identical bytes
+    const bool Identical = (SprintfBytes == SerializerBytes) && memcmp(Reference.data(), Batch.data(), SprintfBytes) == 0;
+
+    printf("Ticks: %d, best of %d passes\n", NumTicks, Passes);
+    printf("  sprintf_s          %8.1f ns/tick  %6.1f bytes/tick\n", SprintfNs, static_cast<double>(SprintfBytes) / NumTicks);
+    printf("  TickJsonSerializer %8.1f ns/tick  %6.1f bytes/tick\n", SerializerNs, static_cast<double>(SerializerBytes) / NumTicks);
+    printf("  Speedup            %8.2fx\n", SprintfNs / SerializerNs);
+    printf("  Output identical:  %s\n", Identical ? "yes" : "NO");
+
+    return Identical ? 0 : 1;
+}
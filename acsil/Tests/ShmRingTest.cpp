@@ -0,0 +1,204 @@
+// Shared-memory ring test
+// Writes frames with ShmRingWriter and reads them back with ShmRingReader
+// over one block of memory, as the exporter and a consumer do through the
+// mapping: layout, wrap-around, overruns, a writer restart and definitions.
+// Build: see "Tests Build.txt". Run: ShmRingTest (exit code 0 on success)
+
+#include "../TradeFlowShm.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static int Failures = 0;
+
+static void Check(bool Condition, const char* What)
+{
+    if (!Condition)
+    {
+        printf("FAILED: %s\n", What);
+        Failures++;
+    }
+}
+
+static const uint64_t DATA_CAPACITY = 64 * 1024;
+
+alignas(64) static char Memory[SHM_HEADER_SIZE + SHM_DEFINITIONS_CAPACITY + DATA_CAPACITY];
+
+static ShmRingHeader* Header() { return reinterpret_cast<ShmRingHeader*>(Memory); }
+
+// A frame of Length bytes whose contents depend on Seed
+static std::vector<char> MakeFrame(size_t Length, int Seed)
+{
+    std::vector<char> Frame(Length);
+    for (size_t i = 0; i < Length; i++)
+        Frame[i] = static_cast<char>((Seed * 131 + i * 7) & 0xFF);
+    return Frame;
+}
+
+// Reads everything available, ChunkLength bytes at a time
+static int ReadAll(ShmRingReader& Reader, std::vector<char>& Out, size_t ChunkLength)
+{
+    std::vector<char> Chunk(ChunkLength);
+    for (;;)
+    {
+        size_t Length;
+        const int Result = Reader.Read(Chunk.data(), Chunk.size(), Length);
+        if (Result != SHM_READ_DATA)
+            return Result;
+        Out.insert(Out.end(), Chunk.begin(), Chunk.begin() + Length);
+    }
+}
+
+static void Layout()
+{
+    Check(ShmRingDataCapacity(1) == 64 * 1024, "the data area is at least 64 KB");
+    Check(ShmRingDataCapacity(64 * 1024 + 1) == 128 * 1024, "the data area is a power of two");
+    Check(ShmRingMappingSize(DATA_CAPACITY) == sizeof(Memory), "mapping size");
+
+    memset(Memory, 0, sizeof(Memory));
+    ShmRingReader Early;
+    Check(!Early.Attach(Memory), "a reader cannot attach before the ring is formatted");
+
+    ShmRingWriter Writer;
+    Writer.Initialize(Memory, DATA_CAPACITY);
+    Check(Header()->Magic == SHM_MAGIC && Header()->Version == SHM_VERSION, "magic and version");
+    Check(Header()->WireVersion == WIRE_VERSION, "wire version");
+    Check(Header()->HeaderSize == SHM_HEADER_SIZE && Header()->DefinitionsCapacity == SHM_DEFINITIONS_CAPACITY, "area sizes");
+    Check(Header()->DataCapacity == DATA_CAPACITY, "data capacity");
+
+    // The data area follows the definitions area
+    const char Frame[] = "frame";
+    Writer.Publish(Frame, sizeof(Frame));
+    Check(memcmp(Memory + SHM_HEADER_SIZE + SHM_DEFINITIONS_CAPACITY, Frame, sizeof(Frame)) == 0, "frames start after the definitions");
+    Check(Header()->WriteCursor.load() == sizeof(Frame) && Header()->FrameCount.load() == 1, "cursor and frame count");
+
+    ShmRingReader Reader;
+    Check(Reader.Attach(Memory), "a reader attaches to a formatted ring");
+    Check(Reader.Lag() == 0, "a new reader starts at the latest frame");
+}
+
+static void RoundTripWithWrap()
+{
+    ShmRingWriter Writer;
+    Writer.Initialize(Memory, DATA_CAPACITY);
+    ShmRingReader Reader;
+    Check(Reader.Attach(Memory), "attach");
+
+    // Several laps of frames of uneven sizes, read in chunks that split them
+    std::vector<char> Expected;
+    std::vector<char> Received;
+    for (int Round = 0; Round < 40; Round++)
+    {
+        for (int i = 0; i < 7; i++)
+        {
+            const std::vector<char> Frame = MakeFrame(1000 + Round * 37 + i * 101, Round * 7 + i);
+            Writer.Publish(Frame.data(), Frame.size());
+            Expected.insert(Expected.end(), Frame.begin(), Frame.end());
+        }
+        Check(ReadAll(Reader, Received, 3000) == SHM_READ_EMPTY, "reads until nothing is new");
+    }
+
+    Check(Expected.size() > 4 * DATA_CAPACITY, "the writer wrapped several times");
+    Check(Received == Expected, "every byte comes back in order across wraps");
+    Check(Reader.Overruns() == 0, "no overruns while the reader keeps up");
+}
+
+static void Overrun()
+{
+    ShmRingWriter Writer;
+    Writer.Initialize(Memory, DATA_CAPACITY);
+    ShmRingReader Reader;
+    Check(Reader.Attach(Memory), "attach");
+
+    // Exactly one lap behind can still be read
+    const std::vector<char> Frame = MakeFrame(DATA_CAPACITY / 4, 1);
+    for (int i = 0; i < 4; i++)
+        Writer.Publish(Frame.data(), Frame.size());
+    Check(Reader.Lag() == DATA_CAPACITY, "a full lap behind");
+
+    std::vector<char> Buffer(DATA_CAPACITY);
+    size_t Length;
+    Check(Reader.Read(Buffer.data(), Buffer.size(), Length) == SHM_READ_DATA && Length == DATA_CAPACITY, "a full lap is readable");
+
+    // More than a lap behind: frames were lost
+    for (int i = 0; i < 5; i++)
+        Writer.Publish(Frame.data(), Frame.size());
+    Check(Reader.Read(Buffer.data(), Buffer.size(), Length) == SHM_READ_OVERRUN, "lapped reader sees an overrun");
+    Check(Reader.Overruns() == 1 && Reader.Lag() == 0, "and moves to the latest frame");
+
+    // A full lap behind while the writer has begun the next frame: the copy
+    // may hold half-overwritten bytes, so it is refused
+    for (int i = 0; i < 4; i++)
+        Writer.Publish(Frame.data(), Frame.size());
+    Header()->ReserveCursor.store(Header()->WriteCursor.load() + 16);
+    Check(Reader.Read(Buffer.data(), Buffer.size(), Length) == SHM_READ_OVERRUN, "a copy the writer is overwriting is refused");
+    Check(Reader.Overruns() == 2, "counted as an overrun");
+
+    // Frames larger than the ring are never published
+    const std::vector<char> Huge = MakeFrame(DATA_CAPACITY + 1, 2);
+    const uint64_t Before = Header()->WriteCursor.load();
+    Writer.Publish(Huge.data(), Huge.size());
+    Check(Header()->WriteCursor.load() == Before, "a frame bigger than the ring is skipped");
+}
+
+static void WriterRestart()
+{
+    ShmRingWriter Writer;
+    Writer.Initialize(Memory, DATA_CAPACITY);
+    ShmRingReader Reader;
+    Check(Reader.Attach(Memory), "attach");
+
+    const std::vector<char> Frame = MakeFrame(4000, 3);
+    Writer.Publish(Frame.data(), Frame.size());
+    std::vector<char> Received;
+    ReadAll(Reader, Received, 4096);
+
+    // A new writer formats the ring again under the attached reader
+    ShmRingWriter NewWriter;
+    NewWriter.Initialize(Memory, DATA_CAPACITY);
+    NewWriter.Publish(Frame.data(), 100);
+
+    char Buffer[4096];
+    size_t Length;
+    Check(Reader.Read(Buffer, sizeof(Buffer), Length) == SHM_READ_RESET, "the reader notices the new writer");
+
+    NewWriter.Publish(Frame.data(), Frame.size());
+    Check(Reader.Read(Buffer, sizeof(Buffer), Length) == SHM_READ_DATA && Length == Frame.size()
+        && memcmp(Buffer, Frame.data(), Length) == 0, "and follows it from there");
+}
+
+static void Definitions()
+{
+    ShmRingWriter Writer;
+    Writer.Initialize(Memory, DATA_CAPACITY);
+    ShmRingReader Reader;
+    Check(Reader.Attach(Memory), "attach");
+
+    static char Copy[SHM_DEFINITIONS_CAPACITY];
+    Check(Reader.CopyDefinitions(Copy) == 0, "no definitions yet");
+
+    const std::vector<char> First = MakeFrame(300, 4);
+    const std::vector<char> Second = MakeFrame(120, 5);
+    Check(Writer.SetDefinitions(First.data(), First.size()), "definitions fit");
+    Check(Reader.CopyDefinitions(Copy) == First.size() && memcmp(Copy, First.data(), First.size()) == 0, "definitions come back");
+    Check(Writer.SetDefinitions(Second.data(), Second.size()), "replaced");
+    Check(Reader.CopyDefinitions(Copy) == Second.size() && memcmp(Copy, Second.data(), Second.size()) == 0, "the latest definitions come back");
+    Check((Header()->DefinitionsSequence.load() & 1) == 0, "the seqlock is even between updates");
+
+    const std::vector<char> TooBig = MakeFrame(SHM_DEFINITIONS_CAPACITY + 1, 6);
+    Check(!Writer.SetDefinitions(TooBig.data(), TooBig.size()), "definitions larger than the area are refused");
+}
+
+int main()
+{
+    Layout();
+    RoundTripWithWrap();
+    Overrun();
+    WriterRestart();
+    Definitions();
+
+    if (Failures == 0)
+        printf("ShmRingTest: all checks passed\n");
+    return (Failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+// Trade event detector test
+// Feeds TradeEventDetector the way the exporter does, one chart update at a
+// time, and checks that a sweep split across updates is reported once, whole.
+// Build: see "Tests Build.txt". Run: TradeEventTest (exit code 0 on success)
+
+#include "../TradeFlowEvents.h"
+
+#include <cstdio>
+
+static int Failures = 0;
+
+static void Check(bool Condition, const char* What)
+{
+    if (!Condition)
+    {
+        printf("FAILED: %s\n", What);
+        Failures++;
+    }
+}
+
+static TradeEventDetector MakeDetector()
+{
+    TradeEventConfig Config;
+    Config.MinLevels = 5;
+    Config.MinSweepVolume = 0;
+    Config.MinBlockVolume = 0;
+    Config.WindowMicros = 100000;
+
+    TradeEventDetector Detector;
+    Detector.Configure(Config);
+    return Detector;
+}
+
+// One chart update: adds the trades, then expires at the update's clock as
+// the exporter does. Returns the number of events reported.
+static int Process(TradeEventDetector& Detector, const int64_t* Times, const int32_t* Prices, int Count, int64_t NowMicros,
+    TradeEvent& Event)
+{
+    int Events = 0;
+    for (int i = 0; i < Count; i++)
+    {
+        if (Detector.Add(Times[i], Prices[i], 10, true, Event))
+            Events++;
+    }
+    if (Detector.Expire(NowMicros, Event))
+        Events++;
+    return Events;
+}
+
+static void SweepSplitAcrossUpdates()
+{
+    TradeEventDetector Detector = MakeDetector();
+    TradeEvent Event;
+
+    // Five ask levels, three in one update and two in the next
+    const int64_t FirstTimes[] = { 1000000, 1001000, 1002000 };
+    const int32_t FirstPrices[] = { 100, 101, 102 };
+    Check(Process(Detector, FirstTimes, FirstPrices, 3, 1002000, Event) == 0, "no event after the first part of the sweep");
+
+    const int64_t SecondTimes[] = { 1010000, 1011000 };
+    const int32_t SecondPrices[] = { 103, 104 };
+    Check(Process(Detector, SecondTimes, SecondPrices, 2, 1011000, Event) == 0, "no event while the sweep can still extend");
+
+    // No more trades; the next update comes after the window has passed
+    Check(Process(Detector, NULL, NULL, 0, 1150000, Event) == 1, "the sweep is reported once its window has passed");
+    Check(Event.Kind == WIRE_TRADE_EVENT_SWEEP, "reported as a sweep");
+    Check(Event.Levels == 5, "all five levels");
+    Check(Event.Volume == 50, "all the volume");
+    Check(Event.Prints == 5, "all five prints");
+    Check(Event.FirstPriceTicks == 100 && Event.LastPriceTicks == 104, "first and last price");
+    Check(Event.LastMicros - Event.FirstMicros == 11000, "the whole duration");
+
+    Check(Process(Detector, NULL, NULL, 0, 1300000, Event) == 0, "reported only once");
+}
+
+static void SweepEndedByTrade()
+{
+    TradeEventDetector Detector = MakeDetector();
+    TradeEvent Event;
+
+    const int64_t FirstTimes[] = { 2000000, 2001000 };
+    const int32_t FirstPrices[] = { 200, 201 };
+    Check(Process(Detector, FirstTimes, FirstPrices, 2, 2001000, Event) == 0, "no event after two levels");
+
+    // Three more levels, then a trade back down that ends the run
+    const int64_t SecondTimes[] = { 2002000, 2003000, 2004000, 2005000 };
+    const int32_t SecondPrices[] = { 202, 203, 204, 203 };
+    Check(Process(Detector, SecondTimes, SecondPrices, 4, 2005000, Event) == 1, "the breaking trade reports the sweep");
+    Check(Event.Levels == 5 && Event.Prints == 5 && Event.Volume == 50, "the sweep is whole");
+}
+
+static void ShortRunExpiresQuietly()
+{
+    TradeEventDetector Detector = MakeDetector();
+    TradeEvent Event;
+
+    const int64_t Times[] = { 3000000, 3001000 };
+    const int32_t Prices[] = { 300, 301 };
+    Check(Process(Detector, Times, Prices, 2, 3200000, Event) == 0, "a run short of the levels is not reported");
+}
+
+int main()
+{
+    SweepSplitAcrossUpdates();
+    SweepEndedByTrade();
+    ShortRunExpiresQuietly();
+
+    if (Failures == 0)
+        printf("TradeEventTest: all checks passed\n");
+    return (Failures == 0) ? 0 : 1;
+}
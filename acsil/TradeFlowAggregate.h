@@ -0,0 +1,176 @@
+// TradeFlowAggregate.h
+// Incremental rolling-window trade aggregates for the TradeFlow exporter.
+// Keeps buy/sell volume and counts over several windows at once (for example
+// 200 ms, 1 s and 5 s) with O(1) amortized work per trade, so consumers can
+// read a few aggregate frames per second instead of rescanning every trade.
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+struct AggregateTotals
+{
+    int64_t BidVolume;
+    int64_t AskVolume;
+    uint32_t BidTicks;
+    uint32_t AskTicks;
+};
+
+// Parses a comma separated list of window lengths in milliseconds. Invalid
+// or non-positive entries are skipped. Returns the number stored in Out.
+inline int ParseWindowList(const char* Text, int* Out, int MaxWindows)
+{
+    int Count = 0;
+    const char* p = Text;
+
+    while (p != NULL && *p != '\0' && Count < MaxWindows)
+    {
+        char* End = NULL;
+        const long Value = strtol(p, &End, 10);
+        if (End == p)
+        {
+            p++;
+            continue;
+        }
+
+        if (Value > 0 && Value <= 24L * 60 * 60 * 1000)
+            Out[Count++] = static_cast<int>(Value);
+
+        p = End;
+    }
+
+    return Count;
+}
+
+// One ring of recent trades shared by every window. Each window keeps the
+// absolute index of its oldest trade and running totals; adding a trade
+// updates every window, and expiry only ever moves a window's start forward.
+class RollingAggregator
+{
+public:
+    static const int MAX_WINDOWS = 8;
+
+    RollingAggregator() : WindowCount(0), Added(0), Stored(0) {}
+
+    // MaxTrades bounds memory; when more trades than that fall inside the
+    // longest window the oldest are evicted early, as the JS engines'
+    // maxWindowTrades cap does.
+    void Configure(const int* NewWindowsMs, int Count, size_t MaxTrades)
+    {
+        WindowCount = (Count < MAX_WINDOWS) ? Count : MAX_WINDOWS;
+        for (int i = 0; i < WindowCount; i++)
+            Windows[i].LengthMs = NewWindowsMs[i];
+
+        Trades.assign(MaxTrades > 0 ? MaxTrades : 1, Trade());
+        Reset();
+    }
+
+    void Reset()
+    {
+        Added = 0;
+        Stored = 0;
+        for (int i = 0; i < WindowCount; i++)
+        {
+            Windows[i].Start = 0;
+            Windows[i].Totals = AggregateTotals();
+        }
+    }
+
+    int GetWindowCount() const { return WindowCount; }
+    int GetWindowMs(int Index) const { return Windows[Index].LengthMs; }
+    const AggregateTotals& GetTotals(int Index) const { return Windows[Index].Totals; }
+
+    void Add(int64_t TimestampMs, uint32_t Volume, bool IsAsk)
+    {
+        const size_t Capacity = Trades.size();
+
+        if (Stored == Capacity)
+        {
+            const uint64_t Oldest = Added - Capacity;
+            for (int i = 0; i < WindowCount; i++)
+            {
+                if (Windows[i].Start == Oldest)
+                    Evict(Windows[i]);
+            }
+            Stored--;
+        }
+
+        Trade& Entry = Trades[static_cast<size_t>(Added % Capacity)];
+        Entry.TimestampMs = TimestampMs;
+        Entry.Volume = Volume;
+        Entry.IsAsk = IsAsk;
+        Added++;
+        Stored++;
+
+        for (int i = 0; i < WindowCount; i++)
+        {
+            AggregateTotals& Totals = Windows[i].Totals;
+            if (IsAsk)
+            {
+                Totals.AskVolume += Volume;
+                Totals.AskTicks++;
+            }
+            else
+            {
+                Totals.BidVolume += Volume;
+                Totals.BidTicks++;
+            }
+        }
+
+        Advance(TimestampMs);
+    }
+
+    // Expires trades older than each window as of NowMs
+    void Advance(int64_t NowMs)
+    {
+        const size_t Capacity = Trades.size();
+
+        for (int i = 0; i < WindowCount; i++)
+        {
+            Window& Current = Windows[i];
+            const int64_t Cutoff = NowMs - Current.LengthMs;
+            while (Current.Start < Added && Trades[static_cast<size_t>(Current.Start % Capacity)].TimestampMs < Cutoff)
+                Evict(Current);
+        }
+    }
+
+private:
+    struct Trade
+    {
+        int64_t TimestampMs;
+        uint32_t Volume;
+        bool IsAsk;
+    };
+
+    struct Window
+    {
+        int LengthMs;
+        uint64_t Start;         // Absolute index of the oldest trade in the window
+        AggregateTotals Totals;
+    };
+
+    void Evict(Window& Current)
+    {
+        const Trade& Oldest = Trades[static_cast<size_t>(Current.Start % Trades.size())];
+        if (Oldest.IsAsk)
+        {
+            Current.Totals.AskVolume -= Oldest.Volume;
+            Current.Totals.AskTicks--;
+        }
+        else
+        {
+            Current.Totals.BidVolume -= Oldest.Volume;
+            Current.Totals.BidTicks--;
+        }
+        Current.Start++;
+    }
+
+    Window Windows[MAX_WINDOWS];
+    int WindowCount;
+    std::vector<Trade> Trades;
+    uint64_t Added;     // Trades added since Reset(); the next absolute index
+    size_t Stored;      // Trades still held in the ring
+};
@@ -0,0 +1,403 @@
+// TradeFlowBatch.h
+// Batch conversion of Time & Sales records. The exporter gathers each run of
+// new records into the struct-of-arrays scratch buffers of a RecordBatch and
+// converts the run in one pass per field: date-time parts to Unix
+// microseconds, prices to ticks and record types to trade/side flags. The
+// kernels come as scalar code, SSE2 and AVX2 on x64 and NEON on ARM64, and
+// are picked at runtime. Every kernel gives exactly the results of the
+// per-record conversions (UnixTimeConverter, PriceToTicks).
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <cstdint>
+
+#include "TradeFlowWire.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define TRADEFLOW_BATCH_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TRADEFLOW_TARGET_AVX2
+#else
+#define TRADEFLOW_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define TRADEFLOW_BATCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+enum ConversionKernelEnum
+{
+    CONVERSION_KERNEL_AUTO = 0,     // Best the processor supports
+    CONVERSION_KERNEL_SCALAR = 1,
+    CONVERSION_KERNEL_SSE2 = 2,     // Any x64 processor
+    CONVERSION_KERNEL_AVX2 = 3,     // x64 with AVX2
+    CONVERSION_KERNEL_NEON = 4      // Any ARM64 processor
+};
+
+// Flags of a converted record
+static const uint8_t RECORD_TRADE = 1;      // Bid or ask trade
+static const uint8_t RECORD_ASK = 2;        // Ask trade (RECORD_TRADE is set too)
+
+// Sierra Chart dates count days from 1899-12-30; the Unix epoch is day 25569
+static const uint32_t BATCH_UNIX_EPOCH_DATE = 25569;
+static const int64_t BATCH_MICROS_PER_DAY = 86400000000LL;
+
+// 86400000000 = 84375000 << 10, so a day's microseconds are a 32-bit
+// multiply and a shift
+static const uint32_t BATCH_DAY_MULTIPLIER = 84375000;
+static const int BATCH_DAY_SHIFT = 10;
+
+inline const char* ConversionKernelName(int Kernel)
+{
+    switch (Kernel)
+    {
+    case CONVERSION_KERNEL_SSE2: return "SSE2";
+    case CONVERSION_KERNEL_AVX2: return "AVX2";
+    case CONVERSION_KERNEL_NEON: return "NEON";
+    default: return "scalar";
+    }
+}
+
+inline bool ProcessorHasAvx2()
+{
+#if defined(TRADEFLOW_BATCH_X64) && defined(_MSC_VER)
+    int Info[4];
+    __cpuid(Info, 0);
+    if (Info[0] < 7)
+        return false;
+
+    // AVX2 needs the OS to save the YMM registers as well
+    __cpuid(Info, 1);
+    const bool OsSavesYmm = (Info[2] & (1 << 27)) != 0 && (Info[2] & (1 << 28)) != 0
+        && (_xgetbv(0) & 6) == 6;
+
+    __cpuidex(Info, 7, 0);
+    return OsSavesYmm && (Info[1] & (1 << 5)) != 0;
+#elif defined(TRADEFLOW_BATCH_X64)
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+// The kernel to use for Requested: itself when this build and processor
+// support it, otherwise the best one that is
+inline int ResolveConversionKernel(int Requested)
+{
+#if defined(TRADEFLOW_BATCH_X64)
+    static const bool HasAvx2 = ProcessorHasAvx2();
+    if (Requested == CONVERSION_KERNEL_SCALAR || Requested == CONVERSION_KERNEL_SSE2)
+        return Requested;
+    return HasAvx2 ? CONVERSION_KERNEL_AVX2 : CONVERSION_KERNEL_SSE2;
+#elif defined(TRADEFLOW_BATCH_NEON)
+    return (Requested == CONVERSION_KERNEL_SCALAR) ? CONVERSION_KERNEL_SCALAR : CONVERSION_KERNEL_NEON;
+#else
+    (void)Requested;
+    return CONVERSION_KERNEL_SCALAR;
+#endif
+}
+
+// Scalar kernels; the vector kernels finish their last few records here
+
+inline void ConvertTimesScalar(const uint32_t* Dates, const uint32_t* Seconds, const uint32_t* SubMicros, int64_t* Micros, int Begin, int End)
+{
+    for (int i = Begin; i < End; i++)
+    {
+        Micros[i] = (static_cast<int64_t>(Dates[i]) - BATCH_UNIX_EPOCH_DATE) * BATCH_MICROS_PER_DAY
+            + static_cast<int64_t>(Seconds[i]) * 1000000 + SubMicros[i];
+    }
+}
+
+inline void ConvertPricesScalar(const double* Prices, double TickSize, int32_t* Ticks, int Begin, int End)
+{
+    for (int i = Begin; i < End; i++)
+        Ticks[i] = PriceToTicks(Prices[i], TickSize);
+}
+
+inline void ConvertTypesScalar(const int32_t* Types, int32_t BidType, int32_t AskType, uint8_t* Flags, int Begin, int End)
+{
+    for (int i = Begin; i < End; i++)
+    {
+        const int32_t Type = Types[i];
+        Flags[i] = (Type == AskType) ? (RECORD_TRADE | RECORD_ASK) : (Type == BidType) ? RECORD_TRADE : 0;
+    }
+}
+
+#if defined(TRADEFLOW_BATCH_X64)
+
+// Date-times in unsigned 64-bit lanes; the epoch offset is taken off last,
+// so dates before 1970 come out negative as in the scalar code
+inline void ConvertTimesSse2(const uint32_t* Dates, const uint32_t* Seconds, const uint32_t* SubMicros, int64_t* Micros, int Count)
+{
+    const __m128i Zero = _mm_setzero_si128();
+    const __m128i DayMultiplier = _mm_set1_epi64x(BATCH_DAY_MULTIPLIER);
+    const __m128i SecondMultiplier = _mm_set1_epi64x(1000000);
+    const __m128i EpochOffset = _mm_set1_epi64x(BATCH_UNIX_EPOCH_DATE * BATCH_MICROS_PER_DAY);
+
+    int i = 0;
+    for (; i + 4 <= Count; i += 4)
+    {
+        const __m128i D = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Dates + i));
+        const __m128i S = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Seconds + i));
+        const __m128i U = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SubMicros + i));
+
+        __m128i Lo = _mm_slli_epi64(_mm_mul_epu32(_mm_unpacklo_epi32(D, Zero), DayMultiplier), BATCH_DAY_SHIFT);
+        Lo = _mm_add_epi64(Lo, _mm_mul_epu32(_mm_unpacklo_epi32(S, Zero), SecondMultiplier));
+        Lo = _mm_sub_epi64(_mm_add_epi64(Lo, _mm_unpacklo_epi32(U, Zero)), EpochOffset);
+
+        __m128i Hi = _mm_slli_epi64(_mm_mul_epu32(_mm_unpackhi_epi32(D, Zero), DayMultiplier), BATCH_DAY_SHIFT);
+        Hi = _mm_add_epi64(Hi, _mm_mul_epu32(_mm_unpackhi_epi32(S, Zero), SecondMultiplier));
+        Hi = _mm_sub_epi64(_mm_add_epi64(Hi, _mm_unpackhi_epi32(U, Zero)), EpochOffset);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Micros + i), Lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Micros + i + 2), Hi);
+    }
+
+    ConvertTimesScalar(Dates, Seconds, SubMicros, Micros, i, Count);
+}
+
+// Rounds half away from zero like llround: truncate, then step one tick
+// when the fraction left is at least a half. Exact for prices within 2^31
+// ticks.
+inline void ConvertPricesSse2(const double* Prices, double TickSize, int32_t* Ticks, int Count)
+{
+    const __m128d Divisor = _mm_set1_pd(TickSize > 0.0 ? TickSize : 1.0);
+    const __m128d Half = _mm_set1_pd(0.5);
+    const __m128d MinusHalf = _mm_set1_pd(-0.5);
+    const __m128d One = _mm_set1_pd(1.0);
+
+    int i = 0;
+    for (; i + 2 <= Count; i += 2)
+    {
+        const __m128d Quotient = _mm_div_pd(_mm_loadu_pd(Prices + i), Divisor);
+        const __m128d Truncated = _mm_cvtepi32_pd(_mm_cvttpd_epi32(Quotient));
+        const __m128d Fraction = _mm_sub_pd(Quotient, Truncated);
+        const __m128d Step = _mm_sub_pd(_mm_and_pd(_mm_cmpge_pd(Fraction, Half), One), _mm_and_pd(_mm_cmple_pd(Fraction, MinusHalf), One));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(Ticks + i), _mm_cvttpd_epi32(_mm_add_pd(Truncated, Step)));
+    }
+
+    ConvertPricesScalar(Prices, TickSize, Ticks, i, Count);
+}
+
+inline void ConvertTypesSse2(const int32_t* Types, int32_t BidType, int32_t AskType, uint8_t* Flags, int Count)
+{
+    const __m128i Bid = _mm_set1_epi32(BidType);
+    const __m128i Ask = _mm_set1_epi32(AskType);
+    const __m128i TradeFlag = _mm_set1_epi32(RECORD_TRADE);
+    const __m128i AskFlags = _mm_set1_epi32(RECORD_TRADE | RECORD_ASK);
+
+    int i = 0;
+    for (; i + 8 <= Count; i += 8)
+    {
+        const __m128i A = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Types + i));
+        const __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Types + i + 4));
+        const __m128i FlagsA = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(A, Bid), TradeFlag), _mm_and_si128(_mm_cmpeq_epi32(A, Ask), AskFlags));
+        const __m128i FlagsB = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(B, Bid), TradeFlag), _mm_and_si128(_mm_cmpeq_epi32(B, Ask), AskFlags));
+        const __m128i Packed = _mm_packs_epi32(FlagsA, FlagsB);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(Flags + i), _mm_packus_epi16(Packed, Packed));
+    }
+
+    ConvertTypesScalar(Types, BidType, AskType, Flags, i, Count);
+}
+
+TRADEFLOW_TARGET_AVX2
+inline void ConvertTimesAvx2(const uint32_t* Dates, const uint32_t* Seconds, const uint32_t* SubMicros, int64_t* Micros, int Count)
+{
+    const __m256i DayMultiplier = _mm256_set1_epi64x(BATCH_DAY_MULTIPLIER);
+    const __m256i SecondMultiplier = _mm256_set1_epi64x(1000000);
+    const __m256i EpochOffset = _mm256_set1_epi64x(BATCH_UNIX_EPOCH_DATE * BATCH_MICROS_PER_DAY);
+
+    int i = 0;
+    for (; i + 4 <= Count; i += 4)
+    {
+        const __m256i D = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Dates + i)));
+        const __m256i S = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Seconds + i)));
+        const __m256i U = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(SubMicros + i)));
+
+        __m256i T = _mm256_slli_epi64(_mm256_mul_epu32(D, DayMultiplier), BATCH_DAY_SHIFT);
+        T = _mm256_add_epi64(T, _mm256_mul_epu32(S, SecondMultiplier));
+        T = _mm256_sub_epi64(_mm256_add_epi64(T, U), EpochOffset);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Micros + i), T);
+    }
+
+    ConvertTimesScalar(Dates, Seconds, SubMicros, Micros, i, Count);
+}
+
+TRADEFLOW_TARGET_AVX2
+inline void ConvertPricesAvx2(const double* Prices, double TickSize, int32_t* Ticks, int Count)
+{
+    const __m256d Divisor = _mm256_set1_pd(TickSize > 0.0 ? TickSize : 1.0);
+    const __m256d Half = _mm256_set1_pd(0.5);
+    const __m256d MinusHalf = _mm256_set1_pd(-0.5);
+    const __m256d One = _mm256_set1_pd(1.0);
+
+    int i = 0;
+    for (; i + 4 <= Count; i += 4)
+    {
+        const __m256d Quotient = _mm256_div_pd(_mm256_loadu_pd(Prices + i), Divisor);
+        const __m256d Truncated = _mm256_cvtepi32_pd(_mm256_cvttpd_epi32(Quotient));
+        const __m256d Fraction = _mm256_sub_pd(Quotient, Truncated);
+        const __m256d Step = _mm256_sub_pd(_mm256_and_pd(_mm256_cmp_pd(Fraction, Half, _CMP_GE_OQ), One),
+            _mm256_and_pd(_mm256_cmp_pd(Fraction, MinusHalf, _CMP_LE_OQ), One));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Ticks + i), _mm256_cvttpd_epi32(_mm256_add_pd(Truncated, Step)));
+    }
+
+    ConvertPricesScalar(Prices, TickSize, Ticks, i, Count);
+}
+
+TRADEFLOW_TARGET_AVX2
+inline void ConvertTypesAvx2(const int32_t* Types, int32_t BidType, int32_t AskType, uint8_t* Flags, int Count)
+{
+    const __m256i Bid = _mm256_set1_epi32(BidType);
+    const __m256i Ask = _mm256_set1_epi32(AskType);
+    const __m256i TradeFlag = _mm256_set1_epi32(RECORD_TRADE);
+    const __m256i AskFlags = _mm256_set1_epi32(RECORD_TRADE | RECORD_ASK);
+
+    int i = 0;
+    for (; i + 16 <= Count; i += 16)
+    {
+        const __m256i A = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Types + i));
+        const __m256i B = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Types + i + 8));
+        const __m256i FlagsA = _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi32(A, Bid), TradeFlag), _mm256_and_si256(_mm256_cmpeq_epi32(A, Ask), AskFlags));
+        const __m256i FlagsB = _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi32(B, Bid), TradeFlag), _mm256_and_si256(_mm256_cmpeq_epi32(B, Ask), AskFlags));
+
+        // Packing works within 128-bit lanes; the permute puts the records back in order
+        const __m256i Packed = _mm256_packs_epi32(FlagsA, FlagsB);
+        const __m256i Bytes = _mm256_packus_epi16(Packed, Packed);
+        const __m256i Ordered = _mm256_permutevar8x32_epi32(Bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Flags + i), _mm256_castsi256_si128(Ordered));
+    }
+
+    ConvertTypesScalar(Types, BidType, AskType, Flags, i, Count);
+}
+
+#endif
+
+#if defined(TRADEFLOW_BATCH_NEON)
+
+inline void ConvertTimesNeon(const uint32_t* Dates, const uint32_t* Seconds, const uint32_t* SubMicros, int64_t* Micros, int Count)
+{
+    const uint32x2_t DayMultiplier = vdup_n_u32(BATCH_DAY_MULTIPLIER);
+    const uint32x2_t SecondMultiplier = vdup_n_u32(1000000);
+    const uint64x2_t EpochOffset = vdupq_n_u64(static_cast<uint64_t>(BATCH_UNIX_EPOCH_DATE * BATCH_MICROS_PER_DAY));
+
+    int i = 0;
+    for (; i + 4 <= Count; i += 4)
+    {
+        const uint32x4_t D = vld1q_u32(Dates + i);
+        const uint32x4_t S = vld1q_u32(Seconds + i);
+        const uint32x4_t U = vld1q_u32(SubMicros + i);
+
+        uint64x2_t Lo = vshlq_n_u64(vmull_u32(vget_low_u32(D), DayMultiplier), BATCH_DAY_SHIFT);
+        Lo = vmlal_u32(Lo, vget_low_u32(S), SecondMultiplier);
+        Lo = vsubq_u64(vaddw_u32(Lo, vget_low_u32(U)), EpochOffset);
+
+        uint64x2_t Hi = vshlq_n_u64(vmull_u32(vget_high_u32(D), DayMultiplier), BATCH_DAY_SHIFT);
+        Hi = vmlal_u32(Hi, vget_high_u32(S), SecondMultiplier);
+        Hi = vsubq_u64(vaddw_u32(Hi, vget_high_u32(U)), EpochOffset);
+
+        vst1q_s64(Micros + i, vreinterpretq_s64_u64(Lo));
+        vst1q_s64(Micros + i + 2, vreinterpretq_s64_u64(Hi));
+    }
+
+    ConvertTimesScalar(Dates, Seconds, SubMicros, Micros, i, Count);
+}
+
+// FCVTAS rounds half away from zero, as llround does
+inline void ConvertPricesNeon(const double* Prices, double TickSize, int32_t* Ticks, int Count)
+{
+    const float64x2_t Divisor = vdupq_n_f64(TickSize > 0.0 ? TickSize : 1.0);
+
+    int i = 0;
+    for (; i + 4 <= Count; i += 4)
+    {
+        const int64x2_t Lo = vcvtaq_s64_f64(vdivq_f64(vld1q_f64(Prices + i), Divisor));
+        const int64x2_t Hi = vcvtaq_s64_f64(vdivq_f64(vld1q_f64(Prices + i + 2), Divisor));
+        vst1q_s32(Ticks + i, vcombine_s32(vmovn_s64(Lo), vmovn_s64(Hi)));
+    }
+
+    ConvertPricesScalar(Prices, TickSize, Ticks, i, Count);
+}
+
+inline void ConvertTypesNeon(const int32_t* Types, int32_t BidType, int32_t AskType, uint8_t* Flags, int Count)
+{
+    const int32x4_t Bid = vdupq_n_s32(BidType);
+    const int32x4_t Ask = vdupq_n_s32(AskType);
+    const uint32x4_t TradeFlag = vdupq_n_u32(RECORD_TRADE);
+    const uint32x4_t AskFlags = vdupq_n_u32(RECORD_TRADE | RECORD_ASK);
+
+    int i = 0;
+    for (; i + 8 <= Count; i += 8)
+    {
+        const int32x4_t A = vld1q_s32(Types + i);
+        const int32x4_t B = vld1q_s32(Types + i + 4);
+        const uint32x4_t FlagsA = vorrq_u32(vandq_u32(vceqq_s32(A, Bid), TradeFlag), vandq_u32(vceqq_s32(A, Ask), AskFlags));
+        const uint32x4_t FlagsB = vorrq_u32(vandq_u32(vceqq_s32(B, Bid), TradeFlag), vandq_u32(vceqq_s32(B, Ask), AskFlags));
+        vst1_u8(Flags + i, vmovn_u16(vcombine_u16(vmovn_u32(FlagsA), vmovn_u32(FlagsB))));
+    }
+
+    ConvertTypesScalar(Types, BidType, AskType, Flags, i, Count);
+}
+
+#endif
+
+// Scratch buffers for one run of records. The caller fills the inputs of
+// records [0, Count), up to CAPACITY, and calls Convert.
+class RecordBatch
+{
+public:
+    static const int CAPACITY = 1024;
+
+    RecordBatch() : Count(0) {}
+
+    // Inputs, one array per field
+    uint32_t Dates[CAPACITY];       // Days since 1899-12-30
+    uint32_t Seconds[CAPACITY];     // Second of the day
+    uint32_t SubMicros[CAPACITY];   // Microsecond within the second
+    double Prices[CAPACITY];
+    int32_t Types[CAPACITY];
+
+    // Outputs
+    int64_t Micros[CAPACITY];       // Since the Unix epoch
+    int32_t PriceTicks[CAPACITY];
+    uint8_t Flags[CAPACITY];        // RECORD_TRADE, RECORD_ASK
+
+    int Count;
+
+    // Kernel must be one ResolveConversionKernel returned. BidType and
+    // AskType are the record types of bid and ask trades.
+    void Convert(int Kernel, double TickSize, int32_t BidType, int32_t AskType)
+    {
+        switch (Kernel)
+        {
+#if defined(TRADEFLOW_BATCH_X64)
+        case CONVERSION_KERNEL_SSE2:
+            ConvertTimesSse2(Dates, Seconds, SubMicros, Micros, Count);
+            ConvertPricesSse2(Prices, TickSize, PriceTicks, Count);
+            ConvertTypesSse2(Types, BidType, AskType, Flags, Count);
+            return;
+
+        case CONVERSION_KERNEL_AVX2:
+            ConvertTimesAvx2(Dates, Seconds, SubMicros, Micros, Count);
+            ConvertPricesAvx2(Prices, TickSize, PriceTicks, Count);
+            ConvertTypesAvx2(Types, BidType, AskType, Flags, Count);
+            return;
+#endif
+#if defined(TRADEFLOW_BATCH_NEON)
+        case CONVERSION_KERNEL_NEON:
+            ConvertTimesNeon(Dates, Seconds, SubMicros, Micros, Count);
+            ConvertPricesNeon(Prices, TickSize, PriceTicks, Count);
+            ConvertTypesNeon(Types, BidType, AskType, Flags, Count);
+            return;
+#endif
+        default:
+            ConvertTimesScalar(Dates, Seconds, SubMicros, Micros, 0, Count);
+            ConvertPricesScalar(Prices, TickSize, PriceTicks, 0, Count);
+            ConvertTypesScalar(Types, BidType, AskType, Flags, 0, Count);
+            return;
+        }
+    }
+};
@@ -0,0 +1,279 @@
+// TradeFlowCompact.h
+// Compact encoding of a ticks frame, for links where bandwidth matters more
+// than the few microseconds it costs to encode. Each frame stands alone, so
+// a dropped or resent frame never breaks the ones around it.
+// No Sierra Chart dependencies.
+//
+// WIRE_FRAME_COMPACT_TICKS payload:
+//   uint8 Encoding              WireCompactEncodingEnum
+//   body                        WIRE_COMPACT_VARINT
+//   varint BodyLength, block    WIRE_COMPACT_VARINT_LZ4: the body as one LZ4 block
+//
+// The body is one record per tick, each field a delta against the previous
+// tick of the frame (all zero before the first):
+//   uint8 Flags                 WireCompactTickFlagEnum
+//   [zigzag varint]             sequence delta, only with WIRE_COMPACT_SEQUENCE_GAP (otherwise +1)
+//   [varint]                    symbol ID, only with WIRE_COMPACT_SYMBOL
+//   zigzag varint               timestamp delta
+//   zigzag varint               price delta in ticks
+//   zigzag varint               volume delta
+//   [varint]                    prints, only with WIRE_COMPACT_PRINTS (otherwise 1)
+//
+// Varints are little-endian base 128. A tick at the same price and size as
+// the one before it, in the same millisecond (or microsecond), takes four
+// bytes.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "TradeFlowWire.h"
+
+enum WireCompactEncodingEnum
+{
+    WIRE_COMPACT_VARINT = 0,
+    WIRE_COMPACT_VARINT_LZ4 = 1
+};
+
+enum WireCompactTickFlagEnum
+{
+    WIRE_COMPACT_ASK = 0x01,
+    WIRE_COMPACT_SEQUENCE_GAP = 0x02,
+    WIRE_COMPACT_SYMBOL = 0x04,
+    WIRE_COMPACT_PRINTS = 0x08,
+    WIRE_COMPACT_MICROSECONDS = 0x10    // Timestamp in microseconds (WIRE_TICK_MICROSECONDS)
+};
+
+// Largest record: flags, sequence and timestamp (64-bit), symbol ID, then
+// price, volume and prints (33 bits at most)
+static const size_t WIRE_COMPACT_MAX_TICK_BYTES = 1 + 10 + 10 + 3 + 3 * 5;
+
+// Encoding byte and the LZ4 body length
+static const size_t WIRE_COMPACT_MAX_PREFIX_BYTES = 1 + 10;
+
+inline uint64_t ZigZagEncode(int64_t Value)
+{
+    return (static_cast<uint64_t>(Value) << 1) ^ static_cast<uint64_t>(Value >> 63);
+}
+
+inline size_t WriteVarint(uint8_t* Out, uint64_t Value)
+{
+    size_t Length = 0;
+    while (Value >= 0x80)
+    {
+        Out[Length++] = static_cast<uint8_t>(Value | 0x80);
+        Value >>= 7;
+    }
+    Out[Length++] = static_cast<uint8_t>(Value);
+    return Length;
+}
+
+// Differences are taken in unsigned arithmetic so a wild value cannot overflow
+inline int64_t WrappingDelta(int64_t Value, int64_t Previous)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(Value) - static_cast<uint64_t>(Previous));
+}
+
+// LZ4 block format compressor (greedy, single hash probe). Output can be
+// read by any LZ4 block decoder; the one the relay uses is in
+// components/tradeflow-wire.js.
+class Lz4BlockCompressor
+{
+public:
+    // Largest block Compress() can write for Length input bytes
+    static size_t Bound(size_t Length) { return Length + Length / 255 + 16; }
+
+    size_t Compress(const uint8_t* Source, size_t Length, uint8_t* Out)
+    {
+        uint8_t* Op = Out;
+        size_t Anchor = 0;
+
+        // The format ends every block with at least 5 literals, and the last
+        // match must start 12 bytes or more before the end
+        if (Length >= MIN_MATCH_INPUT)
+        {
+            std::fill(Table, Table + TABLE_SIZE, -1);
+
+            const size_t MatchLimit = Length - LAST_LITERALS;
+            size_t Ip = 0;
+            while (Ip + MATCH_FIND_LIMIT <= Length)
+            {
+                const uint32_t Sequence = Read32(Source + Ip);
+                const uint32_t Hash = (Sequence * 2654435761u) >> (32 - TABLE_BITS);
+                const int32_t Reference = Table[Hash];
+                Table[Hash] = static_cast<int32_t>(Ip);
+
+                if (Reference < 0 || Ip - static_cast<size_t>(Reference) > MAX_OFFSET || Read32(Source + Reference) != Sequence)
+                {
+                    Ip++;
+                    continue;
+                }
+
+                size_t MatchLength = MIN_MATCH;
+                while (Ip + MatchLength < MatchLimit && Source[Reference + MatchLength] == Source[Ip + MatchLength])
+                    MatchLength++;
+
+                uint8_t* Token = Op++;
+                Op = WriteLiterals(Op, Token, Source + Anchor, Ip - Anchor);
+
+                const size_t Offset = Ip - static_cast<size_t>(Reference);
+                *Op++ = static_cast<uint8_t>(Offset);
+                *Op++ = static_cast<uint8_t>(Offset >> 8);
+
+                const size_t Extra = MatchLength - MIN_MATCH;
+                if (Extra >= 15)
+                {
+                    *Token |= 15;
+                    Op = WriteLengthExtension(Op, Extra - 15);
+                }
+                else
+                {
+                    *Token |= static_cast<uint8_t>(Extra);
+                }
+
+                Ip += MatchLength;
+                Anchor = Ip;
+            }
+        }
+
+        uint8_t* Token = Op++;
+        Op = WriteLiterals(Op, Token, Source + Anchor, Length - Anchor);
+        return static_cast<size_t>(Op - Out);
+    }
+
+private:
+    static const int TABLE_BITS = 12;
+    static const size_t TABLE_SIZE = size_t(1) << TABLE_BITS;
+    static const size_t MIN_MATCH = 4;
+    static const size_t LAST_LITERALS = 5;
+    static const size_t MATCH_FIND_LIMIT = 12;
+    static const size_t MIN_MATCH_INPUT = 13;
+    static const size_t MAX_OFFSET = 65535;
+
+    static uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t Value;
+        memcpy(&Value, p, sizeof(Value));
+        return Value;
+    }
+
+    static uint8_t* WriteLengthExtension(uint8_t* Op, size_t Length)
+    {
+        while (Length >= 255)
+        {
+            *Op++ = 255;
+            Length -= 255;
+        }
+        *Op++ = static_cast<uint8_t>(Length);
+        return Op;
+    }
+
+    // Sets the literal length in the token, then copies the literals
+    static uint8_t* WriteLiterals(uint8_t* Op, uint8_t* Token, const uint8_t* Literals, size_t Length)
+    {
+        if (Length >= 15)
+        {
+            *Token = 15 << 4;
+            Op = WriteLengthExtension(Op, Length - 15);
+        }
+        else
+        {
+            *Token = static_cast<uint8_t>(Length << 4);
+        }
+
+        memcpy(Op, Literals, Length);
+        return Op + Length;
+    }
+
+    int32_t Table[TABLE_SIZE];
+};
+
+// Re-encodes an array of WireTick as one complete WIRE_FRAME_COMPACT_TICKS
+// frame. The buffers grow to the largest batch seen and are then reused.
+class CompactTickEncoder
+{
+public:
+    // Records points at Count packed WireTick records. Returns the frame,
+    // valid until the next call.
+    const char* Encode(const char* Records, size_t Count, bool Lz4, size_t& Length)
+    {
+        const size_t MaxBody = Count * WIRE_COMPACT_MAX_TICK_BYTES;
+        const size_t MaxFrame = sizeof(WireFrameHeader) + WIRE_COMPACT_MAX_PREFIX_BYTES
+            + (Lz4 ? Lz4BlockCompressor::Bound(MaxBody) : MaxBody);
+        if (Frame.size() < MaxFrame)
+            Frame.resize(MaxFrame);
+
+        uint8_t* Payload = reinterpret_cast<uint8_t*>(Frame.data()) + sizeof(WireFrameHeader);
+        size_t PayloadLength;
+        if (Lz4)
+        {
+            if (Body.size() < MaxBody)
+                Body.resize(MaxBody);
+
+            const size_t BodyLength = EncodeBody(Records, Count, Body.data());
+            Payload[0] = WIRE_COMPACT_VARINT_LZ4;
+            PayloadLength = 1 + WriteVarint(Payload + 1, BodyLength);
+            PayloadLength += Compressor.Compress(Body.data(), BodyLength, Payload + PayloadLength);
+        }
+        else
+        {
+            Payload[0] = WIRE_COMPACT_VARINT;
+            PayloadLength = 1 + EncodeBody(Records, Count, Payload + 1);
+        }
+
+        WriteFrameHeader(Frame.data(), WIRE_FRAME_COMPACT_TICKS, static_cast<uint32_t>(PayloadLength));
+        Length = sizeof(WireFrameHeader) + PayloadLength;
+        return Frame.data();
+    }
+
+private:
+    static size_t EncodeBody(const char* Records, size_t Count, uint8_t* Out)
+    {
+        WireTick Previous;
+        memset(&Previous, 0, sizeof(Previous));
+
+        size_t Length = 0;
+        for (size_t i = 0; i < Count; i++)
+        {
+            WireTick Tick;
+            memcpy(&Tick, Records + i * sizeof(WireTick), sizeof(Tick));
+
+            const int64_t SequenceDelta = WrappingDelta(Tick.Sequence, Previous.Sequence);
+            const uint32_t Prints = (Tick.Prints == 0) ? 1 : Tick.Prints;
+
+            uint8_t Flags = 0;
+            if (Tick.Side == WIRE_SIDE_ASK)
+                Flags |= WIRE_COMPACT_ASK;
+            if (SequenceDelta != 1)
+                Flags |= WIRE_COMPACT_SEQUENCE_GAP;
+            if (Tick.SymbolId != Previous.SymbolId)
+                Flags |= WIRE_COMPACT_SYMBOL;
+            if (Prints != 1)
+                Flags |= WIRE_COMPACT_PRINTS;
+            if (Tick.Flags & WIRE_TICK_MICROSECONDS)
+                Flags |= WIRE_COMPACT_MICROSECONDS;
+
+            Out[Length++] = Flags;
+            if (Flags & WIRE_COMPACT_SEQUENCE_GAP)
+                Length += WriteVarint(Out + Length, ZigZagEncode(SequenceDelta));
+            if (Flags & WIRE_COMPACT_SYMBOL)
+                Length += WriteVarint(Out + Length, Tick.SymbolId);
+            Length += WriteVarint(Out + Length, ZigZagEncode(WrappingDelta(Tick.Timestamp, Previous.Timestamp)));
+            Length += WriteVarint(Out + Length, ZigZagEncode(static_cast<int64_t>(Tick.PriceTicks) - Previous.PriceTicks));
+            Length += WriteVarint(Out + Length, ZigZagEncode(static_cast<int64_t>(Tick.Volume) - Previous.Volume));
+            if (Flags & WIRE_COMPACT_PRINTS)
+                Length += WriteVarint(Out + Length, Prints);
+
+            Previous = Tick;
+        }
+
+        return Length;
+    }
+
+    std::vector<char> Frame;
+    std::vector<uint8_t> Body;
+    Lz4BlockCompressor Compressor;
+};
@@ -0,0 +1,319 @@
+// TradeFlowControl.h
+// Control messages a consumer sends back to the exporter over the same TCP
+// connection the ticks go out on. Each is one JSON line, whatever the wire
+// format of the tick stream:
+//
+//   {"type":"resume","sym":"ESZ5","seq":12345}  last sequence received for a
+//                                                symbol ("sym" may be omitted
+//                                                when there is only one)
+//   {"type":"resume","sym":"ESZ5","seq":12345,"to":12400}
+//                                                multicast gap fill: only the
+//                                                ticks up to "to" are missing
+//   {"type":"ready"}                             nothing more to resume; go live
+//   {"type":"heartbeat"}                         reply to an exporter heartbeat
+//   {"type":"footprint","sym":"ESZ5"}            send a full footprint snapshot
+//                                                ("sym" optional: every symbol)
+//   {"type":"filter","sym":"ESZ5","minVolume":10,"stream":"both"}
+//                                                only ticks of at least
+//                                                minVolume; stream is "ticks",
+//                                                "aggregates" or "both". Replaces
+//                                                the last filter, and fields left
+//                                                out take the study's settings
+//                                                ("sym" optional: every symbol)
+//   {"type":"subscribe","syms":"ESZ5,NQH6"}      only these symbols are sent
+//                                                ("" for every symbol)
+//
+// Filters and subscriptions last until the connection closes. Filtered ticks
+// keep their sequence numbers, so a filtered stream skips numbers.
+// Only the fields above are read, so the parser is a field lookup rather
+// than a full JSON reader.
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Longer lines are discarded rather than buffered
+static const size_t CONTROL_MAX_LINE_LENGTH = 4096;
+
+enum ControlTypeEnum
+{
+    CONTROL_UNKNOWN = 0,
+    CONTROL_RESUME = 1,
+    CONTROL_READY = 2,
+    CONTROL_HEARTBEAT = 3,
+    CONTROL_FOOTPRINT = 4,
+    CONTROL_FILTER = 5,
+    CONTROL_SUBSCRIBE = 6
+};
+
+// Streams a filter can pick
+enum ControlStreamEnum
+{
+    CONTROL_STREAM_DEFAULT = 0,     // As the study inputs select
+    CONTROL_STREAM_TICKS = 1,       // Ticks without aggregates
+    CONTROL_STREAM_AGGREGATES = 2,  // Aggregates instead of ticks
+    CONTROL_STREAM_BOTH = 3         // Ticks and aggregates
+};
+
+struct ControlMessage
+{
+    int Type;                   // ControlTypeEnum
+    std::string Symbol;         // Empty when not given
+    int64_t Sequence;
+    int64_t Through;            // Resume: last sequence wanted, 0 for everything after Sequence
+    int64_t MinVolume;          // Filter: 0 when not given
+    int Stream;                 // Filter: ControlStreamEnum
+    std::string Symbols;        // Subscribe: comma-separated, empty for every symbol
+};
+
+// Splits received bytes into lines. A line may arrive over several reads.
+class ControlLineReader
+{
+public:
+    ControlLineReader() : Discarding(false) {}
+
+    void Clear()
+    {
+        Pending.clear();
+        Discarding = false;
+    }
+
+    void Append(const char* Data, size_t Length)
+    {
+        Pending.append(Data, Length);
+    }
+
+    // Takes the next complete line, without its line ending
+    bool NextLine(std::string& Line)
+    {
+        for (;;)
+        {
+            const size_t End = Pending.find('\n');
+            if (End == std::string::npos)
+            {
+                // Drop an overlong line as it arrives, up to its end
+                if (Pending.size() > CONTROL_MAX_LINE_LENGTH)
+                {
+                    Pending.clear();
+                    Discarding = true;
+                }
+                return false;
+            }
+
+            const bool Skip = Discarding || End > CONTROL_MAX_LINE_LENGTH;
+            Discarding = false;
+            if (!Skip)
+            {
+                Line.assign(Pending, 0, (End > 0 && Pending[End - 1] == '\r') ? End - 1 : End);
+                Pending.erase(0, End + 1);
+                return true;
+            }
+
+            Pending.erase(0, End + 1);
+        }
+    }
+
+private:
+    std::string Pending;
+    bool Discarding;
+};
+
+// Start of the value of "Name": in Line, or NULL if the field is missing
+inline const char* FindControlField(const std::string& Line, const char* Name)
+{
+    const std::string Key = std::string("\"") + Name + "\"";
+
+    size_t Position = Line.find(Key);
+    while (Position != std::string::npos)
+    {
+        const char* p = Line.c_str() + Position + Key.size();
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == ':')
+        {
+            p++;
+            while (*p == ' ' || *p == '\t')
+                p++;
+            return p;
+        }
+
+        Position = Line.find(Key, Position + 1);
+    }
+
+    return NULL;
+}
+
+// String value of a field, with \" and \\ unescaped
+inline bool ReadControlString(const std::string& Line, const char* Name, std::string& Value)
+{
+    const char* p = FindControlField(Line, Name);
+    if (p == NULL || *p != '"')
+        return false;
+
+    Value.clear();
+    for (p++; *p != '\0' && *p != '"'; p++)
+    {
+        if (*p == '\\' && p[1] != '\0')
+            p++;
+        Value += *p;
+    }
+    return *p == '"';
+}
+
+inline bool ReadControlInteger(const std::string& Line, const char* Name, int64_t& Value)
+{
+    const char* p = FindControlField(Line, Name);
+    if (p == NULL)
+        return false;
+
+    char* End;
+    Value = strtoll(p, &End, 10);
+    return End != p;
+}
+
+// Returns false if the line is not a control message this exporter knows
+inline bool ParseControlMessage(const std::string& Line, ControlMessage& Message)
+{
+    Message.Type = CONTROL_UNKNOWN;
+    Message.Symbol.clear();
+    Message.Sequence = 0;
+    Message.Through = 0;
+    Message.MinVolume = 0;
+    Message.Stream = CONTROL_STREAM_DEFAULT;
+    Message.Symbols.clear();
+
+    std::string Type;
+    if (!ReadControlString(Line, "type", Type))
+        return false;
+
+    if (Type == "resume")
+    {
+        if (!ReadControlInteger(Line, "seq", Message.Sequence))
+            return false;
+        ReadControlString(Line, "sym", Message.Symbol);
+        ReadControlInteger(Line, "to", Message.Through);
+        Message.Type = CONTROL_RESUME;
+        return true;
+    }
+
+    if (Type == "ready")
+    {
+        Message.Type = CONTROL_READY;
+        return true;
+    }
+
+    if (Type == "heartbeat")
+    {
+        Message.Type = CONTROL_HEARTBEAT;
+        return true;
+    }
+
+    if (Type == "footprint")
+    {
+        ReadControlString(Line, "sym", Message.Symbol);
+        Message.Type = CONTROL_FOOTPRINT;
+        return true;
+    }
+
+    if (Type == "filter")
+    {
+        ReadControlString(Line, "sym", Message.Symbol);
+        if (ReadControlInteger(Line, "minVolume", Message.MinVolume) && Message.MinVolume < 0)
+            Message.MinVolume = 0;
+
+        std::string Stream;
+        if (ReadControlString(Line, "stream", Stream))
+        {
+            if (Stream == "ticks")
+                Message.Stream = CONTROL_STREAM_TICKS;
+            else if (Stream == "aggregates")
+                Message.Stream = CONTROL_STREAM_AGGREGATES;
+            else if (Stream == "both")
+                Message.Stream = CONTROL_STREAM_BOTH;
+        }
+        Message.Type = CONTROL_FILTER;
+        return true;
+    }
+
+    if (Type == "subscribe")
+    {
+        ReadControlString(Line, "syms", Message.Symbols);
+        Message.Type = CONTROL_SUBSCRIBE;
+        return true;
+    }
+
+    return false;
+}
+
+// True if Symbol is one of the comma-separated names in List, or List is empty
+inline bool SymbolListContains(const std::string& List, const char* Symbol)
+{
+    if (List.empty())
+        return true;
+
+    const size_t SymbolLength = strlen(Symbol);
+    size_t Start = 0;
+    while (Start <= List.size())
+    {
+        size_t End = List.find(',', Start);
+        if (End == std::string::npos)
+            End = List.size();
+
+        size_t First = Start;
+        size_t Last = End;
+        while (First < Last && List[First] == ' ')
+            First++;
+        while (Last > First && List[Last - 1] == ' ')
+            Last--;
+        if (Last - First == SymbolLength && List.compare(First, SymbolLength, Symbol) == 0)
+            return true;
+
+        Start = End + 1;
+    }
+    return false;
+}
+
+// What one consumer wants from one chart, evaluated per tick before the tick
+// is serialized
+struct TickFilter
+{
+    TickFilter() { Clear(); }
+
+    void Clear()
+    {
+        Subscribed = true;
+        MinVolume = 0;
+        Stream = CONTROL_STREAM_DEFAULT;
+    }
+
+    bool Accepts(uint32_t Volume) const { return Subscribed && Volume >= MinVolume; }
+
+    // Takes a filter or subscribe message into account for the chart of
+    // Symbol. Returns true if the filter changed.
+    bool Apply(const ControlMessage& Message, const char* Symbol)
+    {
+        const bool WasSubscribed = Subscribed;
+        const uint32_t OldMinVolume = MinVolume;
+        const int OldStream = Stream;
+
+        if (Message.Type == CONTROL_SUBSCRIBE)
+        {
+            Subscribed = SymbolListContains(Message.Symbols, Symbol);
+        }
+        else if (Message.Type == CONTROL_FILTER && (Message.Symbol.empty() || Message.Symbol == Symbol))
+        {
+            MinVolume = (Message.MinVolume > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(Message.MinVolume);
+            Stream = Message.Stream;
+        }
+
+        return Subscribed != WasSubscribed || MinVolume != OldMinVolume || Stream != OldStream;
+    }
+
+    bool Subscribed;            // Not excluded by a subscribe message
+    uint32_t MinVolume;         // Smaller ticks are not sent
+    int Stream;                 // ControlStreamEnum
+};
@@ -3,139 +3,5743 @@
 
 #include "sierrachart.h"
 
+#include <mswsock.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TradeFlowAggregate.h"
+#include "TradeFlowBatch.h"
+#include "TradeFlowCompact.h"
+#include "TradeFlowControl.h"
+#include "TradeFlowEvents.h"
+#include "TradeFlowFootprint.h"
+#include "TradeFlowHistory.h"
+#include "TradeFlowMulticast.h"
+#include "TradeFlowQuotes.h"
+#include "TradeFlowRecorder.h"
+#include "TradeFlowRing.h"
+#include "TradeFlowSerializer.h"
+#include "TradeFlowShm.h"
+#include "TradeFlowSnapshot.h"
+#include "TradeFlowStats.h"
+#include "TradeFlowWebSocket.h"
+#include "TradeFlowWire.h"
+
 // Link with Winsock library
 #pragma comment(lib, "ws2_32.lib")
 
-SCDLLName("TradeFlow Data Exporter")
+SCDLLName("TradeFlow Data Exporter")
+
+// What to do when the outbound ring cannot hold a new batch
+enum OverflowPolicyEnum
+{
+    OVERFLOW_DROP_OLDEST = 0,
+    OVERFLOW_DROP_NEWEST = 1,
+    OVERFLOW_COALESCE = 2
+};
+
+enum TransportEnum
+{
+    TRANSPORT_TCP = 0,
+    TRANSPORT_SHARED_MEMORY = 1,    // TradeFlowShm.h ring, always binary frames
+    TRANSPORT_WEBSOCKET = 2,        // Serves clients directly (TradeFlowWebSocket.h), always binary frames
+    TRANSPORT_MULTICAST = 3         // UDP multicast to the LAN (TradeFlowMulticast.h), always binary frames
+};
+
+enum WireFormatEnum
+{
+    WIRE_FORMAT_JSON = 0,       // Newline-delimited JSON
+    WIRE_FORMAT_BINARY = 1      // TradeFlowWire.h frames
+};
+
+// Encoding of the ticks frames on a binary TCP connection
+enum TickCompressionEnum
+{
+    TICK_COMPRESSION_NONE = 0,      // WIRE_FRAME_TICKS
+    TICK_COMPRESSION_VARINT = 1,    // WIRE_FRAME_COMPACT_TICKS (TradeFlowCompact.h)
+    TICK_COMPRESSION_LZ4 = 2        // Compact frames with an LZ4-compressed body
+};
+
+// Timestamp fields of the exported ticks. Binary ticks carry one timestamp,
+// in microseconds (WIRE_TICK_MICROSECONDS) unless milliseconds are selected.
+enum TimestampResolutionEnum
+{
+    TIMESTAMPS_MILLISECONDS = 0,    // "ts", as before
+    TIMESTAMPS_MICROSECONDS = 1,    // "us"
+    TIMESTAMPS_BOTH = 2             // "us" plus "ts" for consumers that only read milliseconds
+};
+
+enum AggregateOutputEnum
+{
+    AGGREGATES_OFF = 0,
+    AGGREGATES_WITH_TICKS = 1,
+    AGGREGATES_ONLY = 2         // Aggregate frames instead of individual ticks
+};
+
+// How the I/O thread hands its send queue to the socket
+enum SendBackendEnum
+{
+    SEND_BACKEND_WINSOCK = 0,   // Non-blocking WSASend when WSAPoll reports room
+    SEND_BACKEND_IOCP = 1,      // Overlapped WSASend, completions from an I/O completion port
+    SEND_BACKEND_RIO = 2        // Registered I/O: RIOSend from buffers registered once
+};
+
+// Running totals over a range of ticks. Used to describe ticks that were
+// coalesced into a summary frame instead of being sent individually.
+struct TickSummary {
+    int Ticks;
+    int64_t FirstSequence;
+    int64_t LastSequence;
+    int64_t FirstTimestampMs;
+    int64_t LastTimestampMs;
+    int BidTicks;
+    int AskTicks;
+    int64_t BidVolume;
+    int64_t AskVolume;
+    double High;
+    double Low;
+};
+
+static void ResetSummary(TickSummary& Summary)
+{
+    memset(&Summary, 0, sizeof(Summary));
+}
+
+static void AddToSummary(TickSummary& Summary, int64_t Sequence, int64_t TimestampMs, double Price, unsigned int Volume, bool IsAsk)
+{
+    if (Summary.Ticks == 0)
+    {
+        Summary.FirstSequence = Sequence;
+        Summary.FirstTimestampMs = TimestampMs;
+        Summary.High = Price;
+        Summary.Low = Price;
+    }
+
+    Summary.Ticks++;
+    Summary.LastSequence = Sequence;
+    Summary.LastTimestampMs = TimestampMs;
+
+    if (IsAsk)
+    {
+        Summary.AskTicks++;
+        Summary.AskVolume += Volume;
+    }
+    else
+    {
+        Summary.BidTicks++;
+        Summary.BidVolume += Volume;
+    }
+
+    if (Price > Summary.High)
+        Summary.High = Price;
+    if (Price < Summary.Low)
+        Summary.Low = Price;
+}
+
+static void MergeSummary(TickSummary& Into, const TickSummary& From)
+{
+    if (From.Ticks == 0)
+        return;
+
+    if (Into.Ticks == 0)
+    {
+        Into = From;
+        return;
+    }
+
+    Into.Ticks += From.Ticks;
+    Into.LastSequence = From.LastSequence;
+    Into.LastTimestampMs = From.LastTimestampMs;
+    Into.BidTicks += From.BidTicks;
+    Into.AskTicks += From.AskTicks;
+    Into.BidVolume += From.BidVolume;
+    Into.AskVolume += From.AskVolume;
+    if (From.High > Into.High)
+        Into.High = From.High;
+    if (From.Low < Into.Low)
+        Into.Low = From.Low;
+}
+
+// Reconnect backoff: the first retry after a failure comes quickly, then the
+// wait doubles up to the cap. Each wait is jittered down by up to half so
+// charts that lost the same relay do not retry in lockstep.
+static const int CONNECT_BACKOFF_MIN_MS = 50;
+static const int CONNECT_BACKOFF_MAX_MS = 5000;
+
+// A connect still pending after this long is abandoned and retried
+static const int CONNECT_TIMEOUT_MS = 2000;
+
+// A connection that drops sooner than this counts as a failed attempt
+static const int CONNECT_STABLE_MS = 1000;
+
+// A consumer silent for this many heartbeat intervals is presumed dead
+static const int HEARTBEAT_TIMEOUT_INTERVALS = 3;
+
+// Upper bound on one heartbeat line or frame
+static const int MAX_HEARTBEAT_MESSAGE_LENGTH = 64;
+
+// Encodes a heartbeat in the given wire format. Returns its length.
+static int FormatHeartbeat(char* Buffer, int WireFormat)
+{
+    const int64_t NowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    if (WireFormat == WIRE_FORMAT_BINARY)
+    {
+        WireHeartbeat Heartbeat;
+        Heartbeat.Timestamp = NowMs;
+        const int Length = WriteFrameHeader(Buffer, WIRE_FRAME_HEARTBEAT, sizeof(Heartbeat));
+        memcpy(Buffer + Length, &Heartbeat, sizeof(Heartbeat));
+        return Length + static_cast<int>(sizeof(Heartbeat));
+    }
+
+    return sprintf_s(Buffer, MAX_HEARTBEAT_MESSAGE_LENGTH, "{\"type\":\"heartbeat\",\"ts\":%lld}\n", static_cast<long long>(NowMs));
+}
+
+// Client side of one TCP connection to the consumer. Connects without
+// blocking and completes the connect with WSAPoll, backs off between failed
+// attempts, sets the socket options, and times heartbeats in both
+// directions. Used from one thread: the study's for a direct connection,
+// the I/O thread's otherwise.
+class TcpConnection
+{
+public:
+    TcpConnection()
+        : Socket(INVALID_SOCKET), Connected(false), Port(0), SendBufferBytes(0), SocketFlags(0), Resolved(false), Failures(0), HeardFromPeer(false)
+        , Random(static_cast<unsigned>(std::chrono::steady_clock::now().time_since_epoch().count()))
+    {
+        NextAttempt = std::chrono::steady_clock::now();
+    }
+
+    ~TcpConnection() { Close(); }
+
+    // Applies to the next connect. Host is an IPv4 address or a name;
+    // SendBufferBytes 0 keeps the system default.
+    void Configure(const char* NewHost, int NewPort, int NewSendBufferBytes)
+    {
+        if (Host != NewHost)
+        {
+            Host = NewHost;
+            Resolved = false;
+        }
+        Port = NewPort;
+        SendBufferBytes = NewSendBufferBytes;
+    }
+
+    // WSASocket flags for the next connect (e.g. WSA_FLAG_REGISTERED_IO);
+    // 0 creates the socket with socket()
+    void SetSocketFlags(DWORD NewSocketFlags) { SocketFlags = NewSocketFlags; }
+
+    // Whether the open connection goes where Configure() now says
+    bool Targets(const char* OtherHost, int OtherPort) const
+    {
+        return Host == OtherHost && Port == OtherPort;
+    }
+
+    SOCKET GetSocket() const { return Socket; }
+    bool IsOpen() const { return Socket != INVALID_SOCKET; }
+    bool IsConnected() const { return Connected; }
+
+    // Starts a connect, or waits up to TimeoutMs for the pending one.
+    // Returns true on the call that completes it. While backing off after a
+    // failure this only reads the clock.
+    bool Poll(int TimeoutMs)
+    {
+        if (Connected)
+            return false;
+
+        const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+        if (Socket == INVALID_SOCKET)
+        {
+            if (Now < NextAttempt)
+                return false;
+
+            if (!StartConnect())
+            {
+                Fail(Now);
+                return false;
+            }
+            AttemptStart = Now;
+
+            if (Connected)
+                return true;
+        }
+
+        WSAPOLLFD PollFd;
+        PollFd.fd = Socket;
+        PollFd.events = POLLWRNORM;
+        PollFd.revents = 0;
+        const int Ready = WSAPoll(&PollFd, 1, TimeoutMs);
+        if (Ready == 0)
+        {
+            if (Now - AttemptStart >= std::chrono::milliseconds(CONNECT_TIMEOUT_MS))
+                Fail(Now);
+            return false;
+        }
+
+        // A refused connect shows up as an error event or in SO_ERROR
+        int Error = 0;
+        int ErrorLength = sizeof(Error);
+        if (Ready < 0 || (PollFd.revents & (POLLERR | POLLHUP)) || !(PollFd.revents & POLLWRNORM)
+            || getsockopt(Socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&Error), &ErrorLength) != 0 || Error != 0)
+        {
+            Fail(Now);
+            return false;
+        }
+
+        OnEstablished(Now);
+        return true;
+    }
+
+    // A connection that lasted is reconnected at once; a short-lived one
+    // backs off as if the connect had failed
+    void Close()
+    {
+        const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+        const bool WasConnected = Connected;
+
+        if (Socket != INVALID_SOCKET)
+            closesocket(Socket);
+        Socket = INVALID_SOCKET;
+        Connected = false;
+
+        if (WasConnected)
+        {
+            if (Now - ConnectedClock >= std::chrono::milliseconds(CONNECT_STABLE_MS))
+            {
+                Failures = 0;
+                NextAttempt = Now;
+            }
+            else
+            {
+                ScheduleRetry(Now);
+            }
+        }
+    }
+
+    // Anything the consumer sends shows it is alive
+    void NoteReceived()
+    {
+        LastReceiveClock = std::chrono::steady_clock::now();
+        HeardFromPeer = true;
+    }
+
+    // Only a consumer that has written at least once on this connection is
+    // expected to answer heartbeats; older ones never write
+    bool PeerTimedOut(int HeartbeatMs) const
+    {
+        return HeartbeatMs > 0 && HeardFromPeer
+            && std::chrono::steady_clock::now() - LastReceiveClock >= std::chrono::milliseconds(HeartbeatMs * HEARTBEAT_TIMEOUT_INTERVALS);
+    }
+
+    // True once per interval while connected
+    bool HeartbeatDue(int HeartbeatMs)
+    {
+        if (!Connected || HeartbeatMs <= 0)
+            return false;
+
+        const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+        if (Now - LastHeartbeatClock < std::chrono::milliseconds(HeartbeatMs))
+            return false;
+
+        LastHeartbeatClock = Now;
+        return true;
+    }
+
+    // Time left before the next attempt may start, for callers that sleep
+    int MillisecondsUntilRetry() const
+    {
+        const std::chrono::steady_clock::duration Left = NextAttempt - std::chrono::steady_clock::now();
+        const long long Ms = std::chrono::duration_cast<std::chrono::milliseconds>(Left).count();
+        return (Ms > 0) ? static_cast<int>(Ms) : 0;
+    }
+
+private:
+    bool StartConnect()
+    {
+        if (SocketFlags != 0)
+            Socket = WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, SocketFlags);
+        else
+            Socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (Socket == INVALID_SOCKET)
+            return false;
+
+        u_long Mode = 1;
+        ioctlsocket(Socket, FIONBIO, &Mode);
+
+        // Batches are already coalesced; Nagle would only add delay
+        int NoDelay = 1;
+        setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&NoDelay), sizeof(NoDelay));
+
+        int KeepAlive = 1;
+        setsockopt(Socket, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&KeepAlive), sizeof(KeepAlive));
+
+        if (SendBufferBytes > 0)
+            setsockopt(Socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&SendBufferBytes), sizeof(SendBufferBytes));
+
+        if (!Resolve())
+            return false;
+
+        sockaddr_in ServerAddress;
+        memset(&ServerAddress, 0, sizeof(ServerAddress));
+        ServerAddress.sin_family = AF_INET;
+        ServerAddress.sin_port = htons(static_cast<u_short>(Port));
+        ServerAddress.sin_addr = Address;
+
+        if (connect(Socket, reinterpret_cast<SOCKADDR*>(&ServerAddress), sizeof(ServerAddress)) == 0)
+        {
+            OnEstablished(std::chrono::steady_clock::now());
+            return true;
+        }
+
+        const int Error = WSAGetLastError();
+        return Error == WSAEWOULDBLOCK || Error == WSAEINPROGRESS;
+    }
+
+    // Addresses are used as given. A name is looked up once, and again after
+    // a failed attempt in case it has moved; the lookup blocks the caller.
+    bool Resolve()
+    {
+        if (Resolved)
+            return true;
+
+        const unsigned long Literal = inet_addr(Host.c_str());
+        if (Literal != INADDR_NONE)
+        {
+            Address.s_addr = Literal;
+            Resolved = true;
+            return true;
+        }
+
+        addrinfo Hints;
+        memset(&Hints, 0, sizeof(Hints));
+        Hints.ai_family = AF_INET;
+        Hints.ai_socktype = SOCK_STREAM;
+        Hints.ai_protocol = IPPROTO_TCP;
+
+        addrinfo* Results = NULL;
+        if (getaddrinfo(Host.c_str(), NULL, &Hints, &Results) != 0 || Results == NULL)
+            return false;
+
+        Address = reinterpret_cast<sockaddr_in*>(Results->ai_addr)->sin_addr;
+        freeaddrinfo(Results);
+        Resolved = true;
+        return true;
+    }
+
+    void OnEstablished(std::chrono::steady_clock::time_point Now)
+    {
+        Connected = true;
+        ConnectedClock = Now;
+        LastHeartbeatClock = Now;
+        LastReceiveClock = Now;
+        HeardFromPeer = false;
+    }
+
+    void Fail(std::chrono::steady_clock::time_point Now)
+    {
+        if (Socket != INVALID_SOCKET)
+            closesocket(Socket);
+        Socket = INVALID_SOCKET;
+        Resolved = false;
+        ScheduleRetry(Now);
+    }
+
+    void ScheduleRetry(std::chrono::steady_clock::time_point Now)
+    {
+        int DelayMs = CONNECT_BACKOFF_MAX_MS;
+        if (Failures < 16 && (CONNECT_BACKOFF_MIN_MS << Failures) < CONNECT_BACKOFF_MAX_MS)
+            DelayMs = CONNECT_BACKOFF_MIN_MS << Failures;
+        Failures++;
+
+        std::uniform_int_distribution<int> Jitter(0, DelayMs / 2);
+        NextAttempt = Now + std::chrono::milliseconds(DelayMs - Jitter(Random));
+    }
+
+    SOCKET Socket;
+    bool Connected;
+    std::string Host;
+    int Port;
+    int SendBufferBytes;
+    DWORD SocketFlags;
+    in_addr Address;            // Host, once resolved
+    bool Resolved;
+    int Failures;               // Consecutive failed attempts
+    bool HeardFromPeer;
+    std::minstd_rand Random;
+    std::chrono::steady_clock::time_point NextAttempt;
+    std::chrono::steady_clock::time_point AttemptStart;
+    std::chrono::steady_clock::time_point ConnectedClock;
+    std::chrono::steady_clock::time_point LastHeartbeatClock;
+    std::chrono::steady_clock::time_point LastReceiveClock;
+};
+
+// Completion-based sends (I/O thread). The send queue is copied into this
+// many buffers, allocated once per worker (and registered, for RIO); each
+// carries one send until its completion comes back.
+static const int COMPLETION_SEND_SLOTS = 8;
+static const size_t COMPLETION_SEND_SLOT_BYTES = 128 * 1024;
+
+// RIO completion queue entries. Sends of a closed socket may still hold
+// entries while the next connection posts its own.
+static const DWORD COMPLETION_QUEUE_ENTRIES = 4 * (COMPLETION_SEND_SLOTS + 1);
+
+// Sends still in flight when a connection closes are waited for this long
+static const int COMPLETION_DRAIN_MS = 200;
+
+// Send side of the I/O thread's connection for the IOCP and RIO backends.
+// Sends are posted from fixed buffers and complete asynchronously, so the
+// thread never polls for room. RIO registers the buffers once; IOCP still
+// has Winsock lock them for every send. Completions are tagged with the
+// connection they were posted on, so a late one from a closed socket is
+// never taken for a send on the next. Used from the I/O thread only.
+class CompletionSender
+{
+public:
+    CompletionSender()
+        : Backend(SEND_BACKEND_WINSOCK), Socket(INVALID_SOCKET), Generation(0), Memory(NULL), Port(NULL), SkipOnSuccess(false)
+        , BufferId(RIO_INVALID_BUFFERID), CompletionQueue(RIO_INVALID_CQ), RequestQueue(RIO_INVALID_RQ), Event(WSA_INVALID_EVENT)
+    {
+        memset(&Rio, 0, sizeof(Rio));
+    }
+
+    ~CompletionSender() { Release(); }
+
+    int GetBackend() const { return Backend; }
+    bool IsAttached() const { return Socket != INVALID_SOCKET; }
+    bool HasFreeSlot() const { return !FreeSlots.empty(); }
+    int InFlight() const { return static_cast<int>(Slots.size() - FreeSlots.size()); }
+
+    // Sets up NewBackend: the buffers, and the completion port or the RIO
+    // function table and completion queue. Returns false, with the Winsock
+    // backend selected, if it is not available on this system.
+    bool Initialize(int NewBackend)
+    {
+        Release();
+        if (NewBackend == SEND_BACKEND_WINSOCK)
+            return true;
+
+        const size_t Bytes = COMPLETION_SEND_SLOTS * COMPLETION_SEND_SLOT_BYTES;
+        Memory = static_cast<char*>(VirtualAlloc(NULL, Bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        if (Memory == NULL)
+            return false;
+
+        const bool Ready = (NewBackend == SEND_BACKEND_RIO) ? InitializeRio(Bytes) : InitializeIocp();
+        if (!Ready)
+        {
+            Release();
+            return false;
+        }
+
+        Backend = NewBackend;
+        Slots.assign(COMPLETION_SEND_SLOTS, Slot());
+        ResetSlots();
+        return true;
+    }
+
+    // Frees everything and selects the Winsock backend. The socket must
+    // already be detached.
+    void Release()
+    {
+        if (CompletionQueue != RIO_INVALID_CQ)
+            Rio.RIOCloseCompletionQueue(CompletionQueue);
+        if (BufferId != RIO_INVALID_BUFFERID)
+            Rio.RIODeregisterBuffer(BufferId);
+        if (Event != WSA_INVALID_EVENT)
+            WSACloseEvent(Event);
+        if (Port != NULL)
+            CloseHandle(Port);
+        if (Memory != NULL)
+            VirtualFree(Memory, 0, MEM_RELEASE);
+
+        CompletionQueue = RIO_INVALID_CQ;
+        BufferId = RIO_INVALID_BUFFERID;
+        Event = WSA_INVALID_EVENT;
+        Port = NULL;
+        Memory = NULL;
+        Slots.clear();
+        FreeSlots.clear();
+        Backend = SEND_BACKEND_WINSOCK;
+    }
+
+    // WSASocket flags for the sockets this backend sends on
+    DWORD SocketFlags() const
+    {
+        if (Backend == SEND_BACKEND_RIO)
+            return WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO;
+        if (Backend == SEND_BACKEND_IOCP)
+            return WSA_FLAG_OVERLAPPED;
+        return 0;
+    }
+
+    // Binds to a newly connected socket created with SocketFlags()
+    bool Attach(SOCKET NewSocket)
+    {
+        Generation++;
+
+        if (Backend == SEND_BACKEND_RIO)
+        {
+            // Receives stay on recv(); the one receive slot is never posted
+            RequestQueue = Rio.RIOCreateRequestQueue(NewSocket, 1, 1, COMPLETION_SEND_SLOTS, 1, CompletionQueue, CompletionQueue, NULL);
+            if (RequestQueue == RIO_INVALID_RQ)
+                return false;
+        }
+        else
+        {
+            if (CreateIoCompletionPort(reinterpret_cast<HANDLE>(NewSocket), Port, Generation, 0) != Port)
+                return false;
+
+            // Sends that finish at once are then completed inline, without a packet
+            SkipOnSuccess = SetFileCompletionNotificationModes(reinterpret_cast<HANDLE>(NewSocket), FILE_SKIP_COMPLETION_PORT_ON_SUCCESS) != FALSE;
+        }
+
+        Socket = NewSocket;
+        return true;
+    }
+
+    // After the socket is closed: waits briefly for the sends it still had
+    // in flight, which now complete with errors, then frees every buffer
+    void Detach()
+    {
+        if (Socket == INVALID_SOCKET)
+            return;
+
+        Socket = INVALID_SOCKET;
+        RequestQueue = RIO_INVALID_RQ;  // Went with its socket
+
+        const std::chrono::steady_clock::time_point Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(COMPLETION_DRAIN_MS);
+        while (InFlight() > 0 && std::chrono::steady_clock::now() < Deadline)
+            Reap(10);
+
+        ResetSlots();
+    }
+
+    // Copies up to one buffer's worth from the front of Queue into a free
+    // buffer and posts it; what was copied is consumed from Queue, calling
+    // Sent for each message completed. Returns false on a socket error.
+    // Bytes is 0 if the socket took nothing.
+    template <typename SentFunction>
+    bool Post(OutboundQueue& Queue, uint32_t& Ticks, size_t& Bytes, SentFunction Sent)
+    {
+        Ticks = 0;
+        Bytes = 0;
+
+        const int Index = FreeSlots.back();
+        char* Data = Memory + Index * COMPLETION_SEND_SLOT_BYTES;
+
+        const char* First;
+        const char* Second;
+        size_t FirstLength;
+        size_t SecondLength;
+        Queue.Peek(First, FirstLength, Second, SecondLength);
+
+        size_t Length = (FirstLength < COMPLETION_SEND_SLOT_BYTES) ? FirstLength : COMPLETION_SEND_SLOT_BYTES;
+        memcpy(Data, First, Length);
+        if (Length < COMPLETION_SEND_SLOT_BYTES && SecondLength > 0)
+        {
+            const size_t More = (SecondLength < COMPLETION_SEND_SLOT_BYTES - Length) ? SecondLength : COMPLETION_SEND_SLOT_BYTES - Length;
+            memcpy(Data + Length, Second, More);
+            Length += More;
+        }
+
+        Slot& Posted = Slots[Index];
+        bool Completed = false;
+        if (Backend == SEND_BACKEND_RIO)
+        {
+            RIO_BUF Buffer;
+            Buffer.BufferId = BufferId;
+            Buffer.Offset = static_cast<ULONG>(Index * COMPLETION_SEND_SLOT_BYTES);
+            Buffer.Length = static_cast<ULONG>(Length);
+            if (!Rio.RIOSend(RequestQueue, &Buffer, 1, 0, reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(RequestContext(Index)))))
+                return false;
+        }
+        else
+        {
+            memset(&Posted.Overlapped, 0, sizeof(Posted.Overlapped));
+
+            WSABUF Buffer;
+            Buffer.buf = Data;
+            Buffer.len = static_cast<ULONG>(Length);
+            DWORD Sent = 0;
+            if (WSASend(Socket, &Buffer, 1, &Sent, 0, &Posted.Overlapped, NULL) == SOCKET_ERROR)
+            {
+                const int Error = WSAGetLastError();
+                if (Error == WSAEWOULDBLOCK)
+                    return true;
+                if (Error != WSA_IO_PENDING)
+                    return false;
+            }
+            else
+            {
+                Completed = SkipOnSuccess;
+            }
+        }
+
+        if (!Completed)
+        {
+            Posted.Length = Length;
+            Posted.InFlight = true;
+            FreeSlots.pop_back();
+        }
+
+        Bytes = Length;
+        Ticks = Queue.Consume(Length, Sent);
+        return true;
+    }
+
+    // Takes finished sends off the port or completion queue, waiting up to
+    // TimeoutMs if there are none yet. Returns false if a send failed.
+    bool Reap(int TimeoutMs)
+    {
+        if (InFlight() == 0)
+            return true;
+
+        return (Backend == SEND_BACKEND_RIO) ? ReapRio(TimeoutMs) : ReapIocp(TimeoutMs);
+    }
+
+private:
+    struct Slot
+    {
+        Slot() : Length(0), InFlight(false) { memset(&Overlapped, 0, sizeof(Overlapped)); }
+
+        WSAOVERLAPPED Overlapped;   // IOCP only
+        size_t Length;
+        bool InFlight;
+    };
+
+    bool InitializeIocp()
+    {
+        Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+        return Port != NULL;
+    }
+
+    bool InitializeRio(size_t Bytes)
+    {
+        // The function table is looked up through any socket made for RIO
+        const SOCKET Probe = WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO);
+        if (Probe == INVALID_SOCKET)
+            return false;
+
+        GUID FunctionTableId = WSAID_MULTIPLE_RIO;
+        DWORD Returned = 0;
+        Rio.cbSize = sizeof(Rio);
+        const int Result = WSAIoctl(Probe, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &FunctionTableId, sizeof(FunctionTableId),
+            &Rio, sizeof(Rio), &Returned, NULL, NULL);
+        closesocket(Probe);
+        if (Result != 0)
+            return false;
+
+        BufferId = Rio.RIORegisterBuffer(Memory, static_cast<DWORD>(Bytes));
+        if (BufferId == RIO_INVALID_BUFFERID)
+            return false;
+
+        Event = WSACreateEvent();
+        if (Event == WSA_INVALID_EVENT)
+            return false;
+
+        RIO_NOTIFICATION_COMPLETION Notification;
+        Notification.Type = RIO_EVENT_COMPLETION;
+        Notification.Event.EventHandle = Event;
+        Notification.Event.NotifyReset = TRUE;
+        CompletionQueue = Rio.RIOCreateCompletionQueue(COMPLETION_QUEUE_ENTRIES, &Notification);
+        return CompletionQueue != RIO_INVALID_CQ;
+    }
+
+    bool ReapIocp(int TimeoutMs)
+    {
+        OVERLAPPED_ENTRY Entries[COMPLETION_SEND_SLOTS];
+        ULONG Count = 0;
+        if (!GetQueuedCompletionStatusEx(Port, Entries, COMPLETION_SEND_SLOTS, &Count, static_cast<DWORD>(TimeoutMs), FALSE))
+            return true;
+
+        bool Succeeded = true;
+        for (ULONG i = 0; i < Count; i++)
+        {
+            if (Entries[i].lpCompletionKey != Generation)
+                continue;
+
+            for (size_t Index = 0; Index < Slots.size(); Index++)
+            {
+                if (&Slots[Index].Overlapped == Entries[i].lpOverlapped)
+                {
+                    if (!Finish(static_cast<int>(Index), Entries[i].dwNumberOfBytesTransferred))
+                        Succeeded = false;
+                    break;
+                }
+            }
+        }
+        return Succeeded;
+    }
+
+    bool ReapRio(int TimeoutMs)
+    {
+        RIORESULT Results[COMPLETION_SEND_SLOTS];
+        ULONG Count = Rio.RIODequeueCompletion(CompletionQueue, Results, COMPLETION_SEND_SLOTS);
+        if (Count == 0 && TimeoutMs > 0)
+        {
+            // Still armed if the last wait timed out; that is not an error
+            Rio.RIONotify(CompletionQueue);
+            if (WaitForSingleObject(Event, static_cast<DWORD>(TimeoutMs)) == WAIT_OBJECT_0)
+                Count = Rio.RIODequeueCompletion(CompletionQueue, Results, COMPLETION_SEND_SLOTS);
+        }
+        if (Count == RIO_CORRUPT_CQ)
+            return false;
+
+        bool Succeeded = true;
+        for (ULONG i = 0; i < Count; i++)
+        {
+            if ((Results[i].RequestContext >> 8) != Generation)
+                continue;
+
+            const ULONG Transferred = (Results[i].Status == 0) ? Results[i].BytesTransferred : 0;
+            if (!Finish(static_cast<int>(Results[i].RequestContext & 0xFF), Transferred))
+                Succeeded = false;
+        }
+        return Succeeded;
+    }
+
+    // A send that moved fewer bytes than were posted has failed
+    bool Finish(int Index, DWORD Transferred)
+    {
+        Slot& Done = Slots[Index];
+        if (!Done.InFlight)
+            return true;
+
+        Done.InFlight = false;
+        FreeSlots.push_back(Index);
+        return Transferred == Done.Length;
+    }
+
+    ULONGLONG RequestContext(int Index) const
+    {
+        return (static_cast<ULONGLONG>(Generation) << 8) | static_cast<ULONGLONG>(Index);
+    }
+
+    void ResetSlots()
+    {
+        FreeSlots.clear();
+        for (size_t Index = 0; Index < Slots.size(); Index++)
+        {
+            Slots[Index].InFlight = false;
+            FreeSlots.push_back(static_cast<int>(Index));
+        }
+    }
+
+    int Backend;                // SendBackendEnum
+    SOCKET Socket;              // Attached socket, owned by the caller
+    ULONG_PTR Generation;       // Counts attached sockets; tags their completions
+    char* Memory;               // COMPLETION_SEND_SLOTS buffers back to back
+    std::vector<Slot> Slots;
+    std::vector<int> FreeSlots;
+
+    // IOCP
+    HANDLE Port;
+    bool SkipOnSuccess;
+
+    // RIO
+    RIO_EXTENSION_FUNCTION_TABLE Rio;
+    RIO_BUFFERID BufferId;
+    RIO_CQ CompletionQueue;
+    RIO_RQ RequestQueue;
+    WSAEVENT Event;
+};
+
+// Background I/O thread. Study instances only push encoded messages into
+// their own SPSC ring (a Channel); the worker owns the socket and does
+// connect, send, reconnect and drain, so network stalls never block the
+// chart update. One worker can carry several channels: in hub mode every
+// chart exporting to the same port shares one worker and one connection,
+// and each channel's ticks are tagged with its own symbol ID.
+// The worker never calls into Sierra Chart; it reports through atomics that
+// the study thread polls (and logs from). Control lines the consumer sends
+// back are handed to every channel for its study to read. Sends go out
+// through the Winsock, IOCP or RIO backend (SendBackendEnum); the
+// completion-based ones fall back to Winsock where they cannot be set up.
+class IoWorker
+{
+public:
+    // Tag bit marking a definition message (e.g. a binary symbol frame). The
+    // latest definition of each channel is replayed after every reconnect.
+    static const uint32_t TAG_DEFINITION = 0x80000000u;
+
+    // Tag bits holding the connection a message was queued for (0 = any),
+    // a bit marking messages the drop-oldest policy must not drop, and the
+    // tick count in the rest
+    static const uint32_t TAG_GENERATION_MASK = 0x7F000000u;
+    static const uint32_t TAG_PINNED = 0x00800000u;
+    static const uint32_t TAG_TICKS_MASK = 0x007FFFFFu;
+
+    // Control lines held per channel until its study reads them
+    static const size_t MAX_CONTROL_LINES = 256;
+
+    // Generation bits for the connection counted as ConnectCount. Never 0.
+    static uint32_t GenerationTag(int ConnectCount)
+    {
+        return static_cast<uint32_t>(ConnectCount % 127 + 1) << 24;
+    }
+
+    // One producer (study instance). Push* are called from that study only.
+    class Channel
+    {
+    public:
+        Channel() : TicksSent(0), DroppedTicks(0), BytesSent(0), SymbolId(0), Generation(0) {}
+
+        uint16_t GetSymbolId() const { return SymbolId; }
+        size_t GetRingBytes() const { return RingBytes; }
+        size_t QueuedBytes() const { return Ring.SizeBytes(); }
+
+        // Messages pushed from here on are only sent on the connection with
+        // this GenerationTag(), and dropped if a newer one has been made by
+        // the time the worker reaches them. 0 sends on any connection.
+        void SetGeneration(uint32_t NewGeneration) { Generation = NewGeneration; }
+
+        // Fails if the ring is full
+        bool Push(const char* Data, size_t Length, uint32_t Ticks, bool Pinned = false)
+        {
+            if (Ticks > TAG_TICKS_MASK)
+                Ticks = TAG_TICKS_MASK;
+            return Ring.TryPush(Data, static_cast<uint32_t>(Length), Ticks | Generation | (Pinned ? TAG_PINNED : 0));
+        }
+
+        bool PushDefinition(const char* Data, size_t Length)
+        {
+            return Ring.TryPush(Data, static_cast<uint32_t>(Length), TAG_DEFINITION);
+        }
+
+        // Moves the control lines received since the last call into Lines
+        void TakeControlLines(std::vector<std::string>& Lines)
+        {
+            Lines.clear();
+            std::lock_guard<std::mutex> Lock(ControlMutex);
+            Lines.swap(ControlLines);
+        }
+
+        // This chart's share of the connection, counted by the worker
+        std::atomic<int64_t> TicksSent;
+        std::atomic<int64_t> DroppedTicks;      // Dropped on the worker side (drop-oldest, oversize)
+        std::atomic<int64_t> BytesSent;
+
+    private:
+        friend class IoWorker;
+
+        SpscMessageRing Ring;
+        size_t RingBytes;
+        uint16_t SymbolId;
+        uint32_t Generation;            // Owned by the study thread
+        std::vector<char> Definition;   // Owned by the worker thread
+
+        std::mutex ControlMutex;
+        std::vector<std::string> ControlLines;
+    };
+
+    IoWorker()
+        : Shared(false), RefCount(0), StopRequested(false), Running(false)
+        , Connected(false), ConnectCount(0), DisconnectCount(0), WouldBlocks(0), SendCalls(0)
+        , OverflowPolicy(OVERFLOW_DROP_OLDEST), HeartbeatMs(0), SocketBufferBytes(0), SendBackend(SEND_BACKEND_WINSOCK)
+        , ActiveSendBackend(SEND_BACKEND_WINSOCK), SettingsOwner(NULL), Port(0), WireFormat(WIRE_FORMAT_JSON), QueueBytes(0), WorkPending(false), NextChannel(0)
+        , ConfiguredSendBackend(SEND_BACKEND_WINSOCK)
+    {
+    }
+
+    ~IoWorker()
+    {
+        Stop();
+        for (size_t i = 0; i < Channels.size(); i++)
+            delete Channels[i];
+    }
+
+    bool IsRunning() const { return Running; }
+    const std::string& GetHost() const { return Host; }
+    int GetPort() const { return Port; }
+    int GetWireFormat() const { return WireFormat; }
+
+    void Start(const char* NewHost, int NewPort, int NewWireFormat, size_t NewQueueBytes)
+    {
+        Stop();
+
+        Host = NewHost;
+        Port = NewPort;
+        WireFormat = NewWireFormat;
+        QueueBytes = NewQueueBytes;
+        SendQueue.Allocate(QueueBytes, QueueBytes / 64 + 16);
+        StopRequested = false;
+        Connected = false;
+        Running = true;
+        Thread = std::thread(&IoWorker::Run, this);
+    }
+
+    void Stop()
+    {
+        if (!Running)
+            return;
+
+        {
+            std::lock_guard<std::mutex> Lock(WakeMutex);
+            StopRequested = true;
+        }
+        Wake.notify_one();
+        if (Thread.joinable())
+            Thread.join();
+
+        Running = false;
+        Connected = false;
+    }
+
+    // Adds a producer with its own ring and the lowest free symbol ID.
+    // Returns NULL if all IDs are in use.
+    Channel* OpenChannel(size_t RingBytes)
+    {
+        std::lock_guard<std::mutex> Lock(ChannelsMutex);
+
+        uint16_t SymbolId = 0;
+        for (size_t i = 0; i < Channels.size(); )
+        {
+            if (Channels[i]->SymbolId == SymbolId)
+            {
+                if (SymbolId == 0xFFFF)
+                    return NULL;
+                SymbolId++;
+                i = 0;
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        Channel* pChannel = new Channel();
+        pChannel->Ring.Allocate(RingBytes);
+        pChannel->RingBytes = RingBytes;
+        pChannel->SymbolId = SymbolId;
+
+        // A chart joining a live connection takes up what the consumer
+        // already asked for
+        pChannel->ControlLines = FilterLines;
+        Channels.push_back(pChannel);
+
+        if (Scratch.size() < pChannel->Ring.Capacity())
+            Scratch.resize(pChannel->Ring.Capacity());
+
+        return pChannel;
+    }
+
+    // Messages the channel already handed to the send queue are still sent
+    void CloseChannel(Channel* pChannel)
+    {
+        std::lock_guard<std::mutex> Lock(ChannelsMutex);
+
+        for (size_t i = 0; i < Channels.size(); i++)
+        {
+            if (Channels[i] == pChannel)
+            {
+                Channels.erase(Channels.begin() + i);
+                break;
+            }
+        }
+
+        delete pChannel;
+    }
+
+    // Study thread: wake the worker after pushing. Remembered if the worker
+    // is not waiting, so its next wait returns at once.
+    void Notify()
+    {
+        {
+            std::lock_guard<std::mutex> Lock(WakeMutex);
+            WorkPending = true;
+        }
+        Wake.notify_one();
+    }
+
+    // Configuration shared by every instance using this worker. Guarded by
+    // WorkerRegistryMutex.
+    bool Shared;
+    int RefCount;
+
+    std::atomic<bool> StopRequested;
+    std::atomic<bool> Running;
+    std::atomic<bool> Connected;
+    std::atomic<int> ConnectCount;          // Connections made since the worker started
+    std::atomic<int> DisconnectCount;
+    std::atomic<int> WouldBlocks;           // Sends that found no room (Winsock) or no free buffer
+    std::atomic<int64_t> SendCalls;         // WSASend calls, or sends posted to the backend
+    std::atomic<int> OverflowPolicy;
+    std::atomic<int> HeartbeatMs;           // 0 = no heartbeats
+    std::atomic<int> SocketBufferBytes;     // SO_SNDBUF for the next connect; 0 = default
+    std::atomic<int> SendBackend;           // SendBackendEnum for the next connect
+    std::atomic<int> ActiveSendBackend;     // What the last connect got; Winsock if SendBackend was unavailable
+    std::atomic<const void*> SettingsOwner; // The chart whose inputs set the four above; NULL until one does
+
+private:
+    void Run()
+    {
+        while (!StopRequested)
+        {
+            if (!Connected)
+            {
+                // Polls a pending connect in short steps so Stop() is never
+                // held up, and sleeps through the backoff
+                Connection.Configure(Host.c_str(), Port, SocketBufferBytes);
+                if (!Connection.IsOpen())
+                    PrepareSender();
+                if (!Connection.Poll(50))
+                {
+                    const int RetryMs = Connection.MillisecondsUntilRetry();
+                    if (!Connection.IsOpen())
+                        WaitForWork((RetryMs < 500) ? RetryMs : 500);
+                    continue;
+                }
+
+                // Counted first: a study that sees Connected also sees this connection
+                ConnectCount++;
+                Connected = true;
+                OnConnected();
+
+                if (Sender.GetBackend() != SEND_BACKEND_WINSOCK && !Sender.Attach(Connection.GetSocket()))
+                    Sender.Release();
+                ActiveSendBackend = Sender.GetBackend();
+            }
+
+            if (Connection.PeerTimedOut(HeartbeatMs))
+            {
+                Disconnect();
+                continue;
+            }
+
+            if (Connection.HeartbeatDue(HeartbeatMs))
+            {
+                char Heartbeat[MAX_HEARTBEAT_MESSAGE_LENGTH];
+                const int Length = FormatHeartbeat(Heartbeat, WireFormat);
+                std::lock_guard<std::mutex> Lock(ChannelsMutex);
+                if (MakeRoom(static_cast<uint32_t>(Length)))
+                    SendQueue.Push(Heartbeat, Length, 0);
+            }
+
+            PullFromChannels();
+
+            if (Sender.IsAttached())
+            {
+                DrainWithCompletions();
+                continue;
+            }
+
+            if (SendQueue.Empty())
+            {
+                if (ReceiveControl())
+                    WaitForWork(50);
+                continue;
+            }
+
+            // Wait briefly for socket buffer space rather than spinning
+            WSAPOLLFD PollFd;
+            PollFd.fd = Connection.GetSocket();
+            PollFd.events = POLLWRNORM | POLLRDNORM;
+            PollFd.revents = 0;
+            if (WSAPoll(&PollFd, 1, 20) <= 0)
+                continue;
+
+            if (PollFd.revents & (POLLERR | POLLHUP))
+            {
+                Disconnect();
+                continue;
+            }
+
+            if ((PollFd.revents & POLLRDNORM) && !ReceiveControl())
+                continue;
+
+            if (PollFd.revents & POLLWRNORM)
+                Drain();
+        }
+
+        Disconnect();
+    }
+
+    void WaitForWork(int TimeoutMs)
+    {
+        std::unique_lock<std::mutex> Lock(WakeMutex);
+        Wake.wait_for(Lock, std::chrono::milliseconds(TimeoutMs), [this] { return WorkPending || StopRequested; });
+        WorkPending = false;
+    }
+
+    void OnConnected()
+    {
+        SendQueue.Clear();
+        Control.Clear();
+
+        if (WireFormat == WIRE_FORMAT_BINARY)
+        {
+            char Header[sizeof(WireStreamHeader)];
+            SendQueue.Push(Header, WriteStreamHeader(Header), 0, true);
+        }
+
+        std::lock_guard<std::mutex> Lock(ChannelsMutex);
+        for (size_t i = 0; i < Channels.size(); i++)
+        {
+            const std::vector<char>& Definition = Channels[i]->Definition;
+            if (!Definition.empty())
+                SendQueue.Push(Definition.data(), Definition.size(), 0, true, Channels[i]->SymbolId);
+
+            // Lines left from the last connection are stale
+            std::lock_guard<std::mutex> ControlLock(Channels[i]->ControlMutex);
+            Channels[i]->ControlLines.clear();
+        }
+        FilterLines.clear();
+    }
+
+    // Moves messages from the channel rings into the send queue, one message
+    // per channel in turn so a busy symbol cannot starve the others. With the
+    // drop-oldest policy room is made by dropping queued batches; otherwise
+    // messages wait in the rings and each study applies its own policy when
+    // its ring fills.
+    void PullFromChannels()
+    {
+        std::lock_guard<std::mutex> Lock(ChannelsMutex);
+
+        const uint32_t CurrentGeneration = GenerationTag(ConnectCount);
+        const size_t Count = Channels.size();
+        bool Progress = true;
+        while (Progress && Count > 0)
+        {
+            Progress = false;
+            for (size_t i = 0; i < Count; i++)
+            {
+                Channel& Source = *Channels[(NextChannel + i) % Count];
+
+                uint32_t Length;
+                uint32_t Tag;
+                if (!Source.Ring.Peek(Length, Tag))
+                    continue;
+
+                // Queued for an earlier connection: the study resends these
+                // from its history if the consumer asks
+                const uint32_t Generation = Tag & TAG_GENERATION_MASK;
+                if (!(Tag & TAG_DEFINITION) && Generation != 0 && Generation != CurrentGeneration)
+                {
+                    Source.Ring.Pop(Length);
+                    Progress = true;
+                    continue;
+                }
+
+                if (!MakeRoom(Length))
+                {
+                    // Larger than the whole queue: it can never be sent
+                    if (Length > SendQueue.CapacityBytes())
+                    {
+                        if (!(Tag & TAG_DEFINITION))
+                            Source.DroppedTicks += Tag & TAG_TICKS_MASK;
+                        Source.Ring.Pop(Length);
+                        Progress = true;
+                        continue;
+                    }
+
+                    NextChannel = (NextChannel + i) % Count;
+                    return;
+                }
+
+                Source.Ring.CopyFront(Scratch.data(), Length);
+                Source.Ring.Pop(Length);
+
+                if (Tag & TAG_DEFINITION)
+                {
+                    Source.Definition.assign(Scratch.data(), Scratch.data() + Length);
+                    SendQueue.Push(Scratch.data(), Length, 0, true, Source.SymbolId);
+                }
+                else
+                {
+                    SendQueue.Push(Scratch.data(), Length, Tag & TAG_TICKS_MASK, (Tag & TAG_PINNED) != 0, Source.SymbolId);
+                }
+
+                Progress = true;
+            }
+
+            NextChannel = (NextChannel + 1) % Count;
+        }
+    }
+
+    // Called with ChannelsMutex held
+    bool MakeRoom(uint32_t Length)
+    {
+        if (!SendQueue.CanFit(Length) && OverflowPolicy == OVERFLOW_DROP_OLDEST)
+        {
+            uint32_t Dropped;
+            uint32_t SourceId;
+            while (!SendQueue.CanFit(Length) && SendQueue.DropOldest(Dropped, SourceId))
+            {
+                Channel* Source = FindChannel(SourceId);
+                if (Source != NULL)
+                    Source->DroppedTicks += Dropped;
+            }
+        }
+
+        return SendQueue.CanFit(Length);
+    }
+
+    // The open channel with this symbol ID, or NULL (a message can outlive
+    // its channel). Called with ChannelsMutex held.
+    Channel* FindChannel(uint32_t SymbolId) const
+    {
+        for (size_t i = 0; i < Channels.size(); i++)
+        {
+            if (Channels[i]->SymbolId == SymbolId)
+                return Channels[i];
+        }
+        return NULL;
+    }
+
+    // Credits a sent message to its channel. Called with ChannelsMutex held.
+    void CountSent(uint32_t SourceId, uint32_t Ticks, uint32_t Bytes)
+    {
+        Channel* Source = FindChannel(SourceId);
+        if (Source == NULL)
+            return;
+        Source->TicksSent += Ticks;
+        Source->BytesSent += Bytes;
+    }
+
+    void Drain()
+    {
+        const char* First;
+        const char* Second;
+        size_t FirstLength;
+        size_t SecondLength;
+        SendQueue.Peek(First, FirstLength, Second, SecondLength);
+
+        WSABUF Buffers[2];
+        Buffers[0].buf = const_cast<char*>(First);
+        Buffers[0].len = static_cast<ULONG>(FirstLength);
+        Buffers[1].buf = const_cast<char*>(Second);
+        Buffers[1].len = static_cast<ULONG>(SecondLength);
+
+        DWORD BytesSent = 0;
+        if (WSASend(Connection.GetSocket(), Buffers, (SecondLength > 0) ? 2 : 1, &BytesSent, 0, NULL, NULL) == SOCKET_ERROR)
+        {
+            if (WSAGetLastError() == WSAEWOULDBLOCK)
+                WouldBlocks++;
+            else
+                Disconnect();
+            return;
+        }
+
+        SendCalls++;
+        std::lock_guard<std::mutex> Lock(ChannelsMutex);
+        SendQueue.Consume(BytesSent, [this](uint32_t SourceId, uint32_t Ticks, uint32_t Bytes) { CountSent(SourceId, Ticks, Bytes); });
+    }
+
+    // Sets up the requested backend before a socket is made for it. A
+    // backend that failed is not retried until the setting changes.
+    void PrepareSender()
+    {
+        const int Requested = SendBackend;
+        if (Requested != ConfiguredSendBackend)
+        {
+            ConfiguredSendBackend = Requested;
+            Sender.Initialize(Requested);
+        }
+        Connection.SetSocketFlags(Sender.SocketFlags());
+    }
+
+    // Completion-based counterpart of the poll and Drain(): the queue is
+    // copied into the sender's buffers as they come free, and the thread
+    // only waits on completions while every buffer is busy. Ticks and bytes
+    // count as sent once posted, as with a WSASend the socket accepted.
+    void DrainWithCompletions()
+    {
+        while (!SendQueue.Empty() && Sender.HasFreeSlot())
+        {
+            uint32_t Ticks;
+            size_t Bytes;
+            bool Posted;
+            {
+                std::lock_guard<std::mutex> Lock(ChannelsMutex);
+                Posted = Sender.Post(SendQueue, Ticks, Bytes,
+                    [this](uint32_t SourceId, uint32_t SentTicks, uint32_t SentBytes) { CountSent(SourceId, SentTicks, SentBytes); });
+            }
+            if (!Posted)
+            {
+                Disconnect();
+                return;
+            }
+            if (Bytes == 0)
+                break;
+
+            SendCalls++;
+        }
+
+        // Every buffer busy, or the socket has too many sends outstanding
+        const bool Blocked = !SendQueue.Empty();
+        if (Blocked)
+            WouldBlocks++;
+
+        if (!Sender.Reap(Blocked ? 20 : 0))
+        {
+            Disconnect();
+            return;
+        }
+        if (Blocked && Sender.InFlight() == 0)
+            WaitForWork(1);
+
+        // Control lines are still read with recv()
+        if (!ReceiveControl())
+            return;
+
+        if (SendQueue.Empty())
+            WaitForWork(50);
+    }
+
+    // Reads whatever the consumer has sent and passes complete lines to
+    // every channel. Returns false if the connection was closed.
+    bool ReceiveControl()
+    {
+        char Buffer[4096];
+        for (;;)
+        {
+            const int Received = recv(Connection.GetSocket(), Buffer, sizeof(Buffer), 0);
+            if (Received == 0 || (Received == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK))
+            {
+                Disconnect();
+                return false;
+            }
+            if (Received == SOCKET_ERROR)
+                break;
+
+            Connection.NoteReceived();
+            Control.Append(Buffer, static_cast<size_t>(Received));
+        }
+
+        std::string Line;
+        while (Control.NextLine(Line))
+        {
+            std::lock_guard<std::mutex> Lock(ChannelsMutex);
+            NoteFilterLine(Line);
+            for (size_t i = 0; i < Channels.size(); i++)
+            {
+                std::lock_guard<std::mutex> ControlLock(Channels[i]->ControlMutex);
+                if (Channels[i]->ControlLines.size() < MAX_CONTROL_LINES)
+                    Channels[i]->ControlLines.push_back(Line);
+            }
+        }
+
+        return true;
+    }
+
+    // Keeps the connection's filter and subscribe lines for channels opened
+    // later. A line replaces the earlier one it supersedes, so replaying them
+    // in order gives the same filter. Called with ChannelsMutex held.
+    void NoteFilterLine(const std::string& Line)
+    {
+        ControlMessage Message;
+        if (!ParseControlMessage(Line, Message) || (Message.Type != CONTROL_FILTER && Message.Type != CONTROL_SUBSCRIBE))
+            return;
+
+        for (size_t i = 0; i < FilterLines.size(); i++)
+        {
+            ControlMessage Earlier;
+            if (ParseControlMessage(FilterLines[i], Earlier) && Earlier.Type == Message.Type
+                && (Message.Type == CONTROL_SUBSCRIBE || Earlier.Symbol == Message.Symbol))
+            {
+                FilterLines.erase(FilterLines.begin() + i);
+                break;
+            }
+        }
+
+        if (FilterLines.size() < MAX_CONTROL_LINES)
+            FilterLines.push_back(Line);
+    }
+
+    void Disconnect()
+    {
+        Connection.Close();
+        Sender.Detach();
+        SendQueue.Clear();
+
+        if (Connected)
+        {
+            Connected = false;
+            DisconnectCount++;
+        }
+    }
+
+    // Fixed while the thread runs
+    std::string Host;
+    int Port;
+    int WireFormat;
+    size_t QueueBytes;
+    std::thread Thread;
+    std::mutex WakeMutex;
+    std::condition_variable Wake;
+    bool WorkPending;               // Notify() since the last wait; guarded by WakeMutex
+
+    // Held by the worker while it reads the rings, and by the study threads
+    // while they add or remove channels
+    std::mutex ChannelsMutex;
+    std::vector<Channel*> Channels;
+    size_t NextChannel;
+    std::vector<char> Scratch;
+    std::vector<std::string> FilterLines;   // See NoteFilterLine()
+
+    // Owned by the worker thread
+    TcpConnection Connection;
+    OutboundQueue SendQueue;
+    ControlLineReader Control;
+    CompletionSender Sender;
+    int ConfiguredSendBackend;      // SendBackend the sender was last set up for
+};
+
+// Every worker in the DLL. Shared (hub) workers are found by host, port and
+// wire format; a private worker serves a single study instance.
+static std::mutex WorkerRegistryMutex;
+static std::vector<IoWorker*> WorkerRegistry;
+
+// Returns a running worker for the given settings and counts a reference
+static IoWorker* AcquireWorker(const char* Host, int Port, int WireFormat, size_t QueueBytes, bool Shared)
+{
+    std::lock_guard<std::mutex> Lock(WorkerRegistryMutex);
+
+    if (Shared)
+    {
+        for (size_t i = 0; i < WorkerRegistry.size(); i++)
+        {
+            IoWorker* pWorker = WorkerRegistry[i];
+            if (pWorker->Shared && pWorker->GetHost() == Host && pWorker->GetPort() == Port && pWorker->GetWireFormat() == WireFormat)
+            {
+                pWorker->RefCount++;
+                return pWorker;
+            }
+        }
+    }
+
+    IoWorker* pWorker = new IoWorker();
+    pWorker->Shared = Shared;
+    pWorker->RefCount = 1;
+    pWorker->Start(Host, Port, WireFormat, QueueBytes);
+    WorkerRegistry.push_back(pWorker);
+    return pWorker;
+}
+
+// Stops and frees the worker when its last user lets go
+static void ReleaseWorker(IoWorker* pWorker)
+{
+    std::lock_guard<std::mutex> Lock(WorkerRegistryMutex);
+
+    if (--pWorker->RefCount > 0)
+        return;
+
+    for (size_t i = 0; i < WorkerRegistry.size(); i++)
+    {
+        if (WorkerRegistry[i] == pWorker)
+        {
+            WorkerRegistry.erase(WorkerRegistry.begin() + i);
+            break;
+        }
+    }
+
+    delete pWorker;
+}
+
+// Named shared-memory ring (TradeFlowShm.h) for consumers on the same host.
+// Every chart exporting to the same mapping shares one publisher; study
+// threads serialize on its mutex, so readers see a single writer.
+class ShmPublisher
+{
+public:
+    ShmPublisher() : RefCount(0), BytesPublished(0), Port(0), DataBytes(0), Mapping(NULL), View(NULL) {}
+    ~ShmPublisher() { Close(); }
+
+    int RefCount;   // Guarded by ShmRegistryMutex
+    std::atomic<int64_t> BytesPublished;
+
+    int GetPort() const { return Port; }
+    size_t GetDataBytes() const { return DataBytes; }
+
+    bool Open(int NewPort, size_t MinDataBytes)
+    {
+        Close();
+
+        const uint64_t Capacity = ShmRingDataCapacity(MinDataBytes);
+        const uint64_t MappingSize = ShmRingMappingSize(Capacity);
+
+        char Name[64];
+        snprintf(Name, sizeof(Name), "%s%d", SHM_NAME_PREFIX, NewPort);
+
+        Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+            static_cast<DWORD>(MappingSize >> 32), static_cast<DWORD>(MappingSize & 0xFFFFFFFF), Name);
+        if (Mapping == NULL)
+            return false;
+
+        // An existing mapping (kept open by a reader) may be smaller than asked for
+        View = MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(MappingSize));
+        if (View == NULL)
+        {
+            Close();
+            return false;
+        }
+
+        Writer.Initialize(View, Capacity);
+        Port = NewPort;
+        DataBytes = MinDataBytes;
+        return true;
+    }
+
+    void Close()
+    {
+        if (View != NULL)
+            UnmapViewOfFile(View);
+        if (Mapping != NULL)
+            CloseHandle(Mapping);
+
+        View = NULL;
+        Mapping = NULL;
+        Writer = ShmRingWriter();
+    }
+
+    void Publish(const char* Frames, size_t Length)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Writer.Publish(Frames, Length);
+        BytesPublished += Length;
+    }
+
+    // Lowest symbol ID not used by another chart on this mapping
+    uint16_t AcquireSymbolId()
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+
+        uint16_t SymbolId = 0;
+        while (Definitions.count(SymbolId) != 0 && SymbolId < 0xFFFF)
+            SymbolId++;
+
+        Definitions[SymbolId].clear();
+        return SymbolId;
+    }
+
+    void ReleaseSymbolId(uint16_t SymbolId)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Definitions.erase(SymbolId);
+        UpdateDefinitions();
+    }
+
+    // Publishes the symbol frame in the stream and records it in the
+    // definitions area for readers that attach (or resync) later
+    void DefineSymbol(uint16_t SymbolId, const char* Frame, size_t Length)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Definitions[SymbolId].assign(Frame, Frame + Length);
+        UpdateDefinitions();
+        Writer.Publish(Frame, Length);
+    }
+
+private:
+    void UpdateDefinitions()
+    {
+        std::vector<char> All;
+        for (std::map<uint16_t, std::vector<char>>::const_iterator it = Definitions.begin(); it != Definitions.end(); ++it)
+            All.insert(All.end(), it->second.begin(), it->second.end());
+
+        Writer.SetDefinitions(All.data(), All.size());
+    }
+
+    int Port;
+    size_t DataBytes;
+    HANDLE Mapping;
+    void* View;
+    std::mutex Mutex;
+    ShmRingWriter Writer;
+    std::map<uint16_t, std::vector<char>> Definitions;
+};
+
+static std::mutex ShmRegistryMutex;
+static std::vector<ShmPublisher*> ShmRegistry;
+
+// Returns the publisher for the port's mapping, creating it on first use
+static ShmPublisher* AcquireShmPublisher(int Port, size_t DataBytes)
+{
+    std::lock_guard<std::mutex> Lock(ShmRegistryMutex);
+
+    for (size_t i = 0; i < ShmRegistry.size(); i++)
+    {
+        if (ShmRegistry[i]->GetPort() == Port)
+        {
+            ShmRegistry[i]->RefCount++;
+            return ShmRegistry[i];
+        }
+    }
+
+    ShmPublisher* pPublisher = new ShmPublisher();
+    if (!pPublisher->Open(Port, DataBytes))
+    {
+        delete pPublisher;
+        return NULL;
+    }
+
+    pPublisher->RefCount = 1;
+    ShmRegistry.push_back(pPublisher);
+    return pPublisher;
+}
+
+static void ReleaseShmPublisher(ShmPublisher* pPublisher)
+{
+    std::lock_guard<std::mutex> Lock(ShmRegistryMutex);
+
+    if (--pPublisher->RefCount > 0)
+        return;
+
+    for (size_t i = 0; i < ShmRegistry.size(); i++)
+    {
+        if (ShmRegistry[i] == pPublisher)
+        {
+            ShmRegistry.erase(ShmRegistry.begin() + i);
+            break;
+        }
+    }
+
+    delete pPublisher;
+}
+
+// The WebSocket server thread wakes this often to pick up new connections
+// and sends that would have blocked
+static const int WS_POLL_INTERVAL_MS = 10;
+
+// WebSocket connections that have not completed the handshake by then are closed
+static const int WS_HANDSHAKE_TIMEOUT_MS = 5000;
+
+// Exporter-hosted WebSocket server (TradeFlowWebSocket.h) that the app
+// connects to directly, without the Node relay. Every chart exporting to the
+// same port shares one server. Published frames are framed once into the
+// broadcast ring; caught-up clients are sent to right away with non-blocking
+// sends from the publishing study thread, and the server thread accepts,
+// runs handshakes and finishes sends that would have blocked. A client that
+// falls a whole ring behind is disconnected rather than slowing the others.
+class WebSocketServer
+{
+public:
+    WebSocketServer()
+        : RefCount(0), BytesPublished(0), BytesSent(0), ClientConnects(0), ClientDisconnects(0), LappedClients(0)
+        , ClientCount(0), BacklogBytes(0), StopRequested(false), Port(0), RingBytes(0), AcceptRemote(false)
+        , ListenSocket(INVALID_SOCKET)
+    {
+    }
+
+    ~WebSocketServer() { Stop(); }
+
+    int RefCount;   // Guarded by WsRegistryMutex
+    std::atomic<int64_t> BytesPublished;
+    std::atomic<int64_t> BytesSent;
+    std::atomic<int> ClientConnects;
+    std::atomic<int> ClientDisconnects;
+    std::atomic<int> LappedClients;     // Disconnected for falling a ring behind
+    std::atomic<int> ClientCount;
+    std::atomic<int64_t> BacklogBytes;  // Furthest any client is behind
+
+    int GetPort() const { return Port; }
+    size_t GetRingBytes() const { return RingBytes; }
+    bool GetAcceptRemote() const { return AcceptRemote; }
+
+    bool Start(int NewPort, size_t NewRingBytes, bool NewAcceptRemote)
+    {
+        Stop();
+
+        ListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (ListenSocket == INVALID_SOCKET)
+            return false;
+
+        u_long mode = 1;
+        ioctlsocket(ListenSocket, FIONBIO, &mode);
+
+        sockaddr_in serverAddr;
+        memset(&serverAddr, 0, sizeof(serverAddr));
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_port = htons(static_cast<u_short>(NewPort));
+        serverAddr.sin_addr.s_addr = NewAcceptRemote ? htonl(INADDR_ANY) : inet_addr("127.0.0.1");
+
+        if (bind(ListenSocket, (SOCKADDR*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR
+            || listen(ListenSocket, SOMAXCONN) == SOCKET_ERROR)
+        {
+            closesocket(ListenSocket);
+            ListenSocket = INVALID_SOCKET;
+            return false;
+        }
+
+        Port = NewPort;
+        RingBytes = NewRingBytes;
+        AcceptRemote = NewAcceptRemote;
+        Ring.Allocate(NewRingBytes);
+        StopRequested = false;
+        Thread = std::thread(&WebSocketServer::Run, this);
+        return true;
+    }
+
+    void Stop()
+    {
+        StopRequested = true;
+        if (Thread.joinable())
+            Thread.join();
+
+        for (size_t i = 0; i < Clients.size(); i++)
+        {
+            closesocket(Clients[i]->Socket);
+            delete Clients[i];
+        }
+        Clients.clear();
+        ClientCount = 0;
+
+        if (ListenSocket != INVALID_SOCKET)
+            closesocket(ListenSocket);
+        ListenSocket = INVALID_SOCKET;
+    }
+
+    // Sends Frames to every client as one binary WebSocket message. Returns
+    // false if the message is bigger than the ring and was dropped.
+    bool Publish(const char* Frames, size_t Length)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        return Broadcast(Frames, Length);
+    }
+
+    // Lowest symbol ID not used by another chart on this server
+    uint16_t AcquireSymbolId()
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+
+        uint16_t SymbolId = 0;
+        while (Definitions.count(SymbolId) != 0 && SymbolId < 0xFFFF)
+            SymbolId++;
+
+        Definitions[SymbolId].clear();
+        return SymbolId;
+    }
+
+    void ReleaseSymbolId(uint16_t SymbolId)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Definitions.erase(SymbolId);
+    }
+
+    // Broadcasts the symbol frame and keeps it for clients that connect later
+    void DefineSymbol(uint16_t SymbolId, const char* Frame, size_t Length)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Definitions[SymbolId].assign(Frame, Frame + Length);
+        Broadcast(Frame, Length);
+    }
+
+private:
+    struct Client
+    {
+        SOCKET Socket;
+        bool Open;                  // Handshake done; sent from the broadcast ring
+        bool Closing;               // Close once Private has been sent (rejected handshake)
+        bool Failed;                // Close on the server thread's next pass
+        std::string Request;        // Handshake request received so far
+        std::vector<uint8_t> Inbound;   // Client frames not yet complete
+        std::string Private;        // Handshake reply and stream start, sent ahead of the ring
+        size_t PrivateSent;
+        uint64_t Cursor;            // Next ring byte to send
+        std::chrono::steady_clock::time_point AcceptedAt;
+    };
+
+    // Frames and sends one message. Returns false if it can never fit in the
+    // ring. Caller holds Mutex.
+    bool Broadcast(const char* Frames, size_t Length)
+    {
+        if (!Ring.AppendMessage(Frames, Length))
+            return false;
+        BytesPublished += Length;
+
+        const uint64_t WriteCursor = Ring.GetWriteCursor();
+        for (size_t i = 0; i < Clients.size(); i++)
+        {
+            Client& Target = *Clients[i];
+            if (!Target.Open || Target.Failed)
+                continue;
+
+            if (WriteCursor - Target.Cursor > Ring.Capacity())
+            {
+                Target.Failed = true;
+                LappedClients++;
+                continue;
+            }
+
+            SendPending(Target);
+        }
+        return true;
+    }
+
+    bool HasPending(const Client& Target) const
+    {
+        return Target.PrivateSent < Target.Private.size()
+            || (Target.Open && Target.Cursor != Ring.GetWriteCursor());
+    }
+
+    // Sends as much as the socket takes: the private bytes first, then the
+    // ring from the client's cursor. Caller holds Mutex.
+    void SendPending(Client& Target)
+    {
+        if (Target.PrivateSent < Target.Private.size())
+        {
+            WSABUF Buffer;
+            Buffer.buf = const_cast<char*>(Target.Private.data() + Target.PrivateSent);
+            Buffer.len = static_cast<ULONG>(Target.Private.size() - Target.PrivateSent);
+
+            DWORD Sent = 0;
+            if (WSASend(Target.Socket, &Buffer, 1, &Sent, 0, NULL, NULL) == SOCKET_ERROR)
+            {
+                if (WSAGetLastError() != WSAEWOULDBLOCK)
+                    Target.Failed = true;
+                return;
+            }
+
+            Target.PrivateSent += Sent;
+            if (Target.PrivateSent < Target.Private.size())
+                return;
+
+            Target.Private.clear();
+            Target.PrivateSent = 0;
+            if (Target.Closing)
+            {
+                Target.Failed = true;
+                return;
+            }
+        }
+
+        if (!Target.Open || Target.Cursor == Ring.GetWriteCursor())
+            return;
+
+        const char* First;
+        const char* Second;
+        size_t FirstLength;
+        size_t SecondLength;
+        Ring.Peek(Target.Cursor, First, FirstLength, Second, SecondLength);
+
+        WSABUF Buffers[2];
+        Buffers[0].buf = const_cast<char*>(First);
+        Buffers[0].len = static_cast<ULONG>(FirstLength);
+        Buffers[1].buf = const_cast<char*>(Second);
+        Buffers[1].len = static_cast<ULONG>(SecondLength);
+
+        DWORD Sent = 0;
+        if (WSASend(Target.Socket, Buffers, (SecondLength > 0) ? 2 : 1, &Sent, 0, NULL, NULL) == SOCKET_ERROR)
+        {
+            if (WSAGetLastError() != WSAEWOULDBLOCK)
+                Target.Failed = true;
+            return;
+        }
+
+        Target.Cursor += Sent;
+        BytesSent += Sent;
+    }
+
+    void Run()
+    {
+        std::vector<WSAPOLLFD> PollFds;
+        while (!StopRequested)
+        {
+            PollFds.clear();
+            WSAPOLLFD ListenFd;
+            ListenFd.fd = ListenSocket;
+            ListenFd.events = POLLRDNORM;
+            ListenFd.revents = 0;
+            PollFds.push_back(ListenFd);
+
+            {
+                std::lock_guard<std::mutex> Lock(Mutex);
+                RemoveClosedClients();
+
+                int64_t Backlog = 0;
+                for (size_t i = 0; i < Clients.size(); i++)
+                {
+                    WSAPOLLFD ClientFd;
+                    ClientFd.fd = Clients[i]->Socket;
+                    ClientFd.events = POLLRDNORM | (HasPending(*Clients[i]) ? POLLWRNORM : 0);
+                    ClientFd.revents = 0;
+                    PollFds.push_back(ClientFd);
+
+                    if (Clients[i]->Open && static_cast<int64_t>(Ring.GetWriteCursor() - Clients[i]->Cursor) > Backlog)
+                        Backlog = static_cast<int64_t>(Ring.GetWriteCursor() - Clients[i]->Cursor);
+                }
+                BacklogBytes = Backlog;
+            }
+
+            // Only this thread adds or removes clients, so PollFds[i + 1]
+            // stays Clients[i] until the next pass
+            if (WSAPoll(PollFds.data(), static_cast<ULONG>(PollFds.size()), WS_POLL_INTERVAL_MS) < 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(WS_POLL_INTERVAL_MS));
+                continue;
+            }
+
+            if (PollFds[0].revents & POLLRDNORM)
+                AcceptClients();
+
+            std::lock_guard<std::mutex> Lock(Mutex);
+            for (size_t i = 1; i < PollFds.size(); i++)
+            {
+                Client& Target = *Clients[i - 1];
+                const short Events = PollFds[i].revents;
+                if (Events & POLLRDNORM)
+                    Receive(Target);
+                if (Events & POLLWRNORM)
+                    SendPending(Target);
+                if (Events & (POLLERR | POLLHUP | POLLNVAL))
+                    Target.Failed = true;
+            }
+        }
+    }
+
+    void AcceptClients()
+    {
+        for (;;)
+        {
+            SOCKET Socket = accept(ListenSocket, NULL, NULL);
+            if (Socket == INVALID_SOCKET)
+                return;
+
+            u_long mode = 1;
+            ioctlsocket(Socket, FIONBIO, &mode);
+
+            // Ticks go out as soon as they are published
+            const BOOL NoDelay = TRUE;
+            setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&NoDelay), sizeof(NoDelay));
+
+            Client* pClient = new Client();
+            pClient->Socket = Socket;
+            pClient->Open = false;
+            pClient->Closing = false;
+            pClient->Failed = false;
+            pClient->PrivateSent = 0;
+            pClient->Cursor = 0;
+            pClient->AcceptedAt = std::chrono::steady_clock::now();
+
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Clients.push_back(pClient);
+        }
+    }
+
+    // Reads the handshake, then client frames, of which only close matters.
+    // Caller holds Mutex.
+    void Receive(Client& Target)
+    {
+        char Buffer[4096];
+        const int Received = recv(Target.Socket, Buffer, sizeof(Buffer), 0);
+        if (Received == 0 || (Received == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK))
+        {
+            Target.Failed = true;
+            return;
+        }
+        if (Received <= 0)
+            return;
+
+        if (!Target.Open)
+        {
+            if (Target.Closing)
+                return;
+
+            Target.Request.append(Buffer, Received);
+            if (Target.Request.find("\r\n\r\n") == std::string::npos)
+            {
+                if (Target.Request.size() > WS_MAX_REQUEST_LENGTH)
+                    Target.Failed = true;
+                return;
+            }
+
+            if (BuildHandshakeResponse(Target.Request, Target.Private))
+                OpenClient(Target);
+            else
+                Target.Closing = true;
+
+            Target.Request.clear();
+            SendPending(Target);
+            return;
+        }
+
+        Target.Inbound.insert(Target.Inbound.end(), Buffer, Buffer + Received);
+
+        size_t Offset = 0;
+        uint8_t Opcode;
+        size_t FrameLength;
+        while ((FrameLength = MeasureClientFrame(Target.Inbound.data() + Offset, Target.Inbound.size() - Offset, Opcode)) > 0)
+        {
+            // Replies could not be interleaved with a partly sent message,
+            // and browsers do not ping, so anything but close is ignored
+            if (Opcode == WS_OPCODE_CLOSE)
+            {
+                Target.Failed = true;
+                return;
+            }
+            Offset += FrameLength;
+        }
+
+        Target.Inbound.erase(Target.Inbound.begin(), Target.Inbound.begin() + Offset);
+        if (Target.Inbound.size() > WS_MAX_REQUEST_LENGTH)
+            Target.Failed = true;
+    }
+
+    // Queues the stream header and current symbol definitions as the
+    // client's first message and starts it at the ring's write cursor
+    void OpenClient(Client& Target)
+    {
+        std::vector<char> Start(sizeof(WireStreamHeader));
+        WriteStreamHeader(Start.data());
+        for (std::map<uint16_t, std::vector<char>>::const_iterator it = Definitions.begin(); it != Definitions.end(); ++it)
+            Start.insert(Start.end(), it->second.begin(), it->second.end());
+
+        char Header[WS_MAX_FRAME_HEADER];
+        Target.Private.append(Header, WriteWebSocketFrameHeader(Header, WS_OPCODE_BINARY, Start.size()));
+        Target.Private.append(Start.data(), Start.size());
+
+        Target.Open = true;
+        Target.Cursor = Ring.GetWriteCursor();
+        ClientConnects++;
+    }
+
+    // Caller holds Mutex
+    void RemoveClosedClients()
+    {
+        const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < Clients.size(); )
+        {
+            Client* pClient = Clients[i];
+            if (!pClient->Open && !pClient->Closing && Now - pClient->AcceptedAt > std::chrono::milliseconds(WS_HANDSHAKE_TIMEOUT_MS))
+                pClient->Failed = true;
+
+            if (!pClient->Failed)
+            {
+                i++;
+                continue;
+            }
+
+            if (pClient->Open)
+                ClientDisconnects++;
+            closesocket(pClient->Socket);
+            delete pClient;
+            Clients.erase(Clients.begin() + i);
+        }
+
+        int Open = 0;
+        for (size_t i = 0; i < Clients.size(); i++)
+            Open += Clients[i]->Open ? 1 : 0;
+        ClientCount = Open;
+    }
+
+    std::atomic<bool> StopRequested;
+    int Port;
+    size_t RingBytes;
+    bool AcceptRemote;
+    std::thread Thread;
+
+    SOCKET ListenSocket;    // Owned by the server thread once started
+
+    // Held by the publishing study threads and by the server thread while
+    // it touches clients or the ring
+    std::mutex Mutex;
+    WsBroadcastRing Ring;
+    std::vector<Client*> Clients;
+    std::map<uint16_t, std::vector<char>> Definitions;
+};
+
+static std::mutex WsRegistryMutex;
+static std::vector<WebSocketServer*> WsRegistry;
+
+// Returns the running server for the port, starting it on first use
+static WebSocketServer* AcquireWebSocketServer(int Port, size_t RingBytes, bool AcceptRemote)
+{
+    std::lock_guard<std::mutex> Lock(WsRegistryMutex);
+
+    for (size_t i = 0; i < WsRegistry.size(); i++)
+    {
+        if (WsRegistry[i]->GetPort() == Port)
+        {
+            WsRegistry[i]->RefCount++;
+            return WsRegistry[i];
+        }
+    }
+
+    WebSocketServer* pServer = new WebSocketServer();
+    if (!pServer->Start(Port, RingBytes, AcceptRemote))
+    {
+        delete pServer;
+        return NULL;
+    }
+
+    pServer->RefCount = 1;
+    WsRegistry.push_back(pServer);
+    return pServer;
+}
+
+static void ReleaseWebSocketServer(WebSocketServer* pServer)
+{
+    std::lock_guard<std::mutex> Lock(WsRegistryMutex);
+
+    if (--pServer->RefCount > 0)
+        return;
+
+    for (size_t i = 0; i < WsRegistry.size(); i++)
+    {
+        if (WsRegistry[i] == pServer)
+        {
+            WsRegistry.erase(WsRegistry.begin() + i);
+            break;
+        }
+    }
+
+    delete pServer;
+}
+
+// Control lines held for a chart until its next update; more are dropped
+static const size_t MULTICAST_MAX_PENDING_REQUESTS = 64;
+
+// Symbol definitions and newest sequences are repeated on the group this often
+static const int MULTICAST_ANNOUNCE_INTERVAL_MS = 1000;
+
+// SO_SNDBUF of the multicast socket unless the socket buffer input is set.
+// Datagrams that do not fit are lost, so it covers a resend as well as a burst.
+static const int MULTICAST_SOCKET_BUFFER_BYTES = 1024 * 1024;
+
+// A control line from a multicast receiver, answered to its address
+struct MulticastRequest
+{
+    sockaddr_in From;
+    ControlMessage Message;
+};
+
+// UDP multicast publisher (TradeFlowMulticast.h). Every chart exporting to
+// the same group and port shares one; any number of receivers on the LAN
+// join the group at no cost to the exporter. Its socket also takes the
+// receivers' unicast control lines. Only the study threads hold the tick
+// history, so each chart picks up the requests for its symbol from an inbox
+// here and answers them with SendTo. Like the shared-memory publisher it
+// has no thread: sends and receives are non-blocking calls made by the
+// study threads, serialized on its mutex.
+class MulticastPublisher
+{
+public:
+    MulticastPublisher()
+        : RefCount(0), BytesPublished(0), DroppedDatagrams(0), Requests(0), Port(0), Ttl(0)
+        , Socket(INVALID_SOCKET), RetransmitPort(0)
+    {
+    }
+
+    ~MulticastPublisher() { Close(); }
+
+    int RefCount;   // Guarded by McRegistryMutex
+    std::atomic<int64_t> BytesPublished;
+    std::atomic<int> DroppedDatagrams;  // Refused by the socket (send buffer full) or too large
+    std::atomic<int> Requests;          // Control lines received
+
+    const std::string& GetGroup() const { return Group; }
+    int GetPort() const { return Port; }
+    int GetTtl() const { return Ttl; }
+    const std::string& GetInterface() const { return Interface; }
+
+    bool Open(const std::string& NewGroup, int NewPort, int NewTtl, const std::string& NewInterface, int SocketBufferBytes)
+    {
+        Close();
+
+        memset(&GroupAddress, 0, sizeof(GroupAddress));
+        GroupAddress.sin_family = AF_INET;
+        GroupAddress.sin_port = htons(static_cast<u_short>(NewPort));
+        GroupAddress.sin_addr.s_addr = inet_addr(NewGroup.c_str());
+        if (!IN_MULTICAST(ntohl(GroupAddress.sin_addr.s_addr)))
+            return false;
+
+        Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (Socket == INVALID_SOCKET)
+            return false;
+
+        u_long mode = 1;
+        ioctlsocket(Socket, FIONBIO, &mode);
+
+        // An ephemeral port for the requests; every datagram names it
+        sockaddr_in Local;
+        memset(&Local, 0, sizeof(Local));
+        Local.sin_family = AF_INET;
+        Local.sin_addr.s_addr = htonl(INADDR_ANY);
+        int LocalLength = sizeof(Local);
+        if (bind(Socket, (SOCKADDR*)&Local, sizeof(Local)) == SOCKET_ERROR
+            || getsockname(Socket, (SOCKADDR*)&Local, &LocalLength) == SOCKET_ERROR)
+        {
+            Close();
+            return false;
+        }
+
+        const int TtlValue = NewTtl;
+        setsockopt(Socket, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&TtlValue), sizeof(TtlValue));
+
+        // Receivers on this machine get the group too
+        const BOOL Loop = TRUE;
+        setsockopt(Socket, IPPROTO_IP, IP_MULTICAST_LOOP, reinterpret_cast<const char*>(&Loop), sizeof(Loop));
+
+        if (!NewInterface.empty())
+        {
+            in_addr InterfaceAddress;
+            InterfaceAddress.s_addr = inet_addr(NewInterface.c_str());
+            if (InterfaceAddress.s_addr == INADDR_NONE
+                || setsockopt(Socket, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char*>(&InterfaceAddress), sizeof(InterfaceAddress)) == SOCKET_ERROR)
+            {
+                Close();
+                return false;
+            }
+        }
+
+        const int BufferBytes = (SocketBufferBytes > 0) ? SocketBufferBytes : MULTICAST_SOCKET_BUFFER_BYTES;
+        setsockopt(Socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&BufferBytes), sizeof(BufferBytes));
+
+        std::random_device Seed;
+        RetransmitPort = ntohs(Local.sin_port);
+        Packetizer.Configure(Seed(), RetransmitPort);
+        Group = NewGroup;
+        Port = NewPort;
+        Ttl = NewTtl;
+        Interface = NewInterface;
+        LastAnnounceClock = std::chrono::steady_clock::time_point();
+        return true;
+    }
+
+    void Close()
+    {
+        if (Socket != INVALID_SOCKET)
+            closesocket(Socket);
+        Socket = INVALID_SOCKET;
+    }
+
+    // Sends whole frames to the group
+    void Publish(const char* Frames, size_t Length)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Send(GroupAddress, Frames, Length, false);
+    }
+
+    // Sends whole frames to one receiver, outside the packet sequence
+    void SendTo(const sockaddr_in& To, const char* Frames, size_t Length)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Send(To, Frames, Length, true);
+    }
+
+    // Lowest symbol ID not used by another chart on this group
+    uint16_t AcquireSymbolId()
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+
+        uint16_t SymbolId = 0;
+        while (Symbols.count(SymbolId) != 0 && SymbolId < 0xFFFF)
+            SymbolId++;
+
+        Symbols[SymbolId] = Symbol();
+        return SymbolId;
+    }
+
+    void ReleaseSymbolId(uint16_t SymbolId)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Symbols.erase(SymbolId);
+    }
+
+    // Publishes the symbol frame and keeps it for the announcements
+    void DefineSymbol(uint16_t SymbolId, const char* Name, const char* Frame, size_t Length)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Symbol& Entry = Symbols[SymbolId];
+        Entry.Name = Name;
+        Entry.Definition.assign(Frame, Frame + Length);
+        Entry.LastSequence = 0;
+        Entry.Inbox.clear();
+        Send(GroupAddress, Frame, Length, false);
+    }
+
+    // Newest tick published for the symbol, for the announcements
+    void NoteSequence(uint16_t SymbolId, int64_t LastSequence)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Symbols[SymbolId].LastSequence = LastSequence;
+    }
+
+    // Reads the control lines received since the last call into the inboxes
+    // of the charts they name (every chart when they name none), and repeats
+    // the announcements when they are due. Called on every chart's update.
+    void Service(std::chrono::steady_clock::time_point Now)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+
+        char Buffer[CONTROL_MAX_LINE_LENGTH + 1];
+        for (;;)
+        {
+            sockaddr_in From;
+            int FromLength = sizeof(From);
+            const int Received = recvfrom(Socket, Buffer, sizeof(Buffer), 0, (SOCKADDR*)&From, &FromLength);
+            if (Received == SOCKET_ERROR)
+            {
+                // Windows reports an ICMP port unreachable for an earlier
+                // unicast reply here; the next datagram may still be fine
+                if (WSAGetLastError() == WSAECONNRESET)
+                    continue;
+                break;
+            }
+
+            // One or more control lines per datagram; a last line without
+            // its newline is taken as complete
+            ControlLineReader Reader;
+            Reader.Append(Buffer, Received);
+            Reader.Append("\n", 1);
+
+            std::string Line;
+            while (Reader.NextLine(Line))
+            {
+                MulticastRequest Request;
+                Request.From = From;
+                if (!ParseControlMessage(Line, Request.Message))
+                    continue;
+
+                Requests++;
+                for (std::map<uint16_t, Symbol>::iterator it = Symbols.begin(); it != Symbols.end(); ++it)
+                {
+                    if ((Request.Message.Symbol.empty() || Request.Message.Symbol == it->second.Name)
+                        && it->second.Inbox.size() < MULTICAST_MAX_PENDING_REQUESTS)
+                        it->second.Inbox.push_back(Request);
+                }
+            }
+        }
+
+        if (Now - LastAnnounceClock >= std::chrono::milliseconds(MULTICAST_ANNOUNCE_INTERVAL_MS))
+        {
+            LastAnnounceClock = Now;
+            Announce();
+        }
+    }
+
+    // Takes the requests waiting for the chart with SymbolId
+    void TakeRequests(uint16_t SymbolId, std::vector<MulticastRequest>& Out)
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        std::map<uint16_t, Symbol>::iterator it = Symbols.find(SymbolId);
+        if (it == Symbols.end())
+            return;
+
+        Out.insert(Out.end(), it->second.Inbox.begin(), it->second.Inbox.end());
+        it->second.Inbox.clear();
+    }
+
+private:
+    struct Symbol
+    {
+        Symbol() : LastSequence(0) {}
+
+        std::string Name;
+        std::vector<char> Definition;       // Symbol frame; empty until defined
+        int64_t LastSequence;               // 0 until ticks are published
+        std::vector<MulticastRequest> Inbox;
+    };
+
+    // Caller holds Mutex
+    void Send(const sockaddr_in& To, const char* Frames, size_t Length, bool Retransmit)
+    {
+        DroppedDatagrams += Packetizer.Packetize(Frames, Length, Retransmit, [&](const char* Data, size_t DataLength)
+        {
+            if (sendto(Socket, Data, static_cast<int>(DataLength), 0, (const SOCKADDR*)&To, sizeof(To)) == SOCKET_ERROR)
+                DroppedDatagrams++;
+            else
+                BytesPublished += static_cast<int64_t>(DataLength);
+        });
+    }
+
+    // Every definition, then every symbol's newest sequence. Caller holds Mutex.
+    void Announce()
+    {
+        std::vector<char> Frames;
+        for (std::map<uint16_t, Symbol>::const_iterator it = Symbols.begin(); it != Symbols.end(); ++it)
+            Frames.insert(Frames.end(), it->second.Definition.begin(), it->second.Definition.end());
+
+        for (std::map<uint16_t, Symbol>::const_iterator it = Symbols.begin(); it != Symbols.end(); ++it)
+        {
+            if (it->second.Definition.empty() || it->second.LastSequence == 0)
+                continue;
+
+            WireSequence Sequence;
+            Sequence.LastSequence = it->second.LastSequence;
+            Sequence.SymbolId = it->first;
+            Sequence.Reserved = 0;
+            Sequence.Reserved2 = 0;
+
+            char Frame[sizeof(WireFrameHeader) + sizeof(WireSequence)];
+            const int HeaderLength = WriteFrameHeader(Frame, WIRE_FRAME_SEQUENCE, sizeof(Sequence));
+            memcpy(Frame + HeaderLength, &Sequence, sizeof(Sequence));
+            Frames.insert(Frames.end(), Frame, Frame + sizeof(Frame));
+        }
+
+        if (!Frames.empty())
+            Send(GroupAddress, Frames.data(), Frames.size(), false);
+    }
+
+    std::string Group;
+    int Port;
+    int Ttl;
+    std::string Interface;
+    SOCKET Socket;
+    sockaddr_in GroupAddress;
+    uint16_t RetransmitPort;
+    std::chrono::steady_clock::time_point LastAnnounceClock;
+
+    std::mutex Mutex;
+    MulticastPacketizer Packetizer;
+    std::map<uint16_t, Symbol> Symbols;
+};
+
+static std::mutex McRegistryMutex;
+static std::vector<MulticastPublisher*> McRegistry;
+
+// Returns the publisher for the group and port, opening it on first use
+static MulticastPublisher* AcquireMulticastPublisher(const std::string& Group, int Port, int Ttl, const std::string& Interface, int SocketBufferBytes)
+{
+    std::lock_guard<std::mutex> Lock(McRegistryMutex);
+
+    for (size_t i = 0; i < McRegistry.size(); i++)
+    {
+        if (McRegistry[i]->GetGroup() == Group && McRegistry[i]->GetPort() == Port)
+        {
+            McRegistry[i]->RefCount++;
+            return McRegistry[i];
+        }
+    }
+
+    MulticastPublisher* pPublisher = new MulticastPublisher();
+    if (!pPublisher->Open(Group, Port, Ttl, Interface, SocketBufferBytes))
+    {
+        delete pPublisher;
+        return NULL;
+    }
+
+    pPublisher->RefCount = 1;
+    McRegistry.push_back(pPublisher);
+    return pPublisher;
+}
+
+static void ReleaseMulticastPublisher(MulticastPublisher* pPublisher)
+{
+    std::lock_guard<std::mutex> Lock(McRegistryMutex);
+
+    if (--pPublisher->RefCount > 0)
+        return;
+
+    for (size_t i = 0; i < McRegistry.size(); i++)
+    {
+        if (McRegistry[i] == pPublisher)
+        {
+            McRegistry.erase(McRegistry.begin() + i);
+            break;
+        }
+    }
+
+    delete pPublisher;
+}
+
+// Optional on-disk tick recorder (layout in TradeFlowRecorder.h). The study
+// thread only appends records to a pending buffer; a writer thread moves
+// them to the current segment in large sequential writes. Durability is
+// group-committed once per commit interval: records and index are flushed
+// first, then the header's record count is published and flushed. Segments
+// are preallocated to their full size and rotated when full. Like the I/O
+// worker, the writer never calls into Sierra Chart and reports through
+// atomics that the study thread polls.
+class TickRecorder
+{
+public:
+    // The writer is woken early once this much is pending
+    static const size_t WRITE_CHUNK_BYTES = 1024 * 1024;
+
+    // Records beyond this are dropped while the disk cannot keep up
+    static const size_t MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+    // Trade time covered by one index entry
+    static const uint32_t INDEX_INTERVAL_MS = 1000;
+
+    // Names tried for a segment whose files already exist
+    static const uint32_t MAX_SESSION_SUFFIX = 100;
+
+    TickRecorder()
+        : StopRequested(false), Running(false), RecordsCommitted(0), DroppedRecords(0), Segments(0), WriteErrors(0), LastError(0)
+        , SegmentBytes(0), CommitIntervalMs(1000), TickSize(0.0), PriceDecimals(0)
+        , File(INVALID_HANDLE_VALUE), IndexFile(INVALID_HANDLE_VALUE), SegmentNumber(0), SessionSuffix(0), SegmentRecords(0), IndexBytes(0)
+    {
+        memset(&Header, 0, sizeof(Header));
+    }
+
+    ~TickRecorder() { Stop(); }
+
+    const std::string& GetDirectory() const { return Directory; }
+    const std::string& GetSymbol() const { return Symbol; }
+    uint64_t GetSegmentBytes() const { return SegmentBytes; }
+    int GetCommitIntervalMs() const { return CommitIntervalMs; }
+    double GetTickSize() const { return TickSize; }
+
+    // Segment files are named <Directory>\<Symbol>_<UTC start time>_<segment>
+    void Start(const char* NewDirectory, const char* NewSymbol, double NewTickSize, int NewPriceDecimals,
+        uint64_t NewSegmentBytes, int NewCommitIntervalMs)
+    {
+        Stop();
+
+        Directory = NewDirectory;
+        Symbol = NewSymbol;
+        TickSize = NewTickSize;
+        PriceDecimals = NewPriceDecimals;
+        SegmentBytes = NewSegmentBytes;
+        CommitIntervalMs = NewCommitIntervalMs;
+
+        SYSTEMTIME Now;
+        GetSystemTime(&Now);
+        char StartTime[32];
+        snprintf(StartTime, sizeof(StartTime), "_%04u%02u%02u_%02u%02u%02u",
+            Now.wYear, Now.wMonth, Now.wDay, Now.wHour, Now.wMinute, Now.wSecond);
+
+        // Symbols such as "F.US.EPZ25" or "ESZ5:CME" become file-name safe
+        SessionName.clear();
+        for (size_t i = 0; i < Symbol.size(); i++)
+        {
+            const char c = Symbol[i];
+            const bool Safe = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-' || c == '.';
+            SessionName += Safe ? c : '_';
+        }
+        SessionName += StartTime;
+
+        Pending.reserve(WRITE_CHUNK_BYTES / sizeof(WireTick));
+        SegmentNumber = 0;
+        SessionSuffix = 0;
+        StopRequested = false;
+        Running = true;
+        Thread = std::thread(&TickRecorder::Run, this);
+    }
+
+    // Writes and commits everything appended so far
+    void Stop()
+    {
+        if (!Running)
+            return;
+
+        {
+            std::lock_guard<std::mutex> Lock(PendingMutex);
+            StopRequested = true;
+        }
+        Wake.notify_one();
+        if (Thread.joinable())
+            Thread.join();
+
+        Running = false;
+    }
+
+    // Study thread
+    void Append(const WireTick* Ticks, size_t Count)
+    {
+        bool WakeWriter;
+        {
+            std::lock_guard<std::mutex> Lock(PendingMutex);
+            if ((Pending.size() + Count) * sizeof(WireTick) > MAX_PENDING_BYTES)
+            {
+                DroppedRecords += Count;
+                return;
+            }
+
+            Pending.insert(Pending.end(), Ticks, Ticks + Count);
+            WakeWriter = (Pending.size() * sizeof(WireTick) >= WRITE_CHUNK_BYTES);
+        }
+
+        if (WakeWriter)
+            Wake.notify_one();
+    }
+
+    std::atomic<bool> StopRequested;
+    std::atomic<bool> Running;
+    std::atomic<int64_t> RecordsCommitted;
+    std::atomic<int64_t> DroppedRecords;    // Disk too slow, or lost to a failed write
+    std::atomic<int> Segments;
+    std::atomic<int> WriteErrors;
+    std::atomic<uint32_t> LastError;        // Win32 error code of the last failure
+
+private:
+    void Run()
+    {
+        std::chrono::steady_clock::time_point NextCommit = std::chrono::steady_clock::now() + std::chrono::milliseconds(CommitIntervalMs);
+
+        while (!StopRequested)
+        {
+            {
+                std::unique_lock<std::mutex> Lock(PendingMutex);
+                Wake.wait_until(Lock, NextCommit, [this] {
+                    return StopRequested || Pending.size() * sizeof(WireTick) >= WRITE_CHUNK_BYTES;
+                });
+                Writing.swap(Pending);
+            }
+
+            WriteRecords();
+
+            const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+            if (Now >= NextCommit)
+            {
+                Commit();
+                NextCommit = Now + std::chrono::milliseconds(CommitIntervalMs);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> Lock(PendingMutex);
+            Writing.swap(Pending);
+        }
+        WriteRecords();
+        CloseSegment();
+    }
+
+    void Fail()
+    {
+        LastError = GetLastError();
+        WriteErrors++;
+    }
+
+    // Synchronous write at an absolute file offset
+    static bool WriteAt(HANDLE Handle, uint64_t Offset, const void* Data, size_t Length)
+    {
+        OVERLAPPED Position;
+        memset(&Position, 0, sizeof(Position));
+        Position.Offset = static_cast<DWORD>(Offset & 0xFFFFFFFF);
+        Position.OffsetHigh = static_cast<DWORD>(Offset >> 32);
+
+        DWORD Written = 0;
+        return WriteFile(Handle, Data, static_cast<DWORD>(Length), &Written, &Position) && Written == Length;
+    }
+
+    // Moves the swapped-out pending records into segments
+    void WriteRecords()
+    {
+        size_t Done = 0;
+        while (Done < Writing.size())
+        {
+            if (File == INVALID_HANDLE_VALUE && !OpenSegment())
+            {
+                DroppedRecords += Writing.size() - Done;
+                break;
+            }
+
+            if (SegmentRecords == Header.CapacityRecords)
+            {
+                CloseSegment();
+                continue;
+            }
+
+            size_t Count = Writing.size() - Done;
+            if (Count > Header.CapacityRecords - SegmentRecords)
+                Count = static_cast<size_t>(Header.CapacityRecords - SegmentRecords);
+
+            const WireTick* pFirst = Writing.data() + Done;
+            if (!WriteAt(File, RECORDING_HEADER_SIZE + SegmentRecords * sizeof(WireTick), pFirst, Count * sizeof(WireTick)))
+            {
+                // Start over in a fresh segment rather than leave a hole
+                Fail();
+                DroppedRecords += Count;
+                Done += Count;
+                CloseSegment();
+                continue;
+            }
+
+            IndexScratch.clear();
+            for (size_t i = 0; i < Count; i++)
+            {
+                if (Indexer.ShouldIndex(pFirst[i].Timestamp))
+                {
+                    RecordingIndexEntry Entry;
+                    Entry.Timestamp = pFirst[i].Timestamp;
+                    Entry.RecordIndex = SegmentRecords + i;
+                    IndexScratch.push_back(Entry);
+                }
+            }
+
+            if (!IndexScratch.empty())
+            {
+                const size_t Length = IndexScratch.size() * sizeof(RecordingIndexEntry);
+                if (WriteAt(IndexFile, IndexBytes, IndexScratch.data(), Length))
+                    IndexBytes += Length;
+                else
+                    Fail();
+            }
+
+            if (SegmentRecords == 0)
+            {
+                Header.FirstTimestamp = pFirst[0].Timestamp;
+                Header.FirstSequence = pFirst[0].Sequence;
+            }
+            Header.LastTimestamp = pFirst[Count - 1].Timestamp;
+            Header.LastSequence = pFirst[Count - 1].Sequence;
+
+            SegmentRecords += Count;
+            Done += Count;
+        }
+
+        Writing.clear();
+    }
+
+    bool OpenSegment()
+    {
+        if (!CreateDirectoryA(Directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+        {
+            Fail();
+            return false;
+        }
+
+        // A restart within the same second finds the session's names taken
+        // by the earlier run; the session then moves to the next free
+        // "-<n>" suffix and keeps it for its later segments
+        for (;;)
+        {
+            char Session[MAX_PATH];
+            if (SessionSuffix == 0)
+                snprintf(Session, sizeof(Session), "%s", SessionName.c_str());
+            else
+                snprintf(Session, sizeof(Session), "%s-%u", SessionName.c_str(), SessionSuffix);
+
+            char Path[MAX_PATH];
+            char IndexPath[MAX_PATH];
+            snprintf(Path, sizeof(Path), "%s\\%s_%03u%s", Directory.c_str(), Session, SegmentNumber, RECORDING_EXTENSION);
+            snprintf(IndexPath, sizeof(IndexPath), "%s\\%s_%03u%s", Directory.c_str(), Session, SegmentNumber, RECORDING_INDEX_EXTENSION);
+
+            // Readers may open the files while they are being written
+            File = CreateFileA(Path, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            if (File != INVALID_HANDLE_VALUE)
+            {
+                IndexFile = CreateFileA(IndexPath, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+                if (IndexFile != INVALID_HANDLE_VALUE)
+                    break;
+
+                // Only the index is taken: give the new segment file back
+                const DWORD Error = GetLastError();
+                CloseHandles();
+                DeleteFileA(Path);
+                SetLastError(Error);
+            }
+
+            const bool Taken = (GetLastError() == ERROR_FILE_EXISTS);
+            if (!Taken || SessionSuffix >= MAX_SESSION_SUFFIX)
+            {
+                Fail();
+                CloseHandles();
+                return false;
+            }
+
+            SessionSuffix++;
+        }
+
+        uint64_t Capacity = (SegmentBytes > RECORDING_HEADER_SIZE) ? (SegmentBytes - RECORDING_HEADER_SIZE) / sizeof(WireTick) : 0;
+        if (Capacity == 0)
+            Capacity = 1;
+
+        // Reserve the whole segment up front so appends never extend the file
+        LARGE_INTEGER Size;
+        Size.QuadPart = static_cast<LONGLONG>(RECORDING_HEADER_SIZE + Capacity * sizeof(WireTick));
+        if (!SetFilePointerEx(File, Size, NULL, FILE_BEGIN) || !SetEndOfFile(File))
+        {
+            Fail();
+            CloseHandles();
+            return false;
+        }
+
+        memset(&Header, 0, sizeof(Header));
+        Header.Magic = RECORDING_MAGIC;
+        Header.Version = RECORDING_VERSION;
+        Header.HeaderSize = RECORDING_HEADER_SIZE;
+        Header.RecordSize = sizeof(WireTick);
+        Header.CapacityRecords = Capacity;
+        Header.CreatedTimestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        Header.TickSize = TickSize;
+        Header.SegmentNumber = SegmentNumber;
+        Header.IndexIntervalMs = INDEX_INTERVAL_MS;
+        Header.PriceDecimals = static_cast<uint8_t>(PriceDecimals);
+        strncpy_s(Header.Symbol, sizeof(Header.Symbol), Symbol.c_str(), _TRUNCATE);
+
+        if (!WriteAt(File, 0, &Header, sizeof(Header)))
+        {
+            Fail();
+            CloseHandles();
+            return false;
+        }
+
+        Indexer.Reset(INDEX_INTERVAL_MS);
+        SegmentRecords = 0;
+        IndexBytes = 0;
+        SegmentNumber++;
+        Segments++;
+        return true;
+    }
+
+    // Publishes the records written so far
+    void Commit()
+    {
+        if (File == INVALID_HANDLE_VALUE || Header.RecordCount == SegmentRecords)
+            return;
+
+        // The header must never cover records that are not on disk yet
+        if (!FlushFileBuffers(File) || !FlushFileBuffers(IndexFile))
+        {
+            Fail();
+            return;
+        }
+
+        const uint64_t NewRecords = SegmentRecords - Header.RecordCount;
+        Header.RecordCount = SegmentRecords;
+        if (!WriteAt(File, 0, &Header, sizeof(Header)) || !FlushFileBuffers(File))
+        {
+            Fail();
+            return;
+        }
+
+        RecordsCommitted += static_cast<int64_t>(NewRecords);
+    }
+
+    // Commits and gives back the unused preallocated space. The file keeps
+    // every record written, so a failed commit leaves them for recovery.
+    void CloseSegment()
+    {
+        if (File == INVALID_HANDLE_VALUE)
+            return;
+
+        Commit();
+
+        LARGE_INTEGER Size;
+        Size.QuadPart = static_cast<LONGLONG>(RECORDING_HEADER_SIZE + SegmentRecords * sizeof(WireTick));
+        if (!SetFilePointerEx(File, Size, NULL, FILE_BEGIN) || !SetEndOfFile(File))
+            Fail();
+
+        CloseHandles();
+    }
+
+    void CloseHandles()
+    {
+        if (File != INVALID_HANDLE_VALUE)
+            CloseHandle(File);
+        if (IndexFile != INVALID_HANDLE_VALUE)
+            CloseHandle(IndexFile);
+
+        File = INVALID_HANDLE_VALUE;
+        IndexFile = INVALID_HANDLE_VALUE;
+    }
+
+    std::string Directory;
+    std::string Symbol;
+    std::string SessionName;
+    uint64_t SegmentBytes;
+    int CommitIntervalMs;
+    double TickSize;
+    int PriceDecimals;
+    std::thread Thread;
+
+    // Guarded by PendingMutex
+    std::mutex PendingMutex;
+    std::condition_variable Wake;
+    std::vector<WireTick> Pending;
+
+    // Owned by the writer thread
+    std::vector<WireTick> Writing;
+    std::vector<RecordingIndexEntry> IndexScratch;
+    RecordingIndexer Indexer;
+    RecordingHeader Header;     // As last committed, plus the ranges of records written since
+    HANDLE File;
+    HANDLE IndexFile;
+    uint32_t SegmentNumber;
+    uint32_t SessionSuffix;     // 0, or the n of a "-<n>" taken when the name was in use
+    uint64_t SegmentRecords;    // Written to the current segment, committed or not
+    uint64_t IndexBytes;
+};
+
+// Converts Sierra Chart date-times to microseconds since the Unix epoch with
+// integer arithmetic only. The start of the day is computed when the date
+// changes, so each record costs a time-of-day lookup and two multiplies.
+class UnixTimeConverter
+{
+public:
+    UnixTimeConverter() : CachedDate(-1), CachedDayStartUs(0) {}
+
+    int64_t Microseconds(const SCDateTime& DateTime)
+    {
+        const int Date = DateTime.GetDate();
+        if (Date != CachedDate)
+        {
+            // Dates count days from 1899-12-30; the Unix epoch is day 25569
+            CachedDate = Date;
+            CachedDayStartUs = (static_cast<int64_t>(Date) - 25569) * 86400000000LL;
+        }
+
+        return CachedDayStartUs + static_cast<int64_t>(DateTime.GetTimeInSeconds()) * 1000000
+            + DateTime.GetMillisecond() * 1000 + DateTime.GetMicrosecond();
+    }
+
+    int64_t Milliseconds(const SCDateTime& DateTime) { return Microseconds(DateTime) / 1000; }
+
+private:
+    int CachedDate;
+    int64_t CachedDayStartUs;
+};
+
+// Trade being coalesced with the records that follow it
+struct PendingPrint {
+    uint32_t Prints;                // 0 when nothing is pending
+    int64_t FirstMicros;            // Time of the first record, also the tick's timestamp
+    double Price;
+    int32_t PriceTicks;
+    uint32_t Volume;
+    bool IsAsk;
+};
+
+// Structure to hold socket state
+struct SocketState {
+    TcpConnection Connection;   // Direct connection, when no worker or publisher is attached
+    bool Connected;
+    int64_t SequenceNumber;
+    int64_t LastProcessedSequence;
+    int LastProcessedIndex;     // Index of LastProcessedSequence in the last scan (hint only)
+    int LastReplayStatus;
+    double LastReplayDateTime;
+
+    // Replay pacing: backfill progress and the replay speed measured from the
+    // replay clock against the local clock
+    int64_t BackfillEndSequence;    // Last record to backfill; 0 when not backfilling
+    int64_t BackfillTicks;
+    double ReplaySpeed;
+    double SpeedSampleReplayDateTime;
+    std::chrono::steady_clock::time_point SpeedSampleClock;
+
+    // Wire format of the current connection (fixed until it is closed)
+    int ConnectionFormat;
+    bool SymbolDefined;         // Binary: symbol frame sent on this connection
+    SCString DefinedSymbol;
+    double DefinedTickSize;     // The tick size and decimals the symbol frame carried
+    int DefinedPriceDecimals;
+    double TickSize;
+    int PriceDecimals;
+
+    // Binary TCP: ticks frames are re-encoded as compact frames when set.
+    // Every frame stands alone, so this may change between batches.
+    int TickCompression;            // TickCompressionEnum
+    CompactTickEncoder CompactEncoder;
+
+    // Record times, converted without floating point
+    UnixTimeConverter TimeConverter;
+
+    // New records are gathered and converted a batch at a time
+    RecordBatch Batch;
+    int ConversionKernel;           // ConversionKernelEnum in use; -1 until the first call
+    int TimestampResolution;        // TimestampResolutionEnum
+
+    // JSON: pre-rendered per symbol/tick size, rebuilt when either changes
+    TickJsonSerializer JsonSerializer;
+    SCString SerializerSymbol;
+    double SerializerTickSize;
+    int SerializerValueFormat;
+
+    // Output batching: every tick from one study call is serialized here and
+    // queued as one message. The buffer is reused across calls.
+    std::vector<char> BatchBuffer;
+    int BatchLength;
+    int BatchTicks;
+    TickSummary BatchSummary;
+
+    // Latency stamping: a timing message precedes each batch when enabled
+    bool StampLatency;
+    int64_t BatchEnqueueMicros;
+
+    // Print coalescing: consecutive records of one aggressive order (same
+    // time within the tolerance, side and price) are held here and sent as a
+    // single tick with their summed volume and print count
+    PendingPrint Print;
+
+    // Bytes not yet accepted by the socket, drained on later calls
+    OutboundQueue SendQueue;
+    TickSummary PendingSummary;     // Ticks coalesced on overflow, not yet queued
+
+    // Resume: every tick sequenced is also kept in the history. After each
+    // connect the study waits for the consumer to say which sequence it last
+    // received, resends the ticks after it, then goes live.
+    TickHistory History;
+    int HistoryTicks;               // Input value the history was sized from
+    SCString HistorySymbol;
+    bool AwaitingResume;
+    std::chrono::steady_clock::time_point ResumeDeadline;
+    int64_t ResendNext;             // Next tick to resend; 0 when not resending
+    int64_t ResendLast;
+    std::vector<char> ResendBuffer;
+    ControlLineReader Control;      // Direct connection; the worker reads its own
+    std::vector<std::string> ControlLines;
+
+    // What the TCP consumer asked to be sent (filter and subscribe control
+    // lines); back to everything on each connect
+    TickFilter Filter;
+
+    // Overflow accounting
+    int OverflowEvents;
+    int64_t DroppedTicks;
+    int64_t CoalescedTicks;
+    int LastLoggedOverflowEvents;
+
+    // Optional background I/O thread, private or shared with other charts
+    // (hub mode). When attached it owns the connection and Connection and
+    // SendQueue are unused.
+    IoWorker* Worker;
+    IoWorker::Channel* Channel;
+    uint16_t SymbolId;          // Binary: this instance's ID on the stream
+    int LastWorkerConnects;
+    int LastWorkerDisconnects;
+    int64_t LastChannelTicksSent;
+    int64_t LastChannelDroppedTicks;
+    bool WorkerSettingsMismatchLogged;  // A shared worker set up by another chart
+
+    // Shared-memory transport; replaces the connection when set
+    ShmPublisher* Shm;
+    int64_t LastShmBytesPublished;
+    bool ShmSizeMismatchLogged; // The ring on this port has another chart's size
+
+    // Exporter-hosted WebSocket server; replaces the connection when set
+    WebSocketServer* Ws;
+    int64_t LastWsBytesSent;
+    int LastWsConnects;
+    int LastWsDisconnects;
+    int LastWsLappedClients;
+    bool WsListenFailed;        // Logged once; retried every update
+    bool WsSettingsMismatchLogged;  // The server on this port has another chart's settings
+
+    // UDP multicast publisher; replaces the connection when set. Receivers
+    // ask for lost ticks by unicast and are answered from the history.
+    MulticastPublisher* Multicast;
+    int64_t LastMulticastBytesPublished;
+    int LastMulticastDroppedDatagrams;
+    std::vector<MulticastRequest> MulticastRequests;
+    bool MulticastOpenFailed;   // Logged once; retried every update
+    bool MulticastSettingsMismatchLogged;   // The publisher for this group has another chart's settings
+
+    // Optional disk recorder. It reads the Time & Sales array on its own
+    // position, so it keeps recording while nothing is connected.
+    TickRecorder* Recorder;
+    int64_t LastRecordedSequence;
+    int LastRecordedIndex;
+    std::vector<WireTick> RecordBuffer;
+    uint32_t LastRecorderError;
+    int64_t LastRecorderDropped;
+
+    // Instrumentation, reported every stats interval. Transport counters of a
+    // worker or shared-memory ring are connection-wide in hub mode.
+    ExporterStats Stats;
+    std::chrono::steady_clock::time_point LastStatsClock;
+    int64_t LastChannelBytesSent;
+    int LastWorkerWouldBlocks;
+
+    // Rolling-window aggregates. Time advances with trade timestamps, and
+    // with the local clock between trades so idle windows drain.
+    RollingAggregator Aggregator;
+    SCString AggregateWindows;      // Input text the aggregator was configured from
+    int64_t LastTradeTimestampMs;
+    std::chrono::steady_clock::time_point LastTradeClock;
+    double LastTradePrice;
+    int64_t LastAggregateMs;
+
+    // Quote channel: bid/ask updates delta-encoded against the last quote
+    // sent, coalesced per interval and sent once per update
+    QuoteDeltaEncoder Quotes;
+    std::vector<char> QuoteBuffer;
+    int QuoteLength;
+    int QuoteRecords;
+    int64_t LatestQuoteMs;          // Newest quote seen
+    int64_t LastQuoteRecordMs;      // Quote time of the last record written
+    int64_t LastKeyframeMs;
+    std::chrono::steady_clock::time_point LastQuoteClock;  // When the last record was written
+
+    // Footprint: bid/ask volume at each price of the current trading
+    // session, sent as changed levels every interval
+    FootprintLadder Footprint;
+    bool ExportFootprint;
+    double FootprintTickSize;       // Tick size the ladder's prices are in
+    int64_t FootprintSessionStartUs;
+    int64_t FootprintSessionEndUs;  // Start of the next session; 0 before the first trade
+    int64_t FootprintLastTradeUs;
+    bool FootprintSnapshotDue;      // Send the whole ladder next (connect, request, new session)
+    std::vector<char> FootprintBuffer;
+    std::chrono::steady_clock::time_point LastFootprintClock;
+    std::chrono::steady_clock::time_point LastFootprintSnapshotClock;
+
+    // Sweeps and block trades, detected on every trade record whatever the
+    // tick stream is throttled to and sent as soon as each run completes
+    TradeEventDetector Events;
+    bool ExportEvents;
+    int64_t LastEventTradeMicros;   // Newest trade added to the detector, and when
+    std::chrono::steady_clock::time_point LastEventTradeClock;
+
+    // Warm start: the trades of the last minutes, sent to a TCP consumer
+    // that connects without resuming, before its first live tick
+    RecentTradeRing Recent;
+    bool WarmStartDue;
+    size_t WarmStartNext;           // Next ring index to send
+    std::vector<char> WarmStartBuffer;
+};
+
+// Upper bound on the size of one serialized tick
+static const int MAX_TICK_MESSAGE_LENGTH = 512;
+
+// Upper bound on one aggregate line or frame (all windows plus the symbol)
+static const int MAX_AGGREGATE_MESSAGE_LENGTH = 2048;
+
+// Trades the aggregator can hold across its longest window
+static const size_t MAX_AGGREGATE_TRADES = 256 * 1024;
+
+// Every quote record is a keyframe at least this often
+static const int QUOTE_KEYFRAME_INTERVAL_MS = 5000;
+
+// Shared-memory readers and multicast receivers join without the exporter
+// knowing, so they get a footprint snapshot at least this often
+static const int FOOTPRINT_PERIODIC_SNAPSHOT_INTERVAL_MS = 10000;
+
+// Replay speed is re-measured over at least this much local time
+static const int REPLAY_SPEED_SAMPLE_MS = 250;
+
+// Trades per warm-start snapshot frame or line
+static const size_t WARM_START_CHUNK_TRADES = 1024;
+
+// Records processed between checks of the replay time budget
+static const int REPLAY_BUDGET_CHECK_RECORDS = 64;
+
+// Ticks per message when resending from the history
+static const int RESEND_CHUNK_TICKS = 512;
+
+// Most ticks resent for one multicast request; a receiver still missing
+// some asks again
+static const int MULTICAST_MAX_RESEND_TICKS = 8 * RESEND_CHUNK_TICKS;
+
+static void ResetBatch(SocketState* pState)
+{
+    pState->BatchLength = 0;
+    pState->BatchTicks = 0;
+    ResetSummary(pState->BatchSummary);
+}
+
+// Drops unsent quote records; the next record is a keyframe
+static void ResetQuotes(SocketState* pState)
+{
+    pState->Quotes.Reset();
+    pState->QuoteLength = 0;
+    pState->QuoteRecords = 0;
+}
+
+static void CloseConnection(SocketState* pState)
+{
+    pState->Connection.Close();
+    pState->Connected = false;
+    pState->SymbolDefined = false;
+
+    // Queued bytes belong to the old stream; a partial message cannot be resumed
+    ResetBatch(pState);
+    ResetQuotes(pState);
+    pState->Print.Prints = 0;
+    pState->SendQueue.Clear();
+    ResetSummary(pState->PendingSummary);
+}
+
+// Leaves the I/O thread; a private worker is stopped, a shared one keeps
+// running for the other charts
+static void DetachWorker(SocketState* pState)
+{
+    if (pState->Worker == NULL)
+        return;
+
+    // The next chart to use the worker takes over its settings
+    const void* Owner = pState;
+    pState->Worker->SettingsOwner.compare_exchange_strong(Owner, NULL);
+
+    pState->Worker->CloseChannel(pState->Channel);
+    ReleaseWorker(pState->Worker);
+
+    pState->Worker = NULL;
+    pState->Channel = NULL;
+    pState->SymbolId = 0;
+    pState->SymbolDefined = false;
+    ResetBatch(pState);
+    ResetQuotes(pState);
+    pState->Print.Prints = 0;
+    ResetSummary(pState->PendingSummary);
+}
+
+static bool AttachWorker(SocketState* pState, const char* Host, int Port, int WireFormat, size_t QueueBytes, bool Shared)
+{
+    DetachWorker(pState);
+
+    IoWorker* Worker = AcquireWorker(Host, Port, WireFormat, QueueBytes, Shared);
+    IoWorker::Channel* Channel = Worker->OpenChannel(QueueBytes);
+    if (Channel == NULL)
+    {
+        ReleaseWorker(Worker);
+        return false;
+    }
+
+    pState->Worker = Worker;
+    pState->Channel = Channel;
+    pState->SymbolId = Channel->GetSymbolId();
+    pState->ConnectionFormat = WireFormat;
+    pState->SymbolDefined = false;
+
+    // The channel starts with the filter lines of the worker's connection
+    pState->ControlLines.clear();
+    pState->Filter.Clear();
+
+    // A shared worker may already have been running; only report changes
+    // from here on. One this chart just started can connect before we get
+    // here, and that first connect is still this chart's to report.
+    const bool Started = Worker->RefCount == 1;
+    pState->LastWorkerConnects = Started ? 0 : Worker->ConnectCount.load();
+    pState->LastWorkerDisconnects = Started ? 0 : Worker->DisconnectCount.load();
+    pState->LastChannelTicksSent = 0;
+    pState->LastChannelDroppedTicks = 0;
+    pState->LastChannelBytesSent = 0;
+    pState->LastWorkerWouldBlocks = Worker->WouldBlocks;
+    pState->WorkerSettingsMismatchLogged = false;
+    return true;
+}
+
+static void DetachShm(SocketState* pState)
+{
+    if (pState->Shm == NULL)
+        return;
+
+    pState->Shm->ReleaseSymbolId(pState->SymbolId);
+    ReleaseShmPublisher(pState->Shm);
+
+    pState->Shm = NULL;
+    pState->SymbolId = 0;
+    pState->SymbolDefined = false;
+    ResetBatch(pState);
+    ResetQuotes(pState);
+    pState->Print.Prints = 0;
+    ResetSummary(pState->PendingSummary);
+}
+
+static bool AttachShm(SocketState* pState, int Port, size_t DataBytes)
+{
+    DetachShm(pState);
+
+    ShmPublisher* Shm = AcquireShmPublisher(Port, DataBytes);
+    if (Shm == NULL)
+        return false;
+
+    pState->Shm = Shm;
+    pState->SymbolId = Shm->AcquireSymbolId();
+    pState->LastShmBytesPublished = Shm->BytesPublished;
+    pState->ShmSizeMismatchLogged = false;
+    pState->ConnectionFormat = WIRE_FORMAT_BINARY;
+    pState->SymbolDefined = false;
+    return true;
+}
+
+// Leaves the WebSocket server; the last chart using it stops it
+static void DetachWebSocket(SocketState* pState)
+{
+    if (pState->Ws == NULL)
+        return;
+
+    pState->Ws->ReleaseSymbolId(pState->SymbolId);
+    ReleaseWebSocketServer(pState->Ws);
+
+    pState->Ws = NULL;
+    pState->SymbolId = 0;
+    pState->SymbolDefined = false;
+    ResetBatch(pState);
+    ResetQuotes(pState);
+    pState->Print.Prints = 0;
+    ResetSummary(pState->PendingSummary);
+}
+
+static bool AttachWebSocket(SocketState* pState, int Port, size_t RingBytes, bool AcceptRemote)
+{
+    DetachWebSocket(pState);
+
+    WebSocketServer* Ws = AcquireWebSocketServer(Port, RingBytes, AcceptRemote);
+    if (Ws == NULL)
+        return false;
+
+    pState->Ws = Ws;
+    pState->SymbolId = Ws->AcquireSymbolId();
+    pState->ConnectionFormat = WIRE_FORMAT_BINARY;
+    pState->SymbolDefined = false;
+
+    // A server shared with other charts may already have clients; only
+    // report changes from here on
+    pState->LastWsBytesSent = Ws->BytesSent;
+    pState->LastWsConnects = Ws->ClientConnects;
+    pState->LastWsDisconnects = Ws->ClientDisconnects;
+    pState->LastWsLappedClients = Ws->LappedClients;
+    pState->WsSettingsMismatchLogged = false;
+    return true;
+}
+
+// Leaves the multicast group; the last chart using the publisher closes it
+static void DetachMulticast(SocketState* pState)
+{
+    if (pState->Multicast == NULL)
+        return;
+
+    pState->Multicast->ReleaseSymbolId(pState->SymbolId);
+    ReleaseMulticastPublisher(pState->Multicast);
+
+    pState->Multicast = NULL;
+    pState->SymbolId = 0;
+    pState->SymbolDefined = false;
+    pState->MulticastRequests.clear();
+    ResetBatch(pState);
+    ResetQuotes(pState);
+    pState->Print.Prints = 0;
+    ResetSummary(pState->PendingSummary);
+}
+
+static bool AttachMulticast(SocketState* pState, const std::string& Group, int Port, int Ttl, const std::string& Interface, int SocketBufferBytes)
+{
+    DetachMulticast(pState);
+
+    MulticastPublisher* Multicast = AcquireMulticastPublisher(Group, Port, Ttl, Interface, SocketBufferBytes);
+    if (Multicast == NULL)
+        return false;
+
+    pState->Multicast = Multicast;
+    pState->SymbolId = Multicast->AcquireSymbolId();
+    pState->LastMulticastBytesPublished = Multicast->BytesPublished;
+    pState->LastMulticastDroppedDatagrams = Multicast->DroppedDatagrams;
+    pState->MulticastSettingsMismatchLogged = false;
+    pState->ConnectionFormat = WIRE_FORMAT_BINARY;
+    pState->SymbolDefined = false;
+    return true;
+}
+
+// Shared memory, the WebSocket server and the multicast group take whole
+// frames. Only the WebSocket server refuses any, a message bigger than its
+// ring; Published tells. Returns false if none is in use.
+static bool PublishFrames(SocketState* pState, const char* Data, size_t Length, bool& Published)
+{
+    Published = true;
+    if (pState->Shm != NULL)
+    {
+        pState->Shm->Publish(Data, Length);
+        return true;
+    }
+
+    if (pState->Ws != NULL)
+    {
+        Published = pState->Ws->Publish(Data, Length);
+        return true;
+    }
+
+    if (pState->Multicast != NULL)
+    {
+        pState->Multicast->Publish(Data, Length);
+        return true;
+    }
+
+    return false;
+}
+
+static bool PublishFrames(SocketState* pState, const char* Data, size_t Length)
+{
+    bool Published;
+    return PublishFrames(pState, Data, Length, Published);
+}
+
+// Makes room for at least Bytes more bytes after the Used bytes of Buffer
+static char* ReserveSpace(std::vector<char>& Buffer, int Used, int Bytes)
+{
+    const size_t Required = static_cast<size_t>(Used) + Bytes;
+    if (Buffer.size() < Required)
+    {
+        size_t NewSize = Buffer.size() * 2;
+        if (NewSize < Required)
+            NewSize = Required;
+        Buffer.resize(NewSize);
+    }
+
+    return Buffer.data() + Used;
+}
+
+// Makes room for at least Bytes more bytes in the batch buffer
+static char* ReserveBatchSpace(SocketState* pState, int Bytes)
+{
+    return ReserveSpace(pState->BatchBuffer, pState->BatchLength, Bytes);
+}
+
+static int FormatSummaryMessage(char* Buffer, int BufferSize, const TickSummary& Summary, int PriceDecimals, const char* Symbol);
+static int FormatSummaryFrame(char* Buffer, const TickSummary& Summary, double TickSize, uint16_t SymbolId);
+static bool SendAuxMessage(SCStudyInterfaceRef sc, SocketState* pState, const char* Data, size_t Length, int& TicksSent);
+
+// Holds live ticks back until the consumer of a new connection has said
+// where its stream ended, or WaitMs passes without a word from it
+static void BeginResume(SocketState* pState, int WaitMs)
+{
+    pState->AwaitingResume = pState->History.Enabled();
+    pState->ResumeDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WaitMs);
+    pState->ResendNext = 0;
+    pState->ResendLast = 0;
+    pState->Control.Clear();
+    pState->ControlLines.clear();
+    pState->Filter.Clear();
+    pState->WarmStartDue = pState->Recent.Enabled();
+    pState->WarmStartNext = 0;
+}
+
+// Starts a new connection's stream. Binary streams open with the stream header.
+static void OnConnected(SocketState* pState, int WireFormat, int ResumeWaitMs)
+{
+    pState->ConnectionFormat = WireFormat;
+    pState->SymbolDefined = false;
+
+    if (WireFormat == WIRE_FORMAT_BINARY)
+    {
+        char Header[sizeof(WireStreamHeader)];
+        pState->SendQueue.Push(Header, WriteStreamHeader(Header), 0, true);
+    }
+
+    BeginResume(pState, ResumeWaitMs);
+    pState->FootprintSnapshotDue = true;
+}
+
+// Binary streams refer to the symbol by ID; send its definition before the
+// first tick and again whenever the chart symbol or its tick size changes.
+static bool EnsureSymbolDefined(SocketState* pState, const SCString& Symbol)
+{
+    if (pState->ConnectionFormat != WIRE_FORMAT_BINARY)
+        return true;
+
+    if (pState->SymbolDefined && strcmp(pState->DefinedSymbol.GetChars(), Symbol.GetChars()) == 0
+        && pState->DefinedTickSize == pState->TickSize && pState->DefinedPriceDecimals == pState->PriceDecimals)
+        return true;
+
+    char Frame[WIRE_MAX_SYMBOL_FRAME];
+    const int Length = WriteSymbolFrame(Frame, pState->SymbolId, Symbol.GetChars(), pState->TickSize, pState->PriceDecimals);
+    if (pState->Shm != NULL)
+    {
+        pState->Shm->DefineSymbol(pState->SymbolId, Frame, Length);
+    }
+    else if (pState->Ws != NULL)
+    {
+        pState->Ws->DefineSymbol(pState->SymbolId, Frame, Length);
+    }
+    else if (pState->Multicast != NULL)
+    {
+        pState->Multicast->DefineSymbol(pState->SymbolId, Symbol.GetChars(), Frame, Length);
+    }
+    else if (pState->Channel != NULL)
+    {
+        // The worker keeps the latest definition and replays it on reconnect
+        if (!pState->Channel->PushDefinition(Frame, Length))
+            return false;
+        pState->Worker->Notify();
+    }
+    else if (!pState->SendQueue.Push(Frame, Length, 0, true))
+    {
+        return false;
+    }
+
+    pState->SymbolDefined = true;
+    pState->DefinedSymbol = Symbol;
+    pState->DefinedTickSize = pState->TickSize;
+    pState->DefinedPriceDecimals = pState->PriceDecimals;
+    return true;
+}
+
+// Encodes the pending coalesced summary in the connection's wire format.
+// Buffer must hold MAX_TICK_MESSAGE_LENGTH bytes.
+static int FormatPendingSummary(SocketState* pState, char* Buffer, const char* Symbol)
+{
+    return (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+        ? FormatSummaryFrame(Buffer, pState->PendingSummary, pState->TickSize, pState->SymbolId)
+        : FormatSummaryMessage(Buffer, MAX_TICK_MESSAGE_LENGTH, pState->PendingSummary, pState->PriceDecimals, Symbol);
+}
+
+// Queues the pending coalesced summary if there is room for it
+static bool TryQueuePendingSummary(SocketState* pState, const char* Symbol)
+{
+    if (pState->PendingSummary.Ticks == 0)
+        return true;
+
+    char Buffer[MAX_TICK_MESSAGE_LENGTH];
+    const int Length = FormatPendingSummary(pState, Buffer, Symbol);
+
+    if (!pState->SendQueue.Push(Buffer, Length, pState->PendingSummary.Ticks))
+        return false;
+
+    ResetSummary(pState->PendingSummary);
+    return true;
+}
+
+// Sends as much of the outbound queue as the socket accepts, with a single
+// scatter/gather send. Ticks from completed messages are added to TicksSent.
+// Returns false if the connection was lost.
+static bool DrainSendQueue(SCStudyInterfaceRef sc, SocketState* pState, int& TicksSent)
+{
+    if (pState->SendQueue.Empty())
+        return true;
+
+    const char* First;
+    const char* Second;
+    size_t FirstLength;
+    size_t SecondLength;
+    pState->SendQueue.Peek(First, FirstLength, Second, SecondLength);
+
+    WSABUF Buffers[2];
+    Buffers[0].buf = const_cast<char*>(First);
+    Buffers[0].len = static_cast<ULONG>(FirstLength);
+    Buffers[1].buf = const_cast<char*>(Second);
+    Buffers[1].len = static_cast<ULONG>(SecondLength);
+
+    DWORD BytesSent = 0;
+    int sendResult = WSASend(pState->Connection.GetSocket(), Buffers, (SecondLength > 0) ? 2 : 1, &BytesSent, 0, NULL, NULL);
+
+    if (sendResult == SOCKET_ERROR)
+    {
+        int error = WSAGetLastError();
+        if (error == WSAEWOULDBLOCK)
+        {
+            pState->Stats.WouldBlocks++;
+            return true;    // Socket buffer full - retry on a later call
+        }
+
+        sc.AddMessageToLog("Socket Exporter: Connection lost", 1);
+        CloseConnection(pState);
+        return false;
+    }
+
+    pState->Stats.BytesSent += BytesSent;
+    TicksSent += pState->SendQueue.Consume(BytesSent);
+    return true;
+}
+
+// Completes a binary ticks frame of Ticks records at Frame for the TCP
+// connection: fills in its header, or re-encodes it as a compact frame.
+// Returns the message to queue, which is Frame or the encoder's buffer.
+static const char* FinishTicksFrame(SocketState* pState, char* Frame, int Ticks, size_t& Length)
+{
+    if (pState->TickCompression != TICK_COMPRESSION_NONE)
+    {
+        return pState->CompactEncoder.Encode(Frame + sizeof(WireFrameHeader), static_cast<size_t>(Ticks),
+            pState->TickCompression == TICK_COMPRESSION_LZ4, Length);
+    }
+
+    WriteFrameHeader(Frame, WIRE_FRAME_TICKS, static_cast<uint32_t>(Length - sizeof(WireFrameHeader)));
+    return Frame;
+}
+
+// Threaded counterpart of FlushBatch: hands the batch to the I/O thread.
+// Drop-oldest is applied by the worker to its own queue; a full ring here
+// means the batch is dropped or coalesced.
+static void FlushBatchToWorker(SocketState* pState, int OverflowPolicy, const char* Symbol)
+{
+    IoWorker::Channel& Channel = *pState->Channel;
+
+    if (pState->PendingSummary.Ticks > 0)
+    {
+        char Buffer[MAX_TICK_MESSAGE_LENGTH];
+        const int Length = FormatPendingSummary(pState, Buffer, Symbol);
+        if (Channel.Push(Buffer, Length, pState->PendingSummary.Ticks))
+            ResetSummary(pState->PendingSummary);
+    }
+
+    if (pState->BatchTicks > 0)
+    {
+        size_t Length = static_cast<size_t>(pState->BatchLength);
+        const char* Data = pState->BatchBuffer.data();
+
+        if (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+            Data = FinishTicksFrame(pState, pState->BatchBuffer.data(), pState->BatchTicks, Length);
+
+        if (pState->PendingSummary.Ticks > 0 || !Channel.Push(Data, Length, pState->BatchTicks))
+        {
+            pState->OverflowEvents++;
+
+            if (OverflowPolicy == OVERFLOW_COALESCE)
+            {
+                MergeSummary(pState->PendingSummary, pState->BatchSummary);
+                pState->CoalescedTicks += pState->BatchTicks;
+            }
+            else
+            {
+                pState->DroppedTicks += pState->BatchTicks;
+            }
+        }
+
+        ResetBatch(pState);
+    }
+
+    pState->Worker->Notify();
+}
+
+// Shared-memory, WebSocket and multicast counterpart of FlushBatch. None
+// waits for room: shared-memory readers that fall a full ring behind detect
+// the overrun themselves, the WebSocket server drops clients that do, and
+// multicast receivers ask for what they lost. A batch bigger than the
+// WebSocket ring is dropped.
+static void FlushBatchToPublisher(SocketState* pState, const char* Symbol)
+{
+    if (pState->PendingSummary.Ticks > 0)
+    {
+        char Buffer[MAX_TICK_MESSAGE_LENGTH];
+        PublishFrames(pState, Buffer, FormatPendingSummary(pState, Buffer, Symbol));
+        ResetSummary(pState->PendingSummary);
+    }
+
+    if (pState->BatchTicks > 0)
+    {
+        const size_t Length = static_cast<size_t>(pState->BatchLength);
+        WriteFrameHeader(pState->BatchBuffer.data(), WIRE_FRAME_TICKS, static_cast<uint32_t>(Length - sizeof(WireFrameHeader)));
+        bool Published;
+        PublishFrames(pState, pState->BatchBuffer.data(), Length, Published);
+        if (!Published)
+        {
+            pState->OverflowEvents++;
+            pState->DroppedTicks += pState->BatchTicks;
+        }
+        if (pState->Multicast != NULL)
+            pState->Multicast->NoteSequence(pState->SymbolId, pState->BatchSummary.LastSequence);
+        ResetBatch(pState);
+    }
+}
+
+// Microseconds since the Unix epoch, comparable with the consumers' clocks on
+// the same machine
+static int64_t UnixMicrosecondsNow()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Upper bound on one timing line or frame
+static const int MAX_TIMING_MESSAGE_LENGTH = 256;
+
+// Sends the latency stamps of the batch about to be flushed, ahead of it.
+// Returns false if the connection was lost.
+static bool SendBatchTiming(SCStudyInterfaceRef sc, SocketState* pState, const char* Symbol, int& TicksSent)
+{
+    WireTiming Timing;
+    Timing.FirstSequence = pState->BatchSummary.FirstSequence;
+    Timing.LastSequence = pState->BatchSummary.LastSequence;
+    Timing.EnqueueMicros = pState->BatchEnqueueMicros;
+    Timing.SendMicros = UnixMicrosecondsNow();
+    Timing.SymbolId = pState->SymbolId;
+    Timing.Reserved = 0;
+    Timing.Reserved2 = 0;
+
+    char Buffer[MAX_TIMING_MESSAGE_LENGTH];
+    int Length;
+    if (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+    {
+        Length = WriteFrameHeader(Buffer, WIRE_FRAME_TIMING, sizeof(Timing));
+        memcpy(Buffer + Length, &Timing, sizeof(Timing));
+        Length += sizeof(Timing);
+    }
+    else
+    {
+        Length = sprintf_s(Buffer, sizeof(Buffer),
+                          "{\"type\":\"timing\",\"seq0\":%lld,\"seq1\":%lld,\"tq\":%lld,\"tx\":%lld,\"sym\":\"%s\"}\n",
+                          static_cast<long long>(Timing.FirstSequence),
+                          static_cast<long long>(Timing.LastSequence),
+                          static_cast<long long>(Timing.EnqueueMicros),
+                          static_cast<long long>(Timing.SendMicros),
+                          Symbol);
+        if (Length <= 0 || Length >= static_cast<int>(sizeof(Buffer)))
+            return true;
+    }
+
+    return SendAuxMessage(sc, pState, Buffer, Length, TicksSent);
+}
+
+// Moves the current batch into the outbound queue, applying the overflow
+// policy when it does not fit, then drains the queue.
+// Returns false if the connection was lost.
+static bool FlushBatch(SCStudyInterfaceRef sc, SocketState* pState, int OverflowPolicy, const char* Symbol, int& TicksSent)
+{
+    if (pState->StampLatency && pState->BatchTicks > 0 && !SendBatchTiming(sc, pState, Symbol, TicksSent))
+        return false;
+
+    if (pState->Shm != NULL || pState->Ws != NULL || pState->Multicast != NULL)
+    {
+        FlushBatchToPublisher(pState, Symbol);
+        return true;
+    }
+
+    if (pState->Channel != NULL)
+    {
+        FlushBatchToWorker(pState, OverflowPolicy, Symbol);
+        return true;
+    }
+
+    // Ticks coalesced earlier must reach the wire before anything newer
+    if (!TryQueuePendingSummary(pState, Symbol))
+    {
+        if (!DrainSendQueue(sc, pState, TicksSent))
+            return false;
+        TryQueuePendingSummary(pState, Symbol);
+    }
+
+    if (pState->BatchTicks > 0)
+    {
+        size_t Length = static_cast<size_t>(pState->BatchLength);
+        const char* Data = pState->BatchBuffer.data();
+
+        // Binary: the batch is one ticks frame; fill in its header now
+        if (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+            Data = FinishTicksFrame(pState, pState->BatchBuffer.data(), pState->BatchTicks, Length);
+
+        // Make room by sending first
+        if (!pState->SendQueue.CanFit(Length) && !DrainSendQueue(sc, pState, TicksSent))
+            return false;
+
+        if (!pState->SendQueue.CanFit(Length) || pState->PendingSummary.Ticks > 0)
+        {
+            pState->OverflowEvents++;
+
+            if (OverflowPolicy == OVERFLOW_DROP_OLDEST)
+            {
+                uint32_t Dropped;
+                while (!pState->SendQueue.CanFit(Length) && pState->SendQueue.DropOldest(Dropped))
+                    pState->DroppedTicks += Dropped;
+            }
+            else if (OverflowPolicy == OVERFLOW_COALESCE)
+            {
+                MergeSummary(pState->PendingSummary, pState->BatchSummary);
+                pState->CoalescedTicks += pState->BatchTicks;
+                ResetBatch(pState);
+            }
+        }
+
+        if (pState->BatchLength > 0)
+        {
+            if (!pState->SendQueue.Push(Data, Length, pState->BatchTicks))
+                pState->DroppedTicks += pState->BatchTicks;
+
+            ResetBatch(pState);
+        }
+    }
+
+    if (!DrainSendQueue(sc, pState, TicksSent))
+        return false;
+
+    // Space may have opened up for the summary after draining
+    if (pState->PendingSummary.Ticks > 0 && TryQueuePendingSummary(pState, Symbol))
+        return DrainSendQueue(sc, pState, TicksSent);
+
+    return true;
+}
+
+// Writes a binary tick with the timestamp at the selected resolution
+static int WriteBinaryTick(const SocketState* pState, char* Out, int64_t Sequence, int64_t TimestampUs, int32_t PriceTicks,
+    uint32_t Volume, bool IsAsk, uint32_t Prints)
+{
+    if (pState->TimestampResolution == TIMESTAMPS_MILLISECONDS)
+        return WriteTick(Out, Sequence, TimestampUs / 1000, PriceTicks, Volume, pState->SymbolId, IsAsk, Prints);
+
+    return WriteTick(Out, Sequence, TimestampUs, PriceTicks, Volume, pState->SymbolId, IsAsk, Prints, WIRE_TICK_MICROSECONDS);
+}
+
+// Serializes one trade into the batch under the next exporter sequence
+// number. Prints is the number of Time & Sales records it stands for.
+static void AppendTickToBatch(SocketState* pState, bool BinaryFormat, int64_t TimestampUs, double Price, int32_t PriceTicks,
+    uint32_t Volume, bool IsAsk, uint32_t Prints)
+{
+    pState->SequenceNumber++;
+
+    // Kept in case the consumer reconnects and asks for it again. Always in
+    // microseconds, so the resolution can change before the resend.
+    if (pState->History.Enabled())
+    {
+        WireTick Tick;
+        Tick.Sequence = pState->SequenceNumber;
+        Tick.Timestamp = TimestampUs;
+        Tick.PriceTicks = PriceTicks;
+        Tick.Volume = Volume;
+        Tick.SymbolId = pState->SymbolId;
+        Tick.Side = IsAsk ? WIRE_SIDE_ASK : WIRE_SIDE_BID;
+        Tick.Flags = WIRE_TICK_MICROSECONDS;
+        Tick.Prints = Prints;
+        pState->History.Append(Tick);
+    }
+
+    // Ticks the consumer filtered out are numbered and kept, but not serialized
+    if (!pState->Filter.Accepts(Volume))
+        return;
+
+    if (pState->BatchTicks == 0 && pState->StampLatency)
+        pState->BatchEnqueueMicros = UnixMicrosecondsNow();
+
+    if (BinaryFormat)
+    {
+        // Leave room for the ticks frame header, written when the batch is flushed
+        if (pState->BatchTicks == 0)
+        {
+            ReserveBatchSpace(pState, sizeof(WireFrameHeader));
+            pState->BatchLength = sizeof(WireFrameHeader);
+        }
+
+        char* Out = ReserveBatchSpace(pState, sizeof(WireTick));
+        pState->BatchLength += WriteBinaryTick(pState, Out, pState->SequenceNumber, TimestampUs, PriceTicks, Volume, IsAsk, Prints);
+    }
+    else
+    {
+        char* Out = ReserveBatchSpace(pState, MAX_JSON_TICK_LENGTH);
+        pState->BatchLength += pState->JsonSerializer.Write(Out, pState->SequenceNumber, TimestampUs, Price, Volume, IsAsk, Prints);
+    }
+    pState->BatchTicks++;
+    AddToSummary(pState->BatchSummary, pState->SequenceNumber, TimestampUs / 1000, Price, Volume, IsAsk);
+}
+
+// Serializes the print being coalesced, if there is one, and counts it in the
+// aggregates as one trade, as the ticks do
+static void AppendPendingPrint(SocketState* pState, bool BinaryFormat, int AggregateOutput)
+{
+    PendingPrint& Print = pState->Print;
+    if (Print.Prints == 0)
+        return;
+
+    if (AggregateOutput != AGGREGATES_OFF)
+        pState->Aggregator.Add(Print.FirstMicros / 1000, Print.Volume, Print.IsAsk);
+
+    if (AggregateOutput != AGGREGATES_ONLY)
+    {
+        AppendTickToBatch(pState, BinaryFormat, Print.FirstMicros, Print.Price, Print.PriceTicks, Print.Volume, Print.IsAsk, Print.Prints);
+        pState->Stats.MergedPrints += Print.Prints - 1;
+    }
+    Print.Prints = 0;
+}
+
+// Reads the consumer's control lines on a direct connection into
+// ControlLines. Returns false if the consumer closed the connection.
+static bool ReceiveDirectControl(SCStudyInterfaceRef sc, SocketState* pState)
+{
+    char Buffer[4096];
+    for (;;)
+    {
+        const int Received = recv(pState->Connection.GetSocket(), Buffer, sizeof(Buffer), 0);
+        if (Received > 0)
+        {
+            pState->Connection.NoteReceived();
+            pState->Control.Append(Buffer, static_cast<size_t>(Received));
+            continue;
+        }
+
+        if (Received == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK)
+            break;
+
+        sc.AddMessageToLog("Socket Exporter: Connection lost", 1);
+        CloseConnection(pState);
+        return false;
+    }
+
+    std::string Line;
+    while (pState->Control.NextLine(Line))
+        pState->ControlLines.push_back(Line);
+    return true;
+}
+
+// Per-call upkeep of a direct connection: reads the consumer's control lines
+// (which also notices a consumer that has gone away), drops a consumer that
+// stopped answering heartbeats, and queues a heartbeat when one is due. The
+// heartbeat goes out with the next drain. Returns false if the connection
+// was closed.
+static bool ServiceDirectConnection(SCStudyInterfaceRef sc, SocketState* pState, int HeartbeatMs)
+{
+    // Always read: filter and subscribe lines may come whatever the settings
+    if (!ReceiveDirectControl(sc, pState))
+        return false;
+
+    if (pState->Connection.PeerTimedOut(HeartbeatMs))
+    {
+        sc.AddMessageToLog("Socket Exporter: Consumer stopped answering heartbeats; reconnecting", 1);
+        CloseConnection(pState);
+        return false;
+    }
+
+    if (pState->Connection.HeartbeatDue(HeartbeatMs))
+    {
+        char Heartbeat[MAX_HEARTBEAT_MESSAGE_LENGTH];
+        pState->SendQueue.Push(Heartbeat, FormatHeartbeat(Heartbeat, pState->ConnectionFormat), 0);
+    }
+
+    return true;
+}
+
+// Encodes the next Ticks ticks of the resend that pass the consumer's filter
+// as one message in the connection's wire format. Returns the message, its
+// length and the number of ticks in it.
+static const char* EncodeResendChunk(SocketState* pState, int Ticks, size_t& Length, int& Encoded)
+{
+    const bool BinaryFormat = (pState->ConnectionFormat == WIRE_FORMAT_BINARY);
+    const size_t MaxLength = sizeof(WireFrameHeader) + static_cast<size_t>(Ticks) * MAX_JSON_TICK_LENGTH;
+    if (pState->ResendBuffer.size() < MaxLength)
+        pState->ResendBuffer.resize(MaxLength);
+
+    char* Out = pState->ResendBuffer.data();
+    Length = BinaryFormat ? sizeof(WireFrameHeader) : 0;
+    Encoded = 0;
+    for (int i = 0; i < Ticks; i++)
+    {
+        const WireTick& Tick = pState->History.Get(pState->ResendNext + i);
+        if (!pState->Filter.Accepts(Tick.Volume))
+            continue;
+
+        Encoded++;
+        const bool IsAsk = (Tick.Side == WIRE_SIDE_ASK);
+        if (BinaryFormat)
+            Length += WriteBinaryTick(pState, Out + Length, Tick.Sequence, Tick.Timestamp, Tick.PriceTicks, Tick.Volume, IsAsk, Tick.Prints);
+        else
+            Length += pState->JsonSerializer.Write(Out + Length, Tick.Sequence, Tick.Timestamp, Tick.PriceTicks * pState->TickSize,
+                Tick.Volume, IsAsk, Tick.Prints);
+    }
+
+    if (BinaryFormat && Encoded > 0)
+        return FinishTicksFrame(pState, Out, Encoded, Length);
+    return Out;
+}
+
+// Queues as much of the resend as there is room for. The messages are
+// pinned so the drop-oldest policy cannot discard them. Returns true once it
+// is complete, false while some is left or if the connection was lost.
+static bool ResendHistory(SCStudyInterfaceRef sc, SocketState* pState, const SCString& Symbol, int& TicksSent)
+{
+    // The history was cleared or resized under the resend
+    if (pState->History.Empty() || pState->ResendNext < pState->History.Oldest())
+        pState->ResendNext = 0;
+
+    if (pState->ResendNext == 0)
+        return true;
+
+    // Binary: the definition goes first
+    if (!EnsureSymbolDefined(pState, Symbol))
+        return false;
+
+    while (pState->ResendNext <= pState->ResendLast)
+    {
+        const int64_t Remaining = pState->ResendLast - pState->ResendNext + 1;
+        const int Ticks = (Remaining < RESEND_CHUNK_TICKS) ? static_cast<int>(Remaining) : RESEND_CHUNK_TICKS;
+        size_t Length;
+        int Encoded;
+        const char* Data = EncodeResendChunk(pState, Ticks, Length, Encoded);
+        if (Encoded == 0)
+        {
+            pState->ResendNext += Ticks;
+            continue;
+        }
+
+        bool Queued;
+        if (pState->Channel != NULL)
+        {
+            Queued = pState->Channel->Push(Data, Length, Encoded, true);
+        }
+        else
+        {
+            if (!pState->SendQueue.CanFit(Length) && !DrainSendQueue(sc, pState, TicksSent))
+                return false;
+            Queued = pState->SendQueue.Push(Data, Length, Encoded, true);
+        }
+
+        if (!Queued)
+            break;
+        pState->ResendNext += Ticks;
+    }
+
+    if (pState->Channel != NULL)
+        pState->Worker->Notify();
+    else if (!DrainSendQueue(sc, pState, TicksSent))
+        return false;
+
+    if (pState->ResendNext <= pState->ResendLast)
+        return false;
+
+    pState->ResendNext = 0;
+    pState->ResendLast = 0;
+    return true;
+}
+
+// Queues one warm-start message, pinned like a resend. Queued is false when
+// there is no room yet. Returns false if the connection was lost.
+static bool QueueWarmStartMessage(SCStudyInterfaceRef sc, SocketState* pState, const char* Data, size_t Length, int& TicksSent, bool& Queued)
+{
+    if (pState->Channel != NULL)
+    {
+        Queued = pState->Channel->Push(Data, Length, 0, true);
+        return true;
+    }
+
+    if (!pState->SendQueue.CanFit(Length) && !DrainSendQueue(sc, pState, TicksSent))
+        return false;
+    Queued = pState->SendQueue.Push(Data, Length, 0, true);
+    return true;
+}
+
+// Queues as much of the warm-start snapshot as there is room for, then its
+// end marker. Returns true once it is complete, false while some is left or
+// if the connection was lost.
+static bool SendWarmStart(SCStudyInterfaceRef sc, SocketState* pState, int& TicksSent)
+{
+    const RecentTradeRing& Recent = pState->Recent;
+    if (!pState->Filter.Subscribed || !Recent.Enabled())
+    {
+        pState->WarmStartDue = false;
+        return true;
+    }
+
+    // The ring was cleared or reconfigured under the snapshot
+    if (pState->WarmStartNext > Recent.Size())
+        pState->WarmStartNext = Recent.Size();
+
+    const bool BinaryFormat = (pState->ConnectionFormat == WIRE_FORMAT_BINARY);
+    bool Queued = true;
+    while (pState->WarmStartNext < Recent.Size())
+    {
+        size_t Written;
+        size_t Length;
+        if (BinaryFormat)
+        {
+            char* Out = ReserveSpace(pState->WarmStartBuffer, 0, static_cast<int>(RecentTradeRing::MaxFrameLength(WARM_START_CHUNK_TRADES)));
+            Length = Recent.WriteFrame(Out, pState->WarmStartNext, WARM_START_CHUNK_TRADES, pState->SymbolId, Written);
+        }
+        else
+        {
+            char* Out = ReserveSpace(pState->WarmStartBuffer, 0, static_cast<int>(RecentTradeRing::MaxJsonLength(WARM_START_CHUNK_TRADES)));
+            Length = Recent.WriteJson(Out, pState->WarmStartNext, WARM_START_CHUNK_TRADES, pState->TickSize, pState->JsonSerializer, Written);
+        }
+
+        if (!QueueWarmStartMessage(sc, pState, pState->WarmStartBuffer.data(), Length, TicksSent, Queued))
+            return false;
+        if (!Queued)
+            break;
+        pState->WarmStartNext += Written;
+    }
+
+    if (Queued)
+    {
+        const int64_t NewestMicros = Recent.Size() > 0 ? Recent.Get(Recent.Size() - 1).TimestampMicros : 0;
+        const uint32_t Trades = static_cast<uint32_t>(Recent.Size());
+        char End[MAX_JSON_SNAPSHOT_END_LENGTH];
+        const int Length = BinaryFormat
+            ? RecentTradeRing::WriteEndFrame(End, NewestMicros, pState->SequenceNumber, Trades, pState->SymbolId)
+            : RecentTradeRing::WriteEndJson(End, NewestMicros, pState->SequenceNumber, Trades, pState->JsonSerializer);
+        if (!QueueWarmStartMessage(sc, pState, End, Length, TicksSent, Queued))
+            return false;
+    }
+
+    if (pState->Channel != NULL)
+        pState->Worker->Notify();
+    else if (!DrainSendQueue(sc, pState, TicksSent))
+        return false;
+
+    if (!Queued)
+        return false;
+
+    SCString Msg;
+    Msg.Format("Socket Exporter: Sent %d recent trades to warm up the consumer", static_cast<int>(Recent.Size()));
+    sc.AddMessageToLog(Msg, 0);
+    pState->WarmStartDue = false;
+    return true;
+}
+
+// Fills the warm-start ring from the Time & Sales records already loaded,
+// which the live export starts after
+static void SeedRecentTrades(SocketState* pState, c_SCTimeAndSalesArray& TimeSales)
+{
+    pState->Recent.Clear();
+    if (!pState->Recent.Enabled())
+        return;
+
+    const int Last = TimeSales.Size() - 1;
+    const int64_t OldestMicros = pState->TimeConverter.Microseconds(TimeSales[Last].DateTime) - pState->Recent.Window();
+    int First = Last;
+    while (First > 0 && pState->TimeConverter.Microseconds(TimeSales[First - 1].DateTime) >= OldestMicros)
+        First--;
+
+    for (int i = First; i <= Last; i++)
+    {
+        const s_TimeAndSales& Record = TimeSales[i];
+        if (Record.Type != SC_TS_BID && Record.Type != SC_TS_ASK)
+            continue;
+
+        pState->Recent.Add(pState->TimeConverter.Microseconds(Record.DateTime), PriceToTicks(Record.Price, pState->TickSize),
+            Record.Volume, Record.Type == SC_TS_ASK);
+    }
+}
+
+// Footprint snapshot requests among the consumer's control lines
+static void NoteFootprintRequests(SocketState* pState, const SCString& Symbol)
+{
+    if (!pState->ExportFootprint)
+        return;
+
+    for (size_t i = 0; i < pState->ControlLines.size(); i++)
+    {
+        ControlMessage Message;
+        if (ParseControlMessage(pState->ControlLines[i], Message) && Message.Type == CONTROL_FOOTPRINT
+            && (Message.Symbol.empty() || strcmp(Message.Symbol.c_str(), Symbol.GetChars()) == 0))
+            pState->FootprintSnapshotDue = true;
+    }
+}
+
+// Filter and subscribe requests among the consumer's control lines. Applied
+// before the resend, so it is filtered too.
+static void NoteFilterRequests(SCStudyInterfaceRef sc, SocketState* pState, const SCString& Symbol)
+{
+    bool Changed = false;
+    const bool WasSubscribed = pState->Filter.Subscribed;
+    for (size_t i = 0; i < pState->ControlLines.size(); i++)
+    {
+        ControlMessage Message;
+        if (ParseControlMessage(pState->ControlLines[i], Message)
+            && (Message.Type == CONTROL_FILTER || Message.Type == CONTROL_SUBSCRIBE)
+            && pState->Filter.Apply(Message, Symbol.GetChars()))
+            Changed = true;
+    }
+
+    if (!Changed)
+        return;
+
+    // The consumer has no ladder for a chart it was not receiving
+    if (pState->Filter.Subscribed && !WasSubscribed)
+        pState->FootprintSnapshotDue = true;
+
+    static const char* const StreamNames[] = { "as configured", "ticks only", "aggregates only", "ticks and aggregates" };
+    if (!pState->Filter.Subscribed)
+    {
+        sc.AddMessageToLog("Socket Exporter: Consumer filter: not subscribed to this symbol", 0);
+        return;
+    }
+
+    SCString Msg;
+    Msg.Format("Socket Exporter: Consumer filter: min volume %u, %s", pState->Filter.MinVolume, StreamNames[pState->Filter.Stream]);
+    sc.AddMessageToLog(Msg, 0);
+}
+
+// Study input for aggregates, narrowed or widened by the consumer's filter
+static int FilteredAggregateOutput(const TickFilter& Filter, int AggregateOutput)
+{
+    if (!Filter.Subscribed || Filter.Stream == CONTROL_STREAM_TICKS)
+        return AGGREGATES_OFF;
+    if (Filter.Stream == CONTROL_STREAM_AGGREGATES)
+        return AGGREGATES_ONLY;
+    if (Filter.Stream == CONTROL_STREAM_BOTH)
+        return AGGREGATES_WITH_TICKS;
+    return AggregateOutput;
+}
+
+// Runs the resume handshake of a new connection, then the resend it asked
+// for, and takes up the consumer's other requests. Returns true once live
+// ticks may follow.
+static bool ServiceResume(SCStudyInterfaceRef sc, SocketState* pState, const SCString& Symbol, int& TicksSent)
+{
+    if (pState->Channel != NULL)
+        pState->Channel->TakeControlLines(pState->ControlLines);
+    NoteFootprintRequests(pState, Symbol);
+    NoteFilterRequests(sc, pState, Symbol);
+
+    if (pState->AwaitingResume)
+    {
+        for (size_t i = 0; i < pState->ControlLines.size() && pState->AwaitingResume; i++)
+        {
+            ControlMessage Message;
+            if (!ParseControlMessage(pState->ControlLines[i], Message))
+                continue;
+
+            // A consumer resuming this symbol has its recent tape already
+            if (Message.Type == CONTROL_RESUME
+                && (Message.Symbol.empty() || strcmp(Message.Symbol.c_str(), Symbol.GetChars()) == 0))
+                pState->WarmStartDue = false;
+
+            if (Message.Type == CONTROL_READY)
+            {
+                pState->AwaitingResume = false;
+            }
+            else if (Message.Type == CONTROL_RESUME && !pState->History.Empty()
+                && (Message.Symbol.empty() || strcmp(Message.Symbol.c_str(), Symbol.GetChars()) == 0)
+                && Message.Sequence < pState->History.Newest())
+            {
+                const int64_t First = (Message.Sequence + 1 > pState->History.Oldest()) ? Message.Sequence + 1 : pState->History.Oldest();
+                pState->ResendNext = First;
+                pState->ResendLast = pState->History.Newest();
+
+                SCString Msg;
+                Msg.Format("Socket Exporter: Resending %lld ticks after seq %lld",
+                    static_cast<long long>(pState->ResendLast - First + 1), static_cast<long long>(Message.Sequence));
+                sc.AddMessageToLog(Msg, 0);
+
+                if (First > Message.Sequence + 1)
+                {
+                    Msg.Format("Socket Exporter: %lld ticks were no longer in the history",
+                        static_cast<long long>(First - Message.Sequence - 1));
+                    sc.AddMessageToLog(Msg, 1);
+                }
+            }
+        }
+
+        // A consumer that never answers gets live ticks after the wait
+        if (pState->AwaitingResume && std::chrono::steady_clock::now() >= pState->ResumeDeadline)
+            pState->AwaitingResume = false;
+
+        if (pState->AwaitingResume)
+            return false;
+    }
+
+    pState->ControlLines.clear();
+    return ResendHistory(sc, pState, Symbol, TicksSent);
+}
+
+// Answers the control lines multicast receivers sent for this chart. A
+// resume request gets the ticks after its sequence from the history, sent to
+// that receiver alone behind the symbol definition; a footprint request makes
+// the next footprint message a snapshot, for the whole group.
+static void ServiceMulticastRequests(SocketState* pState, const SCString& Symbol)
+{
+    pState->Multicast->TakeRequests(pState->SymbolId, pState->MulticastRequests);
+
+    for (size_t i = 0; i < pState->MulticastRequests.size(); i++)
+    {
+        const MulticastRequest& Request = pState->MulticastRequests[i];
+        if (Request.Message.Type == CONTROL_FOOTPRINT)
+        {
+            if (pState->ExportFootprint)
+                pState->FootprintSnapshotDue = true;
+            continue;
+        }
+
+        if (Request.Message.Type != CONTROL_RESUME || !pState->SymbolDefined || pState->History.Empty()
+            || Request.Message.Sequence >= pState->History.Newest())
+            continue;
+
+        // The receiver may have joined since the last announcement
+        char Definition[WIRE_MAX_SYMBOL_FRAME];
+        pState->Multicast->SendTo(Request.From, Definition,
+            WriteSymbolFrame(Definition, pState->SymbolId, Symbol.GetChars(), pState->TickSize, pState->PriceDecimals));
+
+        // Receivers name the end of the gap, as the ticks after it reached them
+        int64_t Newest = pState->History.Newest();
+        if (Request.Message.Through > 0 && Request.Message.Through < Newest)
+            Newest = Request.Message.Through;
+
+        int64_t Next = (Request.Message.Sequence + 1 > pState->History.Oldest()) ? Request.Message.Sequence + 1 : pState->History.Oldest();
+        const int64_t Last = (Newest - Next < MULTICAST_MAX_RESEND_TICKS) ? Newest : Next + MULTICAST_MAX_RESEND_TICKS - 1;
+        while (Next <= Last)
+        {
+            const int Ticks = (Last - Next + 1 < RESEND_CHUNK_TICKS) ? static_cast<int>(Last - Next + 1) : RESEND_CHUNK_TICKS;
+            char* Out = ReserveSpace(pState->ResendBuffer, 0, static_cast<int>(sizeof(WireFrameHeader) + Ticks * sizeof(WireTick)));
+
+            size_t Length = sizeof(WireFrameHeader);
+            for (int t = 0; t < Ticks; t++)
+            {
+                const WireTick& Tick = pState->History.Get(Next + t);
+                Length += WriteBinaryTick(pState, Out + Length, Tick.Sequence, Tick.Timestamp, Tick.PriceTicks, Tick.Volume,
+                    Tick.Side == WIRE_SIDE_ASK, Tick.Prints);
+            }
+            WriteFrameHeader(Out, WIRE_FRAME_TICKS, static_cast<uint32_t>(Length - sizeof(WireFrameHeader)));
+
+            pState->Multicast->SendTo(Request.From, Out, Length);
+            Next += Ticks;
+        }
+    }
+
+    pState->MulticastRequests.clear();
+}
+
+// Formats a summary of coalesced ticks as a JSON line. The seq0..seq1 range
+// tells consumers these sequence numbers were not lost.
+static int FormatSummaryMessage(char* Buffer, int BufferSize, const TickSummary& Summary, int PriceDecimals, const char* Symbol)
+{
+    int len = sprintf_s(Buffer, BufferSize,
+                       "{\"type\":\"summary\",\"seq0\":%lld,\"seq1\":%lld,\"n\":%d,\"ts0\":%lld,\"ts1\":%lld,"
+                       "\"bn\":%d,\"an\":%d,\"bv\":%lld,\"av\":%lld,\"hi\":%.*f,\"lo\":%.*f,\"sym\":\"%s\"}\n",
+                       static_cast<long long>(Summary.FirstSequence),
+                       static_cast<long long>(Summary.LastSequence),
+                       Summary.Ticks,
+                       static_cast<long long>(Summary.FirstTimestampMs),
+                       static_cast<long long>(Summary.LastTimestampMs),
+                       Summary.BidTicks,
+                       Summary.AskTicks,
+                       static_cast<long long>(Summary.BidVolume),
+                       static_cast<long long>(Summary.AskVolume),
+                       PriceDecimals,
+                       Summary.High,
+                       PriceDecimals,
+                       Summary.Low,
+                       Symbol);
+
+    return (len > 0) ? len : 0;
+}
+
+// Binary counterpart of FormatSummaryMessage
+static int FormatSummaryFrame(char* Buffer, const TickSummary& Summary, double TickSize, uint16_t SymbolId)
+{
+    WireSummary Frame;
+    Frame.FirstSequence = Summary.FirstSequence;
+    Frame.LastSequence = Summary.LastSequence;
+    Frame.FirstTimestamp = Summary.FirstTimestampMs;
+    Frame.LastTimestamp = Summary.LastTimestampMs;
+    Frame.BidVolume = Summary.BidVolume;
+    Frame.AskVolume = Summary.AskVolume;
+    Frame.Ticks = Summary.Ticks;
+    Frame.BidTicks = Summary.BidTicks;
+    Frame.AskTicks = Summary.AskTicks;
+    Frame.HighTicks = PriceToTicks(Summary.High, TickSize);
+    Frame.LowTicks = PriceToTicks(Summary.Low, TickSize);
+    Frame.SymbolId = SymbolId;
+    Frame.Reserved = 0;
+
+    const int Length = WriteFrameHeader(Buffer, WIRE_FRAME_SUMMARY, sizeof(Frame));
+    memcpy(Buffer + Length, &Frame, sizeof(Frame));
+    return Length + static_cast<int>(sizeof(Frame));
+}
+
+// Sends a self-contained message that the next one of its kind supersedes
+// (aggregates) or that is stale once it waits (trade events). It is dropped
+// rather than queued behind a full buffer, and the overflow policy does not
+// apply. Queued tells whether it was queued or published. Returns false if
+// the connection was lost.
+static bool SendAuxMessage(SCStudyInterfaceRef sc, SocketState* pState, const char* Data, size_t Length, int& TicksSent, bool& Queued)
+{
+    if (PublishFrames(pState, Data, Length, Queued))
+        return true;
+
+    if (pState->Channel != NULL)
+    {
+        Queued = pState->Channel->Push(Data, Length, 0);
+        pState->Worker->Notify();
+        return true;
+    }
+
+    Queued = pState->SendQueue.CanFit(Length) && pState->SendQueue.Push(Data, Length, 0);
+
+    return DrainSendQueue(sc, pState, TicksSent);
+}
+
+static bool SendAuxMessage(SCStudyInterfaceRef sc, SocketState* pState, const char* Data, size_t Length, int& TicksSent)
+{
+    bool Queued;
+    return SendAuxMessage(sc, pState, Data, Length, TicksSent, Queued);
+}
+
+// Formats the aggregator's windows as one JSON line:
+// {"type":"aggregate","ts":..,"p":..,"w":[{"ms":..,"bn":..,"an":..,"bv":..,"av":..},...],"sym":".."}
+static int FormatAggregateMessage(char* Buffer, int BufferSize, const RollingAggregator& Aggregator,
+    int64_t TimestampMs, double LastPrice, int PriceDecimals, const char* Symbol)
+{
+    int len = sprintf_s(Buffer, BufferSize, "{\"type\":\"aggregate\",\"ts\":%lld,\"p\":%.*f,\"w\":[",
+                       static_cast<long long>(TimestampMs), PriceDecimals, LastPrice);
+
+    for (int i = 0; i < Aggregator.GetWindowCount() && len > 0 && len < BufferSize; i++)
+    {
+        const AggregateTotals& Totals = Aggregator.GetTotals(i);
+        const int Written = sprintf_s(Buffer + len, BufferSize - len,
+                                     "%s{\"ms\":%d,\"bn\":%u,\"an\":%u,\"bv\":%lld,\"av\":%lld}",
+                                     (i > 0) ? "," : "",
+                                     Aggregator.GetWindowMs(i),
+                                     Totals.BidTicks,
+                                     Totals.AskTicks,
+                                     static_cast<long long>(Totals.BidVolume),
+                                     static_cast<long long>(Totals.AskVolume));
+        len = (Written > 0) ? len + Written : -1;
+    }
+
+    if (len > 0 && len < BufferSize)
+    {
+        const int Written = sprintf_s(Buffer + len, BufferSize - len, "],\"sym\":\"%s\"}\n", Symbol);
+        len = (Written > 0) ? len + Written : -1;
+    }
+
+    return (len > 0 && len < BufferSize) ? len : 0;
+}
+
+// Binary counterpart of FormatAggregateMessage
+static int FormatAggregateFrame(char* Buffer, const RollingAggregator& Aggregator,
+    int64_t TimestampMs, int32_t LastPriceTicks, uint16_t SymbolId)
+{
+    const int Count = Aggregator.GetWindowCount();
+    int Length = WriteFrameHeader(Buffer, WIRE_FRAME_AGGREGATE, static_cast<uint32_t>(Count * sizeof(WireAggregate)));
+
+    for (int i = 0; i < Count; i++)
+    {
+        const AggregateTotals& Totals = Aggregator.GetTotals(i);
+
+        WireAggregate Frame;
+        Frame.Timestamp = TimestampMs;
+        Frame.BidVolume = Totals.BidVolume;
+        Frame.AskVolume = Totals.AskVolume;
+        Frame.WindowMs = static_cast<uint32_t>(Aggregator.GetWindowMs(i));
+        Frame.BidTicks = Totals.BidTicks;
+        Frame.AskTicks = Totals.AskTicks;
+        Frame.LastPriceTicks = LastPriceTicks;
+        Frame.SymbolId = SymbolId;
+        Frame.Reserved = 0;
+        Frame.Reserved2 = 0;
+
+        memcpy(Buffer + Length, &Frame, sizeof(Frame));
+        Length += sizeof(Frame);
+    }
+
+    return Length;
+}
+
+// Emits one aggregate message if IntervalMs has passed since the last one.
+// Between trades the time runs on with the local clock; a replay runs at its
+// own speed, so there the last trade's time is used. Returns false if the
+// connection was lost.
+static bool EmitAggregates(SCStudyInterfaceRef sc, SocketState* pState, const char* Symbol, int IntervalMs, bool IsReplaying,
+    int& TicksSent)
+{
+    if (pState->Aggregator.GetWindowCount() == 0 || pState->LastTradeTimestampMs == 0)
+        return true;
+
+    const int64_t IdleMs = IsReplaying ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - pState->LastTradeClock).count();
+    const int64_t NowMs = pState->LastTradeTimestampMs + IdleMs;
+
+    if (NowMs - pState->LastAggregateMs < IntervalMs)
+        return true;
+
+    pState->Aggregator.Advance(NowMs);
+    pState->LastAggregateMs = NowMs;
+
+    char Buffer[MAX_AGGREGATE_MESSAGE_LENGTH];
+    const int Length = (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+        ? FormatAggregateFrame(Buffer, pState->Aggregator, NowMs, PriceToTicks(pState->LastTradePrice, pState->TickSize), pState->SymbolId)
+        : FormatAggregateMessage(Buffer, sizeof(Buffer), pState->Aggregator, NowMs, pState->LastTradePrice, pState->PriceDecimals, Symbol);
+
+    if (Length == 0)
+        return true;
+
+    return SendAuxMessage(sc, pState, Buffer, Length, TicksSent);
+}
+
+// Writes the quote fields changed since the last record into the quote
+// buffer, as a keyframe if the last one is QUOTE_KEYFRAME_INTERVAL_MS old
+static void AppendQuoteRecord(SocketState* pState, int64_t TimestampMs, std::chrono::steady_clock::time_point Now)
+{
+    if (!pState->Quotes.HasChanges())
+        return;
+
+    const bool Keyframe = (TimestampMs - pState->LastKeyframeMs >= QUOTE_KEYFRAME_INTERVAL_MS
+        || TimestampMs < pState->LastKeyframeMs);
+
+    if (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+    {
+        // Leave room for the quotes frame header, written by FlushQuotes
+        if (pState->QuoteRecords == 0)
+        {
+            ReserveSpace(pState->QuoteBuffer, 0, sizeof(WireFrameHeader));
+            pState->QuoteLength = sizeof(WireFrameHeader);
+        }
+
+        char* Out = ReserveSpace(pState->QuoteBuffer, pState->QuoteLength, WIRE_MAX_QUOTE_RECORD);
+        pState->QuoteLength += pState->Quotes.WriteRecord(Out, TimestampMs, pState->SymbolId, Keyframe);
+    }
+    else
+    {
+        char* Out = ReserveSpace(pState->QuoteBuffer, pState->QuoteLength, MAX_JSON_QUOTE_LENGTH);
+        pState->QuoteLength += pState->Quotes.WriteJson(Out, TimestampMs, Keyframe, pState->TickSize, pState->JsonSerializer);
+    }
+
+    if (Keyframe)
+        pState->LastKeyframeMs = TimestampMs;
+
+    pState->QuoteRecords++;
+    pState->LastQuoteRecordMs = TimestampMs;
+    pState->LastQuoteClock = Now;
+}
+
+// Sends the buffered quote records as one message on the quote channel.
+// Records that cannot be queued would leave consumers without the fields
+// they changed until the next keyframe, so the next record is then one.
+// Returns false if the connection was lost.
+static bool FlushQuotes(SCStudyInterfaceRef sc, SocketState* pState, int& TicksSent)
+{
+    if (pState->QuoteRecords == 0)
+        return true;
+
+    if (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+        WriteFrameHeader(pState->QuoteBuffer.data(), WIRE_FRAME_QUOTES, static_cast<uint32_t>(pState->QuoteLength - sizeof(WireFrameHeader)));
+
+    const int Length = pState->QuoteLength;
+    pState->QuoteLength = 0;
+    pState->QuoteRecords = 0;
+
+    bool Queued;
+    const bool Connected = SendAuxMessage(sc, pState, pState->QuoteBuffer.data(), Length, TicksSent, Queued);
+    if (!Queued)
+        pState->Quotes.Reset();
+    return Connected;
+}
+
+// Sends a completed sweep or block trade. Returns false if the connection was lost.
+static bool EmitTradeEvent(SCStudyInterfaceRef sc, SocketState* pState, const TradeEvent& Event, int& TicksSent)
+{
+    if (!pState->Filter.Subscribed)
+        return true;
+
+    char Buffer[MAX_JSON_TRADE_EVENT_LENGTH];
+    const int Length = (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+        ? TradeEventDetector::WriteFrame(Buffer, Event, pState->SymbolId)
+        : TradeEventDetector::WriteJson(Buffer, Event, pState->TickSize, pState->JsonSerializer);
+
+    return SendAuxMessage(sc, pState, Buffer, Length, TicksSent);
+}
+
+// Starts the ladder over for the trading session DateTime falls in. The
+// session lasts until the next trading day starts, so the day is only
+// looked up again when a trade crosses that point.
+static void BeginFootprintSession(SCStudyInterfaceRef sc, SocketState* pState, const SCDateTime& DateTime, int64_t TimestampUs)
+{
+    const int TradingDate = sc.GetTradingDayDate(DateTime);
+    int64_t StartUs = pState->TimeConverter.Microseconds(sc.GetStartDateTimeForTradingDate(TradingDate));
+    int64_t EndUs = pState->TimeConverter.Microseconds(sc.GetStartDateTimeForTradingDate(TradingDate + 1));
+
+    // Session times that do not bracket the trade (unusual session settings)
+    // fall back to the calendar day
+    if (StartUs > TimestampUs || EndUs <= TimestampUs)
+    {
+        StartUs = TimestampUs - TimestampUs % 86400000000LL;
+        EndUs = StartUs + 86400000000LL;
+    }
+
+    pState->Footprint.Clear();
+    pState->FootprintTickSize = pState->TickSize;
+    pState->FootprintSessionStartUs = StartUs;
+    pState->FootprintSessionEndUs = EndUs;
+    pState->FootprintSnapshotDue = true;
+}
+
+// Forgets the ladder; the next trade starts a new one
+static void ResetFootprint(SocketState* pState)
+{
+    pState->Footprint.Clear();
+    pState->FootprintSessionStartUs = 0;
+    pState->FootprintSessionEndUs = 0;
+    pState->FootprintLastTradeUs = 0;
+}
+
+static void AddToFootprint(SCStudyInterfaceRef sc, SocketState* pState, const SCDateTime& DateTime, int64_t TimestampUs,
+    int32_t PriceTicks, uint32_t Volume, bool IsAsk)
+{
+    // A new session, or time moving back (replay seek) past what the ladder holds
+    if (TimestampUs >= pState->FootprintSessionEndUs || TimestampUs < pState->FootprintSessionStartUs
+        || TimestampUs + 1000000 < pState->FootprintLastTradeUs || pState->FootprintTickSize != pState->TickSize)
+        BeginFootprintSession(sc, pState, DateTime, TimestampUs);
+
+    pState->Footprint.Add(PriceTicks, Volume, IsAsk);
+    pState->FootprintLastTradeUs = TimestampUs;
+}
+
+// Queues a footprint message. A delta that cannot be queued would leave
+// consumers without those levels until they trade again, so the next
+// message is then a snapshot. Returns false if the connection was lost.
+static bool SendFootprintMessage(SCStudyInterfaceRef sc, SocketState* pState, const char* Data, size_t Length, int& TicksSent)
+{
+    bool Queued;
+    const bool Connected = SendAuxMessage(sc, pState, Data, Length, TicksSent, Queued);
+    if (!Queued)
+        pState->FootprintSnapshotDue = true;
+    return Connected;
+}
+
+// Sends the levels changed in the last interval, or the whole ladder when a
+// snapshot is due. Returns false if the connection was lost.
+static bool EmitFootprint(SCStudyInterfaceRef sc, SocketState* pState, int IntervalMs, std::chrono::steady_clock::time_point Now, int& TicksSent)
+{
+    if (pState->FootprintSessionEndUs == 0)
+        return true;
+
+    if ((pState->Shm != NULL || pState->Multicast != NULL)
+        && Now - pState->LastFootprintSnapshotClock >= std::chrono::milliseconds(FOOTPRINT_PERIODIC_SNAPSHOT_INTERVAL_MS))
+        pState->FootprintSnapshotDue = true;
+
+    const bool Snapshot = pState->FootprintSnapshotDue;
+    if (!Snapshot && (!pState->Footprint.HasChanges() || Now - pState->LastFootprintClock < std::chrono::milliseconds(IntervalMs)))
+        return true;
+
+    pState->FootprintSnapshotDue = false;
+    pState->LastFootprintClock = Now;
+    if (Snapshot)
+        pState->LastFootprintSnapshotClock = Now;
+
+    const int64_t TimestampMs = pState->FootprintLastTradeUs / 1000;
+    const int64_t SessionStartMs = pState->FootprintSessionStartUs / 1000;
+    size_t Length;
+    if (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+    {
+        char* Out = ReserveSpace(pState->FootprintBuffer, 0, static_cast<int>(pState->Footprint.MaxFrameLength(Snapshot)));
+        Length = pState->Footprint.WriteFrame(Out, TimestampMs, SessionStartMs, pState->SymbolId, Snapshot);
+    }
+    else
+    {
+        char* Out = ReserveSpace(pState->FootprintBuffer, 0, static_cast<int>(pState->Footprint.MaxJsonLength(Snapshot)));
+        Length = pState->Footprint.WriteJson(Out, TimestampMs, SessionStartMs, Snapshot, pState->TickSize, pState->JsonSerializer);
+    }
+
+    return SendFootprintMessage(sc, pState, pState->FootprintBuffer.data(), Length, TicksSent);
+}
+
+// Upper bound on one stats line or frame
+static const int MAX_STATS_MESSAGE_LENGTH = 512;
+
+static int FormatStatsMessage(char* Buffer, int BufferSize, const WireStats& Stats, const char* Symbol)
+{
+    const int len = sprintf_s(Buffer, BufferSize,
+                             "{\"type\":\"stats\",\"ts\":%lld,\"ms\":%u,\"calls\":%u,\"ticks\":%llu,\"bytes\":%llu,"
+                             "\"p50\":%u,\"p99\":%u,\"max\":%u,\"tpc\":%u,\"wb\":%u,\"conn\":%u,"
+                             "\"backlog\":%llu,\"dropped\":%lld,\"merged\":%u,\"sym\":\"%s\"}\n",
+                             static_cast<long long>(Stats.Timestamp),
+                             Stats.IntervalMs,
+                             Stats.Calls,
+                             static_cast<unsigned long long>(Stats.Ticks),
+                             static_cast<unsigned long long>(Stats.BytesSent),
+                             Stats.CallP50Micros,
+                             Stats.CallP99Micros,
+                             Stats.CallMaxMicros,
+                             Stats.MaxTicksPerCall,
+                             Stats.WouldBlocks,
+                             Stats.Connects,
+                             static_cast<unsigned long long>(Stats.BacklogBytes),
+                             static_cast<long long>(Stats.DroppedTicks),
+                             Stats.MergedPrints,
+                             Symbol);
+
+    return (len > 0 && len < BufferSize) ? len : 0;
+}
+
+// Folds in the worker's, shared-memory ring's, WebSocket server's or
+// multicast publisher's transport counters since the last call, so all
+// transports report the same stats. Datagrams the socket refused count as
+// would-block sends.
+static void CollectTransportStats(SocketState* pState)
+{
+    if (pState->Worker != NULL)
+    {
+        const int64_t ChannelBytesSent = pState->Channel->BytesSent;
+        const int WorkerWouldBlocks = pState->Worker->WouldBlocks;
+        pState->Stats.BytesSent += ChannelBytesSent - pState->LastChannelBytesSent;
+        pState->Stats.WouldBlocks += WorkerWouldBlocks - pState->LastWorkerWouldBlocks;
+        pState->LastChannelBytesSent = ChannelBytesSent;
+        pState->LastWorkerWouldBlocks = WorkerWouldBlocks;
+    }
+    else if (pState->Shm != NULL)
+    {
+        const int64_t BytesPublished = pState->Shm->BytesPublished;
+        pState->Stats.BytesSent += BytesPublished - pState->LastShmBytesPublished;
+        pState->LastShmBytesPublished = BytesPublished;
+    }
+    else if (pState->Ws != NULL)
+    {
+        const int64_t WsBytesSent = pState->Ws->BytesSent;
+        pState->Stats.BytesSent += WsBytesSent - pState->LastWsBytesSent;
+        pState->LastWsBytesSent = WsBytesSent;
+    }
+    else if (pState->Multicast != NULL)
+    {
+        const int64_t BytesPublished = pState->Multicast->BytesPublished;
+        const int DroppedDatagrams = pState->Multicast->DroppedDatagrams;
+        pState->Stats.BytesSent += BytesPublished - pState->LastMulticastBytesPublished;
+        pState->Stats.WouldBlocks += DroppedDatagrams - pState->LastMulticastDroppedDatagrams;
+        pState->LastMulticastBytesPublished = BytesPublished;
+        pState->LastMulticastDroppedDatagrams = DroppedDatagrams;
+    }
+}
+
+// Sends a stats message every IntervalMs and starts a new interval. The
+// values are also written to the study's subgraphs when WriteSubgraphs is set.
+// Returns false if the connection was lost.
+static bool EmitStats(SCStudyInterfaceRef sc, SocketState* pState, const char* Symbol, int IntervalMs,
+    bool WriteSubgraphs, std::chrono::steady_clock::time_point Now, int& TicksSent)
+{
+    const int64_t ElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(Now - pState->LastStatsClock).count();
+    if (ElapsedMs < IntervalMs)
+        return true;
+
+    CollectTransportStats(pState);
+
+    const ExporterStats& Stats = pState->Stats;
+
+    WireStats Frame;
+    Frame.Timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    Frame.IntervalMs = static_cast<uint32_t>(ElapsedMs);
+    Frame.Calls = static_cast<uint32_t>(Stats.CallMicros.GetCount());
+    Frame.Ticks = Stats.Ticks;
+    Frame.BytesSent = Stats.BytesSent;
+    Frame.CallP50Micros = static_cast<uint32_t>(Stats.CallMicros.Percentile(0.50));
+    Frame.CallP99Micros = static_cast<uint32_t>(Stats.CallMicros.Percentile(0.99));
+    Frame.CallMaxMicros = static_cast<uint32_t>(Stats.CallMicros.GetMaxMicros());
+    Frame.MaxTicksPerCall = Stats.MaxTicksPerCall;
+    Frame.WouldBlocks = Stats.WouldBlocks;
+    Frame.Connects = Stats.Connects;
+    if (pState->Ws != NULL)
+        Frame.BacklogBytes = pState->Ws->BacklogBytes;
+    else
+        Frame.BacklogBytes = (pState->Channel != NULL) ? pState->Channel->QueuedBytes() : pState->SendQueue.SizeBytes();
+    Frame.DroppedTicks = pState->DroppedTicks;
+    Frame.SymbolId = pState->SymbolId;
+    Frame.Reserved = 0;
+    Frame.MergedPrints = Stats.MergedPrints;
+
+    pState->Stats.Reset();
+    pState->LastStatsClock = Now;
+
+    if (WriteSubgraphs && sc.ArraySize > 0)
+    {
+        const int Index = sc.ArraySize - 1;
+        sc.Subgraph[0][Index] = static_cast<float>(Frame.CallP99Micros);
+        sc.Subgraph[1][Index] = static_cast<float>(Frame.MaxTicksPerCall);
+        sc.Subgraph[2][Index] = static_cast<float>(Frame.BacklogBytes / 1024.0);
+        sc.Subgraph[3][Index] = static_cast<float>(Frame.BytesSent / 1024.0 * 1000.0 / (Frame.IntervalMs > 0 ? Frame.IntervalMs : 1));
+    }
+
+    char Buffer[MAX_STATS_MESSAGE_LENGTH];
+    int Length;
+    if (pState->ConnectionFormat == WIRE_FORMAT_BINARY)
+    {
+        Length = WriteFrameHeader(Buffer, WIRE_FRAME_STATS, sizeof(Frame));
+        memcpy(Buffer + Length, &Frame, sizeof(Frame));
+        Length += sizeof(Frame);
+    }
+    else
+    {
+        Length = FormatStatsMessage(Buffer, sizeof(Buffer), Frame, Symbol);
+    }
+
+    if (Length == 0)
+        return true;
+
+    return SendAuxMessage(sc, pState, Buffer, Length, TicksSent);
+}
+
+// Adds the call's ticks to the stats and emits them when they are due, as
+// the enclosing scope ends, so every return path of the export is counted
+class ScopedCallStats
+{
+public:
+    ScopedCallStats(SCStudyInterfaceRef Study, SocketState* State, const char* SymbolName, int StatsIntervalMs,
+        bool StatsSubgraphs, std::chrono::steady_clock::time_point CallClock, const int& CallTrades, int& CallTicksSent)
+        : sc(Study), pState(State), Symbol(SymbolName), IntervalMs(StatsIntervalMs), WriteSubgraphs(StatsSubgraphs)
+        , Now(CallClock), TradesThisCall(CallTrades), TicksSent(CallTicksSent)
+    {
+    }
+
+    ~ScopedCallStats()
+    {
+        pState->Stats.AddCallTicks(static_cast<uint32_t>(TradesThisCall));
+
+        // A direct connection closed during the call waits for the next one
+        const bool CanSend = pState->Connected || pState->Channel != NULL || pState->Shm != NULL
+            || pState->Ws != NULL || pState->Multicast != NULL;
+        if (IntervalMs > 0 && CanSend)
+            EmitStats(sc, pState, Symbol, IntervalMs, WriteSubgraphs, Now, TicksSent);
+    }
+
+private:
+    ScopedCallStats(const ScopedCallStats&);
+    ScopedCallStats& operator=(const ScopedCallStats&);
+
+    SCStudyInterfaceRef sc;
+    SocketState* pState;
+    const char* Symbol;
+    int IntervalMs;
+    bool WriteSubgraphs;
+    std::chrono::steady_clock::time_point Now;
+    const int& TradesThisCall;
+    int& TicksSent;
+};
+
+// Tracks how fast the replay clock runs against the local clock, smoothed
+// over a few samples. Stays at 1 outside replays and while paused.
+static void UpdateReplaySpeed(SocketState* pState, bool IsReplaying, double ReplayDateTime, std::chrono::steady_clock::time_point Now)
+{
+    if (!IsReplaying || pState->SpeedSampleReplayDateTime == 0.0 || ReplayDateTime < pState->SpeedSampleReplayDateTime)
+    {
+        if (!IsReplaying)
+            pState->ReplaySpeed = 1.0;
+        pState->SpeedSampleReplayDateTime = ReplayDateTime;
+        pState->SpeedSampleClock = Now;
+        return;
+    }
+
+    const double ElapsedMs = std::chrono::duration<double, std::milli>(Now - pState->SpeedSampleClock).count();
+    if (ElapsedMs < REPLAY_SPEED_SAMPLE_MS)
+        return;
+
+    const double MillisecondsPerDay = 86400000.0;
+    double Speed = (ReplayDateTime - pState->SpeedSampleReplayDateTime) * MillisecondsPerDay / ElapsedMs;
+    if (Speed < 1.0)
+        Speed = 1.0;
+    if (Speed > 1000.0)
+        Speed = 1000.0;
+
+    pState->ReplaySpeed = 0.5 * pState->ReplaySpeed + 0.5 * Speed;
+    pState->SpeedSampleReplayDateTime = ReplayDateTime;
+    pState->SpeedSampleClock = Now;
+}
+
+// Returns the index of the first record with Sequence > LastSequence, or
+// TimeSales.Size() if there is none. Sequence is strictly increasing, so the
+// cached index from the previous call is checked first and a binary search is
+// only needed when records have been trimmed from the front of the array.
+static int FindFirstUnprocessedIndex(const c_SCTimeAndSalesArray& TimeSales, int64_t LastSequence, int HintIndex)
+{
+    const int Size = TimeSales.Size();
+
+    if (HintIndex >= 0 && HintIndex < Size && TimeSales[HintIndex].Sequence == LastSequence)
+        return HintIndex + 1;
+
+    int Low = 0;
+    int High = Size;
+    while (Low < High)
+    {
+        const int Mid = Low + (High - Low) / 2;
+        if (TimeSales[Mid].Sequence <= LastSequence)
+            Low = Mid + 1;
+        else
+            High = Mid;
+    }
+
+    return Low;
+}
+
+// Gathers records from First, up to End and at most the batch's capacity,
+// into the batch and converts them. Returns the index after the last one.
+static int ConvertRecords(SocketState* pState, const c_SCTimeAndSalesArray& TimeSales, int First, int End)
+{
+    RecordBatch& Batch = pState->Batch;
+    const int Last = (End - First < RecordBatch::CAPACITY) ? End : First + RecordBatch::CAPACITY;
+
+    for (int i = First; i < Last; i++)
+    {
+        const s_TimeAndSales& Record = TimeSales[i];
+        const int j = i - First;
+        Batch.Dates[j] = static_cast<uint32_t>(Record.DateTime.GetDate());
+        Batch.Seconds[j] = static_cast<uint32_t>(Record.DateTime.GetTimeInSeconds());
+        Batch.SubMicros[j] = static_cast<uint32_t>(Record.DateTime.GetMillisecond() * 1000 + Record.DateTime.GetMicrosecond());
+        Batch.Prices[j] = Record.Price;
+        Batch.Types[j] = Record.Type;
+    }
+
+    Batch.Count = Last - First;
+    Batch.Convert(pState->ConversionKernel, pState->TickSize, SC_TS_BID, SC_TS_ASK);
+    return Last;
+}
+
+// Stops the recorder after it has written and committed what it was given
+static void StopRecorder(SocketState* pState)
+{
+    if (pState->Recorder == NULL)
+        return;
+
+    delete pState->Recorder;
+    pState->Recorder = NULL;
+    pState->LastRecordedSequence = 0;
+    pState->LastRecordedIndex = -1;
+}
+
+// Hands the trades added since the last call to the recorder, starting a new
+// recording when the settings or the symbol change. Like the live export it
+// starts from the newest record. Replays are not recorded.
+static void RecordNewTicks(SCStudyInterfaceRef sc, SocketState* pState, const char* Directory, int SegmentMB, int CommitIntervalMs)
+{
+    if (sc.ReplayStatus != 0)
+    {
+        StopRecorder(pState);
+        return;
+    }
+
+    const SCString Symbol = sc.GetRealTimeSymbol();
+    const uint64_t SegmentBytes = static_cast<uint64_t>(SegmentMB) * 1024 * 1024;
+
+    TickRecorder* pRecorder = pState->Recorder;
+    if (pRecorder == NULL
+        || pRecorder->GetDirectory() != Directory
+        || pRecorder->GetSymbol() != Symbol.GetChars()
+        || pRecorder->GetSegmentBytes() != SegmentBytes
+        || pRecorder->GetCommitIntervalMs() != CommitIntervalMs
+        || pRecorder->GetTickSize() != sc.TickSize)
+    {
+        StopRecorder(pState);
+
+        pRecorder = new TickRecorder();
+        pRecorder->Start(Directory, Symbol.GetChars(), sc.TickSize, PriceDecimalsFor(sc.TickSize, sc.ValueFormat), SegmentBytes, CommitIntervalMs);
+        pState->Recorder = pRecorder;
+        pState->LastRecorderError = 0;
+        pState->LastRecorderDropped = 0;
+
+        SCString Msg;
+        Msg.Format("Socket Exporter: Recording %s to %s", Symbol.GetChars(), Directory);
+        sc.AddMessageToLog(Msg, 0);
+    }
+
+    // The writer cannot log; report its failures from here
+    const uint32_t Error = pRecorder->LastError;
+    if (Error != pState->LastRecorderError)
+    {
+        SCString Msg;
+        Msg.Format("Socket Exporter: Recorder write failed (error %u, failures: %d)", Error, static_cast<int>(pRecorder->WriteErrors));
+        sc.AddMessageToLog(Msg, 1);
+        pState->LastRecorderError = Error;
+    }
+
+    const int64_t Dropped = pRecorder->DroppedRecords;
+    if (Dropped != pState->LastRecorderDropped)
+    {
+        SCString Msg;
+        Msg.Format("Socket Exporter: Recorder dropped trades (total: %lld)", static_cast<long long>(Dropped));
+        sc.AddMessageToLog(Msg, 1);
+        pState->LastRecorderDropped = Dropped;
+    }
+
+    c_SCTimeAndSalesArray TimeSales;
+    sc.GetTimeAndSales(TimeSales);
+
+    const int NumRecords = TimeSales.Size();
+    if (NumRecords == 0)
+        return;
+
+    const int64_t NewestSequence = TimeSales[NumRecords - 1].Sequence;
+    if (pState->LastRecordedSequence == 0 || NewestSequence < pState->LastRecordedSequence)
+    {
+        pState->LastRecordedSequence = NewestSequence;
+        pState->LastRecordedIndex = NumRecords - 1;
+        return;
+    }
+
+    pState->RecordBuffer.clear();
+    for (int i = FindFirstUnprocessedIndex(TimeSales, pState->LastRecordedSequence, pState->LastRecordedIndex); i < NumRecords; i++)
+    {
+        const s_TimeAndSales& Record = TimeSales[i];
+        if (Record.Type != SC_TS_BID && Record.Type != SC_TS_ASK)
+            continue;
+
+        WireTick Tick;
+        WriteTick(reinterpret_cast<char*>(&Tick), Record.Sequence, pState->TimeConverter.Milliseconds(Record.DateTime),
+            PriceToTicks(Record.Price, sc.TickSize), Record.Volume, 0, Record.Type == SC_TS_ASK, 1);
+        pState->RecordBuffer.push_back(Tick);
+    }
+
+    pState->LastRecordedSequence = NewestSequence;
+    pState->LastRecordedIndex = NumRecords - 1;
+
+    if (!pState->RecordBuffer.empty())
+        pRecorder->Append(pState->RecordBuffer.data(), pState->RecordBuffer.size());
+}
+
+SCSFExport scsf_TimeAndSalesToSocket(SCStudyInterfaceRef sc)
+{
+    SCInputRef Input_Enabled = sc.Input[0];
+    SCInputRef Input_Port = sc.Input[1];
+    SCInputRef Input_ReplayBackfill = sc.Input[2];
+    SCInputRef Input_ResetOnReplayJump = sc.Input[3];
+    SCInputRef Input_BatchSends = sc.Input[4];
+    SCInputRef Input_MaxBatchTicks = sc.Input[5];
+    SCInputRef Input_BatchFlushBytes = sc.Input[6];
+    SCInputRef Input_SendBufferKB = sc.Input[7];
+    SCInputRef Input_OverflowPolicy = sc.Input[8];
+    SCInputRef Input_WireFormat = sc.Input[9];
+    SCInputRef Input_BackgroundIo = sc.Input[10];
+    SCInputRef Input_SharedConnection = sc.Input[11];
+    SCInputRef Input_Transport = sc.Input[12];
+    SCInputRef Input_AggregateOutput = sc.Input[13];
+    SCInputRef Input_AggregateWindows = sc.Input[14];
+    SCInputRef Input_AggregateIntervalMs = sc.Input[15];
+    SCInputRef Input_ExportQuotes = sc.Input[16];
+    SCInputRef Input_QuoteCoalesceMs = sc.Input[17];
+    SCInputRef Input_ReplayChunkTicks = sc.Input[18];
+    SCInputRef Input_ReplayBudgetUs = sc.Input[19];
+    SCInputRef Input_StatsIntervalSec = sc.Input[20];
+    SCInputRef Input_StatsSubgraphs = sc.Input[21];
+    SCInputRef Input_StampLatency = sc.Input[22];
+    SCInputRef Input_RecordTicks = sc.Input[23];
+    SCInputRef Input_RecorderDirectory = sc.Input[24];
+    SCInputRef Input_RecorderSegmentMB = sc.Input[25];
+    SCInputRef Input_RecorderCommitMs = sc.Input[26];
+    SCInputRef Input_CoalescePrints = sc.Input[27];
+    SCInputRef Input_PrintToleranceUs = sc.Input[28];
+    SCInputRef Input_WsPort = sc.Input[29];
+    SCInputRef Input_WsAcceptRemote = sc.Input[30];
+    SCInputRef Input_HistoryTicks = sc.Input[31];
+    SCInputRef Input_ResumeWaitMs = sc.Input[32];
+    SCInputRef Input_SocketBufferKB = sc.Input[33];
+    SCInputRef Input_HeartbeatMs = sc.Input[34];
+    SCInputRef Input_Host = sc.Input[35];
+    SCInputRef Input_TickCompression = sc.Input[36];
+    SCInputRef Input_Timestamps = sc.Input[37];
+    SCInputRef Input_ExportFootprint = sc.Input[38];
+    SCInputRef Input_FootprintIntervalMs = sc.Input[39];
+    SCInputRef Input_MulticastGroup = sc.Input[40];
+    SCInputRef Input_MulticastTtl = sc.Input[41];
+    SCInputRef Input_MulticastInterface = sc.Input[42];
+    SCInputRef Input_SendBackend = sc.Input[43];
+    SCInputRef Input_ExportEvents = sc.Input[44];
+    SCInputRef Input_SweepMinLevels = sc.Input[45];
+    SCInputRef Input_SweepMinVolume = sc.Input[46];
+    SCInputRef Input_BlockMinVolume = sc.Input[47];
+    SCInputRef Input_EventWindowUs = sc.Input[48];
+    SCInputRef Input_WarmStartMinutes = sc.Input[49];
+    SCInputRef Input_ConversionKernel = sc.Input[50];
+
+    SCSubgraphRef Subgraph_CallP99 = sc.Subgraph[0];
+    SCSubgraphRef Subgraph_TicksPerCall = sc.Subgraph[1];
+    SCSubgraphRef Subgraph_BacklogKB = sc.Subgraph[2];
+    SCSubgraphRef Subgraph_SentKBps = sc.Subgraph[3];
+    
+    if (sc.SetDefaults)
+    {
+        sc.GraphName = "TradeFlow Data Exporter";
+        sc.StudyDescription = "Sends real-time tick data over TCP socket";
+        sc.GraphRegion = 0;
+        sc.AutoLoop = 0;
+        sc.UpdateAlways = 1;
+        sc.FreeDLL = 1;
+        
+        Input_Enabled.Name = "Enable Export";
+        Input_Enabled.SetYesNo(0);
+        
+                Input_Port.Name = "TCP Port";
+        Input_Port.SetInt(9999);
+
+        Input_ReplayBackfill.Name = "Replay: Backfill existing Time & Sales on start";
+        Input_ReplayBackfill.SetYesNo(1);
+
+        Input_ResetOnReplayJump.Name = "Replay: Reset on replay start/stop or time jump";
+        Input_ResetOnReplayJump.SetYesNo(1);
+
+        Input_BatchSends.Name = "Output: Batch all new ticks into one send per update";
+        Input_BatchSends.SetYesNo(1);
+
+        Input_MaxBatchTicks.Name = "Output: Max ticks per batch";
+        Input_MaxBatchTicks.SetInt(1000);
+        Input_MaxBatchTicks.SetIntLimits(1, 100000);
+
+        Input_BatchFlushBytes.Name = "Output: Batch flush threshold (bytes)";
+        Input_BatchFlushBytes.SetInt(65536);
+        Input_BatchFlushBytes.SetIntLimits(MAX_TICK_MESSAGE_LENGTH, 16 * 1024 * 1024);
+
+        Input_SendBufferKB.Name = "Output: Send ring buffer size (KB)";
+        Input_SendBufferKB.SetInt(4096);
+        Input_SendBufferKB.SetIntLimits(64, 1024 * 1024);
+
+        Input_OverflowPolicy.Name = "Output: Send buffer overflow policy";
+        Input_OverflowPolicy.SetCustomInputStrings("Drop Oldest;Drop Newest;Coalesce Into Summary");
+        Input_OverflowPolicy.SetCustomInputIndex(OVERFLOW_DROP_OLDEST);
+
+        Input_WireFormat.Name = "Output: Wire format";
+        Input_WireFormat.SetCustomInputStrings("JSON Lines;Binary");
+        Input_WireFormat.SetCustomInputIndex(WIRE_FORMAT_JSON);
+
+        Input_BackgroundIo.Name = "Output: Use background I/O thread";
+        Input_BackgroundIo.SetYesNo(0);
+
+        Input_SharedConnection.Name = "Output: Share one connection across charts (hub)";
+        Input_SharedConnection.SetYesNo(0);
+
+        Input_Transport.Name = "Output: Transport";
+        Input_Transport.SetCustomInputStrings("TCP;Shared Memory;WebSocket Server;UDP Multicast");
+        Input_Transport.SetCustomInputIndex(TRANSPORT_TCP);
+
+        Input_AggregateOutput.Name = "Aggregates: Output";
+        Input_AggregateOutput.SetCustomInputStrings("Off;With Ticks;Instead of Ticks");
+        Input_AggregateOutput.SetCustomInputIndex(AGGREGATES_OFF);
+
+        Input_AggregateWindows.Name = "Aggregates: Windows (ms, comma separated)";
+        Input_AggregateWindows.SetString("200,1000,5000");
+
+        Input_AggregateIntervalMs.Name = "Aggregates: Emit interval (ms)";
+        Input_AggregateIntervalMs.SetInt(250);
+        Input_AggregateIntervalMs.SetIntLimits(10, 60000);
+
+        Input_ExportQuotes.Name = "Quotes: Export bid/ask updates";
+        Input_ExportQuotes.SetYesNo(0);
+
+        Input_QuoteCoalesceMs.Name = "Quotes: Coalesce interval (ms, 0 = every change)";
+        Input_QuoteCoalesceMs.SetInt(10);
+        Input_QuoteCoalesceMs.SetIntLimits(0, 10000);
+
+        Input_ReplayChunkTicks.Name = "Replay: Max ticks per update at 1x (0 = unlimited)";
+        Input_ReplayChunkTicks.SetInt(2000);
+        Input_ReplayChunkTicks.SetIntLimits(0, 1000000);
+
+        Input_ReplayBudgetUs.Name = "Replay: Time budget per update (us, 0 = unlimited)";
+        Input_ReplayBudgetUs.SetInt(5000);
+        Input_ReplayBudgetUs.SetIntLimits(0, 1000000);
+
+        Input_StatsIntervalSec.Name = "Stats: Emit interval (s, 0 = off)";
+        Input_StatsIntervalSec.SetInt(5);
+        Input_StatsIntervalSec.SetIntLimits(0, 3600);
+
+        Input_StatsSubgraphs.Name = "Stats: Write values to subgraphs";
+        Input_StatsSubgraphs.SetYesNo(0);
+
+        Input_StampLatency.Name = "Latency: Send enqueue/send timestamps";
+        Input_StampLatency.SetYesNo(0);
+
+        Input_RecordTicks.Name = "Recorder: Record trades to disk";
+        Input_RecordTicks.SetYesNo(0);
+
+        Input_RecorderDirectory.Name = "Recorder: Directory";
+        Input_RecorderDirectory.SetString("C:\\TradeFlowData");
+
+        Input_RecorderSegmentMB.Name = "Recorder: Segment file size (MB)";
+        Input_RecorderSegmentMB.SetInt(256);
+        Input_RecorderSegmentMB.SetIntLimits(1, 4096);
+
+        Input_RecorderCommitMs.Name = "Recorder: Commit interval (ms)";
+        Input_RecorderCommitMs.SetInt(1000);
+        Input_RecorderCommitMs.SetIntLimits(10, 60000);
+
+        Input_CoalescePrints.Name = "Prints: Merge split prints";
+        Input_CoalescePrints.SetYesNo(0);
+
+        Input_PrintToleranceUs.Name = "Prints: Merge time tolerance (us)";
+        Input_PrintToleranceUs.SetInt(0);
+        Input_PrintToleranceUs.SetIntLimits(0, 1000000);
+
+        Input_WsPort.Name = "WebSocket: Listen port";
+        Input_WsPort.SetInt(8080);
+        Input_WsPort.SetIntLimits(1, 65535);
+
+        Input_WsAcceptRemote.Name = "WebSocket: Accept remote clients";
+        Input_WsAcceptRemote.SetYesNo(0);
+
+        Input_HistoryTicks.Name = "Resume: Ticks kept for resending (0 = off)";
+        Input_HistoryTicks.SetInt(65536);
+        Input_HistoryTicks.SetIntLimits(0, 16 * 1024 * 1024);
+
+        Input_ResumeWaitMs.Name = "Resume: Wait for the consumer after connecting (ms)";
+        Input_ResumeWaitMs.SetInt(250);
+        Input_ResumeWaitMs.SetIntLimits(0, 10000);
+
+        Input_SocketBufferKB.Name = "Output: Socket send buffer (KB, 0 = system default)";
+        Input_SocketBufferKB.SetInt(256);
+        Input_SocketBufferKB.SetIntLimits(0, 64 * 1024);
+
+        Input_HeartbeatMs.Name = "Output: Heartbeat interval (ms, 0 = off)";
+        Input_HeartbeatMs.SetInt(1000);
+        Input_HeartbeatMs.SetIntLimits(0, 60000);
+
+        Input_Host.Name = "TCP Host (address or name of the relay)";
+        Input_Host.SetString("127.0.0.1");
+
+        Input_TickCompression.Name = "Output: Tick compression (binary TCP)";
+        Input_TickCompression.SetCustomInputStrings("None;Varint Deltas;Varint Deltas + LZ4");
+        Input_TickCompression.SetCustomInputIndex(TICK_COMPRESSION_NONE);
+
+        Input_Timestamps.Name = "Output: Timestamps";
+        Input_Timestamps.SetCustomInputStrings("Milliseconds;Microseconds;Microseconds + Milliseconds");
+        Input_Timestamps.SetCustomInputIndex(TIMESTAMPS_MILLISECONDS);
 
-// Structure to hold socket state
-struct SocketState {
-    SOCKET ClientSocket;
-    bool Connected;
-    int SequenceNumber;
-    int64_t LastProcessedSequence;
-    int LastReplayStatus;
-    double LastReplayDateTime;
-};
+        Input_ExportFootprint.Name = "Footprint: Export volume at price";
+        Input_ExportFootprint.SetYesNo(0);
 
-SCSFExport scsf_TimeAndSalesToSocket(SCStudyInterfaceRef sc)
-{
-    SCInputRef Input_Enabled = sc.Input[0];
-    SCInputRef Input_Port = sc.Input[1];
-    SCInputRef Input_ReplayBackfill = sc.Input[2];
-    SCInputRef Input_ResetOnReplayJump = sc.Input[3];
-    
-    if (sc.SetDefaults)
-    {
-        sc.GraphName = "TradeFlow Data Exporter";
-        sc.StudyDescription = "Sends real-time tick data over TCP socket";
-        sc.GraphRegion = 0;
-        sc.AutoLoop = 0;
-        sc.UpdateAlways = 1;
-        sc.FreeDLL = 1;
-        
-        Input_Enabled.Name = "Enable Export";
-        Input_Enabled.SetYesNo(0);
-        
-                Input_Port.Name = "TCP Port";
-        Input_Port.SetInt(9999);
+        Input_FootprintIntervalMs.Name = "Footprint: Emit interval (ms)";
+        Input_FootprintIntervalMs.SetInt(250);
+        Input_FootprintIntervalMs.SetIntLimits(10, 60000);
 
-        Input_ReplayBackfill.Name = "Replay: Backfill existing Time & Sales on start";
-        Input_ReplayBackfill.SetYesNo(1);
+        Input_MulticastGroup.Name = "Multicast: Group address (port is the TCP Port)";
+        Input_MulticastGroup.SetString("239.255.70.70");
 
-        Input_ResetOnReplayJump.Name = "Replay: Reset on replay start/stop or time jump";
-        Input_ResetOnReplayJump.SetYesNo(1);
+        Input_MulticastTtl.Name = "Multicast: TTL (1 = local subnet)";
+        Input_MulticastTtl.SetInt(1);
+        Input_MulticastTtl.SetIntLimits(0, 255);
+
+        Input_MulticastInterface.Name = "Multicast: Interface address (blank = system default)";
+        Input_MulticastInterface.SetString("");
+
+        Input_SendBackend.Name = "Output: Send backend (I/O thread, applies on reconnect)";
+        Input_SendBackend.SetCustomInputStrings("Winsock send;IOCP (overlapped);Registered I/O");
+        Input_SendBackend.SetCustomInputIndex(SEND_BACKEND_WINSOCK);
+
+        Input_ExportEvents.Name = "Events: Export sweeps and block trades";
+        Input_ExportEvents.SetYesNo(0);
+
+        Input_SweepMinLevels.Name = "Events: Sweep minimum price levels";
+        Input_SweepMinLevels.SetInt(3);
+        Input_SweepMinLevels.SetIntLimits(2, 1000);
+
+        Input_SweepMinVolume.Name = "Events: Sweep minimum volume";
+        Input_SweepMinVolume.SetInt(0);
+        Input_SweepMinVolume.SetIntLimits(0, 1000000000);
+
+        Input_BlockMinVolume.Name = "Events: Block trade minimum volume (0 = off)";
+        Input_BlockMinVolume.SetInt(0);
+        Input_BlockMinVolume.SetIntLimits(0, 1000000000);
+
+        Input_EventWindowUs.Name = "Events: Window, first trade to last (us)";
+        Input_EventWindowUs.SetInt(100000);
+        Input_EventWindowUs.SetIntLimits(0, 60000000);
+
+        Input_WarmStartMinutes.Name = "Warm Start: Send recent trades on connect (minutes, 0 = off)";
+        Input_WarmStartMinutes.SetInt(0);
+        Input_WarmStartMinutes.SetIntLimits(0, 60);
+
+        Input_ConversionKernel.Name = "Output: Record conversion kernels";
+        Input_ConversionKernel.SetCustomInputStrings("Automatic;Scalar;SSE2 (x64);AVX2 (x64);NEON (ARM64)");
+        Input_ConversionKernel.SetCustomInputIndex(CONVERSION_KERNEL_AUTO);
+
+        // Hidden unless their draw style is changed; values show in the Data Window
+        Subgraph_CallP99.Name = "Stats: Call p99 (us)";
+        Subgraph_CallP99.DrawStyle = DRAWSTYLE_IGNORE;
+
+        Subgraph_TicksPerCall.Name = "Stats: Max ticks per call";
+        Subgraph_TicksPerCall.DrawStyle = DRAWSTYLE_IGNORE;
+
+        Subgraph_BacklogKB.Name = "Stats: Send backlog (KB)";
+        Subgraph_BacklogKB.DrawStyle = DRAWSTYLE_IGNORE;
+
+        Subgraph_SentKBps.Name = "Stats: Sent (KB/s)";
+        Subgraph_SentKBps.DrawStyle = DRAWSTYLE_IGNORE;
 
         return;
     }
     
-    if (Input_Enabled.GetYesNo() == 0)
-        return;
-    
     // Get persistent socket state
     SocketState* pState = reinterpret_cast<SocketState*>(sc.GetPersistentPointer(1));
+
+    // Release the socket and state when the study is removed or the chart closes
+    if (sc.LastCallToFunction)
+    {
+        if (pState != NULL)
+        {
+            StopRecorder(pState);
+            DetachShm(pState);
+            DetachWebSocket(pState);
+            DetachMulticast(pState);
+            DetachWorker(pState);
+            CloseConnection(pState);
+            delete pState;
+            sc.SetPersistentPointer(1, NULL);
+            WSACleanup();
+        }
+        return;
+    }
+    
+    if (Input_Enabled.GetYesNo() == 0)
+        return;
     
     // Initialize socket on first run
     if (pState == NULL)
     {
         pState = new SocketState();
-        pState->ClientSocket = INVALID_SOCKET;
         pState->Connected = false;
         pState->SequenceNumber = 0;
         pState->LastProcessedSequence = 0;
+        pState->LastProcessedIndex = -1;
         pState->LastReplayStatus = 0;
         pState->LastReplayDateTime = 0.0;
-        sc.SetPersistentPointer(1, pState);
+        pState->BackfillEndSequence = 0;
+        pState->BackfillTicks = 0;
+        pState->ReplaySpeed = 1.0;
+        pState->SpeedSampleReplayDateTime = 0.0;
+        pState->ConnectionFormat = WIRE_FORMAT_JSON;
+        pState->SymbolDefined = false;
+        pState->DefinedTickSize = 0.0;
+        pState->DefinedPriceDecimals = 0;
+        pState->TickCompression = TICK_COMPRESSION_NONE;
+        pState->TimestampResolution = TIMESTAMPS_MILLISECONDS;
+        pState->ConversionKernel = -1;
+        pState->ExportFootprint = false;
+        pState->FootprintTickSize = 0.0;
+        pState->FootprintSnapshotDue = false;
+        ResetFootprint(pState);
+        pState->ExportEvents = false;
+        pState->LastEventTradeMicros = 0;
+        pState->LastEventTradeClock = std::chrono::steady_clock::now();
+        pState->WarmStartDue = false;
+        pState->WarmStartNext = 0;
+        pState->TickSize = sc.TickSize;
+        pState->PriceDecimals = PriceDecimalsFor(sc.TickSize, sc.ValueFormat);
+        pState->SerializerTickSize = 0.0;
+        pState->SerializerValueFormat = -1;
+        ResetBatch(pState);
+        ResetSummary(pState->PendingSummary);
+        pState->HistoryTicks = -1;
+        pState->AwaitingResume = false;
+        pState->ResendNext = 0;
+        pState->ResendLast = 0;
+        pState->StampLatency = false;
+        pState->BatchEnqueueMicros = 0;
+        pState->OverflowEvents = 0;
+        pState->DroppedTicks = 0;
+        pState->CoalescedTicks = 0;
+        pState->Print.Prints = 0;
+        pState->LastLoggedOverflowEvents = 0;
+        pState->Worker = NULL;
+        pState->Channel = NULL;
+        pState->SymbolId = 0;
+        pState->Shm = NULL;
+        pState->LastShmBytesPublished = 0;
+        pState->ShmSizeMismatchLogged = false;
+        pState->Ws = NULL;
+        pState->LastWsBytesSent = 0;
+        pState->LastWsConnects = 0;
+        pState->LastWsDisconnects = 0;
+        pState->LastWsLappedClients = 0;
+        pState->WsListenFailed = false;
+        pState->WsSettingsMismatchLogged = false;
+        pState->Multicast = NULL;
+        pState->LastMulticastBytesPublished = 0;
+        pState->LastMulticastDroppedDatagrams = 0;
+        pState->MulticastOpenFailed = false;
+        pState->MulticastSettingsMismatchLogged = false;
+        pState->Recorder = NULL;
+        pState->LastRecordedSequence = 0;
+        pState->LastRecordedIndex = -1;
+        pState->LastRecorderError = 0;
+        pState->LastRecorderDropped = 0;
+        pState->LastStatsClock = std::chrono::steady_clock::now();
+        pState->LastChannelBytesSent = 0;
+        pState->LastWorkerWouldBlocks = 0;
+        pState->LastWorkerConnects = 0;
+        pState->LastWorkerDisconnects = 0;
+        pState->LastChannelTicksSent = 0;
+        pState->LastChannelDroppedTicks = 0;
+        pState->WorkerSettingsMismatchLogged = false;
+        pState->LastTradeTimestampMs = 0;
+        pState->LastTradePrice = 0.0;
+        pState->LastAggregateMs = 0;
+        pState->QuoteLength = 0;
+        pState->QuoteRecords = 0;
+        pState->LatestQuoteMs = 0;
+        pState->LastQuoteRecordMs = 0;
+        pState->LastKeyframeMs = 0;
         
         // Initialize Winsock
         WSADATA wsaData;
         int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
         if (result != 0)
         {
+            delete pState;
             sc.AddMessageToLog("Failed to initialize Winsock", 1);
             return; 
         }
+
+        sc.SetPersistentPointer(1, pState);
         
         sc.AddMessageToLog("Socket Exporter: Initialized", 0);
     }
+
+    // Measures the rest of this call, whichever way it returns
+    ScopedCallTimer CallTimer(pState->Stats.CallMicros);
+
+    // Recording does not depend on the transport, so it comes first
+    if (Input_RecordTicks.GetYesNo())
+        RecordNewTicks(sc, pState, Input_RecorderDirectory.GetString(), Input_RecorderSegmentMB.GetInt(), Input_RecorderCommitMs.GetInt());
+    else
+        StopRecorder(pState);
     
-    // Try to connect if not connected
-    // Try to connect if not connected
-    if (!pState->Connected)
+    // Size the outbound ring. It must hold at least one full batch.
+    const int BatchFlushBytes = Input_BatchFlushBytes.GetInt();
+    size_t SendBufferBytes = static_cast<size_t>(Input_SendBufferKB.GetInt()) * 1024;
+    if (SendBufferBytes < 2 * static_cast<size_t>(BatchFlushBytes + MAX_TICK_MESSAGE_LENGTH))
+        SendBufferBytes = 2 * static_cast<size_t>(BatchFlushBytes + MAX_TICK_MESSAGE_LENGTH);
+
+    if (pState->SendQueue.CapacityBytes() != SendBufferBytes)
     {
-        // Create socket only if we don't already have one
-        if (pState->ClientSocket == INVALID_SOCKET)
+        // Resizing discards queued bytes, so only do it between connections
+        if (pState->Connected)
+            CloseConnection(pState);
+        pState->SendQueue.Allocate(SendBufferBytes, SendBufferBytes / 64 + 16);
+    }
+
+    // A wire format change takes effect on a fresh connection
+    const int WireFormat = Input_WireFormat.GetIndex();
+    if (pState->Connected && pState->ConnectionFormat != WireFormat)
+        CloseConnection(pState);
+
+    const int OverflowPolicy = Input_OverflowPolicy.GetIndex();
+    int TicksSent = 0;
+
+    // Resizing the history abandons a resend in progress
+    if (pState->HistoryTicks != Input_HistoryTicks.GetInt())
+    {
+        pState->History.Allocate(static_cast<size_t>(Input_HistoryTicks.GetInt()));
+        pState->HistoryTicks = Input_HistoryTicks.GetInt();
+        pState->AwaitingResume = false;
+        pState->ResendNext = 0;
+    }
+    const int ResumeWaitMs = Input_ResumeWaitMs.GetInt();
+    const int SocketBufferBytes = Input_SocketBufferKB.GetInt() * 1024;
+    const int HeartbeatMs = Input_HeartbeatMs.GetInt();
+    pState->TickCompression = Input_TickCompression.GetIndex();
+    pState->TimestampResolution = Input_Timestamps.GetIndex();
+    pState->JsonSerializer.SetTimestampFields(pState->TimestampResolution != TIMESTAMPS_MICROSECONDS,
+        pState->TimestampResolution != TIMESTAMPS_MILLISECONDS);
+
+    // Turning the footprint off drops the ladder; it restarts from the next trade
+    pState->ExportFootprint = (Input_ExportFootprint.GetYesNo() != 0);
+    if (!pState->ExportFootprint && pState->FootprintSessionEndUs != 0)
+        ResetFootprint(pState);
+
+    const bool ExportEvents = (Input_ExportEvents.GetYesNo() != 0);
+    if (ExportEvents != pState->ExportEvents)
+        pState->Events.Reset();
+    pState->ExportEvents = ExportEvents;
+    if (ExportEvents)
+    {
+        TradeEventConfig EventConfig;
+        EventConfig.MinLevels = static_cast<uint32_t>(Input_SweepMinLevels.GetInt());
+        EventConfig.MinSweepVolume = static_cast<uint64_t>(Input_SweepMinVolume.GetInt());
+        EventConfig.MinBlockVolume = static_cast<uint64_t>(Input_BlockMinVolume.GetInt());
+        EventConfig.WindowMicros = Input_EventWindowUs.GetInt();
+        pState->Events.Configure(EventConfig);
+    }
+
+    // A new length discards the ring; it fills again from the next trades
+    pState->Recent.Configure(Input_WarmStartMinutes.GetInt() * 60000000LL);
+
+    // Kernels this processor lacks fall back to the best it has
+    const int RequestedKernel = Input_ConversionKernel.GetIndex();
+    const int ConversionKernel = ResolveConversionKernel(RequestedKernel);
+    if (ConversionKernel != pState->ConversionKernel)
+    {
+        pState->ConversionKernel = ConversionKernel;
+        const bool Unavailable = (RequestedKernel != CONVERSION_KERNEL_AUTO && RequestedKernel != ConversionKernel);
+        SCString Msg;
+        Msg.Format("Socket Exporter: Converting records with the %s kernels%s", ConversionKernelName(ConversionKernel),
+            Unavailable ? " (selected kernels not available)" : "");
+        sc.AddMessageToLog(Msg, Unavailable ? 1 : 0);
+    }
+
+    // A new host or port takes effect on a fresh connection
+    const char* Host = Input_Host.GetString();
+    if (Host == NULL || Host[0] == '\0')
+        Host = "127.0.0.1";
+    if (pState->Connected && !pState->Connection.Targets(Host, Input_Port.GetInt()))
+        CloseConnection(pState);
+
+    const bool UseShm = (Input_Transport.GetIndex() == TRANSPORT_SHARED_MEMORY);
+    const bool UseWs = (Input_Transport.GetIndex() == TRANSPORT_WEBSOCKET);
+    const bool UseMulticast = (Input_Transport.GetIndex() == TRANSPORT_MULTICAST);
+    const bool UseHub = (Input_SharedConnection.GetYesNo() != 0);
+    if (UseShm)
+    {
+        if (pState->Connected || pState->Connection.IsOpen())
+            CloseConnection(pState);
+        DetachWorker(pState);
+        DetachWebSocket(pState);
+        DetachMulticast(pState);
+
+        // The ring is shared by port; the chart that creates it sets its size
+        if (pState->Shm == NULL || pState->Shm->GetPort() != Input_Port.GetInt())
         {
-            pState->ClientSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-            if (pState->ClientSocket == INVALID_SOCKET)
+            if (!AttachShm(pState, Input_Port.GetInt(), SendBufferBytes))
+            {
+                sc.AddMessageToLog("Socket Exporter: Failed to create the shared-memory ring", 1);
                 return;
+            }
 
-            // Set non-blocking mode
-            u_long mode = 1;
-            ioctlsocket(pState->ClientSocket, FIONBIO, &mode);
+            sc.AddMessageToLog("Socket Exporter: Publishing to shared memory", 0);
         }
 
-        // Connect to localhost
-        sockaddr_in serverAddr;
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_port = htons(Input_Port.GetInt());
-        serverAddr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (pState->Shm->GetDataBytes() != SendBufferBytes && !pState->ShmSizeMismatchLogged)
+        {
+            sc.AddMessageToLog("Socket Exporter: The shared-memory ring on this port is open with another send buffer size; it keeps that size until every chart has left it", 1);
+            pState->ShmSizeMismatchLogged = true;
+        }
+    }
+    else if (UseWs)
+    {
+        if (pState->Connected || pState->Connection.IsOpen())
+            CloseConnection(pState);
+        DetachWorker(pState);
+        DetachShm(pState);
+        DetachMulticast(pState);
+
+        // The server is shared by port; the chart that starts it sets its
+        // ring size and which clients it accepts
+        const bool AcceptRemote = (Input_WsAcceptRemote.GetYesNo() != 0);
+        if (pState->Ws == NULL || pState->Ws->GetPort() != Input_WsPort.GetInt())
+        {
+            if (!AttachWebSocket(pState, Input_WsPort.GetInt(), SendBufferBytes, AcceptRemote))
+            {
+                if (!pState->WsListenFailed)
+                    sc.AddMessageToLog("Socket Exporter: Cannot listen on the WebSocket port (is the relay still running?)", 1);
+                pState->WsListenFailed = true;
+                return;
+            }
 
-        int connectResult = connect(pState->ClientSocket, (SOCKADDR*)&serverAddr, sizeof(serverAddr));
+            pState->WsListenFailed = false;
+            sc.AddMessageToLog("Socket Exporter: WebSocket server listening", 0);
+        }
 
-        if (connectResult == SOCKET_ERROR)
+        if ((pState->Ws->GetRingBytes() != SendBufferBytes || pState->Ws->GetAcceptRemote() != AcceptRemote)
+            && !pState->WsSettingsMismatchLogged)
         {
-            int error = WSAGetLastError();
+            sc.AddMessageToLog("Socket Exporter: The WebSocket server on this port runs with another chart's send buffer size or remote client setting; it keeps them until every chart has left it", 1);
+            pState->WsSettingsMismatchLogged = true;
+        }
 
-            // Non-blocking connect in progress (or already in progress)
-            if (error == WSAEWOULDBLOCK || error == WSAEINPROGRESS || error == WSAEALREADY)
-                return;
+        // The server thread cannot log; report its client changes from here
+        WebSocketServer& Ws = *pState->Ws;
+        const int WsConnects = Ws.ClientConnects;
+        if (WsConnects != pState->LastWsConnects)
+        {
+            pState->Stats.Connects += WsConnects - pState->LastWsConnects;
+            pState->LastWsConnects = WsConnects;
+            pState->FootprintSnapshotDue = true;
+            sc.AddMessageToLog("Socket Exporter: WebSocket client connected", 0);
+        }
+        if (Ws.ClientDisconnects != pState->LastWsDisconnects)
+        {
+            pState->LastWsDisconnects = Ws.ClientDisconnects;
+            sc.AddMessageToLog("Socket Exporter: WebSocket client disconnected", 0);
+        }
+        if (Ws.LappedClients != pState->LastWsLappedClients)
+        {
+            pState->LastWsLappedClients = Ws.LappedClients;
+            sc.AddMessageToLog("Socket Exporter: WebSocket client fell a full send buffer behind and was dropped", 1);
+        }
+    }
+    else if (UseMulticast)
+    {
+        if (pState->Connected || pState->Connection.IsOpen())
+            CloseConnection(pState);
+        DetachWorker(pState);
+        DetachShm(pState);
+        DetachWebSocket(pState);
 
-            // Connected (some stacks report "already connected" via error)
-            if (error == WSAEISCONN)
+        const std::string Group = Input_MulticastGroup.GetString();
+        const std::string Interface = Input_MulticastInterface.GetString();
+        // The publisher is shared by group and port; the chart that opens it
+        // sets the TTL and interface
+        if (pState->Multicast == NULL
+            || pState->Multicast->GetGroup() != Group
+            || pState->Multicast->GetPort() != Input_Port.GetInt())
+        {
+            if (!AttachMulticast(pState, Group, Input_Port.GetInt(), Input_MulticastTtl.GetInt(), Interface, SocketBufferBytes))
             {
-                pState->Connected = true;
-                sc.AddMessageToLog("Socket Exporter: Connected", 0);
+                if (!pState->MulticastOpenFailed)
+                    sc.AddMessageToLog("Socket Exporter: Cannot publish to the multicast group (check the group and interface addresses)", 1);
+                pState->MulticastOpenFailed = true;
+                return;
             }
-            else
+
+            pState->MulticastOpenFailed = false;
+            sc.AddMessageToLog("Socket Exporter: Publishing to the multicast group", 0);
+        }
+
+        if ((pState->Multicast->GetTtl() != Input_MulticastTtl.GetInt() || pState->Multicast->GetInterface() != Interface)
+            && !pState->MulticastSettingsMismatchLogged)
+        {
+            sc.AddMessageToLog("Socket Exporter: The multicast group is published with another chart's TTL or interface; it keeps them until every chart has left it", 1);
+            pState->MulticastSettingsMismatchLogged = true;
+        }
+
+        pState->Multicast->Service(std::chrono::steady_clock::now());
+    }
+    else if (UseHub || Input_BackgroundIo.GetYesNo())
+    {
+        DetachShm(pState);
+        DetachWebSocket(pState);
+        DetachMulticast(pState);
+
+        // The worker owns the connection from here on
+        if (pState->Connected || pState->Connection.IsOpen())
+            CloseConnection(pState);
+
+        if (pState->Worker == NULL
+            || pState->Worker->Shared != UseHub
+            || pState->Worker->GetHost() != Host
+            || pState->Worker->GetPort() != Input_Port.GetInt()
+            || pState->Worker->GetWireFormat() != WireFormat
+            || pState->Channel->GetRingBytes() != SendBufferBytes)
+        {
+            if (!AttachWorker(pState, Host, Input_Port.GetInt(), WireFormat, SendBufferBytes, UseHub))
             {
-                // Hard failure: close and retry later
-                closesocket(pState->ClientSocket);
-                pState->ClientSocket = INVALID_SOCKET;
-                pState->Connected = false;
+                sc.AddMessageToLog("Socket Exporter: No free symbol ID on the shared connection", 1);
                 return;
             }
         }
-        else
+
+        // The worker's first chart sets its connection settings; the others
+        // log once if theirs differ
+        IoWorker& Worker = *pState->Worker;
+        const void* NoOwner = NULL;
+        Worker.SettingsOwner.compare_exchange_strong(NoOwner, pState);
+        if (Worker.SettingsOwner == pState)
+        {
+            Worker.OverflowPolicy = OverflowPolicy;
+            Worker.HeartbeatMs = HeartbeatMs;
+            Worker.SocketBufferBytes = SocketBufferBytes;
+            Worker.SendBackend = Input_SendBackend.GetIndex();
+        }
+        else if ((Worker.OverflowPolicy != OverflowPolicy || Worker.HeartbeatMs != HeartbeatMs
+                || Worker.SocketBufferBytes != SocketBufferBytes || Worker.SendBackend != Input_SendBackend.GetIndex())
+            && !pState->WorkerSettingsMismatchLogged)
+        {
+            sc.AddMessageToLog("Socket Exporter: The shared connection uses the first chart's overflow policy, heartbeat, socket buffer and send backend; this chart's differ", 1);
+            pState->WorkerSettingsMismatchLogged = true;
+        }
+
+        // The worker cannot log; report its connection changes from here
+        const int WorkerConnects = Worker.ConnectCount;
+        if (WorkerConnects != pState->LastWorkerConnects)
+        {
+            pState->Stats.Connects += WorkerConnects - pState->LastWorkerConnects;
+            pState->LastWorkerConnects = WorkerConnects;
+            BeginResume(pState, ResumeWaitMs);
+            pState->FootprintSnapshotDue = true;
+            sc.AddMessageToLog("Socket Exporter: Connected (I/O thread)", 0);
+            if (Worker.ActiveSendBackend != Worker.SendBackend)
+                sc.AddMessageToLog("Socket Exporter: Send backend not available, using Winsock send", 1);
+        }
+
+        // Anything queued before the connection the study last saw may
+        // already be in the history's resend, so the worker drops it
+        pState->Channel->SetGeneration(pState->History.Enabled() ? IoWorker::GenerationTag(pState->LastWorkerConnects) : 0);
+        if (Worker.DisconnectCount != pState->LastWorkerDisconnects)
+        {
+            pState->LastWorkerDisconnects = Worker.DisconnectCount;
+            sc.AddMessageToLog("Socket Exporter: Connection lost (I/O thread)", 1);
+        }
+
+        // This chart's own ticks, not everything on a shared connection
+        const int64_t ChannelTicksSent = pState->Channel->TicksSent;
+        TicksSent += static_cast<int>(ChannelTicksSent - pState->LastChannelTicksSent);
+        pState->LastChannelTicksSent = ChannelTicksSent;
+
+        const int64_t ChannelDroppedTicks = pState->Channel->DroppedTicks;
+        if (ChannelDroppedTicks != pState->LastChannelDroppedTicks)
         {
-            // Immediate connect success
-            pState->Connected = true;
-            sc.AddMessageToLog("Socket Exporter: Connected", 0);
+            pState->OverflowEvents++;
+            pState->DroppedTicks += ChannelDroppedTicks - pState->LastChannelDroppedTicks;
+            pState->LastChannelDroppedTicks = ChannelDroppedTicks;
         }
+
+        if (!Worker.Connected)
+            return;
+    }
+    else
+    {
+        DetachShm(pState);
+        DetachWebSocket(pState);
+        DetachMulticast(pState);
+        DetachWorker(pState);
+    }
+
+    // Start or complete a direct connect. While backing off after a failure
+    // this only reads the clock.
+    if (pState->Shm == NULL && pState->Ws == NULL && pState->Multicast == NULL && pState->Worker == NULL && !pState->Connected)
+    {
+        pState->Connection.Configure(Host, Input_Port.GetInt(), SocketBufferBytes);
+        if (!pState->Connection.Poll(0))
+            return;
+
+        pState->Connected = true;
+        pState->Stats.Connects++;
+        OnConnected(pState, WireFormat, ResumeWaitMs);
+        sc.AddMessageToLog("Socket Exporter: Connected", 0);
     }
 
+    // Heartbeats, and the consumer's control lines
+    if (pState->Connected && !ServiceDirectConnection(sc, pState, HeartbeatMs))
+        return;
     
-    if (!pState->Connected)
+    if (pState->Shm == NULL && pState->Ws == NULL && pState->Multicast == NULL && pState->Worker == NULL && !pState->Connected)
         return;
     
     
@@ -169,8 +5773,47 @@ SCSFExport scsf_TimeAndSalesToSocket(SCStudyInterfaceRef sc)
         }
     }
 
-// Get symbol
+    // Get symbol
     SCString SymbolName = sc.GetRealTimeSymbol();
+
+    pState->TickSize = sc.TickSize;
+    pState->PriceDecimals = PriceDecimalsFor(sc.TickSize, sc.ValueFormat);
+    const bool BinaryFormat = (pState->ConnectionFormat == WIRE_FORMAT_BINARY);
+
+    // Only the current symbol's ticks are resent, and only its volume is in the footprint
+    if (strcmp(pState->HistorySymbol.GetChars(), SymbolName.GetChars()) != 0)
+    {
+        pState->History.Clear();
+        pState->HistorySymbol = SymbolName;
+        ResetFootprint(pState);
+        pState->Events.Reset();
+        pState->Recent.Clear();
+    }
+
+    if (!BinaryFormat
+        && (pState->SerializerTickSize != pState->TickSize
+            || pState->SerializerValueFormat != sc.ValueFormat
+            || strcmp(pState->SerializerSymbol.GetChars(), SymbolName.GetChars()) != 0))
+    {
+        pState->JsonSerializer.Configure(SymbolName.GetChars(), pState->TickSize, sc.ValueFormat);
+        pState->SerializerSymbol = SymbolName;
+        pState->SerializerTickSize = pState->TickSize;
+        pState->SerializerValueFormat = sc.ValueFormat;
+    }
+
+    pState->StampLatency = (Input_StampLatency.GetYesNo() != 0);
+
+    // Drain bytes left over from earlier calls before adding new ones
+    if (!FlushBatch(sc, pState, OverflowPolicy, SymbolName.GetChars(), TicksSent))
+        return;
+
+    // After a connect, live ticks wait for the consumer's resume request and
+    // the resend it asks for. Shared memory and the WebSocket server have no
+    // way to ask; multicast receivers ask for their gaps at any time instead.
+    if (pState->Multicast != NULL)
+        ServiceMulticastRequests(pState, SymbolName);
+    else if (pState->Shm == NULL && pState->Ws == NULL && !ServiceResume(sc, pState, SymbolName, TicksSent))
+        return;
     
     // Get Time and Sales
     c_SCTimeAndSalesArray TimeSales;
@@ -192,92 +5835,285 @@ SCSFExport scsf_TimeAndSalesToSocket(SCStudyInterfaceRef sc)
         {
             int64_t FirstSeq = TimeSales[0].Sequence;
             pState->LastProcessedSequence = (FirstSeq > 0) ? (FirstSeq - 1) : 0;
-            // Do not return: allow backfill to stream immediately.
+            pState->LastProcessedIndex = -1;
+            pState->BackfillEndSequence = TimeSales[TimeSales.Size() - 1].Sequence;
+            pState->BackfillTicks = 0;
+            pState->Recent.Clear();
+            // Do not return: the backfill streams in paced chunks from here.
         }
         else
         {
+            // The records skipped still warm up the consumers
+            SeedRecentTrades(pState, TimeSales);
             pState->LastProcessedSequence = TimeSales[TimeSales.Size() - 1].Sequence;
+            pState->LastProcessedIndex = TimeSales.Size() - 1;
+            pState->BackfillEndSequence = 0;
             return;
         }
     }
     
+    // Binary: nothing can be sent until the symbol definition is queued
+    if (!EnsureSymbolDefined(pState, SymbolName))
+        return;
+
+    // A consumer that connected without resuming gets the recent trades first
+    if (pState->WarmStartDue && !SendWarmStart(sc, pState, TicksSent))
+        return;
+
+    // Rebuild the aggregator when its windows change
+    const int AggregateOutput = FilteredAggregateOutput(pState->Filter, Input_AggregateOutput.GetIndex());
+    if (AggregateOutput != AGGREGATES_OFF && strcmp(pState->AggregateWindows.GetChars(), Input_AggregateWindows.GetString()) != 0)
+    {
+        int WindowsMs[RollingAggregator::MAX_WINDOWS];
+        const int Count = ParseWindowList(Input_AggregateWindows.GetString(), WindowsMs, RollingAggregator::MAX_WINDOWS);
+        pState->Aggregator.Configure(WindowsMs, Count, MAX_AGGREGATE_TRADES);
+        pState->AggregateWindows = Input_AggregateWindows.GetString();
+    }
+
     // Process new ticks
-    int TicksSent = 0;
+    const bool BatchSends = (Input_BatchSends.GetYesNo() != 0);
+    const int MaxBatchTicks = BatchSends ? Input_MaxBatchTicks.GetInt() : 1;
+    const std::chrono::steady_clock::time_point CallClock = std::chrono::steady_clock::now();
+
+    // Replays (and their backfill) are paced: each update processes at most
+    // the chunk (scaled by the replay speed, so the export keeps up with the
+    // replay) and stops when its time budget is spent, resuming next update
+    UpdateReplaySpeed(pState, IsReplaying, sc.CurrentDateTimeForReplay.GetAsDouble(), CallClock);
+
+    int MaxTradesThisCall = 0;
+    std::chrono::microseconds ReplayBudget(0);
+    if (IsReplaying)
+    {
+        const double ScaledChunk = Input_ReplayChunkTicks.GetInt() * pState->ReplaySpeed;
+        MaxTradesThisCall = (ScaledChunk < 1e9) ? static_cast<int>(ScaledChunk) : 1000000000;
+        ReplayBudget = std::chrono::microseconds(Input_ReplayBudgetUs.GetInt());
+    }
+    int TradesThisCall = 0;
+
+    // From here on, every return updates the stats
+    ScopedCallStats CallStats(sc, pState, SymbolName.GetChars(), Input_StatsIntervalSec.GetInt() * 1000,
+        Input_StatsSubgraphs.GetYesNo() != 0, CallClock, TradesThisCall, TicksSent);
+
+    const bool ExportQuotes = (Input_ExportQuotes.GetYesNo() != 0 && pState->Filter.Subscribed);
+    const int QuoteCoalesceMs = Input_QuoteCoalesceMs.GetInt();
+
+    const bool CoalescePrints = (Input_CoalescePrints.GetYesNo() != 0);
+    const int64_t PrintToleranceUs = Input_PrintToleranceUs.GetInt();
     
-    for (int i = 0; i < TimeSales.Size(); i++)
+    const int NumRecords = TimeSales.Size();
+    const int FirstNew = FindFirstUnprocessedIndex(TimeSales, pState->LastProcessedSequence, pState->LastProcessedIndex);
+
+    // Records are read from the batch, converted ahead a run at a time
+    const RecordBatch& Batch = pState->Batch;
+    int BatchFirst = FirstNew;
+    int BatchEnd = FirstNew;
+    bool ReadAll = true;            // False when the replay pacing stopped early
+
+    for (int i = FirstNew; i < NumRecords; i++)
     {
-        s_TimeAndSales Record = TimeSales[i];
-        
-        // Skip already processed
-        if (Record.Sequence <= pState->LastProcessedSequence)
-            continue;
+        if (MaxTradesThisCall > 0 && TradesThisCall >= MaxTradesThisCall)
+        {
+            ReadAll = false;
+            break;
+        }
+
+        if (ReplayBudget.count() > 0 && (i - FirstNew) % REPLAY_BUDGET_CHECK_RECORDS == REPLAY_BUDGET_CHECK_RECORDS - 1
+            && std::chrono::steady_clock::now() - CallClock >= ReplayBudget)
+        {
+            ReadAll = false;
+            break;
+        }
+
+        if (i == BatchEnd)
+        {
+            // Under pacing, convert no further than the call may read: the
+            // trades it has left, and up to the next budget check
+            int End = NumRecords;
+            if (MaxTradesThisCall > 0)
+                End = std::min(End, i + (MaxTradesThisCall - TradesThisCall));
+            if (ReplayBudget.count() > 0)
+                End = std::min(End, i + REPLAY_BUDGET_CHECK_RECORDS - (i - FirstNew) % REPLAY_BUDGET_CHECK_RECORDS);
+
+            BatchFirst = i;
+            BatchEnd = ConvertRecords(pState, TimeSales, i, End);
+        }
+
+        const s_TimeAndSales& Record = TimeSales[i];
+        const int j = i - BatchFirst;
         
         pState->LastProcessedSequence = Record.Sequence;
+        pState->LastProcessedIndex = i;
         
+        // Bid/ask updates go to the quote channel
+        if (Record.Type == SC_TS_BIDASK)
+        {
+            if (ExportQuotes)
+            {
+                const int64_t QuoteMs = Batch.Micros[j] / 1000;
+                pState->Quotes.Update(PriceToTicks(Record.Bid, pState->TickSize), PriceToTicks(Record.Ask, pState->TickSize),
+                    Record.BidSize, Record.AskSize);
+                pState->LatestQuoteMs = QuoteMs;
+
+                // Changes within the interval are coalesced into the next record
+                if (QuoteMs - pState->LastQuoteRecordMs >= QuoteCoalesceMs)
+                    AppendQuoteRecord(pState, QuoteMs, CallClock);
+
+                if (pState->QuoteLength >= BatchFlushBytes && !FlushQuotes(sc, pState, TicksSent))
+                    return;
+            }
+            continue;
+        }
+
         // Only process actual trades
-        if (Record.Type != SC_TS_BID && Record.Type != SC_TS_ASK)
+        if ((Batch.Flags[j] & RECORD_TRADE) == 0)
             continue;
         
-        // Convert DateTime to milliseconds
-        SCDateTime DateTime = Record.DateTime;
-        const double UnixEpochInExcelDays = 25569.0;
-        const double MillisecondsPerDay = 86400000.0;
-        double ExcelDateTime = DateTime.GetAsDouble();
-        int64_t TimestampMs = static_cast<int64_t>((ExcelDateTime - UnixEpochInExcelDays) * MillisecondsPerDay);
-        int Milliseconds = DateTime.GetMillisecond();
-        TimestampMs = (TimestampMs / 1000) * 1000 + Milliseconds;
+        const int64_t TimestampUs = Batch.Micros[j];
+        const int64_t TimestampMs = TimestampUs / 1000;
         
         // Determine side
-        const char* Side = (Record.Type == SC_TS_ASK) ? "ASK" : "BID";
-        
-        // Increment sequence
-        pState->SequenceNumber++;
-        
-        // Build JSON message
-        char buffer[512];
-        int len = sprintf_s(buffer, sizeof(buffer),
-                           "{\"seq\":%d,\"ts\":%lld,\"p\":%.2f,\"v\":%u,\"s\":\"%s\",\"sym\":\"%s\"}\n",
-                           pState->SequenceNumber,
-                           TimestampMs,
-                           Record.Price,
-                           Record.Volume,
-                           Side,
-                           SymbolName.GetChars());
-        
-        // Send to socket
-        int sendResult = send(pState->ClientSocket, buffer, len, 0);
+        const bool IsAsk = (Batch.Flags[j] & RECORD_ASK) != 0;
         
-        if (sendResult == SOCKET_ERROR)
+        TradesThisCall++;
+
+        const int32_t PriceTicks = Batch.PriceTicks[j];
+
+        // Every record counts in the footprint, merged into a print or not
+        if (pState->ExportFootprint)
+            AddToFootprint(sc, pState, Record.DateTime, TimestampUs, PriceTicks, Record.Volume, IsAsk);
+
+        pState->Recent.Add(TimestampUs, PriceTicks, Record.Volume, IsAsk);
+
+        // A completed sweep goes out ahead of the ticks still being batched
+        TradeEvent Event;
+        if (pState->ExportEvents)
+        {
+            pState->LastEventTradeMicros = TimestampUs;
+            pState->LastEventTradeClock = CallClock;
+            if (pState->Events.Add(TimestampUs, PriceTicks, Record.Volume, IsAsk, Event) && !EmitTradeEvent(sc, pState, Event, TicksSent))
+                return;
+        }
+
+        if (AggregateOutput != AGGREGATES_OFF)
         {
-            int error = WSAGetLastError();
-            if (error == WSAEWOULDBLOCK)
+            // Time moving back (replay seek) invalidates the windows. A print
+            // from before the seek is completed first.
+            if (TimestampMs + 1000 < pState->LastTradeTimestampMs)
             {
-                // Socket buffer full - skip this tick
-                continue;
+                AppendPendingPrint(pState, BinaryFormat, AggregateOutput);
+                pState->Aggregator.Reset();
+                pState->LastAggregateMs = 0;
             }
-            else
+
+            // Merged prints are added once complete, by AppendPendingPrint()
+            if (!CoalescePrints)
+                pState->Aggregator.Add(TimestampMs, Record.Volume, IsAsk);
+            pState->LastTradeTimestampMs = TimestampMs;
+            pState->LastTradeClock = CallClock;
+            pState->LastTradePrice = Record.Price;
+
+            if (AggregateOutput == AGGREGATES_ONLY && !CoalescePrints)
+                continue;
+        }
+
+        // Serialize straight into the batch buffer, or hold the trade while
+        // the records after it continue the same print
+        if (CoalescePrints)
+        {
+            PendingPrint& Print = pState->Print;
+
+            if (Print.Prints > 0 && Print.IsAsk == IsAsk && Print.PriceTicks == PriceTicks
+                && std::llabs(TimestampUs - Print.FirstMicros) <= PrintToleranceUs
+                && Print.Volume <= UINT32_MAX - Record.Volume)
             {
-                // Connection lost
-                sc.AddMessageToLog("Socket Exporter: Connection lost", 1);
-                closesocket(pState->ClientSocket);
-                pState->ClientSocket = INVALID_SOCKET;
-                pState->Connected = false;
-                return;
+                Print.Volume += Record.Volume;
+                Print.Prints++;
+                continue;
             }
+
+            AppendPendingPrint(pState, BinaryFormat, AggregateOutput);
+
+            Print.Prints = 1;
+            Print.FirstMicros = TimestampUs;
+            Print.Price = Record.Price;
+            Print.PriceTicks = PriceTicks;
+            Print.Volume = Record.Volume;
+            Print.IsAsk = IsAsk;
+        }
+        else
+        {
+            AppendTickToBatch(pState, BinaryFormat, TimestampUs, Record.Price, PriceTicks, Record.Volume, IsAsk, 1);
+        }
+
+        if (pState->BatchTicks >= MaxBatchTicks || pState->BatchLength >= BatchFlushBytes)
+        {
+            if (!FlushBatch(sc, pState, OverflowPolicy, SymbolName.GetChars(), TicksSent))
+                return;
         }
-        
-        TicksSent++;
     }
-    
-    // Log periodically
-    static int s_TotalSent = 0;
-    s_TotalSent += TicksSent;
-    
-    if (s_TotalSent >= 100)
+
+    // A print is never held past the update it arrived in
+    AppendPendingPrint(pState, BinaryFormat, AggregateOutput);
+
+    // An open run ends once its window has passed on the chart's clock: the
+    // last trade's time, moved on by the time since at the replay speed.
+    // Records the pacing left for the next update may still extend it.
+    TradeEvent LastEvent;
+    if (pState->ExportEvents && ReadAll)
+    {
+        const double SinceLastTradeUs = std::chrono::duration<double, std::micro>(CallClock - pState->LastEventTradeClock).count();
+        const int64_t ChartMicros = pState->LastEventTradeMicros + static_cast<int64_t>(SinceLastTradeUs * pState->ReplaySpeed);
+        if (pState->Events.Expire(ChartMicros, LastEvent) && !EmitTradeEvent(sc, pState, LastEvent, TicksSent))
+            return;
+    }
+
+    // Flush whatever is left from this update
+    if (pState->BatchTicks > 0)
+    {
+        if (!FlushBatch(sc, pState, OverflowPolicy, SymbolName.GetChars(), TicksSent))
+            return;
+    }
+
+    if (pState->BackfillEndSequence != 0)
+    {
+        pState->BackfillTicks += TradesThisCall;
+        if (pState->LastProcessedSequence >= pState->BackfillEndSequence)
+        {
+            SCString Msg;
+            Msg.Format("Socket Exporter: Replay backfill complete (%lld ticks)", static_cast<long long>(pState->BackfillTicks));
+            sc.AddMessageToLog(Msg, 0);
+            pState->BackfillEndSequence = 0;
+        }
+    }
+
+    if (AggregateOutput != AGGREGATES_OFF
+        && !EmitAggregates(sc, pState, SymbolName.GetChars(), Input_AggregateIntervalMs.GetInt(), IsReplaying, TicksSent))
+        return;
+
+    if (pState->ExportFootprint && pState->Filter.Subscribed
+        && !EmitFootprint(sc, pState, Input_FootprintIntervalMs.GetInt(), CallClock, TicksSent))
+        return;
+
+    if (ExportQuotes)
+    {
+        // A change still being coalesced goes out once its interval has passed
+        if (pState->Quotes.HasChanges() && CallClock - pState->LastQuoteClock >= std::chrono::milliseconds(QuoteCoalesceMs))
+            AppendQuoteRecord(pState, pState->LatestQuoteMs, CallClock);
+
+        if (!FlushQuotes(sc, pState, TicksSent))
+            return;
+    }
+
+    // Report overflows once per update rather than once per batch
+    if (pState->OverflowEvents != pState->LastLoggedOverflowEvents)
     {
         SCString Msg;
-        Msg.Format("Socket Exporter: Sent %d ticks (total: %d)", s_TotalSent, pState->SequenceNumber);
-        sc.AddMessageToLog(Msg, 0);
-        s_TotalSent = 0;
+        Msg.Format("Socket Exporter: Send buffer overflow (events: %d, dropped ticks: %lld, coalesced ticks: %lld, queued bytes: %d)",
+            pState->OverflowEvents,
+            static_cast<long long>(pState->DroppedTicks),
+            static_cast<long long>(pState->CoalescedTicks),
+            static_cast<int>(pState->Channel != NULL ? pState->Channel->QueuedBytes() : pState->SendQueue.SizeBytes()));
+        sc.AddMessageToLog(Msg, 1);
+        pState->LastLoggedOverflowEvents = pState->OverflowEvents;
     }
 }
\ No newline at end of file
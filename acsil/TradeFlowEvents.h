@@ -0,0 +1,208 @@
+// TradeFlowEvents.h
+// Streaming sweep and block-trade detector for the TradeFlow exporter. Every
+// trade record is fed in as it is read, before print coalescing or any
+// throttling of the tick stream, and extends the current run: trades on one
+// side, within a time window of the run's first trade, at prices that never
+// move back against the aggressor (ask runs climb, bid runs fall). A run that
+// ends is reported when it crossed enough price levels with enough volume
+// (a sweep) or traded enough volume regardless of levels (a block). A run
+// stays open across chart updates; it ends at the first trade that does not
+// extend it, or once its window has passed and no trade can.
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "TradeFlowSerializer.h"
+#include "TradeFlowWire.h"
+
+// {"type":"event","ts":..,"us":..,"e":"sweep","s":"ASK","p0":..,"p1":..,"l":..,"v":..,"n":..,"d":.. plus the symbol fragment
+static const int MAX_JSON_TRADE_EVENT_LENGTH = 512;
+
+static const int TRADE_EVENT_FRAME_LENGTH = sizeof(WireFrameHeader) + sizeof(WireTradeEvent);
+
+struct TradeEventConfig
+{
+    uint32_t MinLevels;         // Sweep: distinct prices traded, including the first
+    uint64_t MinSweepVolume;    // Sweep: total volume of the run
+    uint64_t MinBlockVolume;    // Block: total volume of the run at any number of levels; 0 = off
+    int64_t WindowMicros;       // Longest run, first trade to last
+};
+
+// A completed run, as reported
+struct TradeEvent
+{
+    int64_t FirstMicros;
+    int64_t LastMicros;
+    int32_t FirstPriceTicks;
+    int32_t LastPriceTicks;
+    uint64_t Volume;
+    uint32_t Prints;
+    uint32_t Levels;
+    uint8_t Kind;               // WireTradeEventKindEnum
+    bool IsAsk;
+};
+
+class TradeEventDetector
+{
+public:
+    TradeEventDetector() : Active(false)
+    {
+        Config.MinLevels = 3;
+        Config.MinSweepVolume = 0;
+        Config.MinBlockVolume = 0;
+        Config.WindowMicros = 500000;
+    }
+
+    // Takes effect from the next run
+    void Configure(const TradeEventConfig& NewConfig) { Config = NewConfig; }
+
+    void Reset() { Active = false; }
+
+    // Hot path. Returns true when this trade ended a run that qualifies; the
+    // trade itself starts the next run.
+    bool Add(int64_t TimestampMicros, int32_t PriceTicks, uint32_t Volume, bool IsAsk, TradeEvent& Event)
+    {
+        if (Active && Run.IsAsk == IsAsk && TimestampMicros >= Run.FirstMicros
+            && TimestampMicros - Run.FirstMicros <= Config.WindowMicros
+            && (IsAsk ? PriceTicks >= Run.LastPriceTicks : PriceTicks <= Run.LastPriceTicks))
+        {
+            if (PriceTicks != Run.LastPriceTicks)
+            {
+                Run.LastPriceTicks = PriceTicks;
+                Run.Levels++;
+            }
+            Run.LastMicros = TimestampMicros;
+            Run.Volume += Volume;
+            Run.Prints++;
+            return false;
+        }
+
+        const bool Completed = Active && Qualify(Run);
+        if (Completed)
+            Event = Run;
+
+        Active = true;
+        Run.FirstMicros = TimestampMicros;
+        Run.LastMicros = TimestampMicros;
+        Run.FirstPriceTicks = PriceTicks;
+        Run.LastPriceTicks = PriceTicks;
+        Run.Volume = Volume;
+        Run.Prints = 1;
+        Run.Levels = 1;
+        Run.IsAsk = IsAsk;
+        return Completed;
+    }
+
+    // Ends the current run once NowMicros is past its window, so it is
+    // reported without waiting for the next trade. Only call this with every
+    // record up to NowMicros already added; a trade still to come could
+    // otherwise have extended the run. Returns true when the run qualifies.
+    bool Expire(int64_t NowMicros, TradeEvent& Event)
+    {
+        if (!Active || NowMicros - Run.FirstMicros <= Config.WindowMicros)
+            return false;
+
+        Active = false;
+        if (!Qualify(Run))
+            return false;
+
+        Event = Run;
+        return true;
+    }
+
+    // Writes one complete event frame. Out must hold TRADE_EVENT_FRAME_LENGTH bytes.
+    static int WriteFrame(char* Out, const TradeEvent& Event, uint16_t SymbolId)
+    {
+        WireTradeEvent Record;
+        Record.Timestamp = Event.FirstMicros;
+        Record.DurationMicros = static_cast<uint32_t>(std::min<int64_t>(Event.LastMicros - Event.FirstMicros, UINT32_MAX));
+        Record.Prints = Event.Prints;
+        Record.Volume = Event.Volume;
+        Record.FirstPriceTicks = Event.FirstPriceTicks;
+        Record.LastPriceTicks = Event.LastPriceTicks;
+        Record.Levels = Event.Levels;
+        Record.SymbolId = SymbolId;
+        Record.Side = Event.IsAsk ? WIRE_SIDE_ASK : WIRE_SIDE_BID;
+        Record.Kind = Event.Kind;
+
+        const int Length = WriteFrameHeader(Out, WIRE_FRAME_TRADE_EVENT, sizeof(Record));
+        memcpy(Out + Length, &Record, sizeof(Record));
+        return Length + static_cast<int>(sizeof(Record));
+    }
+
+    // JSON line; "e" is "sweep" or "block", "p0"/"p1" the first and last
+    // prices and "d" the run's duration in microseconds.
+    // Out must hold MAX_JSON_TRADE_EVENT_LENGTH bytes.
+    static int WriteJson(char* Out, const TradeEvent& Event, double TickSize, const TickJsonSerializer& Serializer)
+    {
+        const int Decimals = Serializer.GetPriceDecimals();
+        const uint64_t Scale = Serializer.GetPriceScale();
+        const double TicksToScaled = TickSize * static_cast<double>(Scale);
+
+        char* p = Out;
+        memcpy(p, "{\"type\":\"event\",\"ts\":", 21);
+        p += 21;
+        p += WriteInt64(p, Event.FirstMicros / 1000);
+        memcpy(p, ",\"us\":", 6);
+        p += 6;
+        p += WriteInt64(p, Event.FirstMicros);
+
+        if (Event.Kind == WIRE_TRADE_EVENT_SWEEP)
+        {
+            memcpy(p, ",\"e\":\"sweep\"", 12);
+            p += 12;
+        }
+        else
+        {
+            memcpy(p, ",\"e\":\"block\"", 12);
+            p += 12;
+        }
+
+        memcpy(p, Event.IsAsk ? ",\"s\":\"ASK\"" : ",\"s\":\"BID\"", 10);
+        p += 10;
+        memcpy(p, ",\"p0\":", 6);
+        p += 6;
+        p += WriteFixedPoint(p, std::llround(Event.FirstPriceTicks * TicksToScaled), Decimals, Scale);
+        memcpy(p, ",\"p1\":", 6);
+        p += 6;
+        p += WriteFixedPoint(p, std::llround(Event.LastPriceTicks * TicksToScaled), Decimals, Scale);
+        memcpy(p, ",\"l\":", 5);
+        p += 5;
+        p += WriteUInt64(p, Event.Levels);
+        memcpy(p, ",\"v\":", 5);
+        p += 5;
+        p += WriteUInt64(p, Event.Volume);
+        memcpy(p, ",\"n\":", 5);
+        p += 5;
+        p += WriteUInt64(p, Event.Prints);
+        memcpy(p, ",\"d\":", 5);
+        p += 5;
+        p += WriteInt64(p, Event.LastMicros - Event.FirstMicros);
+
+        memcpy(p, Serializer.GetSymbolFragment(), Serializer.GetSymbolFragmentLength());
+        p += Serializer.GetSymbolFragmentLength();
+        return static_cast<int>(p - Out);
+    }
+
+private:
+    // Sets the run's kind; a run that is both is reported as a sweep
+    bool Qualify(TradeEvent& Candidate) const
+    {
+        if (Candidate.Levels >= Config.MinLevels && Candidate.Volume >= Config.MinSweepVolume)
+            Candidate.Kind = WIRE_TRADE_EVENT_SWEEP;
+        else if (Config.MinBlockVolume > 0 && Candidate.Volume >= Config.MinBlockVolume)
+            Candidate.Kind = WIRE_TRADE_EVENT_BLOCK;
+        else
+            return false;
+        return true;
+    }
+
+    TradeEventConfig Config;
+    TradeEvent Run;             // Current run, while Active
+    bool Active;
+};
@@ -0,0 +1,243 @@
+// TradeFlowFootprint.h
+// Volume-at-price ladder (footprint) for the TradeFlow exporter. Bid and ask
+// volume are kept per price level of the current session in one flat array
+// indexed by price in ticks, so a trade costs one add. Only the levels that
+// changed since the last message are sent, with a full snapshot on connect
+// or request. Values are absolute, so a lost update only loses intermediate
+// states.
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "TradeFlowSerializer.h"
+#include "TradeFlowWire.h"
+
+// {"type":"footprint","ts":..,"s0":..,"k":1,"l":[ plus the symbol fragment
+static const size_t MAX_JSON_FOOTPRINT_HEADER_LENGTH = 128;
+
+// One [price,bid volume,ask volume] entry of the "l" array
+static const size_t MAX_JSON_FOOTPRINT_LEVEL_LENGTH = 64;
+
+class FootprintLadder
+{
+public:
+    // Bounds the memory a wild print can make the ladder span
+    static const size_t MAX_LEVELS = size_t(1) << 20;
+
+    FootprintLadder() : BaseTicks(0), UsedLevels(0) {}
+
+    void Clear()
+    {
+        Levels.clear();
+        Changed.clear();
+        BaseTicks = 0;
+        UsedLevels = 0;
+    }
+
+    // Hot path. Returns false if the price is too far from the rest of the
+    // ladder to be held.
+    bool Add(int32_t PriceTicks, uint32_t Volume, bool IsAsk)
+    {
+        if (Volume == 0)
+            return true;
+
+        int64_t Offset = static_cast<int64_t>(PriceTicks) - BaseTicks;
+        if (Offset < 0 || Offset >= static_cast<int64_t>(Levels.size()))
+        {
+            if (!Cover(PriceTicks))
+                return false;
+            Offset = static_cast<int64_t>(PriceTicks) - BaseTicks;
+        }
+
+        Level& Entry = Levels[static_cast<size_t>(Offset)];
+        if (Entry.BidVolume == 0 && Entry.AskVolume == 0)
+            UsedLevels++;
+
+        if (IsAsk)
+            Entry.AskVolume += Volume;
+        else
+            Entry.BidVolume += Volume;
+
+        if (!Entry.Changed)
+        {
+            Entry.Changed = true;
+            Changed.push_back(PriceTicks);
+        }
+        return true;
+    }
+
+    bool HasChanges() const { return !Changed.empty(); }
+
+    // Levels the next message holds: every traded level for a snapshot
+    size_t MessageLevels(bool Snapshot) const { return Snapshot ? UsedLevels : Changed.size(); }
+
+    size_t MaxFrameLength(bool Snapshot) const
+    {
+        return sizeof(WireFrameHeader) + sizeof(WireFootprintHeader) + MessageLevels(Snapshot) * sizeof(WireFootprintLevel);
+    }
+
+    size_t MaxJsonLength(bool Snapshot) const
+    {
+        return MAX_JSON_FOOTPRINT_HEADER_LENGTH + MessageLevels(Snapshot) * MAX_JSON_FOOTPRINT_LEVEL_LENGTH;
+    }
+
+    // Writes one complete footprint frame, lowest price first for snapshots,
+    // and marks the levels sent. Out must hold MaxFrameLength(Snapshot) bytes.
+    size_t WriteFrame(char* Out, int64_t TimestampMs, int64_t SessionStartMs, uint16_t SymbolId, bool Snapshot)
+    {
+        const size_t Count = MessageLevels(Snapshot);
+
+        WireFootprintHeader Header;
+        Header.Timestamp = TimestampMs;
+        Header.SessionStart = SessionStartMs;
+        Header.Levels = static_cast<uint32_t>(Count);
+        Header.SymbolId = SymbolId;
+        Header.Flags = Snapshot ? WIRE_FOOTPRINT_SNAPSHOT : 0;
+        Header.Reserved = 0;
+
+        size_t Length = WriteFrameHeader(Out, WIRE_FRAME_FOOTPRINT, static_cast<uint32_t>(sizeof(Header) + Count * sizeof(WireFootprintLevel)));
+        memcpy(Out + Length, &Header, sizeof(Header));
+        Length += sizeof(Header);
+
+        if (Snapshot)
+        {
+            for (size_t i = 0; i < Levels.size(); i++)
+            {
+                if (Levels[i].BidVolume != 0 || Levels[i].AskVolume != 0)
+                    Length += WriteLevel(Out + Length, BaseTicks + static_cast<int32_t>(i), Levels[i]);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < Changed.size(); i++)
+                Length += WriteLevel(Out + Length, Changed[i], At(Changed[i]));
+        }
+
+        MarkSent();
+        return Length;
+    }
+
+    // JSON line with "l":[[price,bid volume,ask volume],...] and "k":1 on
+    // snapshots. Out must hold MaxJsonLength(Snapshot) bytes.
+    size_t WriteJson(char* Out, int64_t TimestampMs, int64_t SessionStartMs, bool Snapshot, double TickSize, const TickJsonSerializer& Serializer)
+    {
+        char* p = Out;
+        memcpy(p, "{\"type\":\"footprint\",\"ts\":", 25);
+        p += 25;
+        p += WriteInt64(p, TimestampMs);
+        memcpy(p, ",\"s0\":", 6);
+        p += 6;
+        p += WriteInt64(p, SessionStartMs);
+        if (Snapshot)
+        {
+            memcpy(p, ",\"k\":1", 6);
+            p += 6;
+        }
+        memcpy(p, ",\"l\":[", 6);
+        p += 6;
+
+        const char* First = p;
+        const double TicksToScaled = TickSize * static_cast<double>(Serializer.GetPriceScale());
+        if (Snapshot)
+        {
+            for (size_t i = 0; i < Levels.size(); i++)
+            {
+                if (Levels[i].BidVolume != 0 || Levels[i].AskVolume != 0)
+                    p = WriteJsonLevel(p, p == First, BaseTicks + static_cast<int32_t>(i), Levels[i], TicksToScaled, Serializer);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < Changed.size(); i++)
+                p = WriteJsonLevel(p, p == First, Changed[i], At(Changed[i]), TicksToScaled, Serializer);
+        }
+
+        *p++ = ']';
+        memcpy(p, Serializer.GetSymbolFragment(), Serializer.GetSymbolFragmentLength());
+        p += Serializer.GetSymbolFragmentLength();
+
+        MarkSent();
+        return static_cast<size_t>(p - Out);
+    }
+
+private:
+    struct Level
+    {
+        uint32_t BidVolume;
+        uint32_t AskVolume;
+        bool Changed;           // Listed in Changed
+    };
+
+    static const size_t INITIAL_LEVELS = 1024;
+
+    const Level& At(int32_t PriceTicks) const { return Levels[static_cast<size_t>(static_cast<int64_t>(PriceTicks) - BaseTicks)]; }
+
+    static size_t WriteLevel(char* Out, int32_t PriceTicks, const Level& Entry)
+    {
+        WireFootprintLevel Record;
+        Record.PriceTicks = PriceTicks;
+        Record.BidVolume = Entry.BidVolume;
+        Record.AskVolume = Entry.AskVolume;
+        memcpy(Out, &Record, sizeof(Record));
+        return sizeof(Record);
+    }
+
+    static char* WriteJsonLevel(char* p, bool First, int32_t PriceTicks, const Level& Entry, double TicksToScaled, const TickJsonSerializer& Serializer)
+    {
+        if (!First)
+            *p++ = ',';
+        *p++ = '[';
+        p += WriteFixedPoint(p, std::llround(PriceTicks * TicksToScaled), Serializer.GetPriceDecimals(), Serializer.GetPriceScale());
+        *p++ = ',';
+        p += WriteUInt64(p, Entry.BidVolume);
+        *p++ = ',';
+        p += WriteUInt64(p, Entry.AskVolume);
+        *p++ = ']';
+        return p;
+    }
+
+    // Grows the array to take in PriceTicks, with headroom on both sides so
+    // a trending session regrows rarely
+    bool Cover(int32_t PriceTicks)
+    {
+        if (Levels.empty())
+        {
+            Levels.assign(INITIAL_LEVELS, Level());
+            BaseTicks = static_cast<int32_t>(std::max<int64_t>(static_cast<int64_t>(PriceTicks) - static_cast<int64_t>(INITIAL_LEVELS / 2), INT32_MIN));
+            return true;
+        }
+
+        const int64_t Low = std::min<int64_t>(BaseTicks, PriceTicks);
+        const int64_t High = std::max<int64_t>(static_cast<int64_t>(BaseTicks) + static_cast<int64_t>(Levels.size()) - 1, PriceTicks);
+        const int64_t Span = High - Low + 1;
+        if (Span > static_cast<int64_t>(MAX_LEVELS))
+            return false;
+
+        const int64_t NewSize = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(Levels.size()) * 2, Span + Span / 2), MAX_LEVELS);
+        const int64_t NewBase = std::max<int64_t>(Low - (NewSize - Span) / 2, INT32_MIN);
+
+        std::vector<Level> NewLevels(static_cast<size_t>(NewSize));
+        std::copy(Levels.begin(), Levels.end(), NewLevels.begin() + static_cast<size_t>(BaseTicks - NewBase));
+        Levels.swap(NewLevels);
+        BaseTicks = static_cast<int32_t>(NewBase);
+        return true;
+    }
+
+    void MarkSent()
+    {
+        for (size_t i = 0; i < Changed.size(); i++)
+            Levels[static_cast<size_t>(static_cast<int64_t>(Changed[i]) - BaseTicks)].Changed = false;
+        Changed.clear();
+    }
+
+    std::vector<Level> Levels;
+    int32_t BaseTicks;              // Price of Levels[0]
+    std::vector<int32_t> Changed;   // Prices changed since the last message, in first-change order
+    size_t UsedLevels;              // Levels with any volume
+};
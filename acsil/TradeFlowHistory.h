@@ -0,0 +1,83 @@
+// TradeFlowHistory.h
+// Bounded history of the ticks the exporter has sequenced, kept so a
+// consumer that reconnects can ask for the ticks it missed by sequence
+// number instead of losing them. Ticks are stored as WireTick records; the
+// sequence numbers in the history are always contiguous, so a tick is found
+// from its sequence number without a search.
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "TradeFlowWire.h"
+
+class TickHistory
+{
+public:
+    TickHistory() : Mask(0), OldestSequence(0), Count(0) {}
+
+    // Keeps at least MinTicks ticks, rounded up to a power of two. Zero
+    // disables the history. Discards what is held.
+    void Allocate(size_t MinTicks)
+    {
+        size_t Capacity = 0;
+        if (MinTicks > 0)
+        {
+            Capacity = 1024;
+            while (Capacity < MinTicks)
+                Capacity *= 2;
+        }
+
+        Ticks.assign(Capacity, WireTick());
+        Mask = (Capacity > 0) ? Capacity - 1 : 0;
+        Clear();
+    }
+
+    void Clear()
+    {
+        OldestSequence = 0;
+        Count = 0;
+    }
+
+    bool Enabled() const { return !Ticks.empty(); }
+    size_t Capacity() const { return Ticks.size(); }
+    bool Empty() const { return Count == 0; }
+
+    // Sequence range held; only meaningful when not Empty()
+    int64_t Oldest() const { return OldestSequence; }
+    int64_t Newest() const { return OldestSequence + static_cast<int64_t>(Count) - 1; }
+
+    // Overwrites the oldest tick when full. A tick that does not follow the
+    // newest one (the sequence was restarted) starts the history over.
+    void Append(const WireTick& Tick)
+    {
+        if (Ticks.empty())
+            return;
+
+        if (Count > 0 && Tick.Sequence != Newest() + 1)
+            Clear();
+
+        if (Count == 0)
+            OldestSequence = Tick.Sequence;
+
+        Ticks[static_cast<size_t>(Tick.Sequence) & Mask] = Tick;
+        if (Count < Ticks.size())
+            Count++;
+        else
+            OldestSequence++;
+    }
+
+    // The tick with the given sequence number, which must be held
+    const WireTick& Get(int64_t Sequence) const
+    {
+        return Ticks[static_cast<size_t>(Sequence) & Mask];
+    }
+
+private:
+    std::vector<WireTick> Ticks;
+    size_t Mask;
+    int64_t OldestSequence;
+    size_t Count;
+};
@@ -0,0 +1,206 @@
+// TradeFlowMulticast.h
+// UDP multicast framing for the TradeFlow exporter, for fanning one stream
+// out to any number of receivers on the LAN. Each datagram is one
+// MulticastPacketHeader followed by whole TradeFlowWire.h frames, so a
+// receiver can decode any datagram on its own; there is no stream header.
+// Ticks and footprint frames larger than a datagram are split between
+// records, so nothing relies on IP fragmentation in the common case.
+//
+// Loss is detected from the tick sequence numbers, which are per symbol; the
+// packet sequence only tells receivers that something was lost. Every
+// datagram names the exporter's retransmit port: a receiver sends control
+// lines (TradeFlowControl.h) there as unicast datagrams and the ticks it
+// asks for come back to it alone, flagged MULTICAST_PACKET_RETRANSMIT.
+// Symbol definitions and each symbol's newest sequence (WIRE_FRAME_SEQUENCE)
+// are repeated on the group, so late joiners can decode and the loss of the
+// last ticks before a quiet spell is noticed.
+// No Sierra Chart or Windows dependencies.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "TradeFlowWire.h"
+
+static const uint32_t MULTICAST_MAGIC = 0x4D434654;    // "TFCM" on the wire
+static const uint16_t MULTICAST_VERSION = 1;
+
+// Datagram size including the packet header. Fits a 1500-byte Ethernet MTU
+// with the IP and UDP headers.
+static const size_t MULTICAST_MAX_DATAGRAM = 1400;
+
+// A frame that cannot be split and does not fit MULTICAST_MAX_DATAGRAM goes
+// out alone in a datagram of up to this size (IP-fragmented); larger ones
+// are dropped
+static const size_t MULTICAST_MAX_LARGE_DATAGRAM = 65000;
+
+enum MulticastPacketFlagEnum
+{
+    MULTICAST_PACKET_RETRANSMIT = 0x01  // Unicast answer to a request; not in the packet sequence
+};
+
+#pragma pack(push, 1)
+
+struct MulticastPacketHeader
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t WireVersion;       // WIRE_VERSION of the frames that follow
+    uint32_t SourceId;          // Random per publisher; a new one means the exporter restarted
+    uint16_t RetransmitPort;    // Exporter's UDP port for control lines, at the datagram's source address
+    uint16_t Flags;             // MulticastPacketFlagEnum bits
+    uint64_t PacketSequence;    // Counts multicast datagrams from 1; 0 on retransmits
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(MulticastPacketHeader) == 24, "MulticastPacketHeader layout");
+
+// Packs frames into datagrams for one publisher, numbering the multicast ones
+class MulticastPacketizer
+{
+public:
+    MulticastPacketizer() : SourceId(0), RetransmitPort(0), NextSequence(1), Used(0), Retransmit(false)
+    {
+        Packet.resize(MULTICAST_MAX_LARGE_DATAGRAM);
+    }
+
+    void Configure(uint32_t NewSourceId, uint16_t NewRetransmitPort)
+    {
+        SourceId = NewSourceId;
+        RetransmitPort = NewRetransmitPort;
+        NextSequence = 1;
+    }
+
+    // Splits Length bytes of whole frames into datagrams, in order, and
+    // passes each to Send(const char* Data, size_t Length). Frames are packed
+    // together and nothing is held back for a later call. A split footprint
+    // snapshot keeps its snapshot flag on the first part only; the other
+    // parts carry absolute levels, so they apply as updates. Returns the
+    // number of frames dropped for being too large.
+    template <typename SendFunction>
+    int Packetize(const char* Frames, size_t Length, bool IsRetransmit, SendFunction Send)
+    {
+        Retransmit = IsRetransmit;
+        Used = sizeof(MulticastPacketHeader);
+        int Dropped = 0;
+
+        size_t Offset = 0;
+        while (Length - Offset >= sizeof(WireFrameHeader))
+        {
+            WireFrameHeader Frame;
+            memcpy(&Frame, Frames + Offset, sizeof(Frame));
+            const size_t FrameLength = sizeof(Frame) + Frame.Length;
+            if (FrameLength > Length - Offset)
+                break;
+
+            const char* Payload = Frames + Offset + sizeof(Frame);
+            if (Used + FrameLength <= MULTICAST_MAX_DATAGRAM)
+            {
+                Append(Frames + Offset, FrameLength);
+            }
+            else if (sizeof(MulticastPacketHeader) + FrameLength <= MULTICAST_MAX_DATAGRAM)
+            {
+                Flush(Send);
+                Append(Frames + Offset, FrameLength);
+            }
+            else if (Frame.Type == WIRE_FRAME_TICKS)
+            {
+                SplitRecords(Frame.Type, NULL, 0, Payload, Frame.Length, sizeof(WireTick), Send);
+            }
+            else if (Frame.Type == WIRE_FRAME_FOOTPRINT && Frame.Length >= sizeof(WireFootprintHeader))
+            {
+                WireFootprintHeader Header;
+                memcpy(&Header, Payload, sizeof(Header));
+                SplitRecords(Frame.Type, &Header, sizeof(Header), Payload + sizeof(Header), Frame.Length - sizeof(Header),
+                    sizeof(WireFootprintLevel), Send);
+            }
+            else if (sizeof(MulticastPacketHeader) + FrameLength <= MULTICAST_MAX_LARGE_DATAGRAM)
+            {
+                Flush(Send);
+                Append(Frames + Offset, FrameLength);
+                Flush(Send);
+            }
+            else
+            {
+                Dropped++;
+            }
+
+            Offset += FrameLength;
+        }
+
+        Flush(Send);
+        return Dropped;
+    }
+
+private:
+    void Append(const char* Data, size_t Length)
+    {
+        memcpy(Packet.data() + Used, Data, Length);
+        Used += Length;
+    }
+
+    // Sends the datagram being filled, if it holds any frames
+    template <typename SendFunction>
+    void Flush(SendFunction& Send)
+    {
+        if (Used == sizeof(MulticastPacketHeader))
+            return;
+
+        MulticastPacketHeader Header;
+        Header.Magic = MULTICAST_MAGIC;
+        Header.Version = MULTICAST_VERSION;
+        Header.WireVersion = WIRE_VERSION;
+        Header.SourceId = SourceId;
+        Header.RetransmitPort = RetransmitPort;
+        Header.Flags = Retransmit ? MULTICAST_PACKET_RETRANSMIT : 0;
+        Header.PacketSequence = Retransmit ? 0 : NextSequence++;
+        memcpy(Packet.data(), &Header, sizeof(Header));
+
+        Send(Packet.data(), Used);
+        Used = sizeof(MulticastPacketHeader);
+    }
+
+    // Sends fixed-size records as several frames of the same type, each
+    // starting with a copy of the frame's own header of HeaderLength bytes
+    // (the footprint header, with its level count and flags adjusted)
+    template <typename SendFunction>
+    void SplitRecords(uint16_t Type, WireFootprintHeader* Header, size_t HeaderLength, const char* Records, size_t RecordsLength,
+        size_t RecordSize, SendFunction& Send)
+    {
+        const size_t Count = RecordsLength / RecordSize;
+        size_t Next = 0;
+        while (Next < Count)
+        {
+            const size_t Overhead = Used + sizeof(WireFrameHeader) + HeaderLength;
+            if (Overhead + RecordSize > MULTICAST_MAX_DATAGRAM)
+            {
+                Flush(Send);
+                continue;
+            }
+
+            size_t Fit = (MULTICAST_MAX_DATAGRAM - Overhead) / RecordSize;
+            if (Fit > Count - Next)
+                Fit = Count - Next;
+
+            Used += WriteFrameHeader(Packet.data() + Used, Type, static_cast<uint32_t>(HeaderLength + Fit * RecordSize));
+            if (Header != NULL)
+            {
+                Header->Levels = static_cast<uint32_t>(Fit);
+                Append(reinterpret_cast<const char*>(Header), HeaderLength);
+                Header->Flags = static_cast<uint8_t>(Header->Flags & ~WIRE_FOOTPRINT_SNAPSHOT);
+            }
+            Append(Records + Next * RecordSize, Fit * RecordSize);
+            Next += Fit;
+        }
+    }
+
+    uint32_t SourceId;
+    uint16_t RetransmitPort;
+    uint64_t NextSequence;
+    std::vector<char> Packet;   // Datagram being filled, header first
+    size_t Used;
+    bool Retransmit;
+};
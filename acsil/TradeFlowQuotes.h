@@ -0,0 +1,169 @@
+// TradeFlowQuotes.h
+// Delta encoding of bid/ask quote updates for the TradeFlow exporter's quote
+// channel. Only the fields that changed since the last quote sent are
+// written, with a periodic keyframe so consumers that join late (or lost a
+// message) converge. Values are absolute, so a dropped update only loses
+// intermediate states.
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "TradeFlowSerializer.h"
+#include "TradeFlowWire.h"
+
+// {"type":"quote","ts":..,"k":1,"b":..,"a":..,"bs":..,"as":.. plus the symbol fragment
+static const int MAX_JSON_QUOTE_LENGTH = 512;
+
+class QuoteDeltaEncoder
+{
+public:
+    QuoteDeltaEncoder() : HaveQuote(false), HaveSent(false)
+    {
+        memset(&Current, 0, sizeof(Current));
+        memset(&Sent, 0, sizeof(Sent));
+    }
+
+    // Forgets what was sent; the next record is a keyframe
+    void Reset() { HaveSent = false; }
+
+    // Hot path: records the latest inside market
+    void Update(int32_t BidTicks, int32_t AskTicks, uint32_t BidSize, uint32_t AskSize)
+    {
+        Current.BidTicks = BidTicks;
+        Current.AskTicks = AskTicks;
+        Current.BidSize = BidSize;
+        Current.AskSize = AskSize;
+        HaveQuote = true;
+    }
+
+    // WireQuoteFieldEnum bits that differ from the last quote sent
+    uint8_t ChangedFields() const
+    {
+        if (!HaveQuote)
+            return 0;
+        if (!HaveSent)
+            return WIRE_QUOTE_ALL_FIELDS;
+
+        uint8_t Fields = 0;
+        if (Current.BidTicks != Sent.BidTicks)
+            Fields |= WIRE_QUOTE_BID_PRICE;
+        if (Current.AskTicks != Sent.AskTicks)
+            Fields |= WIRE_QUOTE_ASK_PRICE;
+        if (Current.BidSize != Sent.BidSize)
+            Fields |= WIRE_QUOTE_BID_SIZE;
+        if (Current.AskSize != Sent.AskSize)
+            Fields |= WIRE_QUOTE_ASK_SIZE;
+        return Fields;
+    }
+
+    bool HasChanges() const { return ChangedFields() != 0; }
+
+    // Writes one binary quote record and marks it sent.
+    // Out must hold WIRE_MAX_QUOTE_RECORD bytes.
+    int WriteRecord(char* Out, int64_t TimestampMs, uint16_t SymbolId, bool Keyframe)
+    {
+        const uint8_t Fields = Keyframe ? static_cast<uint8_t>(WIRE_QUOTE_ALL_FIELDS) : ChangedFields();
+
+        WireQuoteHeader Header;
+        Header.Timestamp = TimestampMs;
+        Header.SymbolId = SymbolId;
+        Header.Fields = Fields;
+        Header.Flags = (Keyframe || !HaveSent) ? WIRE_QUOTE_KEYFRAME : 0;
+        memcpy(Out, &Header, sizeof(Header));
+
+        int Length = sizeof(Header);
+        if (Fields & WIRE_QUOTE_BID_PRICE)
+            Length += WriteField(Out + Length, &Current.BidTicks);
+        if (Fields & WIRE_QUOTE_ASK_PRICE)
+            Length += WriteField(Out + Length, &Current.AskTicks);
+        if (Fields & WIRE_QUOTE_BID_SIZE)
+            Length += WriteField(Out + Length, &Current.BidSize);
+        if (Fields & WIRE_QUOTE_ASK_SIZE)
+            Length += WriteField(Out + Length, &Current.AskSize);
+
+        MarkSent();
+        return Length;
+    }
+
+    // JSON line with only the changed keys and "k":1 on keyframes. Prices are
+    // ticks * TickSize printed with the serializer's decimals.
+    // Out must hold MAX_JSON_QUOTE_LENGTH bytes.
+    int WriteJson(char* Out, int64_t TimestampMs, bool Keyframe, double TickSize, const TickJsonSerializer& Serializer)
+    {
+        const uint8_t Fields = Keyframe ? static_cast<uint8_t>(WIRE_QUOTE_ALL_FIELDS) : ChangedFields();
+        const int Decimals = Serializer.GetPriceDecimals();
+        const uint64_t Scale = Serializer.GetPriceScale();
+        const double TicksToScaled = TickSize * static_cast<double>(Scale);
+
+        char* p = Out;
+        memcpy(p, "{\"type\":\"quote\",\"ts\":", 21);
+        p += 21;
+        p += WriteInt64(p, TimestampMs);
+
+        if (Keyframe || !HaveSent)
+        {
+            memcpy(p, ",\"k\":1", 6);
+            p += 6;
+        }
+        if (Fields & WIRE_QUOTE_BID_PRICE)
+        {
+            memcpy(p, ",\"b\":", 5);
+            p += 5;
+            p += WriteFixedPoint(p, std::llround(Current.BidTicks * TicksToScaled), Decimals, Scale);
+        }
+        if (Fields & WIRE_QUOTE_ASK_PRICE)
+        {
+            memcpy(p, ",\"a\":", 5);
+            p += 5;
+            p += WriteFixedPoint(p, std::llround(Current.AskTicks * TicksToScaled), Decimals, Scale);
+        }
+        if (Fields & WIRE_QUOTE_BID_SIZE)
+        {
+            memcpy(p, ",\"bs\":", 6);
+            p += 6;
+            p += WriteUInt64(p, Current.BidSize);
+        }
+        if (Fields & WIRE_QUOTE_ASK_SIZE)
+        {
+            memcpy(p, ",\"as\":", 6);
+            p += 6;
+            p += WriteUInt64(p, Current.AskSize);
+        }
+
+        memcpy(p, Serializer.GetSymbolFragment(), Serializer.GetSymbolFragmentLength());
+        p += Serializer.GetSymbolFragmentLength();
+
+        MarkSent();
+        return static_cast<int>(p - Out);
+    }
+
+private:
+    struct Quote
+    {
+        int32_t BidTicks;
+        int32_t AskTicks;
+        uint32_t BidSize;
+        uint32_t AskSize;
+    };
+
+    static int WriteField(char* Out, const void* Value)
+    {
+        memcpy(Out, Value, 4);
+        return 4;
+    }
+
+    void MarkSent()
+    {
+        Sent = Current;
+        HaveSent = true;
+    }
+
+    Quote Current;
+    Quote Sent;
+    bool HaveQuote;
+    bool HaveSent;
+};
@@ -0,0 +1,116 @@
+// TradeFlowRecorder.h
+// On-disk layout of the exporter's tick recordings. No Sierra Chart
+// dependencies, so readers and converters can share the layout.
+//
+// A recording is a series of segment files per symbol. Each segment is
+// preallocated to its full size and holds:
+//   RecordingHeader                     at offset 0
+//   WireTick records                    from offset HeaderSize, RecordSize apart
+// with a sparse time index alongside it in a file of the same name and the
+// index extension:
+//   RecordingIndexEntry...              one per IndexIntervalMs of trade time
+//
+// The header's RecordCount is only advanced after the records it covers have
+// been flushed, once per commit interval. After a crash the records past it
+// may still be intact; unused preallocated space reads as zeros, so a zero
+// Sequence marks the end.
+//
+// The reader in server/tradeflow-recording.js must be kept in step with
+// this file.
+
+#pragma once
+
+#include <cstdint>
+
+#include "TradeFlowWire.h"
+
+static const uint32_t RECORDING_MAGIC = 0x52544654;     // "TFTR" on disk
+static const uint16_t RECORDING_VERSION = 1;
+
+// Records start on a page boundary
+static const uint32_t RECORDING_HEADER_SIZE = 4096;
+
+static const char* const RECORDING_EXTENSION = ".tfr";
+static const char* const RECORDING_INDEX_EXTENSION = ".tfi";
+
+#pragma pack(push, 1)
+
+struct RecordingHeader
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t Reserved;
+    uint32_t HeaderSize;        // Offset of the first record
+    uint32_t RecordSize;        // sizeof(WireTick)
+    uint64_t RecordCount;       // Committed records
+    uint64_t CapacityRecords;   // Records the preallocated segment can hold
+    int64_t FirstTimestamp;     // Milliseconds since the Unix epoch; 0 while empty
+    int64_t LastTimestamp;
+    int64_t FirstSequence;      // Sierra Chart Time & Sales sequence numbers
+    int64_t LastSequence;
+    int64_t CreatedTimestamp;
+    double TickSize;            // Price = PriceTicks * TickSize
+    uint32_t SegmentNumber;     // Counts up from 0 within one recording session
+    uint32_t IndexIntervalMs;
+    uint8_t PriceDecimals;
+    uint8_t Reserved2[7];
+    char Symbol[64];            // NUL-terminated
+};
+
+// First record at or after a multiple of IndexIntervalMs
+struct RecordingIndexEntry
+{
+    int64_t Timestamp;          // Of the record, milliseconds since the Unix epoch
+    uint64_t RecordIndex;       // Position in the segment, counted in records
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(RecordingHeader) == 160, "RecordingHeader layout");
+static_assert(sizeof(RecordingIndexEntry) == 16, "RecordingIndexEntry layout");
+static_assert(sizeof(RecordingHeader) <= RECORDING_HEADER_SIZE, "RecordingHeader must fit before the records");
+
+// Decides which records get an index entry: the first one in each interval
+class RecordingIndexer
+{
+public:
+    RecordingIndexer() : IntervalMs(1000), LastBucket(INT64_MIN) {}
+
+    void Reset(uint32_t NewIntervalMs)
+    {
+        IntervalMs = (NewIntervalMs > 0) ? NewIntervalMs : 1;
+        LastBucket = INT64_MIN;
+    }
+
+    bool ShouldIndex(int64_t Timestamp)
+    {
+        const int64_t Bucket = Timestamp / IntervalMs;
+        if (Bucket == LastBucket)
+            return false;
+
+        LastBucket = Bucket;
+        return true;
+    }
+
+private:
+    int64_t IntervalMs;
+    int64_t LastBucket;
+};
+
+// Position of the entry to start a forward scan from to reach the first
+// record at or after Timestamp: the last entry before it, or 0
+inline size_t FindRecordingIndexEntry(const RecordingIndexEntry* Entries, size_t Count, int64_t Timestamp)
+{
+    size_t Low = 0;
+    size_t High = Count;
+    while (Low < High)
+    {
+        const size_t Mid = Low + (High - Low) / 2;
+        if (Entries[Mid].Timestamp < Timestamp)
+            Low = Mid + 1;
+        else
+            High = Mid;
+    }
+
+    return (Low > 0) ? Low - 1 : 0;
+}
@@ -0,0 +1,350 @@
+// TradeFlowRing.h
+// Bounded outbound buffering for the TradeFlow exporter.
+// No Sierra Chart dependencies, so it can be reused outside the study.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Fixed-capacity byte ring. Writes are all-or-nothing.
+class ByteRing
+{
+public:
+    ByteRing() : ReadPos(0), Used(0) {}
+
+    void Allocate(size_t Capacity)
+    {
+        Buffer.assign(Capacity, 0);
+        Clear();
+    }
+
+    void Clear()
+    {
+        ReadPos = 0;
+        Used = 0;
+    }
+
+    size_t Capacity() const { return Buffer.size(); }
+    size_t Size() const { return Used; }
+    size_t Free() const { return Buffer.size() - Used; }
+    bool Empty() const { return Used == 0; }
+
+    bool Write(const char* Data, size_t Length)
+    {
+        if (Length > Free())
+            return false;
+
+        const size_t Capacity = Buffer.size();
+        size_t WritePos = ReadPos + Used;
+        if (WritePos >= Capacity)
+            WritePos -= Capacity;
+
+        const size_t FirstPart = (Length < Capacity - WritePos) ? Length : (Capacity - WritePos);
+        memcpy(Buffer.data() + WritePos, Data, FirstPart);
+        if (Length > FirstPart)
+            memcpy(Buffer.data(), Data + FirstPart, Length - FirstPart);
+
+        Used += Length;
+        return true;
+    }
+
+    // Returns the readable bytes as at most two contiguous spans (the second is
+    // non-empty only when the data wraps), suitable for a scatter/gather send.
+    void Peek(const char*& First, size_t& FirstLength, const char*& Second, size_t& SecondLength) const
+    {
+        const size_t Capacity = Buffer.size();
+        const size_t ToEnd = Capacity - ReadPos;
+
+        First = Buffer.data() + ReadPos;
+        FirstLength = (Used < ToEnd) ? Used : ToEnd;
+        Second = Buffer.data();
+        SecondLength = Used - FirstLength;
+    }
+
+    void Consume(size_t Length)
+    {
+        if (Length > Used)
+            Length = Used;
+
+        ReadPos += Length;
+        if (ReadPos >= Buffer.size())
+            ReadPos -= Buffer.size();
+
+        Used -= Length;
+        if (Used == 0)
+            ReadPos = 0;
+    }
+
+private:
+    std::vector<char> Buffer;
+    size_t ReadPos;
+    size_t Used;
+};
+
+// Byte ring that also remembers message boundaries, so that whole messages
+// (batches) can be discarded on overflow. The oldest message may be partially
+// sent; it can then no longer be dropped. Messages the stream cannot do without
+// (headers, definitions) are queued as pinned and are never dropped. Each
+// message may name the source (producer) it came from, which is passed back
+// when it is sent or dropped.
+class OutboundQueue
+{
+public:
+    static const uint32_t NO_SOURCE = 0xFFFFFFFF;
+
+    struct Message
+    {
+        uint32_t Length;    // Unsent bytes remaining
+        uint32_t Bytes;     // Whole length
+        uint32_t Ticks;
+        uint32_t Source;
+        bool Pinned;
+    };
+
+    OutboundQueue() : HeadIndex(0), Count(0), HeadStarted(false), QueuedTicks(0) {}
+
+    // MaxMessages bounds the number of queued messages independently of bytes
+    void Allocate(size_t CapacityBytes, size_t MaxMessages)
+    {
+        Bytes.Allocate(CapacityBytes);
+        Messages.assign(MaxMessages > 0 ? MaxMessages : 1, Message());
+        Clear();
+    }
+
+    void Clear()
+    {
+        Bytes.Clear();
+        HeadIndex = 0;
+        Count = 0;
+        HeadStarted = false;
+        QueuedTicks = 0;
+    }
+
+    bool IsAllocated() const { return Bytes.Capacity() > 0; }
+    bool Empty() const { return Count == 0; }
+    size_t CapacityBytes() const { return Bytes.Capacity(); }
+    size_t SizeBytes() const { return Bytes.Size(); }
+    size_t MessageCount() const { return Count; }
+    uint64_t TickCount() const { return QueuedTicks; }
+
+    bool CanFit(size_t Length) const
+    {
+        return Length <= Bytes.Free() && Count < Messages.size();
+    }
+
+    bool Push(const char* Data, size_t Length, uint32_t Ticks, bool Pinned = false, uint32_t Source = NO_SOURCE)
+    {
+        if (Length == 0)
+            return true;
+
+        if (!CanFit(Length))
+            return false;
+
+        Bytes.Write(Data, Length);
+
+        Message& Entry = Messages[(HeadIndex + Count) % Messages.size()];
+        Entry.Length = static_cast<uint32_t>(Length);
+        Entry.Bytes = static_cast<uint32_t>(Length);
+        Entry.Ticks = Ticks;
+        Entry.Source = Source;
+        Entry.Pinned = Pinned;
+        Count++;
+        QueuedTicks += Ticks;
+        return true;
+    }
+
+    // Drops the oldest message if it is not pinned and has not started sending.
+    // Returns false if there is nothing that can be dropped.
+    bool DropOldest(uint32_t& DroppedTicks, uint32_t& Source)
+    {
+        DroppedTicks = 0;
+        Source = NO_SOURCE;
+
+        if (Count == 0 || HeadStarted)
+            return false;
+
+        const Message& Head = Messages[HeadIndex];
+        if (Head.Pinned)
+            return false;
+
+        Bytes.Consume(Head.Length);
+        DroppedTicks = Head.Ticks;
+        Source = Head.Source;
+        PopHead();
+        return true;
+    }
+
+    bool DropOldest(uint32_t& DroppedTicks)
+    {
+        uint32_t Source;
+        return DropOldest(DroppedTicks, Source);
+    }
+
+    void Peek(const char*& First, size_t& FirstLength, const char*& Second, size_t& SecondLength) const
+    {
+        Bytes.Peek(First, FirstLength, Second, SecondLength);
+    }
+
+    // Marks Length bytes as sent, retiring every message they complete.
+    // Returns the number of ticks in the completed messages. Sent is called
+    // as Sent(Source, Ticks, Bytes) for each of them.
+    template <typename SentFunction>
+    uint32_t Consume(size_t Length, SentFunction Sent)
+    {
+        uint32_t CompletedTicks = 0;
+
+        Bytes.Consume(Length);
+
+        while (Length > 0 && Count > 0)
+        {
+            Message& Head = Messages[HeadIndex];
+            if (Length < Head.Length)
+            {
+                Head.Length -= static_cast<uint32_t>(Length);
+                HeadStarted = true;
+                break;
+            }
+
+            Length -= Head.Length;
+            CompletedTicks += Head.Ticks;
+            Sent(Head.Source, Head.Ticks, Head.Bytes);
+            PopHead();
+        }
+
+        return CompletedTicks;
+    }
+
+    uint32_t Consume(size_t Length)
+    {
+        return Consume(Length, [](uint32_t, uint32_t, uint32_t) {});
+    }
+
+private:
+    void PopHead()
+    {
+        QueuedTicks -= Messages[HeadIndex].Ticks;
+        HeadIndex = (HeadIndex + 1) % Messages.size();
+        Count--;
+        HeadStarted = false;
+    }
+
+    ByteRing Bytes;
+    std::vector<Message> Messages;
+    size_t HeadIndex;
+    size_t Count;
+    bool HeadStarted;
+    uint64_t QueuedTicks;
+};
+
+// Single-producer/single-consumer queue of variable-length messages, used to
+// hand encoded batches from the study thread to the I/O thread without locks.
+// Each side only ever writes its own position; positions increase forever and
+// are masked into the power-of-two sized buffer.
+class SpscMessageRing
+{
+public:
+    SpscMessageRing() : Mask(0), WritePos(0), ReadPos(0) {}
+
+    // Not thread-safe; call before either side starts using the ring
+    void Allocate(size_t MinCapacity)
+    {
+        size_t Capacity = 1024;
+        while (Capacity < MinCapacity)
+            Capacity *= 2;
+
+        Buffer.assign(Capacity, 0);
+        Mask = Capacity - 1;
+        WritePos.store(0, std::memory_order_relaxed);
+        ReadPos.store(0, std::memory_order_relaxed);
+    }
+
+    size_t Capacity() const { return Buffer.size(); }
+
+    // Approximate when called from the producer side
+    size_t SizeBytes() const
+    {
+        return static_cast<size_t>(WritePos.load(std::memory_order_acquire) - ReadPos.load(std::memory_order_acquire));
+    }
+
+    // Producer: queues a message with a caller-defined tag. Fails if full.
+    bool TryPush(const char* Data, uint32_t Length, uint32_t Tag)
+    {
+        const uint64_t Write = WritePos.load(std::memory_order_relaxed);
+        const uint64_t Read = ReadPos.load(std::memory_order_acquire);
+        const size_t Needed = sizeof(Header) + Length;
+
+        if (Buffer.size() - static_cast<size_t>(Write - Read) < Needed)
+            return false;
+
+        Header MessageHeader;
+        MessageHeader.Length = Length;
+        MessageHeader.Tag = Tag;
+        CopyIn(Write, reinterpret_cast<const char*>(&MessageHeader), sizeof(MessageHeader));
+        CopyIn(Write + sizeof(MessageHeader), Data, Length);
+
+        WritePos.store(Write + Needed, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: describes the oldest message without removing it
+    bool Peek(uint32_t& Length, uint32_t& Tag) const
+    {
+        const uint64_t Read = ReadPos.load(std::memory_order_relaxed);
+        if (WritePos.load(std::memory_order_acquire) == Read)
+            return false;
+
+        Header MessageHeader;
+        CopyOut(Read, reinterpret_cast<char*>(&MessageHeader), sizeof(MessageHeader));
+        Length = MessageHeader.Length;
+        Tag = MessageHeader.Tag;
+        return true;
+    }
+
+    // Consumer: copies the payload of the message returned by Peek()
+    void CopyFront(char* Out, uint32_t Length) const
+    {
+        CopyOut(ReadPos.load(std::memory_order_relaxed) + sizeof(Header), Out, Length);
+    }
+
+    // Consumer: removes the message returned by Peek()
+    void Pop(uint32_t Length)
+    {
+        const uint64_t Read = ReadPos.load(std::memory_order_relaxed);
+        ReadPos.store(Read + sizeof(Header) + Length, std::memory_order_release);
+    }
+
+private:
+    struct Header
+    {
+        uint32_t Length;
+        uint32_t Tag;
+    };
+
+    void CopyIn(uint64_t Position, const char* Data, size_t Length)
+    {
+        const size_t Offset = static_cast<size_t>(Position & Mask);
+        const size_t FirstPart = (Length < Buffer.size() - Offset) ? Length : (Buffer.size() - Offset);
+        memcpy(Buffer.data() + Offset, Data, FirstPart);
+        if (Length > FirstPart)
+            memcpy(Buffer.data(), Data + FirstPart, Length - FirstPart);
+    }
+
+    void CopyOut(uint64_t Position, char* Out, size_t Length) const
+    {
+        const size_t Offset = static_cast<size_t>(Position & Mask);
+        const size_t FirstPart = (Length < Buffer.size() - Offset) ? Length : (Buffer.size() - Offset);
+        memcpy(Out, Buffer.data() + Offset, FirstPart);
+        if (Length > FirstPart)
+            memcpy(Out + FirstPart, Buffer.data(), Length - FirstPart);
+    }
+
+    std::vector<char> Buffer;
+    size_t Mask;
+
+    // Kept on separate cache lines so the two threads do not false-share
+    alignas(64) std::atomic<uint64_t> WritePos;
+    alignas(64) std::atomic<uint64_t> ReadPos;
+};
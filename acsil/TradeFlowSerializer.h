@@ -0,0 +1,245 @@
+// TradeFlowSerializer.h
+// Allocation-free JSON line serializer for the TradeFlow exporter hot path.
+// Replaces sprintf_s: integers are converted two digits at a time and prices
+// are written as fixed-point with as many decimals as the instrument needs.
+// No Sierra Chart dependencies, so it can be benchmarked outside the study.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Big enough for {"seq":..,"ts":..,"us":..,"p":..,"v":..,"n":..,"s":"ASK","sym":"..."}\n
+// with the longest symbol fragment
+static const int MAX_JSON_TICK_LENGTH = 416;
+
+static const int MAX_PRICE_DECIMALS = 9;
+
+// Decimal places needed to print prices exactly: the larger of what the chart
+// displays (sc.ValueFormat 0-9 is a plain decimal format) and what the tick
+// size needs, so 6E (0.00005) or ZN (0.015625) are not rounded to 2 decimals.
+inline int PriceDecimalsFor(double TickSize, int ValueFormat)
+{
+    int Decimals = (ValueFormat >= 0 && ValueFormat <= MAX_PRICE_DECIMALS) ? ValueFormat : 2;
+
+    if (TickSize > 0.0)
+    {
+        double Scaled = TickSize;
+        int TickDecimals = 0;
+        while (TickDecimals < MAX_PRICE_DECIMALS && std::fabs(Scaled - std::floor(Scaled + 0.5)) > 1e-6 * (Scaled > 1.0 ? Scaled : 1.0))
+        {
+            Scaled *= 10.0;
+            TickDecimals++;
+        }
+
+        if (TickDecimals > Decimals)
+            Decimals = TickDecimals;
+    }
+
+    return Decimals;
+}
+
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes Value in decimal. Returns the number of characters written.
+inline int WriteUInt64(char* Out, uint64_t Value)
+{
+    char Temp[20];
+    char* End = Temp + sizeof(Temp);
+    char* p = End;
+
+    while (Value >= 100)
+    {
+        const unsigned Pair = static_cast<unsigned>(Value % 100) * 2;
+        Value /= 100;
+        p -= 2;
+        p[0] = DIGIT_PAIRS[Pair];
+        p[1] = DIGIT_PAIRS[Pair + 1];
+    }
+
+    if (Value >= 10)
+    {
+        const unsigned Pair = static_cast<unsigned>(Value) * 2;
+        p -= 2;
+        p[0] = DIGIT_PAIRS[Pair];
+        p[1] = DIGIT_PAIRS[Pair + 1];
+    }
+    else
+    {
+        *--p = static_cast<char>('0' + Value);
+    }
+
+    const int Length = static_cast<int>(End - p);
+    memcpy(Out, p, Length);
+    return Length;
+}
+
+inline int WriteInt64(char* Out, int64_t Value)
+{
+    if (Value < 0)
+    {
+        *Out = '-';
+        return 1 + WriteUInt64(Out + 1, static_cast<uint64_t>(0) - static_cast<uint64_t>(Value));
+    }
+
+    return WriteUInt64(Out, static_cast<uint64_t>(Value));
+}
+
+// Writes ScaledValue / 10^Decimals with exactly Decimals fraction digits
+inline int WriteFixedPoint(char* Out, int64_t ScaledValue, int Decimals, uint64_t Scale)
+{
+    char* p = Out;
+    uint64_t Magnitude;
+    if (ScaledValue < 0)
+    {
+        *p++ = '-';
+        Magnitude = static_cast<uint64_t>(0) - static_cast<uint64_t>(ScaledValue);
+    }
+    else
+    {
+        Magnitude = static_cast<uint64_t>(ScaledValue);
+    }
+
+    p += WriteUInt64(p, Magnitude / Scale);
+
+    if (Decimals > 0)
+    {
+        *p++ = '.';
+        uint64_t Fraction = Magnitude % Scale;
+        for (int i = Decimals - 1; i >= 0; i--)
+        {
+            p[i] = static_cast<char>('0' + Fraction % 10);
+            Fraction /= 10;
+        }
+        p += Decimals;
+    }
+
+    return static_cast<int>(p - Out);
+}
+
+// Per-instance serializer. Configure() pre-renders everything that does not
+// change from tick to tick; Write() then only converts the numbers.
+class TickJsonSerializer
+{
+public:
+    TickJsonSerializer() : PriceDecimals(2), PriceScale(100), SymbolFragmentLength(0),
+        WriteMilliseconds(true), WriteMicroseconds(false)
+    {
+        SymbolFragment[0] = '\0';
+    }
+
+    void Configure(const char* Symbol, double TickSize, int ValueFormat)
+    {
+        PriceDecimals = PriceDecimalsFor(TickSize, ValueFormat);
+        PriceScale = 1;
+        for (int i = 0; i < PriceDecimals; i++)
+            PriceScale *= 10;
+
+        // ,"sym":"<escaped symbol>"}\n
+        static const char Prefix[] = ",\"sym\":\"";
+        char* p = SymbolFragment;
+        memcpy(p, Prefix, sizeof(Prefix) - 1);
+        p += sizeof(Prefix) - 1;
+
+        for (const char* s = Symbol; *s != '\0' && p < SymbolFragment + MAX_SYMBOL_CHARS; s++)
+        {
+            const unsigned char c = static_cast<unsigned char>(*s);
+            if (c < 0x20)
+                continue;
+            if (c == '"' || c == '\\')
+                *p++ = '\\';
+            *p++ = static_cast<char>(c);
+        }
+
+        *p++ = '"';
+        *p++ = '}';
+        *p++ = '\n';
+        SymbolFragmentLength = static_cast<int>(p - SymbolFragment);
+    }
+
+    // "ts" is milliseconds and "us" microseconds since the Unix epoch; at
+    // least one of them is always written
+    void SetTimestampFields(bool Milliseconds, bool Microseconds)
+    {
+        WriteMilliseconds = Milliseconds || !Microseconds;
+        WriteMicroseconds = Microseconds;
+    }
+
+    int GetPriceDecimals() const { return PriceDecimals; }
+    uint64_t GetPriceScale() const { return PriceScale; }
+
+    // ,"sym":"..."}\n as rendered by Configure(), for other line types
+    const char* GetSymbolFragment() const { return SymbolFragment; }
+    int GetSymbolFragmentLength() const { return SymbolFragmentLength; }
+
+    // Writes one tick line. Out must hold MAX_JSON_TICK_LENGTH bytes. The
+    // print count ("n") is only written for merged prints (Prints > 1).
+    // TimestampUs is microseconds since the Unix epoch.
+    int Write(char* Out, int64_t Sequence, int64_t TimestampUs, double Price, uint32_t Volume, bool IsAsk, uint32_t Prints) const
+    {
+        char* p = Out;
+
+        memcpy(p, "{\"seq\":", 7);
+        p += 7;
+        p += WriteInt64(p, Sequence);
+
+        if (WriteMilliseconds)
+        {
+            memcpy(p, ",\"ts\":", 6);
+            p += 6;
+            p += WriteInt64(p, TimestampUs / 1000);
+        }
+
+        if (WriteMicroseconds)
+        {
+            memcpy(p, ",\"us\":", 6);
+            p += 6;
+            p += WriteInt64(p, TimestampUs);
+        }
+
+        memcpy(p, ",\"p\":", 5);
+        p += 5;
+        p += WriteFixedPoint(p, std::llround(Price * static_cast<double>(PriceScale)), PriceDecimals, PriceScale);
+
+        memcpy(p, ",\"v\":", 5);
+        p += 5;
+        p += WriteUInt64(p, Volume);
+
+        if (Prints > 1)
+        {
+            memcpy(p, ",\"n\":", 5);
+            p += 5;
+            p += WriteUInt64(p, Prints);
+        }
+
+        memcpy(p, IsAsk ? ",\"s\":\"ASK\"" : ",\"s\":\"BID\"", 10);
+        p += 10;
+
+        memcpy(p, SymbolFragment, SymbolFragmentLength);
+        p += SymbolFragmentLength;
+
+        return static_cast<int>(p - Out);
+    }
+
+private:
+    // Room for the escaped symbol plus the fixed parts of the fragment
+    static const int MAX_SYMBOL_CHARS = 256;
+
+    int PriceDecimals;
+    uint64_t PriceScale;
+    char SymbolFragment[MAX_SYMBOL_CHARS + 4];
+    int SymbolFragmentLength;
+    bool WriteMilliseconds;
+    bool WriteMicroseconds;
+};
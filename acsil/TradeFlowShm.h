@@ -0,0 +1,290 @@
+// TradeFlowShm.h
+// Shared-memory ring transport for same-host consumers of the TradeFlow
+// exporter. The exporter publishes the binary frames of TradeFlowWire.h into
+// a named memory-mapped ring; readers follow it without any syscalls,
+// tracking their own cursor and detecting when the writer has lapped them.
+// No Sierra Chart or Windows dependencies: both classes work on a block of
+// memory, which the exporter (CreateFileMapping) or a consumer maps.
+//
+// Memory layout:
+//   ShmRingHeader                       HeaderSize bytes
+//   symbol definitions                  DefinitionsCapacity bytes
+//   frame data                          DataCapacity bytes (power of two)
+//
+// Cursors count bytes published since the ring was initialized and only ever
+// grow; a frame starts at Cursor & (DataCapacity - 1) and may wrap. The write
+// cursor only advances by whole frames, so it is always a frame boundary.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "TradeFlowWire.h"
+
+static const uint32_t SHM_MAGIC = 0x4D534654;      // "TFSM" in memory
+static const uint16_t SHM_VERSION = 1;
+
+// Default mapping name; the exporter appends the port number so several
+// exporters (or test setups) can coexist
+static const char SHM_NAME_PREFIX[] = "Local\\TradeFlow_";
+
+static const uint32_t SHM_HEADER_SIZE = 256;
+static const uint32_t SHM_DEFINITIONS_CAPACITY = 64 * 1024;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared-memory cursors must be lock-free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared-memory counters must be lock-free");
+
+struct ShmRingHeader
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t WireVersion;               // WIRE_VERSION of the frames in the ring
+    uint32_t HeaderSize;
+    uint32_t DefinitionsCapacity;
+    uint64_t DataCapacity;
+
+    // Bytes the writer has started to overwrite. A reader's copy is valid only
+    // if this had not passed the copied range (plus one lap) when it finished.
+    alignas(64) std::atomic<uint64_t> ReserveCursor;
+
+    // Bytes fully published
+    alignas(64) std::atomic<uint64_t> WriteCursor;
+    std::atomic<uint64_t> FrameCount;
+
+    // Seqlock over the definitions area: odd while the writer updates it
+    alignas(64) std::atomic<uint32_t> DefinitionsSequence;
+    std::atomic<uint32_t> DefinitionsLength;
+};
+
+static_assert(sizeof(ShmRingHeader) <= SHM_HEADER_SIZE, "ShmRingHeader must fit in SHM_HEADER_SIZE");
+
+// Total mapping size for a ring of at least MinDataCapacity bytes
+inline uint64_t ShmRingDataCapacity(uint64_t MinDataCapacity)
+{
+    uint64_t Capacity = 64 * 1024;
+    while (Capacity < MinDataCapacity)
+        Capacity *= 2;
+    return Capacity;
+}
+
+inline uint64_t ShmRingMappingSize(uint64_t DataCapacity)
+{
+    return SHM_HEADER_SIZE + SHM_DEFINITIONS_CAPACITY + DataCapacity;
+}
+
+// Single writer. If several threads publish they must serialize the calls.
+class ShmRingWriter
+{
+public:
+    ShmRingWriter() : Header(NULL), Definitions(NULL), Data(NULL), Mask(0) {}
+
+    // Formats the ring in Memory, which must hold ShmRingMappingSize(DataCapacity)
+    // bytes. Readers still attached from an earlier writer see their cursor
+    // ahead of the write cursor and resynchronize.
+    void Initialize(void* Memory, uint64_t DataCapacity)
+    {
+        char* Base = static_cast<char*>(Memory);
+        reinterpret_cast<ShmRingHeader*>(Base)->Magic = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Header = new (Base) ShmRingHeader();
+        Definitions = Base + SHM_HEADER_SIZE;
+        Data = Definitions + SHM_DEFINITIONS_CAPACITY;
+        Mask = DataCapacity - 1;
+
+        Header->Version = SHM_VERSION;
+        Header->WireVersion = WIRE_VERSION;
+        Header->HeaderSize = SHM_HEADER_SIZE;
+        Header->DefinitionsCapacity = SHM_DEFINITIONS_CAPACITY;
+        Header->DataCapacity = DataCapacity;
+        Header->ReserveCursor.store(0, std::memory_order_relaxed);
+        Header->WriteCursor.store(0, std::memory_order_relaxed);
+        Header->FrameCount.store(0, std::memory_order_relaxed);
+        Header->DefinitionsSequence.store(0, std::memory_order_relaxed);
+        Header->DefinitionsLength.store(0, std::memory_order_relaxed);
+
+        // Magic last, so a reader never attaches to a half-initialized ring
+        std::atomic_thread_fence(std::memory_order_release);
+        Header->Magic = SHM_MAGIC;
+    }
+
+    bool IsInitialized() const { return Header != NULL; }
+    uint64_t DataCapacity() const { return Mask + 1; }
+
+    // Publishes Length bytes of whole frames (FrameCount is advanced by one)
+    void Publish(const char* Frames, size_t Length)
+    {
+        if (Length == 0 || Length > Mask + 1)
+            return;
+
+        const uint64_t Write = Header->WriteCursor.load(std::memory_order_relaxed);
+        const uint64_t End = Write + Length;
+
+        // Announce the overwrite before touching the bytes
+        Header->ReserveCursor.store(End, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const size_t Offset = static_cast<size_t>(Write & Mask);
+        const size_t FirstPart = (Length < (Mask + 1) - Offset) ? Length : static_cast<size_t>((Mask + 1) - Offset);
+        memcpy(Data + Offset, Frames, FirstPart);
+        if (Length > FirstPart)
+            memcpy(Data, Frames + FirstPart, Length - FirstPart);
+
+        Header->FrameCount.fetch_add(1, std::memory_order_relaxed);
+        Header->WriteCursor.store(End, std::memory_order_release);
+    }
+
+    // Replaces the definitions area (concatenated symbol frames) that late or
+    // lapped readers use to resolve symbol IDs. Returns false if it is too big.
+    bool SetDefinitions(const char* Frames, size_t Length)
+    {
+        if (Length > SHM_DEFINITIONS_CAPACITY)
+            return false;
+
+        const uint32_t Sequence = Header->DefinitionsSequence.load(std::memory_order_relaxed);
+        Header->DefinitionsSequence.store(Sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        memcpy(Definitions, Frames, Length);
+        Header->DefinitionsLength.store(static_cast<uint32_t>(Length), std::memory_order_relaxed);
+
+        Header->DefinitionsSequence.store(Sequence + 2, std::memory_order_release);
+        return true;
+    }
+
+private:
+    ShmRingHeader* Header;
+    char* Definitions;
+    char* Data;
+    uint64_t Mask;
+};
+
+enum ShmReadResultEnum
+{
+    SHM_READ_DATA = 0,          // Bytes were copied
+    SHM_READ_EMPTY = 1,         // Nothing new
+    SHM_READ_OVERRUN = 2,       // The writer lapped the reader; frames were lost
+    SHM_READ_RESET = 3          // The ring was re-initialized by a new writer
+};
+
+// One reader per consumer; any number may follow the same ring.
+class ShmRingReader
+{
+public:
+    ShmRingReader() : Header(NULL), Definitions(NULL), Data(NULL), Mask(0), ReadCursor(0), OverrunCount(0) {}
+
+    // Returns false if Memory does not hold a compatible ring
+    bool Attach(const void* Memory)
+    {
+        const char* Base = static_cast<const char*>(Memory);
+        const ShmRingHeader* Candidate = reinterpret_cast<const ShmRingHeader*>(Base);
+
+        if (Candidate->Magic != SHM_MAGIC || Candidate->Version != SHM_VERSION)
+            return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        const uint64_t Capacity = Candidate->DataCapacity;
+        if (Capacity == 0 || (Capacity & (Capacity - 1)) != 0)
+            return false;
+
+        Header = Candidate;
+        Definitions = Base + Candidate->HeaderSize;
+        Data = Definitions + Candidate->DefinitionsCapacity;
+        Mask = Capacity - 1;
+        SeekToLatest();
+        return true;
+    }
+
+    // Skips everything already published
+    void SeekToLatest()
+    {
+        ReadCursor = Header->WriteCursor.load(std::memory_order_acquire);
+    }
+
+    uint16_t WireVersion() const { return Header->WireVersion; }
+    uint64_t Overruns() const { return OverrunCount; }
+    uint64_t Lag() const { return Header->WriteCursor.load(std::memory_order_acquire) - ReadCursor; }
+
+    // Copies up to MaxLength new bytes into Out. The bytes continue the frame
+    // stream where the previous call stopped, so a frame may be split across
+    // calls. After SHM_READ_OVERRUN or SHM_READ_RESET the reader has moved to
+    // the latest frame boundary: discard any partial frame and re-read the
+    // definitions.
+    int Read(char* Out, size_t MaxLength, size_t& Length)
+    {
+        Length = 0;
+
+        const uint64_t Write = Header->WriteCursor.load(std::memory_order_acquire);
+        if (Write == ReadCursor)
+            return SHM_READ_EMPTY;
+
+        if (Write < ReadCursor)
+        {
+            SeekToLatest();
+            return SHM_READ_RESET;
+        }
+
+        if (Write - ReadCursor > Mask + 1)
+        {
+            OverrunCount++;
+            SeekToLatest();
+            return SHM_READ_OVERRUN;
+        }
+
+        size_t Available = static_cast<size_t>(Write - ReadCursor);
+        if (Available > MaxLength)
+            Available = MaxLength;
+
+        const size_t Offset = static_cast<size_t>(ReadCursor & Mask);
+        const size_t FirstPart = (Available < (Mask + 1) - Offset) ? Available : static_cast<size_t>((Mask + 1) - Offset);
+        memcpy(Out, Data + Offset, FirstPart);
+        if (Available > FirstPart)
+            memcpy(Out + FirstPart, Data, Available - FirstPart);
+
+        // The copy is good only if the writer had not started overwriting it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t Reserve = Header->ReserveCursor.load(std::memory_order_relaxed);
+        if (Reserve > ReadCursor + Mask + 1)
+        {
+            OverrunCount++;
+            SeekToLatest();
+            return SHM_READ_OVERRUN;
+        }
+
+        ReadCursor += Available;
+        Length = Available;
+        return SHM_READ_DATA;
+    }
+
+    // Copies the current symbol definitions (concatenated symbol frames).
+    // Out must hold SHM_DEFINITIONS_CAPACITY bytes. Returns the length.
+    size_t CopyDefinitions(char* Out) const
+    {
+        for (;;)
+        {
+            const uint32_t Before = Header->DefinitionsSequence.load(std::memory_order_acquire);
+            if (Before & 1)
+                continue;
+
+            size_t Length = Header->DefinitionsLength.load(std::memory_order_relaxed);
+            if (Length > Header->DefinitionsCapacity)
+                Length = Header->DefinitionsCapacity;
+            memcpy(Out, Definitions, Length);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (Header->DefinitionsSequence.load(std::memory_order_relaxed) == Before)
+                return Length;
+        }
+    }
+
+private:
+    const ShmRingHeader* Header;
+    const char* Definitions;
+    const char* Data;
+    uint64_t Mask;
+    uint64_t ReadCursor;
+    uint64_t OverrunCount;
+};
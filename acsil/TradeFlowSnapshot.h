@@ -0,0 +1,255 @@
+// TradeFlowSnapshot.h
+// Recent trades for warm starts. The exporter keeps the trades of the last
+// few minutes of trade time and sends them to a consumer that connects
+// without resuming, as snapshot frames followed by one end marker, ahead of
+// the live ticks. The consumer's rolling windows and baselines then start
+// from the recent tape instead of cold. Snapshot trades carry no sequence
+// numbers; they are history, not part of the tick stream.
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "TradeFlowSerializer.h"
+#include "TradeFlowWire.h"
+
+// {"type":"snapshot","us":..,"t":[ plus the symbol fragment
+static const size_t MAX_JSON_SNAPSHOT_HEADER_LENGTH = 64;
+
+// One [offset us,price,volume,side] entry of the "t" array
+static const size_t MAX_JSON_SNAPSHOT_TRADE_LENGTH = 72;
+
+// {"type":"snapshotEnd","us":..,"seq":..,"n":.. plus the symbol fragment
+static const int MAX_JSON_SNAPSHOT_END_LENGTH = 384;
+
+static const int SNAPSHOT_END_FRAME_LENGTH = sizeof(WireFrameHeader) + sizeof(WireSnapshotEnd);
+
+struct RecentTrade
+{
+    int64_t TimestampMicros;
+    int32_t PriceTicks;
+    uint32_t VolumeSide;        // Volume, with WIRE_SNAPSHOT_ASK for ask trades
+};
+
+class RecentTradeRing
+{
+public:
+    // Bounds the memory a busy market can make the ring take (16 MB)
+    static const size_t MAX_TRADES = size_t(1) << 20;
+
+    RecentTradeRing() : Mask(0), Oldest(0), Count(0), WindowMicros(0) {}
+
+    // Keeps trades up to WindowMicros older than the newest; zero disables
+    // the ring. A new window discards what is held.
+    void Configure(int64_t NewWindowMicros)
+    {
+        if (NewWindowMicros == WindowMicros)
+            return;
+
+        WindowMicros = NewWindowMicros;
+        Trades.clear();
+        Trades.shrink_to_fit();
+        Mask = 0;
+        Clear();
+    }
+
+    void Clear()
+    {
+        Oldest = 0;
+        Count = 0;
+    }
+
+    bool Enabled() const { return WindowMicros > 0; }
+    size_t Size() const { return Count; }
+    int64_t Window() const { return WindowMicros; }
+
+    // Index 0 is the oldest trade held
+    const RecentTrade& Get(size_t Index) const { return Trades[(Oldest + Index) & Mask]; }
+
+    // Hot path. Trades that fell out of the window are dropped from the old
+    // end; time moving back (replay seek) starts the ring over.
+    void Add(int64_t TimestampMicros, int32_t PriceTicks, uint32_t Volume, bool IsAsk)
+    {
+        if (WindowMicros <= 0)
+            return;
+
+        if (Count > 0 && TimestampMicros + 1000000 < Get(Count - 1).TimestampMicros)
+            Clear();
+
+        while (Count > 0 && Get(0).TimestampMicros < TimestampMicros - WindowMicros)
+        {
+            Oldest = (Oldest + 1) & Mask;
+            Count--;
+        }
+
+        if (Count == Trades.size() && !Grow())
+        {
+            // At the cap the oldest trade makes room, window or not
+            Oldest = (Oldest + 1) & Mask;
+            Count--;
+        }
+
+        RecentTrade& Entry = Trades[(Oldest + Count) & Mask];
+        Entry.TimestampMicros = TimestampMicros;
+        Entry.PriceTicks = PriceTicks;
+        Entry.VolumeSide = (Volume < WIRE_SNAPSHOT_ASK ? Volume : WIRE_SNAPSHOT_ASK - 1) | (IsAsk ? WIRE_SNAPSHOT_ASK : 0);
+        Count++;
+    }
+
+    static size_t MaxFrameLength(size_t TradeCount)
+    {
+        return sizeof(WireFrameHeader) + sizeof(WireSnapshotHeader) + TradeCount * sizeof(WireSnapshotTrade);
+    }
+
+    static size_t MaxJsonLength(size_t TradeCount)
+    {
+        return MAX_JSON_SNAPSHOT_HEADER_LENGTH + TradeCount * MAX_JSON_SNAPSHOT_TRADE_LENGTH;
+    }
+
+    // Writes one snapshot frame of up to Limit trades from index First, fewer
+    // if their offsets from the first would not fit 32 bits. Out must hold
+    // MaxFrameLength(Limit) bytes. Returns the frame length; Written is the
+    // number of trades in it.
+    size_t WriteFrame(char* Out, size_t First, size_t Limit, uint16_t SymbolId, size_t& Written) const
+    {
+        const size_t Span = FitSpan(First, Limit);
+
+        WireSnapshotHeader Header;
+        Header.BaseTimestamp = Get(First).TimestampMicros;
+        Header.Trades = static_cast<uint32_t>(Span);
+        Header.SymbolId = SymbolId;
+        Header.Reserved = 0;
+
+        size_t Length = WriteFrameHeader(Out, WIRE_FRAME_SNAPSHOT, static_cast<uint32_t>(sizeof(Header) + Span * sizeof(WireSnapshotTrade)));
+        memcpy(Out + Length, &Header, sizeof(Header));
+        Length += sizeof(Header);
+
+        for (size_t i = 0; i < Span; i++)
+        {
+            const RecentTrade& Entry = Get(First + i);
+            WireSnapshotTrade Record;
+            Record.OffsetMicros = static_cast<uint32_t>(Entry.TimestampMicros - Header.BaseTimestamp);
+            Record.PriceTicks = Entry.PriceTicks;
+            Record.VolumeSide = Entry.VolumeSide;
+            memcpy(Out + Length, &Record, sizeof(Record));
+            Length += sizeof(Record);
+        }
+
+        Written = Span;
+        return Length;
+    }
+
+    // JSON line with "t":[[offset us,price,volume,side],...], side 1 for ask
+    // trades and 0 for bid. Out must hold MaxJsonLength(Limit) bytes.
+    size_t WriteJson(char* Out, size_t First, size_t Limit, double TickSize, const TickJsonSerializer& Serializer, size_t& Written) const
+    {
+        const size_t Span = FitSpan(First, Limit);
+        const int64_t BaseMicros = Get(First).TimestampMicros;
+        const double TicksToScaled = TickSize * static_cast<double>(Serializer.GetPriceScale());
+
+        char* p = Out;
+        memcpy(p, "{\"type\":\"snapshot\",\"us\":", 24);
+        p += 24;
+        p += WriteInt64(p, BaseMicros);
+        memcpy(p, ",\"t\":[", 6);
+        p += 6;
+
+        for (size_t i = 0; i < Span; i++)
+        {
+            const RecentTrade& Entry = Get(First + i);
+            if (i > 0)
+                *p++ = ',';
+            *p++ = '[';
+            p += WriteInt64(p, Entry.TimestampMicros - BaseMicros);
+            *p++ = ',';
+            p += WriteFixedPoint(p, std::llround(Entry.PriceTicks * TicksToScaled), Serializer.GetPriceDecimals(), Serializer.GetPriceScale());
+            *p++ = ',';
+            p += WriteUInt64(p, Entry.VolumeSide & ~WIRE_SNAPSHOT_ASK);
+            *p++ = ',';
+            *p++ = (Entry.VolumeSide & WIRE_SNAPSHOT_ASK) ? '1' : '0';
+            *p++ = ']';
+        }
+
+        *p++ = ']';
+        memcpy(p, Serializer.GetSymbolFragment(), Serializer.GetSymbolFragmentLength());
+        p += Serializer.GetSymbolFragmentLength();
+
+        Written = Span;
+        return static_cast<size_t>(p - Out);
+    }
+
+    // End marker: TradeCount trades were sent, the newest at NewestMicros (0 if none),
+    // and live ticks follow Sequence. Out must hold SNAPSHOT_END_FRAME_LENGTH bytes.
+    static int WriteEndFrame(char* Out, int64_t NewestMicros, int64_t Sequence, uint32_t TradeCount, uint16_t SymbolId)
+    {
+        WireSnapshotEnd End;
+        End.NewestTimestamp = NewestMicros;
+        End.LastSequence = Sequence;
+        End.Trades = TradeCount;
+        End.SymbolId = SymbolId;
+        End.Reserved = 0;
+
+        const int Length = WriteFrameHeader(Out, WIRE_FRAME_SNAPSHOT_END, sizeof(End));
+        memcpy(Out + Length, &End, sizeof(End));
+        return Length + static_cast<int>(sizeof(End));
+    }
+
+    // Out must hold MAX_JSON_SNAPSHOT_END_LENGTH bytes
+    static int WriteEndJson(char* Out, int64_t NewestMicros, int64_t Sequence, uint32_t TradeCount, const TickJsonSerializer& Serializer)
+    {
+        char* p = Out;
+        memcpy(p, "{\"type\":\"snapshotEnd\",\"us\":", 27);
+        p += 27;
+        p += WriteInt64(p, NewestMicros);
+        memcpy(p, ",\"seq\":", 7);
+        p += 7;
+        p += WriteInt64(p, Sequence);
+        memcpy(p, ",\"n\":", 5);
+        p += 5;
+        p += WriteUInt64(p, TradeCount);
+        memcpy(p, Serializer.GetSymbolFragment(), Serializer.GetSymbolFragmentLength());
+        p += Serializer.GetSymbolFragmentLength();
+        return static_cast<int>(p - Out);
+    }
+
+private:
+    static const size_t INITIAL_TRADES = 4096;
+
+    // Trades from First, at most Limit, whose offsets fit 32 bits
+    size_t FitSpan(size_t First, size_t Limit) const
+    {
+        const size_t Available = (Count - First < Limit) ? Count - First : Limit;
+        const int64_t BaseMicros = Get(First).TimestampMicros;
+
+        size_t Span = 1;
+        while (Span < Available && Get(First + Span).TimestampMicros - BaseMicros <= static_cast<int64_t>(UINT32_MAX))
+            Span++;
+        return Span;
+    }
+
+    // Doubles the ring, oldest trade first. Returns false at MAX_TRADES.
+    bool Grow()
+    {
+        const size_t Capacity = Trades.empty() ? INITIAL_TRADES : Trades.size() * 2;
+        if (Capacity > MAX_TRADES)
+            return false;
+
+        std::vector<RecentTrade> Grown(Capacity);
+        for (size_t i = 0; i < Count; i++)
+            Grown[i] = Get(i);
+        Trades.swap(Grown);
+        Mask = Capacity - 1;
+        Oldest = 0;
+        return true;
+    }
+
+    std::vector<RecentTrade> Trades;    // Power-of-two ring
+    size_t Mask;
+    size_t Oldest;                      // Slot of the oldest trade
+    size_t Count;
+    int64_t WindowMicros;
+};
@@ -0,0 +1,127 @@
+// TradeFlowStats.h
+// Per-instance instrumentation for the TradeFlow exporter: a histogram of
+// study-call durations plus the counters reported in stats frames. Updating
+// it costs a few adds per call, so it stays on in production.
+// No Sierra Chart dependencies.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Power-of-two buckets of microseconds: bucket 0 holds calls under 1 us,
+// bucket i calls of [2^(i-1), 2^i) us, the last bucket everything longer
+class LatencyHistogram
+{
+public:
+    static const int BUCKETS = 24;
+
+    LatencyHistogram() { Reset(); }
+
+    void Reset()
+    {
+        for (int i = 0; i < BUCKETS; i++)
+            Buckets[i] = 0;
+        Count = 0;
+        MaxMicros = 0;
+    }
+
+    void Add(uint64_t Micros)
+    {
+        int Bucket = 0;
+        while (Bucket < BUCKETS - 1 && (1ULL << Bucket) <= Micros)
+            Bucket++;
+
+        Buckets[Bucket]++;
+        Count++;
+        if (Micros > MaxMicros)
+            MaxMicros = Micros;
+    }
+
+    uint64_t GetCount() const { return Count; }
+    uint64_t GetMaxMicros() const { return MaxMicros; }
+    uint64_t GetBucket(int Index) const { return Buckets[Index]; }
+
+    // Upper bound of the bucket holding the given fraction (0..1) of calls,
+    // capped at the largest call seen
+    uint64_t Percentile(double Fraction) const
+    {
+        if (Count == 0)
+            return 0;
+
+        const uint64_t Target = static_cast<uint64_t>(Fraction * static_cast<double>(Count - 1)) + 1;
+        uint64_t Seen = 0;
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            Seen += Buckets[i];
+            if (Seen >= Target)
+            {
+                const uint64_t Upper = 1ULL << i;
+                return (Upper < MaxMicros) ? Upper : MaxMicros;
+            }
+        }
+
+        return MaxMicros;
+    }
+
+private:
+    uint64_t Buckets[BUCKETS];
+    uint64_t Count;
+    uint64_t MaxMicros;
+};
+
+// Counters for one stats interval; Reset() after each stats frame
+struct ExporterStats
+{
+    LatencyHistogram CallMicros;
+    uint64_t Ticks;
+    uint32_t MaxTicksPerCall;
+    uint64_t BytesSent;
+    uint32_t WouldBlocks;       // Sends the socket refused for lack of buffer space
+    uint32_t Connects;          // Connections made: the direct socket, the I/O worker or WebSocket clients
+    uint32_t MergedPrints;      // Records folded into an earlier tick by print coalescing
+
+    ExporterStats() { Reset(); }
+
+    void Reset()
+    {
+        CallMicros.Reset();
+        Ticks = 0;
+        MaxTicksPerCall = 0;
+        BytesSent = 0;
+        WouldBlocks = 0;
+        Connects = 0;
+        MergedPrints = 0;
+    }
+
+    void AddCallTicks(uint32_t CallTicks)
+    {
+        Ticks += CallTicks;
+        if (CallTicks > MaxTicksPerCall)
+            MaxTicksPerCall = CallTicks;
+    }
+};
+
+// Records the lifetime of the enclosing scope into a histogram, so every
+// return path of the study function is measured
+class ScopedCallTimer
+{
+public:
+    explicit ScopedCallTimer(LatencyHistogram& Target)
+        : Histogram(Target), Start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedCallTimer()
+    {
+        const std::chrono::steady_clock::duration Elapsed = std::chrono::steady_clock::now() - Start;
+        Histogram.Add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Elapsed).count()));
+    }
+
+private:
+    ScopedCallTimer(const ScopedCallTimer&);
+    ScopedCallTimer& operator=(const ScopedCallTimer&);
+
+    LatencyHistogram& Histogram;
+    std::chrono::steady_clock::time_point Start;
+};
@@ -0,0 +1,313 @@
+// TradeFlowWebSocket.h
+// Server side of RFC 6455 for the exporter's WebSocket transport: the opening
+// handshake (SHA-1 and Base64 for Sec-WebSocket-Accept), frame headers, and
+// the broadcast ring every client is sent from. No Sierra Chart or Windows
+// dependencies; the exporter owns the sockets.
+//
+// Each message the exporter publishes becomes one binary WebSocket message
+// whose payload is a run of TradeFlowWire.h frames. A client's first message
+// is the stream header and the current symbol definitions, so the payloads
+// concatenated form an ordinary binary stream.
+//
+// Messages are framed once, into the broadcast ring, and every client sends
+// the same bytes from its own cursor. Cursors count bytes appended since the
+// ring was created and only ever grow, as in TradeFlowShm.h.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Upper bound on a server frame header: no mask, 64-bit length
+static const int WS_MAX_FRAME_HEADER = 10;
+
+// Largest opening handshake request accepted
+static const size_t WS_MAX_REQUEST_LENGTH = 8192;
+
+enum WsOpcodeEnum
+{
+    WS_OPCODE_CONTINUATION = 0x0,
+    WS_OPCODE_TEXT = 0x1,
+    WS_OPCODE_BINARY = 0x2,
+    WS_OPCODE_CLOSE = 0x8,
+    WS_OPCODE_PING = 0x9,
+    WS_OPCODE_PONG = 0xA
+};
+
+// SHA-1 of Length bytes, as RFC 6455 needs for the accept key
+inline void Sha1(const void* Data, size_t Length, uint8_t Digest[20])
+{
+    uint32_t H[5] = { 0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u };
+
+    // Message, 0x80, zero padding, then the bit length big-endian
+    std::vector<uint8_t> Message(static_cast<const uint8_t*>(Data), static_cast<const uint8_t*>(Data) + Length);
+    Message.push_back(0x80);
+    while (Message.size() % 64 != 56)
+        Message.push_back(0);
+    const uint64_t Bits = static_cast<uint64_t>(Length) * 8;
+    for (int i = 7; i >= 0; i--)
+        Message.push_back(static_cast<uint8_t>(Bits >> (i * 8)));
+
+    for (size_t Block = 0; Block < Message.size(); Block += 64)
+    {
+        uint32_t W[80];
+        for (int i = 0; i < 16; i++)
+        {
+            const uint8_t* p = &Message[Block + i * 4];
+            W[i] = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+                | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++)
+        {
+            const uint32_t X = W[i - 3] ^ W[i - 8] ^ W[i - 14] ^ W[i - 16];
+            W[i] = (X << 1) | (X >> 31);
+        }
+
+        uint32_t A = H[0], B = H[1], C = H[2], D = H[3], E = H[4];
+        for (int i = 0; i < 80; i++)
+        {
+            uint32_t F, K;
+            if (i < 20)      { F = (B & C) | (~B & D);          K = 0x5A827999u; }
+            else if (i < 40) { F = B ^ C ^ D;                   K = 0x6ED9EBA1u; }
+            else if (i < 60) { F = (B & C) | (B & D) | (C & D); K = 0x8F1BBCDCu; }
+            else             { F = B ^ C ^ D;                   K = 0xCA62C1D6u; }
+
+            const uint32_t T = ((A << 5) | (A >> 27)) + F + E + K + W[i];
+            E = D;
+            D = C;
+            C = (B << 30) | (B >> 2);
+            B = A;
+            A = T;
+        }
+
+        H[0] += A;
+        H[1] += B;
+        H[2] += C;
+        H[3] += D;
+        H[4] += E;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        Digest[i * 4] = static_cast<uint8_t>(H[i] >> 24);
+        Digest[i * 4 + 1] = static_cast<uint8_t>(H[i] >> 16);
+        Digest[i * 4 + 2] = static_cast<uint8_t>(H[i] >> 8);
+        Digest[i * 4 + 3] = static_cast<uint8_t>(H[i]);
+    }
+}
+
+inline std::string Base64Encode(const uint8_t* Data, size_t Length)
+{
+    static const char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string Out;
+    Out.reserve((Length + 2) / 3 * 4);
+    for (size_t i = 0; i < Length; i += 3)
+    {
+        const uint32_t Group = (static_cast<uint32_t>(Data[i]) << 16)
+            | (i + 1 < Length ? static_cast<uint32_t>(Data[i + 1]) << 8 : 0)
+            | (i + 2 < Length ? Data[i + 2] : 0);
+        Out += Alphabet[(Group >> 18) & 0x3F];
+        Out += Alphabet[(Group >> 12) & 0x3F];
+        Out += (i + 1 < Length) ? Alphabet[(Group >> 6) & 0x3F] : '=';
+        Out += (i + 2 < Length) ? Alphabet[Group & 0x3F] : '=';
+    }
+    return Out;
+}
+
+// Sec-WebSocket-Accept for a client's Sec-WebSocket-Key
+inline std::string WebSocketAcceptKey(const std::string& Key)
+{
+    const std::string Input = Key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t Digest[20];
+    Sha1(Input.data(), Input.size(), Digest);
+    return Base64Encode(Digest, sizeof(Digest));
+}
+
+// Value of the named header in an HTTP request, matched case-insensitively,
+// with surrounding spaces removed. Empty if it is not present.
+inline std::string FindHttpHeader(const std::string& Request, const char* Name)
+{
+    const size_t NameLength = strlen(Name);
+
+    size_t LineStart = Request.find("\r\n");
+    while (LineStart != std::string::npos)
+    {
+        LineStart += 2;
+        const size_t LineEnd = Request.find("\r\n", LineStart);
+        if (LineEnd == std::string::npos || LineEnd == LineStart)
+            break;
+
+        bool Match = (LineEnd - LineStart > NameLength && Request[LineStart + NameLength] == ':');
+        for (size_t i = 0; Match && i < NameLength; i++)
+        {
+            char c = Request[LineStart + i];
+            if (c >= 'A' && c <= 'Z')
+                c = static_cast<char>(c - 'A' + 'a');
+            char n = Name[i];
+            if (n >= 'A' && n <= 'Z')
+                n = static_cast<char>(n - 'A' + 'a');
+            Match = (c == n);
+        }
+
+        if (Match)
+        {
+            size_t ValueStart = LineStart + NameLength + 1;
+            size_t ValueEnd = LineEnd;
+            while (ValueStart < ValueEnd && (Request[ValueStart] == ' ' || Request[ValueStart] == '\t'))
+                ValueStart++;
+            while (ValueEnd > ValueStart && (Request[ValueEnd - 1] == ' ' || Request[ValueEnd - 1] == '\t'))
+                ValueEnd--;
+            return Request.substr(ValueStart, ValueEnd - ValueStart);
+        }
+
+        LineStart = LineEnd;
+    }
+
+    return std::string();
+}
+
+// Builds the reply to a complete opening handshake request (up to and
+// including the blank line). Returns false, with a 400 reply, if the request
+// is not a WebSocket upgrade.
+inline bool BuildHandshakeResponse(const std::string& Request, std::string& Response)
+{
+    const std::string Key = FindHttpHeader(Request, "Sec-WebSocket-Key");
+    if (Request.compare(0, 4, "GET ") != 0 || Key.empty())
+    {
+        Response = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        return false;
+    }
+
+    Response = "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + WebSocketAcceptKey(Key) + "\r\n\r\n";
+    return true;
+}
+
+// Header of an unmasked, unfragmented server frame. Out must hold
+// WS_MAX_FRAME_HEADER bytes. Returns the header length.
+inline int WriteWebSocketFrameHeader(char* Out, uint8_t Opcode, uint64_t PayloadLength)
+{
+    Out[0] = static_cast<char>(0x80 | Opcode);
+    if (PayloadLength < 126)
+    {
+        Out[1] = static_cast<char>(PayloadLength);
+        return 2;
+    }
+
+    if (PayloadLength <= 0xFFFF)
+    {
+        Out[1] = 126;
+        Out[2] = static_cast<char>(PayloadLength >> 8);
+        Out[3] = static_cast<char>(PayloadLength);
+        return 4;
+    }
+
+    Out[1] = 127;
+    for (int i = 0; i < 8; i++)
+        Out[2 + i] = static_cast<char>(PayloadLength >> ((7 - i) * 8));
+    return 10;
+}
+
+// Length of the complete client frame at the start of Data, or 0 if more
+// bytes are needed. Client frames are masked; the payload is not needed here
+// because the exporter only acts on the opcode.
+inline size_t MeasureClientFrame(const uint8_t* Data, size_t Length, uint8_t& Opcode)
+{
+    if (Length < 2)
+        return 0;
+
+    Opcode = Data[0] & 0x0F;
+    uint64_t PayloadLength = Data[1] & 0x7F;
+    size_t HeaderLength = 2;
+    if (PayloadLength == 126)
+    {
+        if (Length < 4)
+            return 0;
+        PayloadLength = (static_cast<uint64_t>(Data[2]) << 8) | Data[3];
+        HeaderLength = 4;
+    }
+    else if (PayloadLength == 127)
+    {
+        if (Length < 10)
+            return 0;
+        PayloadLength = 0;
+        for (int i = 0; i < 8; i++)
+            PayloadLength = (PayloadLength << 8) | Data[2 + i];
+        HeaderLength = 10;
+    }
+
+    if (Data[1] & 0x80)
+        HeaderLength += 4;
+
+    if (PayloadLength > Length || HeaderLength + PayloadLength > Length)
+        return 0;
+    return HeaderLength + static_cast<size_t>(PayloadLength);
+}
+
+// Byte ring of framed messages, written by the publisher and read by every
+// client from its own cursor. A client more than Capacity bytes behind the
+// write cursor has been lapped and must be dropped.
+class WsBroadcastRing
+{
+public:
+    WsBroadcastRing() : Mask(0), WriteCursor(0) {}
+
+    // Capacity is rounded up to a power of two
+    void Allocate(size_t MinCapacity)
+    {
+        size_t Capacity = 4096;
+        while (Capacity < MinCapacity)
+            Capacity *= 2;
+
+        Data.assign(Capacity, 0);
+        Mask = Capacity - 1;
+        WriteCursor = 0;
+    }
+
+    size_t Capacity() const { return Data.size(); }
+    uint64_t GetWriteCursor() const { return WriteCursor; }
+
+    // Frames Payload as one binary message. Returns false if the message
+    // could never fit.
+    bool AppendMessage(const char* Payload, size_t Length)
+    {
+        char Header[WS_MAX_FRAME_HEADER];
+        const int HeaderLength = WriteWebSocketFrameHeader(Header, WS_OPCODE_BINARY, Length);
+        if (HeaderLength + Length > Data.size())
+            return false;
+
+        Write(Header, HeaderLength);
+        Write(Payload, Length);
+        return true;
+    }
+
+    // The bytes from Cursor to the write cursor, in up to two pieces
+    void Peek(uint64_t Cursor, const char*& First, size_t& FirstLength, const char*& Second, size_t& SecondLength) const
+    {
+        const size_t Available = static_cast<size_t>(WriteCursor - Cursor);
+        const size_t Start = static_cast<size_t>(Cursor & Mask);
+        FirstLength = (Available < Data.size() - Start) ? Available : Data.size() - Start;
+        SecondLength = Available - FirstLength;
+        First = Data.data() + Start;
+        Second = Data.data();
+    }
+
+private:
+    void Write(const char* Bytes, size_t Length)
+    {
+        const size_t Start = static_cast<size_t>(WriteCursor & Mask);
+        const size_t FirstLength = (Length < Data.size() - Start) ? Length : Data.size() - Start;
+        memcpy(Data.data() + Start, Bytes, FirstLength);
+        memcpy(Data.data(), Bytes + FirstLength, Length - FirstLength);
+        WriteCursor += Length;
+    }
+
+    std::vector<char> Data;
+    size_t Mask;
+    uint64_t WriteCursor;
+};
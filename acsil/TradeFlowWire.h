@@ -0,0 +1,362 @@
+// TradeFlowWire.h
+// Binary framing for the TradeFlow exporter (alternative to JSON lines).
+// No Sierra Chart dependencies, so consumers and tools can share the layout.
+//
+// Stream layout, all fields little-endian:
+//   WireStreamHeader                    once per connection
+//   { WireFrameHeader, payload }...     repeated
+//
+// The decoder in components/tradeflow-wire.js must be kept in step with
+// this file.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+static const uint32_t WIRE_MAGIC = 0x574C4654;     // "TFLW" on the wire
+static const uint16_t WIRE_VERSION = 1;
+
+enum WireFrameTypeEnum
+{
+    WIRE_FRAME_SYMBOL = 1,      // One WireSymbolDef followed by the symbol name
+    WIRE_FRAME_TICKS = 2,       // Array of WireTick
+    WIRE_FRAME_SUMMARY = 3,     // One WireSummary (ticks coalesced on overflow)
+    WIRE_FRAME_AGGREGATE = 4,   // Array of WireAggregate, one per rolling window
+    WIRE_FRAME_QUOTES = 5,      // WireQuoteHeader records, each followed by its changed fields
+    WIRE_FRAME_STATS = 6,       // One WireStats (exporter instrumentation)
+    WIRE_FRAME_TIMING = 7,      // One WireTiming, sent just before the ticks frame it describes
+    WIRE_FRAME_HEARTBEAT = 8,   // One WireHeartbeat, sent at a fixed interval on an open connection
+    WIRE_FRAME_COMPACT_TICKS = 9,   // Ticks as varint deltas, optionally LZ4-compressed (TradeFlowCompact.h)
+    WIRE_FRAME_FOOTPRINT = 10,      // One WireFootprintHeader followed by its WireFootprintLevel records
+    WIRE_FRAME_SEQUENCE = 11,       // One WireSequence (multicast: newest tick published for a symbol)
+    WIRE_FRAME_TRADE_EVENT = 12,    // One WireTradeEvent (sweep or block trade, TradeFlowEvents.h)
+    WIRE_FRAME_SNAPSHOT = 13,       // One WireSnapshotHeader followed by its WireSnapshotTrade records (TradeFlowSnapshot.h)
+    WIRE_FRAME_SNAPSHOT_END = 14    // One WireSnapshotEnd, after the last snapshot frame of a connection
+};
+
+// Fields present after a WireQuoteHeader, in this order, 4 bytes each:
+// bid and ask price (int32 ticks), bid and ask size (uint32)
+enum WireQuoteFieldEnum
+{
+    WIRE_QUOTE_BID_PRICE = 0x01,
+    WIRE_QUOTE_ASK_PRICE = 0x02,
+    WIRE_QUOTE_BID_SIZE = 0x04,
+    WIRE_QUOTE_ASK_SIZE = 0x08,
+    WIRE_QUOTE_ALL_FIELDS = 0x0F
+};
+
+enum WireQuoteFlagEnum
+{
+    WIRE_QUOTE_KEYFRAME = 0x01  // All fields present; earlier quote state can be discarded
+};
+
+enum WireTickFlagEnum
+{
+    WIRE_TICK_MICROSECONDS = 0x01   // Timestamp is in microseconds rather than milliseconds
+};
+
+enum WireFootprintFlagEnum
+{
+    WIRE_FOOTPRINT_SNAPSHOT = 0x01  // Every traded level of the session; replaces the consumer's ladder
+};
+
+enum WireTradeEventKindEnum
+{
+    WIRE_TRADE_EVENT_SWEEP = 1,     // One side traded through several price levels within the window
+    WIRE_TRADE_EVENT_BLOCK = 2      // Large volume on one side within the window, at any number of levels
+};
+
+// In WireSnapshotTrade.VolumeSide; the volume is the other 31 bits
+static const uint32_t WIRE_SNAPSHOT_ASK = 0x80000000u;
+
+enum WireSideEnum
+{
+    WIRE_SIDE_BID = 0,
+    WIRE_SIDE_ASK = 1
+};
+
+#pragma pack(push, 1)
+
+struct WireStreamHeader
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t HeaderSize;        // sizeof(WireStreamHeader), lets later versions grow it
+};
+
+struct WireFrameHeader
+{
+    uint16_t Type;
+    uint16_t Reserved;
+    uint32_t Length;            // Payload bytes following this header
+};
+
+// Symbols are sent once per connection; ticks refer to them by SymbolId
+struct WireSymbolDef
+{
+    uint16_t SymbolId;
+    uint8_t NameLength;
+    uint8_t PriceDecimals;
+    double TickSize;            // Price = PriceTicks * TickSize
+};
+
+struct WireTick
+{
+    int64_t Sequence;
+    int64_t Timestamp;          // Milliseconds since the Unix epoch, microseconds with WIRE_TICK_MICROSECONDS
+    int32_t PriceTicks;
+    uint32_t Volume;
+    uint16_t SymbolId;
+    uint8_t Side;               // WireSideEnum
+    uint8_t Flags;              // WireTickFlagEnum bits
+    uint32_t Prints;            // Time & Sales records merged into this tick (print coalescing); 0 from older exporters means 1
+};
+
+struct WireSummary
+{
+    int64_t FirstSequence;
+    int64_t LastSequence;
+    int64_t FirstTimestamp;
+    int64_t LastTimestamp;
+    int64_t BidVolume;
+    int64_t AskVolume;
+    uint32_t Ticks;
+    uint32_t BidTicks;
+    uint32_t AskTicks;
+    int32_t HighTicks;
+    int32_t LowTicks;
+    uint16_t SymbolId;
+    uint16_t Reserved;
+};
+
+// Bid/ask update, sent as changes against the previous quote of the symbol
+struct WireQuoteHeader
+{
+    int64_t Timestamp;          // Milliseconds since the Unix epoch
+    uint16_t SymbolId;
+    uint8_t Fields;             // WireQuoteFieldEnum bits
+    uint8_t Flags;              // WireQuoteFlagEnum bits
+};
+
+// Rolling-window totals for one symbol as of Timestamp
+struct WireAggregate
+{
+    int64_t Timestamp;          // Milliseconds since the Unix epoch
+    int64_t BidVolume;
+    int64_t AskVolume;
+    uint32_t WindowMs;
+    uint32_t BidTicks;
+    uint32_t AskTicks;
+    int32_t LastPriceTicks;
+    uint16_t SymbolId;
+    uint16_t Reserved;
+    uint32_t Reserved2;
+};
+
+// Exporter instrumentation for one chart over IntervalMs. Counters, Connects
+// included, cover the interval; DroppedTicks is the total since the study
+// started.
+struct WireStats
+{
+    int64_t Timestamp;          // Milliseconds since the Unix epoch (local clock)
+    uint32_t IntervalMs;
+    uint32_t Calls;             // Study calls in the interval
+    uint64_t Ticks;
+    uint64_t BytesSent;
+    uint32_t CallP50Micros;
+    uint32_t CallP99Micros;
+    uint32_t CallMaxMicros;
+    uint32_t MaxTicksPerCall;
+    uint32_t WouldBlocks;
+    uint32_t Connects;
+    uint64_t BacklogBytes;      // Queued for sending at the end of the interval
+    int64_t DroppedTicks;
+    uint16_t SymbolId;
+    uint16_t Reserved;
+    uint32_t MergedPrints;      // Time & Sales records merged into earlier ticks (print coalescing)
+};
+
+// Latency stamps for one batch of ticks, in microseconds since the Unix
+// epoch on the exporter's clock
+struct WireTiming
+{
+    int64_t FirstSequence;
+    int64_t LastSequence;
+    int64_t EnqueueMicros;      // First tick of the batch serialized
+    int64_t SendMicros;         // Batch handed to the transport
+    uint16_t SymbolId;
+    uint16_t Reserved;
+    uint32_t Reserved2;
+};
+
+// Per connection rather than per symbol. Consumers answer with a heartbeat
+// control line (see TradeFlowControl.h).
+struct WireHeartbeat
+{
+    int64_t Timestamp;          // Milliseconds since the Unix epoch
+};
+
+// Volume at price for the session that started at SessionStart. Without
+// WIRE_FOOTPRINT_SNAPSHOT only the levels changed since the last frame
+// follow, each with its session totals.
+struct WireFootprintHeader
+{
+    int64_t Timestamp;          // Milliseconds since the Unix epoch, of the last trade counted
+    int64_t SessionStart;       // Milliseconds since the Unix epoch
+    uint32_t Levels;            // WireFootprintLevel records following
+    uint16_t SymbolId;
+    uint8_t Flags;              // WireFootprintFlagEnum bits
+    uint8_t Reserved;
+};
+
+struct WireFootprintLevel
+{
+    int32_t PriceTicks;
+    uint32_t BidVolume;
+    uint32_t AskVolume;
+};
+
+// Repeated by the multicast publisher so receivers notice lost trailing
+// ticks without waiting for the next one (TradeFlowMulticast.h)
+struct WireSequence
+{
+    int64_t LastSequence;
+    uint16_t SymbolId;
+    uint16_t Reserved;
+    uint32_t Reserved2;
+};
+
+// A run of same-side trades that swept the book or traded a block, sent as
+// soon as it completes
+struct WireTradeEvent
+{
+    int64_t Timestamp;          // Microseconds since the Unix epoch, of the run's first trade
+    uint64_t Volume;
+    uint32_t DurationMicros;    // First trade to last
+    uint32_t Prints;            // Time & Sales records in the run
+    int32_t FirstPriceTicks;
+    int32_t LastPriceTicks;     // Furthest price reached
+    uint32_t Levels;            // Distinct prices traded
+    uint16_t SymbolId;
+    uint8_t Side;               // WireSideEnum (aggressor)
+    uint8_t Kind;               // WireTradeEventKindEnum
+};
+
+// Recent trades sent on connect to warm up the consumer. Each record's time
+// is BaseTimestamp plus its offset; the records are oldest first.
+struct WireSnapshotHeader
+{
+    int64_t BaseTimestamp;      // Microseconds since the Unix epoch
+    uint32_t Trades;            // WireSnapshotTrade records following
+    uint16_t SymbolId;
+    uint16_t Reserved;
+};
+
+struct WireSnapshotTrade
+{
+    uint32_t OffsetMicros;      // From the frame's BaseTimestamp
+    int32_t PriceTicks;
+    uint32_t VolumeSide;        // Volume, with WIRE_SNAPSHOT_ASK set for ask trades
+};
+
+// Ends a symbol's snapshot; the live ticks follow
+struct WireSnapshotEnd
+{
+    int64_t NewestTimestamp;    // Microseconds since the Unix epoch, of the newest snapshot trade; 0 if none
+    int64_t LastSequence;       // Newest tick sequenced before the snapshot; live ticks continue after it
+    uint32_t Trades;            // In all the snapshot frames
+    uint16_t SymbolId;
+    uint16_t Reserved;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(WireStreamHeader) == 8, "WireStreamHeader layout");
+static_assert(sizeof(WireFrameHeader) == 8, "WireFrameHeader layout");
+static_assert(sizeof(WireSymbolDef) == 12, "WireSymbolDef layout");
+static_assert(sizeof(WireTick) == 32, "WireTick layout");
+static_assert(sizeof(WireSummary) == 72, "WireSummary layout");
+static_assert(sizeof(WireAggregate) == 48, "WireAggregate layout");
+static_assert(sizeof(WireQuoteHeader) == 12, "WireQuoteHeader layout");
+static_assert(sizeof(WireStats) == 80, "WireStats layout");
+static_assert(sizeof(WireTiming) == 40, "WireTiming layout");
+static_assert(sizeof(WireHeartbeat) == 8, "WireHeartbeat layout");
+static_assert(sizeof(WireFootprintHeader) == 24, "WireFootprintHeader layout");
+static_assert(sizeof(WireFootprintLevel) == 12, "WireFootprintLevel layout");
+static_assert(sizeof(WireSequence) == 16, "WireSequence layout");
+static_assert(sizeof(WireTradeEvent) == 40, "WireTradeEvent layout");
+static_assert(sizeof(WireSnapshotHeader) == 16, "WireSnapshotHeader layout");
+static_assert(sizeof(WireSnapshotTrade) == 12, "WireSnapshotTrade layout");
+static_assert(sizeof(WireSnapshotEnd) == 24, "WireSnapshotEnd layout");
+
+// Largest quote record: header plus all four fields
+static const int WIRE_MAX_QUOTE_RECORD = sizeof(WireQuoteHeader) + 4 * 4;
+
+// Largest encoded symbol frame
+static const int WIRE_MAX_SYMBOL_FRAME = sizeof(WireFrameHeader) + sizeof(WireSymbolDef) + 255;
+
+inline int32_t PriceToTicks(double Price, double TickSize)
+{
+    if (TickSize <= 0.0)
+        return static_cast<int32_t>(std::llround(Price));
+
+    return static_cast<int32_t>(std::llround(Price / TickSize));
+}
+
+inline int WriteStreamHeader(char* Out)
+{
+    WireStreamHeader Header;
+    Header.Magic = WIRE_MAGIC;
+    Header.Version = WIRE_VERSION;
+    Header.HeaderSize = sizeof(WireStreamHeader);
+    memcpy(Out, &Header, sizeof(Header));
+    return sizeof(Header);
+}
+
+inline int WriteFrameHeader(char* Out, uint16_t Type, uint32_t PayloadLength)
+{
+    WireFrameHeader Header;
+    Header.Type = Type;
+    Header.Reserved = 0;
+    Header.Length = PayloadLength;
+    memcpy(Out, &Header, sizeof(Header));
+    return sizeof(Header);
+}
+
+// Writes a complete symbol frame. Out must hold WIRE_MAX_SYMBOL_FRAME bytes.
+inline int WriteSymbolFrame(char* Out, uint16_t SymbolId, const char* Name, double TickSize, int PriceDecimals)
+{
+    size_t NameLength = strlen(Name);
+    if (NameLength > 255)
+        NameLength = 255;
+
+    WireSymbolDef Def;
+    Def.SymbolId = SymbolId;
+    Def.NameLength = static_cast<uint8_t>(NameLength);
+    Def.PriceDecimals = static_cast<uint8_t>(PriceDecimals);
+    Def.TickSize = TickSize;
+
+    int Length = WriteFrameHeader(Out, WIRE_FRAME_SYMBOL, static_cast<uint32_t>(sizeof(Def) + NameLength));
+    memcpy(Out + Length, &Def, sizeof(Def));
+    Length += sizeof(Def);
+    memcpy(Out + Length, Name, NameLength);
+    return Length + static_cast<int>(NameLength);
+}
+
+inline int WriteTick(char* Out, int64_t Sequence, int64_t Timestamp, int32_t PriceTicks,
+    uint32_t Volume, uint16_t SymbolId, bool IsAsk, uint32_t Prints, uint8_t Flags = 0)
+{
+    WireTick Tick;
+    Tick.Sequence = Sequence;
+    Tick.Timestamp = Timestamp;
+    Tick.PriceTicks = PriceTicks;
+    Tick.Volume = Volume;
+    Tick.SymbolId = SymbolId;
+    Tick.Side = IsAsk ? WIRE_SIDE_ASK : WIRE_SIDE_BID;
+    Tick.Flags = Flags;
+    Tick.Prints = Prints;
+    memcpy(Out, &Tick, sizeof(Tick));
+    return sizeof(Tick);
+}
@@ -34,6 +34,12 @@ class TradeFlowApp {
         this.dataMode = 'websocket';  // 'websocket' or 'playback'
         this.userDisconnected = false;
 
+        // Binary frames straight from the exporter's WebSocket server (no
+        // relay); created per connection, timing applies to the next batch
+        this.wireDecoder = null;
+        this.wireTiming = null;
+        this.wireReceivedAt = 0;
+
 
         // Audio alert mode: 'raw' | 'intelligent' | 'transition'
         this.audioAlertMode = 'intelligent';
@@ -48,6 +54,22 @@ class TradeFlowApp {
         this.rateWindowMs = 5000;
         this.recentTrades = [];
 
+        // Native windows for the engines and the rate window, when the addon
+        // is built (components/native-engines.js); otherwise the JS ones
+        this.flowWindows = (typeof NativeEngines !== 'undefined') ? NativeEngines.create() : null;
+        this.configureFlowWindows();
+
+        // Latest exporter aggregate for the rate window (used instead of
+        // rescanning recentTrades while it is fresh)
+        this.exporterAggregate = null;
+        this.exporterAggregateAt = 0;
+        this.exporterAggregateMaxAgeMs = 1000;
+
+        // End-to-end latency of stamped trades, reported to the console
+        this.latency = new LatencyStats.LatencyRecorder();
+        this.latencyReportMs = 10000;
+        this.lastLatencyReportAt = 0;
+
         // Totals
         this.stats = {
             sellCount: 0,
@@ -197,6 +219,19 @@ class TradeFlowApp {
     }
 
 
+    // Keeps the native windows in step with the engines' window settings
+    configureFlowWindows() {
+        if (!this.flowWindows) return;
+
+        if (!this.eventEngine || !this.transitionEngine) {
+            this.flowWindows = null;
+            return;
+        }
+
+        this.flowWindows.configure(this.eventEngine.config, this.transitionEngine.config, this.rateWindowMs);
+    }
+
+
     // -----------------------------
     // Settings helpers
     // -----------------------------
@@ -650,6 +685,11 @@ class TradeFlowApp {
             this.transitionEngine.reset?.();
         }
 
+        if (this.flowWindows) {
+            this.flowWindows.resetEngines();
+            this.configureFlowWindows();
+        }
+
         // Velocity Pulse config
         const velocityPulseConfig = {
             baselineWindowMs: readNum('velocity-baselineWindowMs'),
@@ -724,6 +764,11 @@ class TradeFlowApp {
             this.transitionEngine.reset?.();
         }
 
+        if (this.flowWindows) {
+            this.flowWindows.resetEngines();
+            this.configureFlowWindows();
+        }
+
         if (this.velocityPulseEngine && this.velocityPulseEngine.updateConfig) {
             this.velocityPulseEngine.updateConfig(vDefaults);
             this.velocityPulseEngine.reset?.();
@@ -780,6 +825,9 @@ class TradeFlowApp {
 
         try {
             this.websocket = new WebSocket(WS_URL);
+            this.websocket.binaryType = 'arraybuffer';
+            this.wireDecoder = null;
+            this.wireTiming = null;
 
             this.websocket.onopen = () => {
                 console.log('Connected to socket reader WebSocket');
@@ -793,9 +841,26 @@ class TradeFlowApp {
 
             this.websocket.onmessage = (event) => {
                 try {
+                    const receivedAt = LatencyStats.nowMicros();
+
+                    // The exporter serving clients itself sends binary frames
+                    if (typeof event.data !== 'string') {
+                        if (!this.wireDecoder) this.wireDecoder = this.createWireDecoder();
+                        this.wireReceivedAt = receivedAt;
+                        this.wireDecoder.push(event.data);
+                        return;
+                    }
+
                     const message = JSON.parse(event.data);
                     if (message.type === 'trade') {
                         this.handleTrade(message.data);
+                        if (message.data.lat) this.recordLatency(message.data.lat, receivedAt);
+                    } else if (message.type === 'aggregate') {
+                        this.handleAggregate(message.data);
+                    } else if (message.type === 'event') {
+                        this.handleTradeEvent(message.data);
+                    } else if (message.type === 'snapshot') {
+                        this.warmUp(message.data.trades);
                     }
                 } catch (err) {
                     console.error('Failed to parse WebSocket message:', err);
@@ -887,7 +952,11 @@ class TradeFlowApp {
         if (!Number.isFinite(volume)) return;
 
         // totals + rolling buffer (always track raw tape stats)
-        this.updateStats(side, volume);
+        const now = Date.now();
+        this.updateStats(side, volume, now);
+
+        // The native windows take every trade once, for all engines
+        const ts = this.flowWindows ? this.flowWindows.ingest(trade, now) : NaN;
 
         // RAW mode: audio is per trade using real volume, so meter should match tape
         if (this.audioAlertMode === 'raw') {
@@ -909,7 +978,9 @@ class TradeFlowApp {
                 return;
             }
 
-            const evt = this.transitionEngine.ingest(trade);
+            const evt = this.flowWindows
+                ? (Number.isFinite(ts) ? this.flowWindows.transitionFor(this.transitionEngine, ts) : null)
+                : this.transitionEngine.ingest(trade);
             if (!evt) return;
 
             // TransitionDetectionEngine provides imbalance (-1..+1) and/or other metrics.
@@ -933,7 +1004,9 @@ class TradeFlowApp {
             return;
         }
 
-        const event = this.eventEngine.ingest(trade);
+        const event = this.flowWindows
+            ? (Number.isFinite(ts) ? this.flowWindows.eventFor(this.eventEngine, ts) : null)
+            : this.eventEngine.ingest(trade);
         if (!event) return;
 
         const pseudoVolume = Math.max(1, Math.round(event.strength * 10));
@@ -945,9 +1018,141 @@ class TradeFlowApp {
         this.processTrade(trade);
     }
 
+    // Decoder for binary frames from the exporter's WebSocket server; ticks
+    // and aggregates are handed on in the shapes the relay sends
+    createWireDecoder() {
+        return new TradeFlowWire.WireDecoder({
+            onTick: (tick) => this.handleWireTick(tick),
+            onAggregate: (aggregate) => this.handleAggregate(aggregate),
+            onTradeEvent: (event) => this.handleTradeEvent(event),
+            onTiming: (timing) => { this.wireTiming = timing; },
+            onError: (err) => console.error('Exporter stream error:', err.message)
+        });
+    }
+
+    handleWireTick(tick) {
+        const trade = {
+            timestamp: tick.ts,
+            price: tick.p,
+            volume: tick.v,
+            side: tick.s,
+            symbol: tick.sym
+        };
+        if (tick.us !== undefined) trade.timestampUs = tick.us;
+        if (tick.n > 1) trade.prints = tick.n;
+
+        this.handleTrade(trade);
+
+        const timing = this.wireTiming;
+        if (timing && timing.sym === tick.sym && tick.seq >= timing.seq0 && tick.seq <= timing.seq1) {
+            this.recordLatency({ tq: timing.tq, tx: timing.tx }, this.wireReceivedAt);
+        }
+    }
+
+    // Adds the app's hops to the stamps from the exporter and relay. "app"
+    // covers the trade going through the engines and AudioEngine.playTrade.
+    // Without relay stamps (exporter serving the app directly) the network
+    // hop is measured from the exporter's send.
+    recordLatency(lat, receivedAt) {
+        const processedAt = LatencyStats.nowMicros();
+
+        if (lat.fx !== undefined) {
+            this.latency.record('relay→app', receivedAt - lat.fx);
+        } else {
+            this.latency.record('exporter', lat.tx - lat.tq);
+            this.latency.record('exporter→app', receivedAt - lat.tx);
+        }
+        this.latency.record('app', processedAt - receivedAt);
+        this.latency.record('total', processedAt - lat.tq);
+
+        if (processedAt / 1000 - this.lastLatencyReportAt >= this.latencyReportMs) {
+            this.lastLatencyReportAt = processedAt / 1000;
+            console.log(`Latency (last samples per hop):\n${this.latency.format()}`);
+        }
+    }
+
+    // Keeps the exporter's totals for the window matching rateWindowMs
+    handleAggregate(aggregate) {
+        if (this.dataMode !== 'websocket' || !Array.isArray(aggregate.w)) return;
+
+        const win = aggregate.w.find(w => w.ms === this.rateWindowMs);
+        if (!win) return;
+
+        this.exporterAggregate = win;
+        this.exporterAggregateAt = Date.now();
+    }
+
+    // Recent trades from the exporter's warm start (kept by the relay) go
+    // through the engines without sound or stats, so their windows and
+    // baselines start from the recent tape instead of cold
+    warmUp(trades) {
+        if (this.dataMode !== 'websocket' || !Array.isArray(trades) || trades.length === 0) return;
+
+        // Arrived before the rate window, so like the JS fallback (which never
+        // sees these trades) the live rates start from the live tape only
+        const staleArrival = Date.now() - this.rateWindowMs - 1;
+        for (const trade of trades) {
+            if (this.flowWindows) {
+                const ts = this.flowWindows.ingest(trade, staleArrival);
+                if (!Number.isFinite(ts)) continue;
+                this.flowWindows.eventFor(this.eventEngine, ts);
+                this.flowWindows.transitionFor(this.transitionEngine, ts);
+            } else {
+                if (this.eventEngine) this.eventEngine.ingest(trade);
+                if (this.transitionEngine) this.transitionEngine.ingest(trade);
+            }
+        }
+
+        if (this.velocityPulseEngine && this.velocityPulseEngine.warmUp) {
+            this.velocityPulseEngine.warmUp(this.rateSamples(trades, 100));
+        }
+        console.log(`Warm start: ${trades.length} recent trades`);
+    }
+
+    // Rolling rates over rateWindowMs every stepMs of the trades' own time,
+    // as computeRollingRates reports them live
+    rateSamples(trades, stepMs) {
+        const windowSec = this.rateWindowMs / 1000;
+        const samples = [];
+        let first = 0;
+        let buyTrades = 0, sellTrades = 0, buyVol = 0, sellVol = 0;
+        let next = 0;
+
+        const start = Number(trades[0].timestamp) + this.rateWindowMs;
+        const end = Number(trades[trades.length - 1].timestamp);
+        for (let t = start; t <= end; t += stepMs) {
+            for (; next < trades.length && Number(trades[next].timestamp) <= t; next++) {
+                const volume = Number(trades[next].volume) || 0;
+                if (trades[next].side === 'ASK') { buyTrades++; buyVol += volume; } else { sellTrades++; sellVol += volume; }
+            }
+            for (; first < next && Number(trades[first].timestamp) < t - this.rateWindowMs; first++) {
+                const volume = Number(trades[first].volume) || 0;
+                if (trades[first].side === 'ASK') { buyTrades--; buyVol -= volume; } else { sellTrades--; sellVol -= volume; }
+            }
+            samples.push({
+                buyTradesPerSec: buyTrades / windowSec,
+                sellTradesPerSec: sellTrades / windowSec,
+                buyVolPerSec: buyVol / windowSec,
+                sellVolPerSec: sellVol / windowSec,
+                ts: t
+            });
+        }
+        return samples;
+    }
+
+    // Sweeps and block trades detected by the exporter arrive ahead of their
+    // ticks and are cued at once. RAW mode already sounds every print.
+    handleTradeEvent(event) {
+        if (this.dataMode !== 'websocket' || this.audioAlertMode === 'raw') return;
+        if (event.s !== 'BID' && event.s !== 'ASK') return;
+
+        const pseudoVolume = event.e === 'sweep' ? Math.min(10, 4 + 2 * (Number(event.l) || 0)) : 8;
+        this._emitAudioAndVisual(event.s, pseudoVolume);
+    }
+
     handlePlay() {
-        if (!this.dataPlayer.data || this.dataPlayer.data.length === 0) {
-            alert('Please load a CSV file first');
+        if (this.dataPlayer.tradeCount === 0) {
+            alert('Please load a CSV or archive file first');
             return;
         }
 
@@ -964,6 +1169,16 @@ class TradeFlowApp {
     handleFileUpload(file) {
         if (!file) return;
 
+        // Archives are read in place through Electron's file path
+        if (file.name.toLowerCase().endsWith('.tfa') && file.path) {
+            try {
+                this.dataPlayer.loadArchive(file.path);
+            } catch (err) {
+                alert(`Could not open archive: ${err.message}`);
+            }
+            return;
+        }
+
         const reader = new FileReader();
         reader.onload = (e) => {
             const csvData = e.target.result;
@@ -976,9 +1191,7 @@ class TradeFlowApp {
     // -----------------------------
     // Stats (Totals + Rolling Window)
     // -----------------------------
-    updateStats(side, volume) {
-        const now = Date.now();
-
+    updateStats(side, volume, now = Date.now()) {
         if (!this.stats.startTime) {
             this.stats.startTime = now;
         }
@@ -992,7 +1205,8 @@ class TradeFlowApp {
             this.stats.buyVolume += volume;
         }
 
-        // Rolling buffer
+        // Rolling buffer (the native windows keep their own)
+        if (this.flowWindows) return;
         this.recentTrades.push({ t: now, side, volume });
         this.pruneRecentTrades(now);
     }
@@ -1013,13 +1227,32 @@ class TradeFlowApp {
         let sellTrades = 0, buyTrades = 0;
         let sellVol = 0, buyVol = 0;
 
-        for (const tr of this.recentTrades) {
-            if (tr.side === 'BID') {
-                sellTrades++;
-                sellVol += tr.volume;
-            } else if (tr.side === 'ASK') {
-                buyTrades++;
-                buyVol += tr.volume;
+        // Prefer the exporter's incrementally maintained totals when fresh
+        const agg = this.exporterAggregate;
+        const useAggregate =
+            agg && this.dataMode === 'websocket' &&
+            now - this.exporterAggregateAt <= this.exporterAggregateMaxAgeMs;
+
+        if (useAggregate) {
+            sellTrades = agg.bn;
+            buyTrades = agg.an;
+            sellVol = agg.bv;
+            buyVol = agg.av;
+        } else if (this.flowWindows) {
+            const rates = this.flowWindows.rates(now);
+            sellTrades = rates.sellCount;
+            buyTrades = rates.buyCount;
+            sellVol = rates.sellVol;
+            buyVol = rates.buyVol;
+        } else {
+            for (const tr of this.recentTrades) {
+                if (tr.side === 'BID') {
+                    sellTrades++;
+                    sellVol += tr.volume;
+                } else if (tr.side === 'ASK') {
+                    buyTrades++;
+                    buyVol += tr.volume;
+                }
             }
         }
 
@@ -1050,6 +1283,8 @@ class TradeFlowApp {
         };
 
         this.recentTrades = [];
+        this.exporterAggregate = null;
+        if (this.flowWindows) this.flowWindows.reset();
 
         if (this.eventEngine) this.eventEngine.reset();
         if (this.transitionEngine?.reset) this.transitionEngine.reset();
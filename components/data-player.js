@@ -1,7 +1,11 @@
 // CSV Data Player
+// Plays trades from a parsed CSV (this.data) or from a columnar archive
+// (components/tradeflow-archive.js), which is read block by block as
+// playback reaches it.
 class DataPlayer {
     constructor() {
         this.data = [];
+        this.archive = null;
         this.currentIndex = 0;
         this.isPlaying = false;
         this.playbackSpeed = 1.0;
@@ -11,6 +15,8 @@ class DataPlayer {
     
     // Load CSV data
     loadCSV(csvText) {
+        this.closeArchive();
+
         const lines = csvText.trim().split('\n');
         const header = lines[0].split(',');
         
@@ -33,10 +39,50 @@ class DataPlayer {
         console.log('Loaded', this.data.length, 'trades');
         this.currentIndex = 0;
     }
+
+    // Load a columnar archive (.tfa); only its block directory is read here
+    loadArchive(filePath) {
+        this.closeArchive();
+        this.data = [];
+
+        this.archive = new TradeFlowArchive.ArchiveReader(filePath);
+        console.log('Opened archive', this.archive.symbol, this.archive.tickCount, 'trades in', this.archive.blockCount, 'blocks');
+        this.currentIndex = 0;
+    }
+
+    closeArchive() {
+        if (this.archive) this.archive.close();
+        this.archive = null;
+    }
+
+    get tradeCount() {
+        return this.archive ? this.archive.tickCount : this.data.length;
+    }
+
+    tradeAt(index) {
+        return this.archive ? this.archive.tradeAt(index) : this.data[index];
+    }
+
+    // Continue playback from the first trade at or after timestamp (ms)
+    seek(timestamp) {
+        if (this.archive) {
+            this.currentIndex = this.archive.findIndex(timestamp);
+            return;
+        }
+
+        let low = 0;
+        let high = this.data.length;
+        while (low < high) {
+            const mid = (low + high) >> 1;
+            if (this.data[mid].timestamp < timestamp) low = mid + 1;
+            else high = mid;
+        }
+        this.currentIndex = low;
+    }
     
     // Start playback
     play(callback) {
-        if (!this.data || this.data.length === 0) {
+        if (this.tradeCount === 0) {
             console.error('No data loaded');
             return;
         }
@@ -68,13 +114,14 @@ class DataPlayer {
     
     // Play next trade
     playNext() {
-        if (!this.isPlaying || this.currentIndex >= this.data.length) {
+        const count = this.tradeCount;
+        if (!this.isPlaying || this.currentIndex >= count) {
             this.isPlaying = false;
             this.currentIndex = 0;
             return;
         }
         
-        const trade = this.data[this.currentIndex];
+        const trade = this.tradeAt(this.currentIndex);
         
         // Call callback with trade data
         if (this.callback) {
@@ -83,8 +130,8 @@ class DataPlayer {
         
         // Calculate delay until next trade
         let delay = 0;
-        if (this.currentIndex < this.data.length - 1) {
-            const nextTrade = this.data[this.currentIndex + 1];
+        if (this.currentIndex < count - 1) {
+            const nextTrade = this.tradeAt(this.currentIndex + 1);
             delay = (nextTrade.timestamp - trade.timestamp) / this.playbackSpeed;
         }
         
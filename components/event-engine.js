@@ -59,7 +59,9 @@
     // Normalizes incoming trade shapes
     normalizeTrade(trade) {
       // Your app currently uses: { timestamp, price, volume, side, symbol } :contentReference[oaicite:1]{index=1}
-      const timestamp = Number(trade.timestamp ?? trade.ts ?? Date.now());
+      // Microsecond stamps keep their precision as fractional milliseconds
+      const us = trade.timestampUs ?? trade.us;
+      const timestamp = us != null ? Number(us) / 1000 : Number(trade.timestamp ?? trade.ts ?? Date.now());
       const side = trade.side ?? trade.s;
       const volume = Number(trade.volume ?? trade.v ?? 0);
       const price = Number(trade.price ?? trade.p ?? NaN);
@@ -100,6 +102,11 @@
         }
       }
 
+      return this.computeFromTotals(nowTs, buyVol, sellVol, buyCount, sellCount);
+    }
+
+    // Derived stats from window totals (summed here or by the native engines)
+    computeFromTotals(nowTs, buyVol, sellVol, buyCount, sellCount) {
       const totalVol = buyVol + sellVol;
       const totalCount = buyCount + sellCount;
 
@@ -143,8 +150,16 @@
       this.window.push(t);
       this.prune(nowTs);
 
-      const s = this.compute(nowTs);
+      return this.evaluate(nowTs, this.compute(nowTs));
+    }
+
+    // Same as ingest(), for a trade already added to an external window
+    // (components/native-engines.js) whose totals are given
+    ingestTotals(nowTs, buyVol, sellVol, buyCount, sellCount) {
+      return this.evaluate(nowTs, this.computeFromTotals(nowTs, buyVol, sellVol, buyCount, sellCount));
+    }
 
+    evaluate(nowTs, s) {
       // Cooldown
       if (nowTs < this.state.cooldownUntil) return null;
 
@@ -0,0 +1,81 @@
+// latency-stats.js
+// Rolling latency percentiles per hop of the tick path
+// (exporter -> relay -> WebSocket -> app). Samples are microseconds; each hop
+// keeps its most recent samples in a fixed ring so memory stays bounded.
+// Usable from Node (require) and from the browser (window.LatencyStats).
+
+(function (root) {
+  // Microseconds since the Unix epoch, comparable with the exporter's stamps
+  function nowMicros() {
+    const perf = typeof performance !== "undefined" ? performance : null;
+    if (perf && perf.timeOrigin) return Math.round((perf.timeOrigin + perf.now()) * 1000);
+    return Date.now() * 1000;
+  }
+
+  function percentile(sorted, fraction) {
+    if (sorted.length === 0) return 0;
+    const index = Math.min(sorted.length - 1, Math.ceil(fraction * sorted.length) - 1);
+    return sorted[Math.max(0, index)];
+  }
+
+  class LatencyRecorder {
+    constructor(capacity = 8192) {
+      this.capacity = capacity;
+      this.hops = new Map();              // hop name -> { samples: Float64Array, count }
+    }
+
+    record(hop, micros) {
+      if (!Number.isFinite(micros)) return;
+
+      let entry = this.hops.get(hop);
+      if (!entry) {
+        entry = { samples: new Float64Array(this.capacity), count: 0 };
+        this.hops.set(hop, entry);
+      }
+
+      entry.samples[entry.count % this.capacity] = micros;
+      entry.count++;
+    }
+
+    // { hop: { n, p50, p99, p999, max } } over the retained samples
+    summary() {
+      const result = {};
+      for (const [hop, entry] of this.hops) {
+        const n = Math.min(entry.count, this.capacity);
+        const sorted = Array.from(entry.samples.subarray(0, n)).sort((a, b) => a - b);
+        result[hop] = {
+          n: entry.count,
+          p50: percentile(sorted, 0.5),
+          p99: percentile(sorted, 0.99),
+          p999: percentile(sorted, 0.999),
+          max: n > 0 ? sorted[n - 1] : 0
+        };
+      }
+      return result;
+    }
+
+    // One line per hop, in milliseconds
+    format() {
+      const ms = (us) => (us / 1000).toFixed(2);
+      return Object.entries(this.summary())
+        .map(([hop, s]) => `${hop}: p50 ${ms(s.p50)} p99 ${ms(s.p99)} p999 ${ms(s.p999)} max ${ms(s.max)} ms (n=${s.n})`)
+        .join("\n");
+    }
+
+    reset() {
+      this.hops.clear();
+    }
+  }
+
+  const LatencyStats = {
+    nowMicros,
+    LatencyRecorder
+  };
+
+  if (typeof module !== "undefined" && module.exports) {
+    module.exports = LatencyStats;
+  }
+  if (root) {
+    root.LatencyStats = LatencyStats;
+  }
+})(typeof window !== "undefined" ? window : null);
@@ -0,0 +1,145 @@
+// native-engines.js
+// Native rolling windows for the flow engines (native/TradeFlowEngines.cpp).
+// Each trade is added once to the addon, which keeps EventEngine's and
+// TransitionDetectionEngine's windows, the transition imbalance history and
+// the app's rate window up to date incrementally. The JS engines then run
+// their decision logic on the totals (ingestTotals), so events are the same
+// as with their own windows. Without a built addon, create() returns null
+// and the app keeps using the JS windows.
+// Usable from Node (require) and from the browser (window.NativeEngines).
+
+(function (root) {
+  const ADDON_FILE = "tradeflow_engines.node";
+
+  // Slots of the stats array (FlowStatEnum in native/TradeFlowWindows.h)
+  const STAT = {
+    EVENT_BUY_VOL: 0,
+    EVENT_SELL_VOL: 1,
+    EVENT_BUY_COUNT: 2,
+    EVENT_SELL_COUNT: 3,
+    TRANSITION_BUY_VOL: 4,
+    TRANSITION_SELL_VOL: 5,
+    TRANSITION_BUY_COUNT: 6,
+    TRANSITION_SELL_COUNT: 7,
+    TRANSITION_PREVIOUS_IMBALANCE: 8,    // NaN for none
+    RATE_BUY_VOL: 9,
+    RATE_SELL_VOL: 10,
+    RATE_BUY_COUNT: 11,
+    RATE_SELL_COUNT: 12
+  };
+  const STAT_COUNT = 13;
+
+  let loadError = null;
+
+  // The built addon, or null. Looked for next to index.html (renderer) and
+  // next to this file's directory (Node).
+  function loadAddon() {
+    if (typeof require !== "function") return null;
+
+    const path = require("path");
+    const bases = typeof __dirname !== "undefined" ? [__dirname, path.join(__dirname, "..")] : ["."];
+    for (const base of bases) {
+      try {
+        const addon = require(path.join(base, "native", "build", "Release", ADDON_FILE));
+        if (addon.STAT_COUNT !== STAT_COUNT) throw new Error(`addon has ${addon.STAT_COUNT} stats, expected ${STAT_COUNT}`);
+        return addon;
+      } catch (err) {
+        loadError = err;
+      }
+    }
+    return null;
+  }
+
+  class FlowWindows {
+    constructor(addon) {
+      this.engines = new addon.FlowEngines();
+      this.stats = this.engines.stats;
+    }
+
+    // Window settings from the engines' configs and the app's rate window
+    configure(eventConfig, transitionConfig, rateWindowMs) {
+      this.engines.configure({
+        eventWindowMs: eventConfig.windowMs,
+        eventMaxTrades: eventConfig.maxWindowTrades,
+        transitionWindowMs: transitionConfig.windowMs,
+        transitionMaxTrades: transitionConfig.maxWindowTrades,
+        transitionHistoryMs: transitionConfig.historyDepth * 1000,
+        transitionCountMetric: transitionConfig.dominanceMetric === "count",
+        rateWindowMs
+      });
+    }
+
+    reset() {
+      this.engines.reset();
+    }
+
+    // Keeps the rate window
+    resetEngines() {
+      this.engines.resetEngines();
+    }
+
+    // Adds a trade to every window. Returns its timestamp as the engines
+    // normalize it (fractional milliseconds from a microsecond stamp); NaN
+    // means they would have dropped the trade.
+    ingest(trade, arrivalMs) {
+      const us = trade.timestampUs ?? trade.us;
+      const ts = us != null ? Number(us) / 1000 : Number(trade.timestamp ?? trade.ts ?? Date.now());
+      const volume = Number(trade.volume ?? trade.v ?? 0);
+      const side = trade.side ?? trade.s;
+      if ((side !== "ASK" && side !== "BID") || !Number.isFinite(volume)) return NaN;
+
+      this.engines.ingest(ts, volume, side === "ASK", arrivalMs);
+      return ts;
+    }
+
+    // EventEngine.ingest() for the trade just added at ts
+    eventFor(engine, ts) {
+      const s = this.stats;
+      return engine.ingestTotals(ts, s[STAT.EVENT_BUY_VOL], s[STAT.EVENT_SELL_VOL], s[STAT.EVENT_BUY_COUNT], s[STAT.EVENT_SELL_COUNT]);
+    }
+
+    // TransitionDetectionEngine.ingest() for the trade just added at ts
+    transitionFor(engine, ts) {
+      const s = this.stats;
+      const previous = s[STAT.TRANSITION_PREVIOUS_IMBALANCE];
+      return engine.ingestTotals(
+        ts,
+        s[STAT.TRANSITION_BUY_VOL], s[STAT.TRANSITION_SELL_VOL],
+        s[STAT.TRANSITION_BUY_COUNT], s[STAT.TRANSITION_SELL_COUNT],
+        Number.isNaN(previous) ? null : previous
+      );
+    }
+
+    // Rate window totals as of nowMs: { buyVol, sellVol, buyCount, sellCount }
+    rates(nowMs) {
+      this.engines.expireRates(nowMs);
+      const s = this.stats;
+      return {
+        buyVol: s[STAT.RATE_BUY_VOL],
+        sellVol: s[STAT.RATE_SELL_VOL],
+        buyCount: s[STAT.RATE_BUY_COUNT],
+        sellCount: s[STAT.RATE_SELL_COUNT]
+      };
+    }
+  }
+
+  let addon;
+
+  // FlowWindows backed by the addon, or null when it is not built
+  function create() {
+    if (addon === undefined) addon = loadAddon();
+    return addon ? new FlowWindows(addon) : null;
+  }
+
+  const api = {
+    STAT,
+    STAT_COUNT,
+    FlowWindows,
+    loadAddon,
+    create,
+    get loadError() { return loadError; }
+  };
+
+  if (typeof module !== "undefined" && module.exports) module.exports = api;
+  if (root) root.NativeEngines = api;
+})(typeof window !== "undefined" ? window : null);
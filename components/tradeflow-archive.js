@@ -0,0 +1,392 @@
+// tradeflow-archive.js
+// Columnar tick archive for fast replay. Ticks are stored in blocks, each
+// holding its columns separately (time delta, price in ticks, volume, side
+// bits), with a directory of per-block time ranges at the end of the file.
+// Opening an archive reads only the header and directory; blocks are read on
+// demand with positioned reads and decoded as typed-array views, so a day of
+// ticks opens at once and seeks by time without scanning.
+// Needs Node's fs (Node, or the Electron renderer with nodeIntegration).
+//
+// File layout, little-endian:
+//   header (64 bytes), symbol name, padding to 8
+//   per block, each starting on an 8-byte boundary:
+//     Uint32 time[n]     milliseconds after the block's minTs
+//     Int32  price[n]    price in ticks (price = ticks * tickSize)
+//     Uint32 volume[n]
+//     Uint8  side[ceil(n / 8)], bit i % 8 of byte i / 8 set for ASK
+//   directory: one 40-byte entry per block
+//     { Int64 minTs, Int64 maxTs, Uint64 firstTick, Uint64 offset, Uint32 ticks, Uint32 reserved }
+//
+// Run: node tradeflow-archive.js <in.csv | in.tfr | recording directory> <out.tfa> [--tick-size 0.25] [--decimals 2]
+// A CSV's tick size defaults to one unit of its most precise price
+// (0.01 for prices like 75.43); recordings carry their own.
+
+(function (root) {
+  const ARCHIVE_MAGIC = 0x41544654;       // "TFTA"
+  const ARCHIVE_VERSION = 1;
+  const HEADER_SIZE = 64;
+  const DIRECTORY_ENTRY_SIZE = 40;
+
+  const DEFAULT_BLOCK_TICKS = 65536;
+  const MAX_TIME_DELTA = 0xffffffff;
+
+  // Decoded blocks kept in memory by a reader
+  const BLOCK_CACHE_SIZE = 4;
+
+  const TWO_POW_32 = 4294967296;
+
+  // Prices within this many ticks of the grid are on it (floating point noise)
+  const PRICE_GRID_TOLERANCE = 1e-6;
+
+  const fs = typeof require === "function" ? require("fs") : null;
+
+  function readInt64(buffer, offset) {
+    return buffer.readInt32LE(offset + 4) * TWO_POW_32 + buffer.readUInt32LE(offset);
+  }
+
+  function writeInt64(buffer, value, offset) {
+    const hi = Math.floor(value / TWO_POW_32);
+    buffer.writeUInt32LE(value - hi * TWO_POW_32, offset);
+    buffer.writeInt32LE(hi, offset + 4);
+  }
+
+  function align8(value) {
+    return Math.ceil(value / 8) * 8;
+  }
+
+  function blockBytes(ticks) {
+    return align8(ticks * 12 + Math.ceil(ticks / 8));
+  }
+
+  // Streams ticks ({ ts, p, v, s }) into an archive file. Ticks must arrive
+  // in time order, at prices on the tickSize grid.
+  class ArchiveWriter {
+    constructor(filePath, { symbol = "", tickSize = 0.25, decimals = 2, blockTicks = DEFAULT_BLOCK_TICKS } = {}) {
+      this.fd = fs.openSync(filePath, "w");
+      this.symbol = Buffer.from(symbol, "latin1").subarray(0, 255);
+      this.tickSize = tickSize;
+      this.decimals = decimals;
+      this.blockTicks = blockTicks;
+
+      this.times = new Float64Array(blockTicks);
+      this.prices = new Int32Array(blockTicks);
+      this.volumes = new Uint32Array(blockTicks);
+      this.sides = new Uint8Array(Math.ceil(blockTicks / 8));
+      this.blockCount = 0;
+
+      this.directory = [];
+      this.tickCount = 0;
+      this.offset = align8(HEADER_SIZE + this.symbol.length);
+      this.firstTs = 0;
+      this.lastTs = 0;
+    }
+
+    add(tick) {
+      if (this.blockCount > 0 && tick.ts - this.times[0] > MAX_TIME_DELTA) this._flushBlock();
+
+      // Off-grid prices are refused; rounding would store a different price
+      const ticks = Math.round(tick.p / this.tickSize);
+      if (!(Math.abs(tick.p / this.tickSize - ticks) <= PRICE_GRID_TOLERANCE)) {
+        throw new Error(`Price ${tick.p} is not a multiple of the tick size ${this.tickSize}`);
+      }
+      if (ticks > 0x7fffffff || ticks < -0x80000000) {
+        throw new Error(`Price ${tick.p} is out of range for the tick size ${this.tickSize}`);
+      }
+
+      const i = this.blockCount;
+      this.times[i] = tick.ts;
+      this.prices[i] = ticks;
+      this.volumes[i] = tick.v;
+      if (tick.s === "ASK") this.sides[i >> 3] |= 1 << (i & 7);
+
+      if (this.tickCount === 0) this.firstTs = tick.ts;
+      this.lastTs = tick.ts;
+      this.tickCount++;
+      this.blockCount++;
+
+      if (this.blockCount === this.blockTicks) this._flushBlock();
+    }
+
+    // Writes the last block, the directory and the header; returns the tick count
+    finish() {
+      this._flushBlock();
+
+      const directory = Buffer.alloc(this.directory.length * DIRECTORY_ENTRY_SIZE);
+      this.directory.forEach((entry, i) => {
+        const o = i * DIRECTORY_ENTRY_SIZE;
+        writeInt64(directory, entry.minTs, o);
+        writeInt64(directory, entry.maxTs, o + 8);
+        writeInt64(directory, entry.firstTick, o + 16);
+        writeInt64(directory, entry.offset, o + 24);
+        directory.writeUInt32LE(entry.ticks, o + 32);
+      });
+      fs.writeSync(this.fd, directory, 0, directory.length, this.offset);
+
+      const header = Buffer.alloc(align8(HEADER_SIZE + this.symbol.length));
+      header.writeUInt32LE(ARCHIVE_MAGIC, 0);
+      header.writeUInt16LE(ARCHIVE_VERSION, 4);
+      header.writeUInt16LE(HEADER_SIZE, 6);
+      writeInt64(header, this.tickCount, 8);
+      header.writeUInt32LE(this.directory.length, 16);
+      header.writeUInt32LE(this.blockTicks, 20);
+      writeInt64(header, this.offset, 24);
+      writeInt64(header, this.firstTs, 32);
+      writeInt64(header, this.lastTs, 40);
+      header.writeDoubleLE(this.tickSize, 48);
+      header.writeUInt8(this.decimals, 56);
+      header.writeUInt8(this.symbol.length, 57);
+      this.symbol.copy(header, HEADER_SIZE);
+      fs.writeSync(this.fd, header, 0, header.length, 0);
+
+      fs.closeSync(this.fd);
+      this.fd = null;
+      return this.tickCount;
+    }
+
+    _flushBlock() {
+      const n = this.blockCount;
+      if (n === 0) return;
+
+      let minTs = this.times[0];
+      let maxTs = this.times[0];
+      for (let i = 1; i < n; i++) {
+        if (this.times[i] < minTs) minTs = this.times[i];
+        if (this.times[i] > maxTs) maxTs = this.times[i];
+      }
+
+      const buffer = Buffer.alloc(blockBytes(n));
+      const timeColumn = new Uint32Array(buffer.buffer, buffer.byteOffset, n);
+      for (let i = 0; i < n; i++) timeColumn[i] = this.times[i] - minTs;
+      Buffer.from(this.prices.buffer, 0, n * 4).copy(buffer, n * 4);
+      Buffer.from(this.volumes.buffer, 0, n * 4).copy(buffer, n * 8);
+      Buffer.from(this.sides.buffer, 0, Math.ceil(n / 8)).copy(buffer, n * 12);
+
+      fs.writeSync(this.fd, buffer, 0, buffer.length, this.offset);
+      this.directory.push({ minTs, maxTs, firstTick: this.tickCount - n, offset: this.offset, ticks: n });
+      this.offset += buffer.length;
+
+      this.blockCount = 0;
+      this.sides.fill(0);
+    }
+  }
+
+  class ArchiveReader {
+    constructor(filePath) {
+      this.fd = fs.openSync(filePath, "r");
+
+      const header = Buffer.alloc(HEADER_SIZE + 256);
+      fs.readSync(this.fd, header, 0, header.length, 0);
+      if (header.readUInt32LE(0) !== ARCHIVE_MAGIC) throw new Error("Not a TradeFlow archive");
+      if (header.readUInt16LE(4) !== ARCHIVE_VERSION) throw new Error(`Unsupported archive version ${header.readUInt16LE(4)}`);
+
+      const headerSize = header.readUInt16LE(6);
+      this.tickCount = readInt64(header, 8);
+      this.blockCount = header.readUInt32LE(16);
+      this.firstTs = readInt64(header, 32);
+      this.lastTs = readInt64(header, 40);
+      this.tickSize = header.readDoubleLE(48);
+      this.decimals = header.readUInt8(56);
+      this.scale = Math.pow(10, this.decimals);
+      this.symbol = header.toString("latin1", headerSize, headerSize + header.readUInt8(57));
+
+      const directory = Buffer.alloc(this.blockCount * DIRECTORY_ENTRY_SIZE);
+      fs.readSync(this.fd, directory, 0, directory.length, readInt64(header, 24));
+      this.blocks = [];
+      for (let i = 0; i < this.blockCount; i++) {
+        const o = i * DIRECTORY_ENTRY_SIZE;
+        this.blocks.push({
+          minTs: readInt64(directory, o),
+          maxTs: readInt64(directory, o + 8),
+          firstTick: readInt64(directory, o + 16),
+          offset: readInt64(directory, o + 24),
+          ticks: directory.readUInt32LE(o + 32)
+        });
+      }
+
+      this.cache = new Map();             // block number -> decoded columns, in use order
+      this.current = null;                // Block of the last tradeAt, checked first
+    }
+
+    close() {
+      if (this.fd !== null) fs.closeSync(this.fd);
+      this.fd = null;
+      this.cache.clear();
+      this.current = null;
+    }
+
+    // Columns of one block: { base, time, price, volume, side, first, ticks }
+    block(b) {
+      let columns = this.cache.get(b);
+      if (columns) {
+        this.cache.delete(b);
+        this.cache.set(b, columns);
+        return columns;
+      }
+
+      const entry = this.blocks[b];
+      const n = entry.ticks;
+      const buffer = Buffer.alloc(blockBytes(n));
+      fs.readSync(this.fd, buffer, 0, buffer.length, entry.offset);
+
+      // Typed-array views share the block buffer; no per-tick decoding
+      columns = {
+        base: entry.minTs,
+        time: new Uint32Array(buffer.buffer, buffer.byteOffset, n),
+        price: new Int32Array(buffer.buffer, buffer.byteOffset + n * 4, n),
+        volume: new Uint32Array(buffer.buffer, buffer.byteOffset + n * 8, n),
+        side: new Uint8Array(buffer.buffer, buffer.byteOffset + n * 12, Math.ceil(n / 8)),
+        first: entry.firstTick,
+        ticks: n
+      };
+
+      this.cache.set(b, columns);
+      if (this.cache.size > BLOCK_CACHE_SIZE) this.cache.delete(this.cache.keys().next().value);
+      return columns;
+    }
+
+    // Block holding tick number i
+    blockOf(i) {
+      let low = 0;
+      let high = this.blockCount - 1;
+      while (low < high) {
+        const mid = (low + high + 1) >> 1;
+        if (this.blocks[mid].firstTick <= i) low = mid;
+        else high = mid - 1;
+      }
+      return low;
+    }
+
+    // Tick number i in the CSV player's shape: { timestamp, price, volume, side }
+    tradeAt(i) {
+      let c = this.current;
+      if (!c || i < c.first || i >= c.first + c.ticks) c = this.current = this.block(this.blockOf(i));
+      const j = i - c.first;
+      return {
+        timestamp: c.base + c.time[j],
+        price: Math.round(c.price[j] * this.tickSize * this.scale) / this.scale,
+        volume: c.volume[j],
+        side: (c.side[j >> 3] >> (j & 7)) & 1 ? "ASK" : "BID"
+      };
+    }
+
+    // Number of the first tick at or after ts (tickCount if none): the
+    // directory picks the block, its time column is binary-searched
+    findIndex(ts) {
+      let low = 0;
+      let high = this.blockCount;
+      while (low < high) {
+        const mid = (low + high) >> 1;
+        if (this.blocks[mid].maxTs < ts) low = mid + 1;
+        else high = mid;
+      }
+      if (low === this.blockCount) return this.tickCount;
+
+      const c = this.block(low);
+      const target = ts - c.base;
+      let first = 0;
+      let last = c.ticks;
+      while (first < last) {
+        const mid = (first + last) >> 1;
+        if (c.time[mid] < target) first = mid + 1;
+        else last = mid;
+      }
+      return c.first + first;
+    }
+  }
+
+  // Parses CSV playback rows (timestamp,price,volume,side) one line at a time
+  function forEachCsvTick(filePath, onTick) {
+    const text = fs.readFileSync(filePath, "latin1");
+    let start = text.indexOf("\n") + 1;
+    while (start > 0 && start < text.length) {
+      let end = text.indexOf("\n", start);
+      if (end < 0) end = text.length;
+      const values = text.slice(start, end).split(",");
+      if (values.length >= 4) {
+        onTick({ ts: parseInt(values[0], 10), p: parseFloat(values[1]), v: parseFloat(values[2]), s: values[3].trim() });
+      }
+      start = end + 1;
+    }
+  }
+
+  // Most digits after the decimal point in the price column
+  function csvPriceDecimals(filePath) {
+    const text = fs.readFileSync(filePath, "latin1");
+    let decimals = 0;
+    let start = text.indexOf("\n") + 1;
+    while (start > 0 && start < text.length) {
+      let end = text.indexOf("\n", start);
+      if (end < 0) end = text.length;
+      const values = text.slice(start, end).split(",");
+      if (values.length >= 4) {
+        const price = values[1].trim();
+        const point = price.indexOf(".");
+        if (point >= 0) decimals = Math.max(decimals, price.length - point - 1);
+      }
+      start = end + 1;
+    }
+    return decimals;
+  }
+
+  function main(args) {
+    const positional = [];
+    const options = {};
+    for (let i = 0; i < args.length; i++) {
+      if (args[i] === "--tick-size" || args[i] === "--decimals") options[args[i]] = Number(args[++i]);
+      else positional.push(args[i]);
+    }
+
+    const [input, output] = positional;
+    const tickSize = options["--tick-size"];
+    const decimals = options["--decimals"];
+    if (!input || !output || (tickSize !== undefined && !(tickSize > 0))
+      || (decimals !== undefined && !(Number.isInteger(decimals) && decimals >= 0 && decimals <= 15))) {
+      console.error("Usage: node tradeflow-archive.js <in.csv | in.tfr | recording directory> <out.tfa> [--tick-size 0.25] [--decimals 2]");
+      process.exit(1);
+    }
+
+    const started = Date.now();
+    let writer;
+    if (input.toLowerCase().endsWith(".csv")) {
+      // Unless given, the grid is one unit of the most precise price in the file
+      const csvDecimals = decimals !== undefined ? decimals : csvPriceDecimals(input);
+      const csvTickSize = tickSize !== undefined ? tickSize : Number((10 ** -csvDecimals).toFixed(csvDecimals));
+      writer = new ArchiveWriter(output, { tickSize: csvTickSize, decimals: csvDecimals });
+      forEachCsvTick(input, (tick) => writer.add(tick));
+    } else {
+      const { RecordingSegment, listSegments } = require("../server/tradeflow-recording");
+      for (const file of listSegments(input)) {
+        const segment = new RecordingSegment(file, { recover: true });
+        const h = segment.header;
+        if (!writer) {
+          writer = new ArchiveWriter(output, {
+            symbol: h.symbol,
+            tickSize: tickSize !== undefined ? tickSize : h.tickSize,
+            decimals: decimals !== undefined ? decimals : h.decimals
+          });
+        }
+        segment.forEach((tick) => writer.add(tick));
+        segment.close();
+      }
+      if (!writer) throw new Error(`No recordings in ${input}`);
+    }
+
+    const count = writer.finish();
+    console.log(`✓ Wrote ${count} ticks in ${writer.directory.length} blocks to ${output} (${Date.now() - started} ms)`);
+  }
+
+  const TradeFlowArchive = {
+    ArchiveWriter,
+    ArchiveReader,
+    forEachCsvTick,
+    csvPriceDecimals
+  };
+
+  if (typeof module !== "undefined" && module.exports) {
+    module.exports = TradeFlowArchive;
+    if (!root && require.main === module) main(process.argv.slice(2));
+  }
+  if (root) {
+    root.TradeFlowArchive = TradeFlowArchive;
+  }
+})(typeof window !== "undefined" ? window : null);
@@ -0,0 +1,806 @@
+// tradeflow-wire.js
+// Streaming decoder for the TradeFlow exporter output.
+// Accepts either newline-delimited JSON or the binary framing defined in
+// acsil/TradeFlowWire.h, detected from the first byte of the stream, and
+// emits ticks in the JSON shape: { seq, ts, p, v, s, sym }, plus us
+// (microseconds since the Unix epoch) when the exporter sends them.
+// Multicast datagrams (acsil/TradeFlowMulticast.h) go through pushDatagram.
+// Usable from Node (require) and from the browser (window.TradeFlowWire).
+
+(function (root) {
+  const WIRE_MAGIC = 0x574c4654;          // "TFLW"
+  const WIRE_VERSION = 1;
+
+  const FRAME_HEADER_SIZE = 8;
+  const FRAME_SYMBOL = 1;
+  const FRAME_TICKS = 2;
+  const FRAME_SUMMARY = 3;
+  const FRAME_AGGREGATE = 4;
+  const FRAME_QUOTES = 5;
+  const FRAME_STATS = 6;
+  const FRAME_TIMING = 7;
+  const FRAME_HEARTBEAT = 8;
+  const FRAME_COMPACT_TICKS = 9;
+  const FRAME_FOOTPRINT = 10;
+  const FRAME_SEQUENCE = 11;
+  const FRAME_TRADE_EVENT = 12;
+  const FRAME_SNAPSHOT = 13;
+  const FRAME_SNAPSHOT_END = 14;
+
+  const SYMBOL_DEF_SIZE = 12;
+  const TICK_SIZE = 32;
+  const SUMMARY_SIZE = 72;
+  const AGGREGATE_SIZE = 48;
+  const QUOTE_HEADER_SIZE = 12;
+  const STATS_SIZE = 80;
+  const TIMING_SIZE = 40;
+  const HEARTBEAT_SIZE = 8;
+  const FOOTPRINT_HEADER_SIZE = 24;
+  const FOOTPRINT_LEVEL_SIZE = 12;
+  const SEQUENCE_SIZE = 16;
+  const TRADE_EVENT_SIZE = 40;
+  const SNAPSHOT_HEADER_SIZE = 16;
+  const SNAPSHOT_TRADE_SIZE = 12;
+  const SNAPSHOT_END_SIZE = 24;
+
+  // Multicast datagrams: a packet header, then whole frames
+  const MULTICAST_MAGIC = 0x4d434654;     // "TFCM"
+  const MULTICAST_VERSION = 1;
+  const MULTICAST_HEADER_SIZE = 24;
+  const MULTICAST_RETRANSMIT = 1;
+
+  // Quote record field bits, in the order the fields follow the header
+  const QUOTE_BID_PRICE = 1;
+  const QUOTE_ASK_PRICE = 2;
+  const QUOTE_BID_SIZE = 4;
+  const QUOTE_ASK_SIZE = 8;
+  const QUOTE_KEYFRAME = 1;
+  const FOOTPRINT_SNAPSHOT = 1;
+  const TRADE_EVENT_SWEEP = 1;
+  const SNAPSHOT_ASK = 0x80000000;
+
+  const JSON_QUOTE_PREFIX = '{"type":"quote"';
+
+  const SIDE_ASK = 1;
+  const TICK_MICROSECONDS = 1;
+
+  // Compact ticks frames (acsil/TradeFlowCompact.h)
+  const COMPACT_VARINT = 0;
+  const COMPACT_VARINT_LZ4 = 1;
+  const COMPACT_ASK = 1;
+  const COMPACT_SEQUENCE_GAP = 2;
+  const COMPACT_SYMBOL = 4;
+  const COMPACT_PRINTS = 8;
+  const COMPACT_MICROSECONDS = 16;
+
+  const TWO_POW_32 = 4294967296;
+
+  // Little-endian int64 as a Number (exact up to 2^53)
+  function readInt64(view, offset) {
+    const lo = view.getUint32(offset, true);
+    const hi = view.getInt32(offset + 4, true);
+    return hi * TWO_POW_32 + lo;
+  }
+
+  function unzigzag(n) {
+    return n % 2 === 1 ? -(n + 1) / 2 : n / 2;
+  }
+
+  // Decodes one LZ4 block from src[start, end) into dst. Returns the bytes
+  // written, or -1 if the block is malformed or does not fit.
+  function lz4DecodeBlock(src, start, end, dst) {
+    let s = start;
+    let d = 0;
+    while (s < end) {
+      const token = src[s++];
+
+      let literals = token >> 4;
+      if (literals === 15) {
+        let b;
+        do {
+          if (s >= end) return -1;
+          b = src[s++];
+          literals += b;
+        } while (b === 255);
+      }
+      if (s + literals > end || d + literals > dst.length) return -1;
+      for (let i = 0; i < literals; i++) dst[d++] = src[s++];
+
+      // The last sequence is literals only
+      if (s >= end) break;
+      if (s + 2 > end) return -1;
+      const offset = src[s] | (src[s + 1] << 8);
+      s += 2;
+      if (offset === 0 || offset > d) return -1;
+
+      let match = (token & 15) + 4;
+      if ((token & 15) === 15) {
+        let b;
+        do {
+          if (s >= end) return -1;
+          b = src[s++];
+          match += b;
+        } while (b === 255);
+      }
+      if (d + match > dst.length) return -1;
+
+      // Byte by byte: a match may overlap what it is copying
+      for (let m = d - offset, i = 0; i < match; i++) dst[d++] = dst[m++];
+    }
+    return d;
+  }
+
+  class WireDecoder {
+    // handlers: { onTick(tick), onSummary(summary), onAggregate(agg), onQuote(quote), onStats(stats), onTiming(timing), onSymbol(def), onSequence(seq), onTradeEvent(event), onSnapshot(snapshot), onSnapshotEnd(end), onError(err) }
+    // Quotes are changes-only (see _decodeQuotes); without onQuote they are
+    // skipped without being parsed.
+    constructor(handlers = {}) {
+      this.handlers = handlers;
+      this.compactBody = new Uint8Array(0);   // LZ4 output, reused across frames
+      this.pos = 0;                           // Read position within a compact frame
+      this.reset();
+    }
+
+    // Call when a new connection starts; the format is re-detected
+    reset() {
+      this.mode = null;                   // null (undetected) | "json" | "binary"
+      this.text = "";
+      this.textDecoder = null;
+      this.pending = null;                // Uint8Array of unconsumed binary bytes
+      this.headerSeen = false;
+      this.version = 0;
+      this.symbols = new Map();           // SymbolId -> { id, name, tickSize, decimals }
+    }
+
+    push(chunk) {
+      const bytes = chunk instanceof Uint8Array ? chunk : new Uint8Array(chunk);
+      if (bytes.length === 0) return;
+
+      if (this.mode === null) {
+        this.mode = bytes[0] === 0x54 ? "binary" : "json";   // 'T' of "TFLW"
+      }
+
+      if (this.mode === "json") this._pushJson(bytes);
+      else this._pushBinary(bytes);
+    }
+
+    // -----------------------------
+    // JSON lines
+    // -----------------------------
+    _pushJson(bytes) {
+      if (!this.textDecoder) this.textDecoder = new TextDecoder("utf-8");
+      this.text += this.textDecoder.decode(bytes, { stream: true });
+
+      let start = 0;
+      let newlineIndex;
+      while ((newlineIndex = this.text.indexOf("\n", start)) !== -1) {
+        const line = this.text.substring(start, newlineIndex).trim();
+        start = newlineIndex + 1;
+
+        if (!line) continue;
+        if (!this.handlers.onQuote && line.startsWith(JSON_QUOTE_PREFIX)) continue;
+
+        let msg;
+        try {
+          msg = JSON.parse(line);
+        } catch (err) {
+          this._error(new Error(`Failed to parse: ${line}`));
+          continue;
+        }
+
+        if (msg.type === "summary") this._emit("onSummary", msg);
+        else if (msg.type === "aggregate") this._emit("onAggregate", msg);
+        else if (msg.type === "quote") this._emit("onQuote", msg);
+        else if (msg.type === "stats") this._emit("onStats", msg);
+        else if (msg.type === "timing") this._emit("onTiming", msg);
+        else if (msg.type === "heartbeat") this._emit("onHeartbeat", msg);
+        else if (msg.type === "footprint") this._emit("onFootprint", msg);
+        else if (msg.type === "event") this._emit("onTradeEvent", msg);
+        else if (msg.type === "snapshot") {
+          if (this.handlers.onSnapshot) this._emit("onSnapshot", this._snapshotFromJson(msg));
+        }
+        else if (msg.type === "snapshotEnd") {
+          msg.ts = Math.floor(msg.us / 1000);
+          this._emit("onSnapshotEnd", msg);
+        }
+        else {
+          // Microseconds only: derive the millisecond field consumers expect
+          if (msg.ts === undefined && msg.us !== undefined) msg.ts = Math.floor(msg.us / 1000);
+          this._emit("onTick", msg);
+        }
+      }
+
+      this.text = start > 0 ? this.text.substring(start) : this.text;
+    }
+
+    // -----------------------------
+    // Binary frames
+    // -----------------------------
+    _pushBinary(bytes) {
+      let buf = bytes;
+      if (this.pending && this.pending.length) {
+        buf = new Uint8Array(this.pending.length + bytes.length);
+        buf.set(this.pending, 0);
+        buf.set(bytes, this.pending.length);
+      }
+
+      const view = new DataView(buf.buffer, buf.byteOffset, buf.byteLength);
+      let offset = 0;
+
+      if (!this.headerSeen) {
+        if (buf.length < 8) {
+          this.pending = buf;
+          return;
+        }
+
+        const magic = view.getUint32(0, true);
+        const version = view.getUint16(4, true);
+        const headerSize = view.getUint16(6, true);
+
+        if (magic !== WIRE_MAGIC || version !== WIRE_VERSION || headerSize < 8) {
+          this._error(new Error(`Unsupported stream header (magic 0x${magic.toString(16)}, version ${version})`));
+          this.pending = null;
+          this.mode = "invalid";
+          return;
+        }
+
+        if (buf.length < headerSize) {
+          this.pending = buf;
+          return;
+        }
+
+        this.version = version;
+        this.headerSeen = true;
+        offset = headerSize;
+      }
+
+      while (buf.length - offset >= FRAME_HEADER_SIZE) {
+        const type = view.getUint16(offset, true);
+        const length = view.getUint32(offset + 4, true);
+        if (buf.length - offset - FRAME_HEADER_SIZE < length) break;
+
+        this._decodeFrame(type, view, offset + FRAME_HEADER_SIZE, length);
+        offset += FRAME_HEADER_SIZE + length;
+      }
+
+      // Copy the partial frame so the caller's chunk can be released
+      this.pending = offset < buf.length ? buf.slice(offset) : null;
+    }
+
+    // One multicast datagram. Every datagram stands alone apart from the
+    // symbol definitions, so use one decoder per exporter (source ID).
+    // Returns { sourceId, retransmitPort, retransmit, packetSeq }, or null if
+    // the datagram is not from a compatible exporter.
+    pushDatagram(chunk) {
+      const bytes = chunk instanceof Uint8Array ? chunk : new Uint8Array(chunk);
+      if (bytes.length < MULTICAST_HEADER_SIZE) return null;
+
+      const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+      const magic = view.getUint32(0, true);
+      const version = view.getUint16(4, true);
+      const wireVersion = view.getUint16(6, true);
+      if (magic !== MULTICAST_MAGIC || version !== MULTICAST_VERSION || wireVersion !== WIRE_VERSION) {
+        this._error(new Error(`Unsupported multicast datagram (magic 0x${magic.toString(16)}, version ${version}/${wireVersion})`));
+        return null;
+      }
+
+      const packet = {
+        sourceId: view.getUint32(8, true),
+        retransmitPort: view.getUint16(12, true),
+        retransmit: (view.getUint16(14, true) & MULTICAST_RETRANSMIT) !== 0,
+        packetSeq: readInt64(view, 16)
+      };
+
+      let offset = MULTICAST_HEADER_SIZE;
+      while (bytes.length - offset >= FRAME_HEADER_SIZE) {
+        const type = view.getUint16(offset, true);
+        const length = view.getUint32(offset + 4, true);
+        if (bytes.length - offset - FRAME_HEADER_SIZE < length) break;
+
+        this._decodeFrame(type, view, offset + FRAME_HEADER_SIZE, length);
+        offset += FRAME_HEADER_SIZE + length;
+      }
+      return packet;
+    }
+
+    _decodeFrame(type, view, offset, length) {
+      if (type === FRAME_TICKS) {
+        const end = offset + length - (length % TICK_SIZE);
+        for (let o = offset; o < end; o += TICK_SIZE) {
+          this._emit("onTick", this._decodeTick(view, o));
+        }
+        return;
+      }
+
+      if (type === FRAME_COMPACT_TICKS) {
+        this._decodeCompactTicks(view, offset, length);
+        return;
+      }
+
+      if (type === FRAME_SYMBOL) {
+        if (length < SYMBOL_DEF_SIZE) return;
+
+        const id = view.getUint16(offset, true);
+        const nameLength = view.getUint8(offset + 2);
+        const decimals = view.getUint8(offset + 3);
+        const tickSize = view.getFloat64(offset + 4, true);
+
+        let name = "";
+        const nameStart = offset + SYMBOL_DEF_SIZE;
+        for (let i = 0; i < nameLength && nameStart + i < offset + length; i++) {
+          name += String.fromCharCode(view.getUint8(nameStart + i));
+        }
+
+        const def = { id, name, tickSize, decimals, scale: Math.pow(10, decimals) };
+        this.symbols.set(id, def);
+        this._emit("onSymbol", def);
+        return;
+      }
+
+      if (type === FRAME_SUMMARY) {
+        if (length < SUMMARY_SIZE) return;
+        this._emit("onSummary", this._decodeSummary(view, offset));
+        return;
+      }
+
+      if (type === FRAME_AGGREGATE) {
+        if (length < AGGREGATE_SIZE) return;
+        this._emit("onAggregate", this._decodeAggregate(view, offset, length));
+        return;
+      }
+
+      if (type === FRAME_QUOTES) {
+        if (this.handlers.onQuote) this._decodeQuotes(view, offset, length);
+        return;
+      }
+
+      if (type === FRAME_FOOTPRINT) {
+        if (length < FOOTPRINT_HEADER_SIZE || !this.handlers.onFootprint) return;
+        this._emit("onFootprint", this._decodeFootprint(view, offset, length));
+        return;
+      }
+
+      if (type === FRAME_STATS) {
+        if (length < STATS_SIZE) return;
+        this._emit("onStats", this._decodeStats(view, offset));
+        return;
+      }
+
+      if (type === FRAME_TIMING) {
+        if (length < TIMING_SIZE) return;
+        this._emit("onTiming", {
+          type: "timing",
+          seq0: readInt64(view, offset),
+          seq1: readInt64(view, offset + 8),
+          tq: readInt64(view, offset + 16),
+          tx: readInt64(view, offset + 24),
+          sym: this._symbol(view.getUint16(offset + 32, true)).name
+        });
+        return;
+      }
+
+      if (type === FRAME_SEQUENCE) {
+        if (length < SEQUENCE_SIZE) return;
+        this._emit("onSequence", {
+          type: "sequence",
+          seq: readInt64(view, offset),
+          sym: this._symbol(view.getUint16(offset + 8, true)).name
+        });
+        return;
+      }
+
+      if (type === FRAME_TRADE_EVENT) {
+        if (length < TRADE_EVENT_SIZE) return;
+        this._emit("onTradeEvent", this._decodeTradeEvent(view, offset));
+        return;
+      }
+
+      if (type === FRAME_SNAPSHOT) {
+        if (length < SNAPSHOT_HEADER_SIZE || !this.handlers.onSnapshot) return;
+        this._emit("onSnapshot", this._decodeSnapshot(view, offset, length));
+        return;
+      }
+
+      if (type === FRAME_SNAPSHOT_END) {
+        if (length < SNAPSHOT_END_SIZE) return;
+        const us = readInt64(view, offset);
+        this._emit("onSnapshotEnd", {
+          type: "snapshotEnd",
+          ts: Math.floor(us / 1000),
+          us,
+          seq: readInt64(view, offset + 8),
+          n: view.getUint32(offset + 16, true),
+          sym: this._symbol(view.getUint16(offset + 20, true)).name
+        });
+        return;
+      }
+
+      if (type === FRAME_HEARTBEAT) {
+        if (length < HEARTBEAT_SIZE) return;
+        this._emit("onHeartbeat", { type: "heartbeat", ts: readInt64(view, offset) });
+        return;
+      }
+
+      // Unknown frame types are skipped so newer exporters stay readable
+    }
+
+    _symbol(id) {
+      return this.symbols.get(id) || { id, name: "", tickSize: 1, decimals: 0, scale: 1 };
+    }
+
+    _price(ticks, def) {
+      return Math.round(ticks * def.tickSize * def.scale) / def.scale;
+    }
+
+    _decodeTick(view, o) {
+      const def = this._symbol(view.getUint16(o + 24, true));
+      const tick = {
+        seq: readInt64(view, o),
+        ts: readInt64(view, o + 8),
+        p: this._price(view.getInt32(o + 16, true), def),
+        v: view.getUint32(o + 20, true),
+        s: view.getUint8(o + 26) === SIDE_ASK ? "ASK" : "BID",
+        sym: def.name
+      };
+
+      if (view.getUint8(o + 27) & TICK_MICROSECONDS) {
+        tick.us = tick.ts;
+        tick.ts = Math.floor(tick.us / 1000);
+      }
+
+      // Merged prints, only when more than one, as in the JSON format
+      const prints = view.getUint32(o + 28, true);
+      if (prints > 1) tick.n = prints;
+      return tick;
+    }
+
+    // Ticks as deltas against the previous tick of the frame, decoded
+    // straight into the same shape as _decodeTick
+    _decodeCompactTicks(view, offset, length) {
+      if (length < 1) return;
+
+      let bytes = new Uint8Array(view.buffer, view.byteOffset + offset, length);
+      let end = length;
+      this.pos = 1;
+
+      if (bytes[0] === COMPACT_VARINT_LZ4) {
+        const bodyLength = this._readVarint(bytes, end);
+        if (this.compactBody.length < bodyLength) {
+          this.compactBody = new Uint8Array(Math.max(bodyLength, this.compactBody.length * 2));
+        }
+        if (this.pos > end || lz4DecodeBlock(bytes, this.pos, end, this.compactBody) !== bodyLength) {
+          this._error(new Error("Corrupt compressed ticks frame"));
+          return;
+        }
+        bytes = this.compactBody;
+        end = bodyLength;
+        this.pos = 0;
+      } else if (bytes[0] !== COMPACT_VARINT) {
+        return;
+      }
+
+      let seq = 0;
+      let ts = 0;
+      let priceTicks = 0;
+      let volume = 0;
+      let def = this._symbol(0);
+
+      while (this.pos < end) {
+        const flags = bytes[this.pos++];
+        seq += (flags & COMPACT_SEQUENCE_GAP) ? unzigzag(this._readVarint(bytes, end)) : 1;
+        if (flags & COMPACT_SYMBOL) def = this._symbol(this._readVarint(bytes, end));
+        ts += unzigzag(this._readVarint(bytes, end));
+        priceTicks += unzigzag(this._readVarint(bytes, end));
+        volume += unzigzag(this._readVarint(bytes, end));
+        const prints = (flags & COMPACT_PRINTS) ? this._readVarint(bytes, end) : 1;
+
+        if (this.pos > end) {
+          this._error(new Error("Truncated compact ticks frame"));
+          return;
+        }
+
+        const tick = {
+          seq,
+          ts,
+          p: this._price(priceTicks, def),
+          v: volume,
+          s: (flags & COMPACT_ASK) ? "ASK" : "BID",
+          sym: def.name
+        };
+        if (flags & COMPACT_MICROSECONDS) {
+          tick.us = ts;
+          tick.ts = Math.floor(ts / 1000);
+        }
+        if (prints > 1) tick.n = prints;
+        this._emit("onTick", tick);
+      }
+    }
+
+    // Base-128 varint at this.pos, as a Number (exact up to 2^53). Past end,
+    // leaves this.pos beyond it.
+    _readVarint(bytes, end) {
+      let value = 0;
+      let scale = 1;
+      let b;
+      do {
+        if (this.pos >= end) {
+          this.pos = end + 1;
+          return 0;
+        }
+        b = bytes[this.pos++];
+        value += (b & 0x7f) * scale;
+        scale *= 128;
+      } while (b & 0x80);
+      return value;
+    }
+
+    _decodeSummary(view, o) {
+      const def = this._symbol(view.getUint16(o + 68, true));
+      return {
+        type: "summary",
+        seq0: readInt64(view, o),
+        seq1: readInt64(view, o + 8),
+        ts0: readInt64(view, o + 16),
+        ts1: readInt64(view, o + 24),
+        bv: readInt64(view, o + 32),
+        av: readInt64(view, o + 40),
+        n: view.getUint32(o + 48, true),
+        bn: view.getUint32(o + 52, true),
+        an: view.getUint32(o + 56, true),
+        hi: this._price(view.getInt32(o + 60, true), def),
+        lo: this._price(view.getInt32(o + 64, true), def),
+        sym: def.name
+      };
+    }
+
+    // Same shape as the JSON line: { type, ts, p, w: [{ ms, bn, an, bv, av }], sym }
+    _decodeAggregate(view, offset, length) {
+      const def = this._symbol(view.getUint16(offset + 40, true));
+      const windows = [];
+      const end = offset + length - (length % AGGREGATE_SIZE);
+      for (let o = offset; o < end; o += AGGREGATE_SIZE) {
+        windows.push({
+          ms: view.getUint32(o + 24, true),
+          bn: view.getUint32(o + 28, true),
+          an: view.getUint32(o + 32, true),
+          bv: readInt64(view, o + 8),
+          av: readInt64(view, o + 16)
+        });
+      }
+
+      return {
+        type: "aggregate",
+        ts: readInt64(view, offset),
+        p: this._price(view.getInt32(offset + 36, true), def),
+        w: windows,
+        sym: def.name
+      };
+    }
+
+    // Records carry only the fields that changed since the previous record for
+    // the symbol; keyframes (k: 1) carry all four. Same shape as the JSON line:
+    // { type, ts, k?, b?, a?, bs?, as?, sym }
+    _decodeQuotes(view, offset, length) {
+      const end = offset + length;
+      let o = offset;
+
+      while (end - o >= QUOTE_HEADER_SIZE) {
+        const fields = view.getUint8(o + 10);
+        let size = QUOTE_HEADER_SIZE;
+        for (let bit = 1; bit <= QUOTE_ASK_SIZE; bit <<= 1) {
+          if (fields & bit) size += 4;
+        }
+        if (end - o < size) break;
+
+        const def = this._symbol(view.getUint16(o + 8, true));
+        const quote = { type: "quote", ts: readInt64(view, o) };
+        if (view.getUint8(o + 11) & QUOTE_KEYFRAME) quote.k = 1;
+
+        let f = o + QUOTE_HEADER_SIZE;
+        if (fields & QUOTE_BID_PRICE) { quote.b = this._price(view.getInt32(f, true), def); f += 4; }
+        if (fields & QUOTE_ASK_PRICE) { quote.a = this._price(view.getInt32(f, true), def); f += 4; }
+        if (fields & QUOTE_BID_SIZE) { quote.bs = view.getUint32(f, true); f += 4; }
+        if (fields & QUOTE_ASK_SIZE) { quote.as = view.getUint32(f, true); f += 4; }
+        quote.sym = def.name;
+
+        this._emit("onQuote", quote);
+        o += size;
+      }
+    }
+
+    // Changed levels, or every level with k: 1 (snapshot). Same shape as the
+    // JSON line: { type, ts, s0, k?, l: [[price, bidVolume, askVolume]], sym }
+    _decodeFootprint(view, offset, length) {
+      const def = this._symbol(view.getUint16(offset + 20, true));
+      const count = Math.min(view.getUint32(offset + 16, true),
+        Math.floor((length - FOOTPRINT_HEADER_SIZE) / FOOTPRINT_LEVEL_SIZE));
+
+      const levels = new Array(count);
+      for (let i = 0, o = offset + FOOTPRINT_HEADER_SIZE; i < count; i++, o += FOOTPRINT_LEVEL_SIZE) {
+        levels[i] = [this._price(view.getInt32(o, true), def), view.getUint32(o + 4, true), view.getUint32(o + 8, true)];
+      }
+
+      const footprint = { type: "footprint", ts: readInt64(view, offset), s0: readInt64(view, offset + 8) };
+      if (view.getUint8(offset + 22) & FOOTPRINT_SNAPSHOT) footprint.k = 1;
+      footprint.l = levels;
+      footprint.sym = def.name;
+      return footprint;
+    }
+
+    // Recent trades sent on connect, oldest first, in the tick shape without
+    // seq: { type: "snapshot", trades: [{ ts, us, p, v, s }], sym }. A symbol's
+    // snapshot may come in several parts; onSnapshotEnd follows the last.
+    _decodeSnapshot(view, offset, length) {
+      const def = this._symbol(view.getUint16(offset + 12, true));
+      const base = readInt64(view, offset);
+      const count = Math.min(view.getUint32(offset + 8, true),
+        Math.floor((length - SNAPSHOT_HEADER_SIZE) / SNAPSHOT_TRADE_SIZE));
+
+      const trades = new Array(count);
+      for (let i = 0, o = offset + SNAPSHOT_HEADER_SIZE; i < count; i++, o += SNAPSHOT_TRADE_SIZE) {
+        const us = base + view.getUint32(o, true);
+        const volumeSide = view.getUint32(o + 8, true);
+        trades[i] = {
+          ts: Math.floor(us / 1000),
+          us,
+          p: this._price(view.getInt32(o + 4, true), def),
+          v: volumeSide & 0x7fffffff,
+          s: volumeSide & SNAPSHOT_ASK ? "ASK" : "BID"
+        };
+      }
+      return { type: "snapshot", trades, sym: def.name };
+    }
+
+    // The JSON line's "t": [[offset us, price, volume, side]] in the same shape
+    _snapshotFromJson(msg) {
+      const rows = Array.isArray(msg.t) ? msg.t : [];
+      const trades = new Array(rows.length);
+      for (let i = 0; i < rows.length; i++) {
+        const us = msg.us + rows[i][0];
+        trades[i] = { ts: Math.floor(us / 1000), us, p: rows[i][1], v: rows[i][2], s: rows[i][3] === 1 ? "ASK" : "BID" };
+      }
+      return { type: "snapshot", trades, sym: msg.sym };
+    }
+
+    // Sweep or block trade. Same shape as the JSON line:
+    // { type, ts, us, e: "sweep" | "block", s, p0, p1, l, v, n, d, sym }
+    _decodeTradeEvent(view, o) {
+      const def = this._symbol(view.getUint16(o + 36, true));
+      const us = readInt64(view, o);
+      return {
+        type: "event",
+        ts: Math.floor(us / 1000),
+        us,
+        e: view.getUint8(o + 39) === TRADE_EVENT_SWEEP ? "sweep" : "block",
+        s: view.getUint8(o + 38) === SIDE_ASK ? "ASK" : "BID",
+        p0: this._price(view.getInt32(o + 24, true), def),
+        p1: this._price(view.getInt32(o + 28, true), def),
+        l: view.getUint32(o + 32, true),
+        v: readInt64(view, o + 8),
+        n: view.getUint32(o + 20, true),
+        d: view.getUint32(o + 16, true),
+        sym: def.name
+      };
+    }
+
+    // Same shape as the JSON line
+    _decodeStats(view, o) {
+      const def = this._symbol(view.getUint16(o + 72, true));
+      return {
+        type: "stats",
+        ts: readInt64(view, o),
+        ms: view.getUint32(o + 8, true),
+        calls: view.getUint32(o + 12, true),
+        ticks: readInt64(view, o + 16),
+        bytes: readInt64(view, o + 24),
+        p50: view.getUint32(o + 32, true),
+        p99: view.getUint32(o + 36, true),
+        max: view.getUint32(o + 40, true),
+        tpc: view.getUint32(o + 44, true),
+        wb: view.getUint32(o + 48, true),
+        conn: view.getUint32(o + 52, true),
+        backlog: readInt64(view, o + 56),
+        dropped: readInt64(view, o + 64),
+        merged: view.getUint32(o + 76, true),
+        sym: def.name
+      };
+    }
+
+    _emit(name, value) {
+      const fn = this.handlers[name];
+      if (fn) fn(value);
+    }
+
+    _error(err) {
+      if (this.handlers.onError) this.handlers.onError(err);
+    }
+  }
+
+  // Control lines a consumer writes back to the exporter right after it
+  // connects: the last sequence received for each symbol it has seen, then
+  // "ready". The exporter resends what followed from its history (see
+  // acsil/TradeFlowControl.h) before any live ticks.
+  function encodeResumeRequest(lastSequenceBySymbol) {
+    let lines = "";
+    lastSequenceBySymbol.forEach((seq, sym) => {
+      if (Number.isFinite(seq) && seq > 0) {
+        lines += JSON.stringify({ type: "resume", sym, seq }) + "\n";
+      }
+    });
+    return lines + JSON.stringify({ type: "ready" }) + "\n";
+  }
+
+  // Answer to an exporter heartbeat. An exporter that has heard from its
+  // consumer once expects one per heartbeat and reconnects when they stop.
+  const HEARTBEAT_REPLY = JSON.stringify({ type: "heartbeat" }) + "\n";
+
+  // Asks the exporter for a full footprint snapshot of sym, or of every
+  // symbol on the connection
+  function encodeFootprintRequest(sym) {
+    return JSON.stringify(sym ? { type: "footprint", sym } : { type: "footprint" }) + "\n";
+  }
+
+  // Narrows what the exporter sends for sym, or for every symbol if omitted:
+  // filter is { minVolume, stream: "ticks" | "aggregates" | "both" }. Replaces
+  // the previous filter. Ticks left out keep their sequence numbers.
+  function encodeFilterRequest(filter, sym) {
+    const message = { type: "filter" };
+    if (sym) message.sym = sym;
+    if (filter.minVolume > 0) message.minVolume = filter.minVolume;
+    if (filter.stream) message.stream = filter.stream;
+    return JSON.stringify(message) + "\n";
+  }
+
+  // Only the charts of these symbols send anything; an empty list for all
+  function encodeSubscribeRequest(symbols) {
+    return JSON.stringify({ type: "subscribe", syms: symbols.join(",") }) + "\n";
+  }
+
+  // Volume at price per symbol, rebuilt from footprint messages: a snapshot
+  // (k: 1) or a new session replaces the symbol's ladder, other messages
+  // update the levels they list
+  class FootprintBook {
+    constructor() {
+      this.books = new Map();   // sym -> { session, ts, levels: Map(price -> [bidVolume, askVolume]) }
+    }
+
+    apply(footprint) {
+      let book = this.books.get(footprint.sym);
+      if (!book || footprint.k || book.session !== footprint.s0) {
+        // A delta for a session we hold no snapshot of is still applied;
+        // the levels fill in as they trade or with the next snapshot
+        book = { session: footprint.s0, ts: footprint.ts, levels: new Map() };
+        this.books.set(footprint.sym, book);
+      }
+
+      book.ts = footprint.ts;
+      for (const [price, bidVolume, askVolume] of footprint.l) {
+        book.levels.set(price, [bidVolume, askVolume]);
+      }
+      return book;
+    }
+
+    get(sym) {
+      return this.books.get(sym);
+    }
+  }
+
+  const TradeFlowWire = {
+    WIRE_MAGIC,
+    WIRE_VERSION,
+    WireDecoder,
+    encodeResumeRequest,
+    encodeFootprintRequest,
+    encodeFilterRequest,
+    encodeSubscribeRequest,
+    FootprintBook,
+    HEARTBEAT_REPLY
+  };
+
+  if (typeof module !== "undefined" && module.exports) {
+    module.exports = TradeFlowWire;
+  }
+  if (root) {
+    root.TradeFlowWire = TradeFlowWire;
+  }
+})(typeof window !== "undefined" ? window : null);
@@ -62,7 +62,9 @@
     }
 
     normalizeTrade(trade) {
-      const timestamp = Number(trade.timestamp ?? trade.ts ?? Date.now());
+      // Microsecond stamps keep their precision as fractional milliseconds
+      const us = trade.timestampUs ?? trade.us;
+      const timestamp = us != null ? Number(us) / 1000 : Number(trade.timestamp ?? trade.ts ?? Date.now());
       const side = trade.side ?? trade.s;
       const volume = Number(trade.volume ?? trade.v ?? 0);
       const price = Number(trade.price ?? trade.p ?? NaN);
@@ -109,6 +111,11 @@
         }
       }
 
+      return this.computeFromTotals(nowTs, buyVol, sellVol, buyCount, sellCount);
+    }
+
+    // Derived stats from window totals (summed here or by the native engines)
+    computeFromTotals(nowTs, buyVol, sellVol, buyCount, sellCount) {
       const totalVol = buyVol + sellVol;
       const totalCount = buyCount + sellCount;
 
@@ -177,10 +184,9 @@
       return closest.imbalance;
     }
 
-    detectTransition(stats) {
+    detectTransition(stats, previousImb = this.getPreviousImbalance()) {
       const currentImb = stats.imbalance;
-      const previousImb = this.getPreviousImbalance();
-      
+
       if (previousImb === null) return null;
       
       const imbChange = currentImb - previousImb;
@@ -308,14 +314,25 @@
       // Update imbalance history every trade
       this.updateHistory(nowTs, stats.imbalance, stats.tradesPerSec);
 
+      return this.evaluate(nowTs, stats);
+    }
+
+    // Same as ingest(), for a trade already added to an external window and
+    // history (components/native-engines.js). previousImb is null when there
+    // is no history yet.
+    ingestTotals(nowTs, buyVol, sellVol, buyCount, sellCount, previousImb) {
+      return this.evaluate(nowTs, this.computeFromTotals(nowTs, buyVol, sellVol, buyCount, sellCount), previousImb);
+    }
+
+    evaluate(nowTs, stats, previousImb) {
       // Event pacing - don't spam
       if (nowTs - this.state.lastEventAt < this.config.minEventInterval) {
         return null;
       }
 
       // Detect if a transition occurred
-      const transition = this.detectTransition(stats);
-      
+      const transition = this.detectTransition(stats, previousImb);
+
       if (!transition) return null;
 
       // Update state
@@ -114,6 +114,24 @@ class VelocityPulseEngine {
     this._selectActiveSide(ts);
   }
 
+  // Seeds the baselines from rate samples of recent tape, oldest first, in
+  // the shape updateFromRates takes with ts on the tape's clock. No side is
+  // chosen and nothing fires; live updates carry on from the result.
+  warmUp(samples) {
+    for (const s of samples) {
+      this._updateBaseline('ASK', 'pace', Number(s.buyTradesPerSec) || 0, s.ts);
+      this._updateBaseline('BID', 'pace', Number(s.sellTradesPerSec) || 0, s.ts);
+      this._updateBaseline('ASK', 'vol', Number(s.buyVolPerSec) || 0, s.ts);
+      this._updateBaseline('BID', 'vol', Number(s.sellVolPerSec) || 0, s.ts);
+    }
+
+    const now = performance.now();
+    for (const side of ['BID', 'ASK']) {
+      this.state[side].pace.lastTs = now;
+      this.state[side].vol.lastTs = now;
+    }
+  }
+
   _alpha(dtMs) {
     const tau = Math.max(2000, this.config.baselineWindowMs);
     return 1 - Math.exp(-dtMs / tau);
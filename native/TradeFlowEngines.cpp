@@ -0,0 +1,394 @@
+// TradeFlowEngines.cpp
+// Node addon exposing the flow engines' rolling windows (TradeFlowWindows.h)
+// to the app. Plain N-API, so one build works across Node and Electron
+// versions.
+//
+// JS side:
+//   const engines = new FlowEngines({ eventWindowMs, ... });
+//   engines.stats                      Float64Array of STAT_COUNT slots, rewritten by each call below
+//   engines.ingest(ts, volume, isAsk, arrivalMs)
+//   engines.ingestBatch(ts, volume, sides, arrivalMs)   Float64Array columns in, one stats row per tick out
+//   engines.ingestWire(bytes, arrivalMs)                WireTick records in, one stats row per tick out
+//   engines.expireRates(nowMs)
+//   engines.configure({ ... }), engines.reset(), engines.resetEngines()
+//
+// components/native-engines.js wraps this for the app.
+
+#include <node_api.h>
+
+#include "TradeFlowWindows.h"
+
+// Throws and returns from the calling callback when a call fails
+#define NAPI_CALL(Env, Call)                                                \
+    do                                                                      \
+    {                                                                       \
+        if ((Call) != napi_ok)                                              \
+        {                                                                   \
+            const napi_extended_error_info* pInfo = NULL;                   \
+            napi_get_last_error_info((Env), &pInfo);                        \
+            bool Pending = false;                                           \
+            napi_is_exception_pending((Env), &Pending);                     \
+            if (!Pending)                                                   \
+                napi_throw_error((Env), NULL, (pInfo != NULL && pInfo->error_message != NULL) ? pInfo->error_message : "N-API call failed"); \
+            return NULL;                                                    \
+        }                                                                   \
+    } while (0)
+
+struct EnginesInstance
+{
+    FlowEngines Engines;
+    napi_ref StatsRef = NULL;
+    double* pStats = NULL;      // Backing store of the stats array, owned by V8
+};
+
+// Reads an optional number property; leaves Value alone when absent
+static bool ReadNumber(napi_env Env, napi_value Object, const char* Name, double& Value)
+{
+    bool Has = false;
+    if (napi_has_named_property(Env, Object, Name, &Has) != napi_ok || !Has)
+        return true;
+
+    napi_value Property;
+    if (napi_get_named_property(Env, Object, Name, &Property) != napi_ok)
+        return false;
+
+    napi_valuetype Type;
+    napi_typeof(Env, Property, &Type);
+    if (Type == napi_undefined)
+        return true;
+
+    return napi_get_value_double(Env, Property, &Value) == napi_ok;
+}
+
+static bool ReadBool(napi_env Env, napi_value Object, const char* Name, bool& Value)
+{
+    bool Has = false;
+    if (napi_has_named_property(Env, Object, Name, &Has) != napi_ok || !Has)
+        return true;
+
+    napi_value Property;
+    if (napi_get_named_property(Env, Object, Name, &Property) != napi_ok)
+        return false;
+
+    napi_value Coerced;
+    return napi_coerce_to_bool(Env, Property, &Coerced) == napi_ok && napi_get_value_bool(Env, Coerced, &Value) == napi_ok;
+}
+
+// Applies the given keys of a config object on top of Config
+static bool ReadConfig(napi_env Env, napi_value Object, FlowEnginesConfig& Config)
+{
+    napi_valuetype Type;
+    napi_typeof(Env, Object, &Type);
+    if (Type == napi_undefined || Type == napi_null)
+        return true;
+    if (Type != napi_object)
+    {
+        napi_throw_type_error(Env, NULL, "config must be an object");
+        return false;
+    }
+
+    const bool Ok =
+        ReadNumber(Env, Object, "eventWindowMs", Config.EventWindowMs) &&
+        ReadNumber(Env, Object, "eventMaxTrades", Config.EventMaxTrades) &&
+        ReadNumber(Env, Object, "transitionWindowMs", Config.TransitionWindowMs) &&
+        ReadNumber(Env, Object, "transitionMaxTrades", Config.TransitionMaxTrades) &&
+        ReadNumber(Env, Object, "transitionHistoryMs", Config.TransitionHistoryMs) &&
+        ReadNumber(Env, Object, "transitionLookbackMs", Config.TransitionLookbackMs) &&
+        ReadBool(Env, Object, "transitionCountMetric", Config.TransitionCountMetric) &&
+        ReadNumber(Env, Object, "rateWindowMs", Config.RateWindowMs);
+
+    if (!Ok)
+        napi_throw_type_error(Env, NULL, "config values must be numbers");
+    return Ok;
+}
+
+// Data and element count of a typed array argument of the expected type
+static bool GetTypedArray(napi_env Env, napi_value Value, napi_typedarray_type Expected, void** ppData, size_t& Length)
+{
+    bool IsTypedArray = false;
+    napi_is_typedarray(Env, Value, &IsTypedArray);
+    if (!IsTypedArray)
+        return false;
+
+    napi_typedarray_type Type;
+    napi_value ArrayBuffer;
+    size_t Offset;
+    if (napi_get_typedarray_info(Env, Value, &Type, &Length, ppData, &ArrayBuffer, &Offset) != napi_ok)
+        return false;
+
+    return Type == Expected;
+}
+
+// A new Float64Array of Length elements and its data
+static napi_value CreateFloat64Array(napi_env Env, size_t Length, double** ppData)
+{
+    napi_value ArrayBuffer;
+    void* pData = NULL;
+    if (napi_create_arraybuffer(Env, Length * sizeof(double), &pData, &ArrayBuffer) != napi_ok)
+        return NULL;
+
+    napi_value Array;
+    if (napi_create_typedarray(Env, napi_float64_array, Length, ArrayBuffer, 0, &Array) != napi_ok)
+        return NULL;
+
+    *ppData = static_cast<double*>(pData);
+    return Array;
+}
+
+static EnginesInstance* Unwrap(napi_env Env, napi_callback_info Info, size_t& ArgCount, napi_value* pArgs)
+{
+    napi_value This;
+    if (napi_get_cb_info(Env, Info, &ArgCount, pArgs, &This, NULL) != napi_ok)
+        return NULL;
+
+    void* pInstance = NULL;
+    if (napi_unwrap(Env, This, &pInstance) != napi_ok)
+        return NULL;
+
+    return static_cast<EnginesInstance*>(pInstance);
+}
+
+static void Finalize(napi_env Env, void* pData, void*)
+{
+    EnginesInstance* pInstance = static_cast<EnginesInstance*>(pData);
+    if (pInstance->StatsRef != NULL)
+        napi_delete_reference(Env, pInstance->StatsRef);
+    delete pInstance;
+}
+
+static napi_value Construct(napi_env Env, napi_callback_info Info)
+{
+    size_t ArgCount = 1;
+    napi_value Args[1];
+    napi_value This;
+    NAPI_CALL(Env, napi_get_cb_info(Env, Info, &ArgCount, Args, &This, NULL));
+
+    FlowEnginesConfig Config;
+    if (ArgCount >= 1 && !ReadConfig(Env, Args[0], Config))
+        return NULL;
+
+    EnginesInstance* pInstance = new EnginesInstance();
+    pInstance->Engines.Configure(Config);
+
+    // A V8-owned buffer rather than an external one: Electron does not allow
+    // external array buffers
+    napi_value Stats = CreateFloat64Array(Env, STAT_COUNT, &pInstance->pStats);
+    if (Stats == NULL)
+    {
+        delete pInstance;
+        return NULL;
+    }
+    for (int Index = 0; Index < STAT_COUNT; Index++)
+        pInstance->pStats[Index] = 0.0;
+    pInstance->pStats[STAT_TRANSITION_PREVIOUS_IMBALANCE] = std::numeric_limits<double>::quiet_NaN();
+
+    if (napi_wrap(Env, This, pInstance, Finalize, NULL, NULL) != napi_ok)
+    {
+        delete pInstance;
+        NAPI_CALL(Env, napi_generic_failure);
+    }
+    NAPI_CALL(Env, napi_create_reference(Env, Stats, 1, &pInstance->StatsRef));
+
+    napi_property_descriptor StatsProperty = { "stats", NULL, NULL, NULL, NULL, Stats, napi_enumerable, NULL };
+    NAPI_CALL(Env, napi_define_properties(Env, This, 1, &StatsProperty));
+
+    return This;
+}
+
+static napi_value Configure(napi_env Env, napi_callback_info Info)
+{
+    size_t ArgCount = 1;
+    napi_value Args[1];
+    EnginesInstance* pInstance = Unwrap(Env, Info, ArgCount, Args);
+    if (pInstance == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+
+    FlowEnginesConfig Config;
+    if (ArgCount >= 1 && !ReadConfig(Env, Args[0], Config))
+        return NULL;
+
+    pInstance->Engines.Configure(Config);
+    return NULL;
+}
+
+static napi_value Reset(napi_env Env, napi_callback_info Info)
+{
+    size_t ArgCount = 0;
+    EnginesInstance* pInstance = Unwrap(Env, Info, ArgCount, NULL);
+    if (pInstance == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+
+    pInstance->Engines.Reset();
+    return NULL;
+}
+
+static napi_value ResetEngines(napi_env Env, napi_callback_info Info)
+{
+    size_t ArgCount = 0;
+    EnginesInstance* pInstance = Unwrap(Env, Info, ArgCount, NULL);
+    if (pInstance == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+
+    pInstance->Engines.ResetEngines();
+    return NULL;
+}
+
+// ingest(ts, volume, isAsk, arrivalMs)
+static napi_value Ingest(napi_env Env, napi_callback_info Info)
+{
+    size_t ArgCount = 4;
+    napi_value Args[4];
+    EnginesInstance* pInstance = Unwrap(Env, Info, ArgCount, Args);
+    if (pInstance == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+    if (ArgCount < 4)
+    {
+        napi_throw_type_error(Env, NULL, "ingest(ts, volume, isAsk, arrivalMs)");
+        return NULL;
+    }
+
+    double Timestamp, Volume, ArrivalMs;
+    bool IsAsk;
+    NAPI_CALL(Env, napi_get_value_double(Env, Args[0], &Timestamp));
+    NAPI_CALL(Env, napi_get_value_double(Env, Args[1], &Volume));
+    NAPI_CALL(Env, napi_get_value_bool(Env, Args[2], &IsAsk));
+    NAPI_CALL(Env, napi_get_value_double(Env, Args[3], &ArrivalMs));
+
+    pInstance->Engines.Ingest(Timestamp, Volume, IsAsk, ArrivalMs, pInstance->pStats);
+    return NULL;
+}
+
+// ingestBatch(ts: Float64Array, volume: Float64Array, sides: Uint8Array (1 = ask), arrivalMs)
+static napi_value IngestBatch(napi_env Env, napi_callback_info Info)
+{
+    size_t ArgCount = 4;
+    napi_value Args[4];
+    EnginesInstance* pInstance = Unwrap(Env, Info, ArgCount, Args);
+    if (pInstance == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+
+    void* pTimestamps = NULL;
+    void* pVolumes = NULL;
+    void* pSides = NULL;
+    size_t Count = 0, VolumeCount = 0, SideCount = 0;
+    double ArrivalMs = 0.0;
+    if (ArgCount < 4 ||
+        !GetTypedArray(Env, Args[0], napi_float64_array, &pTimestamps, Count) ||
+        !GetTypedArray(Env, Args[1], napi_float64_array, &pVolumes, VolumeCount) ||
+        !GetTypedArray(Env, Args[2], napi_uint8_array, &pSides, SideCount) ||
+        napi_get_value_double(Env, Args[3], &ArrivalMs) != napi_ok ||
+        VolumeCount != Count || SideCount != Count)
+    {
+        napi_throw_type_error(Env, NULL, "ingestBatch(Float64Array ts, Float64Array volume, Uint8Array sides, arrivalMs) with equal lengths");
+        return NULL;
+    }
+
+    double* pRows = NULL;
+    napi_value Rows = CreateFloat64Array(Env, Count * STAT_COUNT, &pRows);
+    if (Rows == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+
+    const double* Timestamps = static_cast<const double*>(pTimestamps);
+    const double* Volumes = static_cast<const double*>(pVolumes);
+    const uint8_t* Sides = static_cast<const uint8_t*>(pSides);
+    for (size_t Index = 0; Index < Count; Index++)
+        pInstance->Engines.Ingest(Timestamps[Index], Volumes[Index], Sides[Index] == WIRE_SIDE_ASK, ArrivalMs, pRows + Index * STAT_COUNT);
+
+    if (Count > 0)
+    {
+        for (int Slot = 0; Slot < STAT_COUNT; Slot++)
+            pInstance->pStats[Slot] = pRows[(Count - 1) * STAT_COUNT + Slot];
+    }
+    return Rows;
+}
+
+// ingestWire(bytes: Uint8Array of WireTick records, arrivalMs)
+static napi_value IngestWire(napi_env Env, napi_callback_info Info)
+{
+    size_t ArgCount = 2;
+    napi_value Args[2];
+    EnginesInstance* pInstance = Unwrap(Env, Info, ArgCount, Args);
+    if (pInstance == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+
+    void* pBytes = NULL;
+    size_t Length = 0;
+    double ArrivalMs = 0.0;
+    if (ArgCount < 2 ||
+        !GetTypedArray(Env, Args[0], napi_uint8_array, &pBytes, Length) ||
+        napi_get_value_double(Env, Args[1], &ArrivalMs) != napi_ok ||
+        Length % sizeof(WireTick) != 0)
+    {
+        napi_throw_type_error(Env, NULL, "ingestWire(Uint8Array of whole WireTick records, arrivalMs)");
+        return NULL;
+    }
+
+    const size_t Count = Length / sizeof(WireTick);
+    double* pRows = NULL;
+    napi_value Rows = CreateFloat64Array(Env, Count * STAT_COUNT, &pRows);
+    if (Rows == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+
+    // Records may sit at any offset of the caller's buffer
+    const uint8_t* pRecords = static_cast<const uint8_t*>(pBytes);
+    for (size_t Index = 0; Index < Count; Index++)
+    {
+        WireTick Tick;
+        memcpy(&Tick, pRecords + Index * sizeof(WireTick), sizeof(WireTick));
+        pInstance->Engines.IngestWire(Tick, ArrivalMs, pRows + Index * STAT_COUNT);
+    }
+
+    if (Count > 0)
+    {
+        for (int Slot = 0; Slot < STAT_COUNT; Slot++)
+            pInstance->pStats[Slot] = pRows[(Count - 1) * STAT_COUNT + Slot];
+    }
+    return Rows;
+}
+
+// expireRates(nowMs)
+static napi_value ExpireRates(napi_env Env, napi_callback_info Info)
+{
+    size_t ArgCount = 1;
+    napi_value Args[1];
+    EnginesInstance* pInstance = Unwrap(Env, Info, ArgCount, Args);
+    if (pInstance == NULL)
+        NAPI_CALL(Env, napi_generic_failure);
+
+    double NowMs = 0.0;
+    if (ArgCount < 1 || napi_get_value_double(Env, Args[0], &NowMs) != napi_ok)
+    {
+        napi_throw_type_error(Env, NULL, "expireRates(nowMs)");
+        return NULL;
+    }
+
+    pInstance->Engines.ExpireRates(NowMs, pInstance->pStats);
+    return NULL;
+}
+
+static napi_value Init(napi_env Env, napi_value Exports)
+{
+    const napi_property_descriptor Methods[] =
+    {
+        { "configure", NULL, Configure, NULL, NULL, NULL, napi_default, NULL },
+        { "reset", NULL, Reset, NULL, NULL, NULL, napi_default, NULL },
+        { "resetEngines", NULL, ResetEngines, NULL, NULL, NULL, napi_default, NULL },
+        { "ingest", NULL, Ingest, NULL, NULL, NULL, napi_default, NULL },
+        { "ingestBatch", NULL, IngestBatch, NULL, NULL, NULL, napi_default, NULL },
+        { "ingestWire", NULL, IngestWire, NULL, NULL, NULL, napi_default, NULL },
+        { "expireRates", NULL, ExpireRates, NULL, NULL, NULL, napi_default, NULL }
+    };
+
+    napi_value Class;
+    NAPI_CALL(Env, napi_define_class(Env, "FlowEngines", NAPI_AUTO_LENGTH, Construct, NULL,
+        sizeof(Methods) / sizeof(Methods[0]), Methods, &Class));
+    NAPI_CALL(Env, napi_set_named_property(Env, Exports, "FlowEngines", Class));
+
+    napi_value StatCount;
+    NAPI_CALL(Env, napi_create_uint32(Env, STAT_COUNT, &StatCount));
+    NAPI_CALL(Env, napi_set_named_property(Env, Exports, "STAT_COUNT", StatCount));
+
+    return Exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,472 @@
+// TradeFlowWindows.h
+// Rolling-window statistics behind the app's flow engines (EventEngine,
+// TransitionDetectionEngine and the rate window feeding VelocityPulseEngine).
+// No Node dependencies; TradeFlowEngines.cpp exposes it to JS.
+//
+// Every tick is stored once in a struct-of-arrays ring. Each window is a
+// suffix of that ring with running totals: a tick is added when it arrives
+// and subtracted when it leaves, so no window is ever rescanned. Windows drop
+// ticks exactly like the JS engines' prune(): from the front while older than
+// the window, then down to the trade cap. Volumes are whole contracts, so the
+// running totals are exact and match the JS sums to the bit.
+//
+// The JS engines in components/ must be kept in step with this file.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "../acsil/TradeFlowWire.h"
+
+enum TickFlagEnum
+{
+    TICK_FLAG_ASK = 0x01,
+    TICK_FLAG_NO_TRADE_TIME = 0x02      // Timestamp was not a number; only arrival-time windows count it
+};
+
+// Which timestamp a window is measured against
+enum WindowClockEnum
+{
+    WINDOW_CLOCK_TRADE = 0,             // The trade's own timestamp (the engines)
+    WINDOW_CLOCK_ARRIVAL = 1            // When the app received it (the rate window)
+};
+
+// Recent ticks as columns. Positions count every tick ever pushed, so they
+// stay valid while the ring grows.
+class TickColumns
+{
+public:
+    TickColumns() { Allocate(1024); }
+
+    void Clear()
+    {
+        Begin = 0;
+        End = 0;
+    }
+
+    uint64_t GetBegin() const { return Begin; }
+    uint64_t GetEnd() const { return End; }
+
+    double Timestamp(uint64_t Position) const { return Timestamps[Position & Mask]; }
+    double Arrival(uint64_t Position) const { return Arrivals[Position & Mask]; }
+    double Volume(uint64_t Position) const { return Volumes[Position & Mask]; }
+    uint8_t Flags(uint64_t Position) const { return TickFlags[Position & Mask]; }
+
+    double Time(uint64_t Position, WindowClockEnum Clock) const
+    {
+        return (Clock == WINDOW_CLOCK_TRADE) ? Timestamp(Position) : Arrival(Position);
+    }
+
+    // Positions before OldestInUse are no longer part of any window
+    void Push(double NewTimestamp, double NewArrival, double NewVolume, uint8_t NewFlags, uint64_t OldestInUse)
+    {
+        Begin = OldestInUse;
+        if (End - Begin == Timestamps.size())
+            Allocate(Timestamps.size() * 2);
+
+        const uint64_t Slot = End & Mask;
+        Timestamps[Slot] = NewTimestamp;
+        Arrivals[Slot] = NewArrival;
+        Volumes[Slot] = NewVolume;
+        TickFlags[Slot] = NewFlags;
+        End++;
+    }
+
+private:
+    // Capacity is a power of two; live ticks keep their positions
+    void Allocate(size_t Capacity)
+    {
+        std::vector<double> NewTimestamps(Capacity), NewArrivals(Capacity), NewVolumes(Capacity);
+        std::vector<uint8_t> NewFlags(Capacity);
+        const uint64_t NewMask = Capacity - 1;
+
+        for (uint64_t Position = Begin; Position < End; Position++)
+        {
+            NewTimestamps[Position & NewMask] = Timestamp(Position);
+            NewArrivals[Position & NewMask] = Arrival(Position);
+            NewVolumes[Position & NewMask] = Volume(Position);
+            NewFlags[Position & NewMask] = Flags(Position);
+        }
+
+        Timestamps.swap(NewTimestamps);
+        Arrivals.swap(NewArrivals);
+        Volumes.swap(NewVolumes);
+        TickFlags.swap(NewFlags);
+        Mask = NewMask;
+    }
+
+    std::vector<double> Timestamps;
+    std::vector<double> Arrivals;
+    std::vector<double> Volumes;
+    std::vector<uint8_t> TickFlags;
+    uint64_t Mask = 0;
+    uint64_t Begin = 0;
+    uint64_t End = 0;
+};
+
+struct WindowTotals
+{
+    double BuyVolume = 0.0;
+    double SellVolume = 0.0;
+    double BuyCount = 0.0;
+    double SellCount = 0.0;
+};
+
+// Running totals over the ticks at positions [Start, End) of a TickColumns
+class FlowWindow
+{
+public:
+    explicit FlowWindow(WindowClockEnum NewClock = WINDOW_CLOCK_TRADE) : Clock(NewClock) {}
+
+    // MaxTrades may be infinity for no cap
+    void Configure(double NewWindowMs, double NewMaxTrades)
+    {
+        WindowMs = NewWindowMs;
+        MaxTrades = NewMaxTrades;
+    }
+
+    void Reset(uint64_t Position)
+    {
+        Start = Position;
+        Totals = WindowTotals();
+    }
+
+    uint64_t GetStart() const { return Start; }
+    const WindowTotals& GetTotals() const { return Totals; }
+
+    // Takes in the tick just pushed, then prunes as of Now
+    void Add(const TickColumns& Ticks, double Now)
+    {
+        const uint64_t Position = Ticks.GetEnd() - 1;
+        if (Counts(Ticks, Position))
+        {
+            if (Ticks.Flags(Position) & TICK_FLAG_ASK)
+            {
+                Totals.BuyVolume += Ticks.Volume(Position);
+                Totals.BuyCount += 1.0;
+            }
+            else
+            {
+                Totals.SellVolume += Ticks.Volume(Position);
+                Totals.SellCount += 1.0;
+            }
+        }
+
+        Expire(Ticks, Now);
+        while (Totals.BuyCount + Totals.SellCount > MaxTrades)
+            DropFront(Ticks);
+    }
+
+    // Drops ticks older than the window as of Now
+    void Expire(const TickColumns& Ticks, double Now)
+    {
+        const double Cutoff = Now - WindowMs;
+        const uint64_t End = Ticks.GetEnd();
+        while (Start < End && (!Counts(Ticks, Start) || Ticks.Time(Start, Clock) < Cutoff))
+            DropFront(Ticks);
+    }
+
+private:
+    bool Counts(const TickColumns& Ticks, uint64_t Position) const
+    {
+        return Clock == WINDOW_CLOCK_ARRIVAL || !(Ticks.Flags(Position) & TICK_FLAG_NO_TRADE_TIME);
+    }
+
+    void DropFront(const TickColumns& Ticks)
+    {
+        const uint64_t Position = Start++;
+        if (!Counts(Ticks, Position))
+            return;
+
+        if (Ticks.Flags(Position) & TICK_FLAG_ASK)
+        {
+            Totals.BuyVolume -= Ticks.Volume(Position);
+            Totals.BuyCount -= 1.0;
+        }
+        else
+        {
+            Totals.SellVolume -= Ticks.Volume(Position);
+            Totals.SellCount -= 1.0;
+        }
+
+        // Start from exact zeros again whenever the window empties
+        if (Totals.BuyCount + Totals.SellCount == 0.0)
+            Totals = WindowTotals();
+    }
+
+    WindowClockEnum Clock;
+    double WindowMs = 1000.0;
+    double MaxTrades = std::numeric_limits<double>::infinity();
+    uint64_t Start = 0;
+    WindowTotals Totals;
+};
+
+// TransitionDetectionEngine's imbalance history: one sample per trade, kept
+// for HistoryMs, and the sample closest to LookbackMs before the newest one
+// (getPreviousImbalance). While the timestamps are non-decreasing the closest
+// sample is tracked with a cursor that only moves forward; otherwise the
+// history is scanned like the JS does.
+class ImbalanceHistory
+{
+public:
+    ImbalanceHistory() : Samples(256) {}
+
+    void Clear()
+    {
+        Begin = 0;
+        End = 0;
+        Descents = 0;
+        Cursor = 0;
+        RunStart = 0;
+    }
+
+    void Push(double Timestamp, double Imbalance, double HistoryMs)
+    {
+        if (End - Begin == Samples.size())
+            Grow();
+
+        if (End > Begin && Timestamp < At(End - 1).Timestamp)
+            Descents++;
+
+        At(End) = Sample{ Timestamp, Imbalance };
+        End++;
+
+        const double Cutoff = Timestamp - HistoryMs;
+        while (Begin < End && At(Begin).Timestamp < Cutoff)
+        {
+            if (Begin + 1 < End && At(Begin + 1).Timestamp < At(Begin).Timestamp)
+                Descents--;
+            Begin++;
+        }
+    }
+
+    // NaN while there are fewer than two samples
+    double Previous(double LookbackMs)
+    {
+        if (End - Begin < 2)
+            return std::numeric_limits<double>::quiet_NaN();
+
+        const double Target = At(End - 1).Timestamp - LookbackMs;
+
+        if (Descents > 0)
+        {
+            Cursor = Begin;
+            RunStart = Begin;
+
+            uint64_t Closest = Begin;
+            double MinDiff = std::fabs(At(Begin).Timestamp - Target);
+            for (uint64_t Position = Begin; Position < End; Position++)
+            {
+                const double Diff = std::fabs(At(Position).Timestamp - Target);
+                if (Diff < MinDiff)
+                {
+                    MinDiff = Diff;
+                    Closest = Position;
+                }
+            }
+            return At(Closest).Imbalance;
+        }
+
+        // Cursor: first sample after Target. RunStart: first sample with the
+        // timestamp of the one before it. Both are ties the JS resolves to
+        // the earliest sample.
+        if (Cursor < Begin)
+        {
+            Cursor = Begin;
+            RunStart = Begin;
+        }
+        while (Cursor < End && At(Cursor).Timestamp <= Target)
+        {
+            if (Cursor == Begin || At(Cursor).Timestamp != At(Cursor - 1).Timestamp)
+                RunStart = Cursor;
+            Cursor++;
+        }
+
+        if (Cursor == Begin)
+            return At(Begin).Imbalance;
+
+        const uint64_t Before = (RunStart > Begin) ? RunStart : Begin;
+        if (Cursor == End)
+            return At(Before).Imbalance;
+
+        const double BeforeDiff = Target - At(Before).Timestamp;
+        const double AfterDiff = At(Cursor).Timestamp - Target;
+        return (AfterDiff < BeforeDiff) ? At(Cursor).Imbalance : At(Before).Imbalance;
+    }
+
+private:
+    struct Sample
+    {
+        double Timestamp;
+        double Imbalance;
+    };
+
+    Sample& At(uint64_t Position) { return Samples[Position & (Samples.size() - 1)]; }
+
+    void Grow()
+    {
+        std::vector<Sample> NewSamples(Samples.size() * 2);
+        for (uint64_t Position = Begin; Position < End; Position++)
+            NewSamples[Position & (NewSamples.size() - 1)] = At(Position);
+        Samples.swap(NewSamples);
+    }
+
+    std::vector<Sample> Samples;
+    uint64_t Begin = 0;
+    uint64_t End = 0;
+    uint64_t Descents = 0;      // Adjacent samples going back in time
+    uint64_t Cursor = 0;
+    uint64_t RunStart = 0;
+};
+
+// Layout of the stats array handed to JS, one row per tick for batches.
+// components/native-engines.js names the same slots.
+enum FlowStatEnum
+{
+    STAT_EVENT_BUY_VOLUME = 0,
+    STAT_EVENT_SELL_VOLUME,
+    STAT_EVENT_BUY_COUNT,
+    STAT_EVENT_SELL_COUNT,
+    STAT_TRANSITION_BUY_VOLUME,
+    STAT_TRANSITION_SELL_VOLUME,
+    STAT_TRANSITION_BUY_COUNT,
+    STAT_TRANSITION_SELL_COUNT,
+    STAT_TRANSITION_PREVIOUS_IMBALANCE,     // NaN for none
+    STAT_RATE_BUY_VOLUME,
+    STAT_RATE_SELL_VOLUME,
+    STAT_RATE_BUY_COUNT,
+    STAT_RATE_SELL_COUNT,
+    STAT_COUNT
+};
+
+struct FlowEnginesConfig
+{
+    double EventWindowMs = 200.0;
+    double EventMaxTrades = 1000.0;
+    double TransitionWindowMs = 1000.0;
+    double TransitionMaxTrades = 500.0;
+    double TransitionHistoryMs = 3000.0;
+    double TransitionLookbackMs = 1000.0;
+    bool TransitionCountMetric = false;     // Imbalance by trade count instead of volume
+    double RateWindowMs = 5000.0;
+};
+
+// All of the app's windows over one shared tick ring
+class FlowEngines
+{
+public:
+    FlowEngines() : RateWindow(WINDOW_CLOCK_ARRIVAL) { Configure(FlowEnginesConfig()); }
+
+    void Configure(const FlowEnginesConfig& NewConfig)
+    {
+        Config = NewConfig;
+        EventWindow.Configure(Config.EventWindowMs, Config.EventMaxTrades);
+        TransitionWindow.Configure(Config.TransitionWindowMs, Config.TransitionMaxTrades);
+        RateWindow.Configure(Config.RateWindowMs, std::numeric_limits<double>::infinity());
+    }
+
+    void Reset()
+    {
+        Ticks.Clear();
+        History.Clear();
+        EventWindow.Reset(0);
+        TransitionWindow.Reset(0);
+        RateWindow.Reset(0);
+        PreviousImbalance = std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Empties the engines' windows and history but keeps the rate window
+    // (the engines are reset when their settings change)
+    void ResetEngines()
+    {
+        History.Clear();
+        EventWindow.Reset(Ticks.GetEnd());
+        TransitionWindow.Reset(Ticks.GetEnd());
+        PreviousImbalance = std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Timestamp may be NaN: the tick then only counts towards rates
+    void Ingest(double Timestamp, double Volume, bool IsAsk, double ArrivalMs, double* Stats)
+    {
+        const bool HasTradeTime = std::isfinite(Timestamp);
+        const uint8_t Flags = (IsAsk ? TICK_FLAG_ASK : 0) | (HasTradeTime ? 0 : TICK_FLAG_NO_TRADE_TIME);
+        Ticks.Push(Timestamp, ArrivalMs, Volume, Flags, OldestInUse());
+
+        RateWindow.Add(Ticks, ArrivalMs);
+        if (HasTradeTime)
+        {
+            EventWindow.Add(Ticks, Timestamp);
+            TransitionWindow.Add(Ticks, Timestamp);
+            History.Push(Timestamp, TransitionImbalance(), Config.TransitionHistoryMs);
+            PreviousImbalance = History.Previous(Config.TransitionLookbackMs);
+        }
+
+        WriteStats(Stats);
+    }
+
+    void IngestWire(const WireTick& Tick, double ArrivalMs, double* Stats)
+    {
+        const double TimestampMs = (Tick.Flags & WIRE_TICK_MICROSECONDS) ? Tick.Timestamp / 1000.0 : static_cast<double>(Tick.Timestamp);
+        Ingest(TimestampMs, static_cast<double>(Tick.Volume), Tick.Side == WIRE_SIDE_ASK, ArrivalMs, Stats);
+    }
+
+    // Ages the rate window without a tick (the display timer)
+    void ExpireRates(double NowMs, double* Stats)
+    {
+        RateWindow.Expire(Ticks, NowMs);
+        WriteStats(Stats);
+    }
+
+private:
+    uint64_t OldestInUse() const
+    {
+        uint64_t Oldest = EventWindow.GetStart();
+        if (TransitionWindow.GetStart() < Oldest)
+            Oldest = TransitionWindow.GetStart();
+        if (RateWindow.GetStart() < Oldest)
+            Oldest = RateWindow.GetStart();
+        return Oldest;
+    }
+
+    // -1 (all sells) to +1 (all buys), as in TransitionDetectionEngine.compute()
+    double TransitionImbalance() const
+    {
+        const WindowTotals& T = TransitionWindow.GetTotals();
+        const double Buy = Config.TransitionCountMetric ? T.BuyCount : T.BuyVolume;
+        const double Sell = Config.TransitionCountMetric ? T.SellCount : T.SellVolume;
+        const double Denominator = Config.TransitionCountMetric ? T.BuyCount + T.SellCount : T.BuyVolume + T.SellVolume;
+        return (Denominator > 0.0) ? (Buy - Sell) / Denominator : 0.0;
+    }
+
+    void WriteStats(double* Stats) const
+    {
+        const WindowTotals& E = EventWindow.GetTotals();
+        const WindowTotals& T = TransitionWindow.GetTotals();
+        const WindowTotals& R = RateWindow.GetTotals();
+
+        Stats[STAT_EVENT_BUY_VOLUME] = E.BuyVolume;
+        Stats[STAT_EVENT_SELL_VOLUME] = E.SellVolume;
+        Stats[STAT_EVENT_BUY_COUNT] = E.BuyCount;
+        Stats[STAT_EVENT_SELL_COUNT] = E.SellCount;
+        Stats[STAT_TRANSITION_BUY_VOLUME] = T.BuyVolume;
+        Stats[STAT_TRANSITION_SELL_VOLUME] = T.SellVolume;
+        Stats[STAT_TRANSITION_BUY_COUNT] = T.BuyCount;
+        Stats[STAT_TRANSITION_SELL_COUNT] = T.SellCount;
+        Stats[STAT_TRANSITION_PREVIOUS_IMBALANCE] = PreviousImbalance;
+        Stats[STAT_RATE_BUY_VOLUME] = R.BuyVolume;
+        Stats[STAT_RATE_SELL_VOLUME] = R.SellVolume;
+        Stats[STAT_RATE_BUY_COUNT] = R.BuyCount;
+        Stats[STAT_RATE_SELL_COUNT] = R.SellCount;
+    }
+
+    FlowEnginesConfig Config;
+    TickColumns Ticks;
+    FlowWindow EventWindow;
+    FlowWindow TransitionWindow;
+    FlowWindow RateWindow;
+    ImbalanceHistory History;
+    double PreviousImbalance = std::numeric_limits<double>::quiet_NaN();
+};
@@ -0,0 +1,12 @@
+{
+  "targets": [
+    {
+      "target_name": "tradeflow_engines",
+      "sources": ["TradeFlowEngines.cpp"],
+      "include_dirs": ["../acsil"],
+      "cflags_cc": ["-std=c++17", "-O2"],
+      "xcode_settings": { "CLANG_CXX_LANGUAGE_STANDARD": "c++17", "GCC_OPTIMIZATION_LEVEL": "2" },
+      "msvs_settings": { "VCCLCompilerTool": { "AdditionalOptions": ["/std:c++17", "/O2"] } }
+    }
+  ]
+}
@@ -0,0 +1,248 @@
+// compare-engines.js
+// A/B check of the native flow windows against the JS engines. Feeds the same
+// trades to EventEngine / TransitionDetectionEngine with their own windows
+// and with the addon's totals, and reports any difference in window stats,
+// events or rate totals, then times both paths.
+//
+// Build the addon first (npx node-gyp rebuild in this directory), then:
+//   node compare-engines.js <trades.csv | archive.tfa> [--speed 20] [--window 300] [--metric count]
+//   node compare-engines.js --synthetic 1000000
+// --speed is the replay speed used to derive arrival times for the rate window.
+
+const path = require('path');
+
+global.window = global;
+require('../components/event-engine');
+require('../components/transition-detection-engine');
+const TradeFlowArchive = require('../components/tradeflow-archive');
+const NativeEngines = require('../components/native-engines');
+
+const RATE_WINDOW_MS = 5000;
+
+// The app reads the rate window on its display timer, not per trade
+const RATE_READ_EVERY = 100;
+
+function option(args, name, fallback) {
+  const index = args.indexOf(name);
+  return index >= 0 ? args[index + 1] : fallback;
+}
+
+function loadTrades(args) {
+  const synthetic = option(args, '--synthetic');
+  if (synthetic) return syntheticTrades(Number(synthetic));
+
+  const file = args.find((a, i) => !a.startsWith('--') && (i === 0 || !args[i - 1].startsWith('--')));
+  if (!file) {
+    console.error('Usage: node compare-engines.js <trades.csv | archive.tfa> [--speed x] [--window ms] [--metric count] | --synthetic <n>');
+    process.exit(1);
+  }
+
+  const trades = [];
+  if (file.toLowerCase().endsWith('.tfa')) {
+    const reader = new TradeFlowArchive.ArchiveReader(file);
+    for (let i = 0; i < reader.tickCount; i++) trades.push(reader.tradeAt(i));
+    reader.close();
+  } else {
+    TradeFlowArchive.forEachCsvTick(file, (t) => trades.push({ timestamp: t.ts, price: t.p, volume: t.v, side: t.s }));
+  }
+  console.log(`${trades.length} trades from ${path.basename(file)}`);
+  return trades;
+}
+
+// Bursts of one-sided flow between quiet stretches, with repeated timestamps
+function syntheticTrades(n) {
+  let seed = 12345;
+  const random = () => (seed = (seed * 1103515245 + 12345) % 2147483648) / 2147483648;
+
+  const trades = [];
+  let ts = 1703001600000;
+  let bias = 0.5;
+  for (let i = 0; i < n; i++) {
+    if (random() < 0.002) bias = random();
+    ts += random() < 0.3 ? 0 : Math.floor(random() * (random() < 0.05 ? 400 : 12));
+    trades.push({ timestamp: ts, price: 25000, volume: 1 + Math.floor(random() * random() * 40), side: random() < bias ? 'ASK' : 'BID' });
+  }
+  console.log(`${n} synthetic trades`);
+  return trades;
+}
+
+function arrivalTimes(trades, speed) {
+  const arrivals = new Float64Array(trades.length);
+  const first = trades.length ? trades[0].timestamp : 0;
+  for (let i = 0; i < trades.length; i++) arrivals[i] = first + (trades[i].timestamp - first) / speed;
+  return arrivals;
+}
+
+// The app's rate window (app.js updateStats / computeRollingRates)
+class JsRates {
+  constructor() {
+    this.recent = [];
+  }
+
+  add(t, side, volume) {
+    this.recent.push({ t, side, volume });
+    this.prune(t);
+  }
+
+  prune(now) {
+    const cutoff = now - RATE_WINDOW_MS;
+    while (this.recent.length > 0 && this.recent[0].t < cutoff) this.recent.shift();
+  }
+
+  totals(now) {
+    this.prune(now);
+
+    const r = { buyVol: 0, sellVol: 0, buyCount: 0, sellCount: 0 };
+    for (const tr of this.recent) {
+      if (tr.side === 'BID') {
+        r.sellCount++;
+        r.sellVol += tr.volume;
+      } else {
+        r.buyCount++;
+        r.buyVol += tr.volume;
+      }
+    }
+    return r;
+  }
+}
+
+function makeEngines(config) {
+  const eventEngine = new EventEngine(config.event);
+  const transitionEngine = new TransitionDetectionEngine(config.transition);
+  return { eventEngine, transitionEngine };
+}
+
+function makeWindows(engines) {
+  const windows = NativeEngines.create();
+  windows.configure(engines.eventEngine.config, engines.transitionEngine.config, RATE_WINDOW_MS);
+  return windows;
+}
+
+function sameStats(a, b) {
+  for (const key of ['buyVol', 'sellVol', 'buyCount', 'sellCount', 'tradesPerSec', 'volPerSec', 'buyRatio', 'sellRatio', 'imbalance']) {
+    if (!Object.is(a[key], b[key])) return false;
+  }
+  return true;
+}
+
+function compare(trades, arrivals, config) {
+  const js = makeEngines(config);
+  const native = makeEngines(config);
+  const windows = makeWindows(native);
+  const jsRates = new JsRates();
+
+  const mismatches = { eventStats: 0, events: 0, transitionStats: 0, transitions: 0, rates: 0 };
+  let events = 0;
+  let transitions = 0;
+  let firstMismatch = null;
+  const note = (kind, i, a, b) => {
+    mismatches[kind]++;
+    if (!firstMismatch) firstMismatch = { kind, trade: i, js: a, native: b };
+  };
+
+  for (let i = 0; i < trades.length; i++) {
+    const trade = trades[i];
+
+    const jsEvent = js.eventEngine.ingest(trade);
+    const jsTransition = js.transitionEngine.ingest(trade);
+    jsRates.add(arrivals[i], trade.side, trade.volume);
+
+    const ts = windows.ingest(trade, arrivals[i]);
+    const nativeEvent = windows.eventFor(native.eventEngine, ts);
+    const nativeTransition = windows.transitionFor(native.transitionEngine, ts);
+    if (jsEvent) events++;
+    if (jsTransition) transitions++;
+
+    if (!sameStats(js.eventEngine.lastComputed, native.eventEngine.lastComputed)) {
+      note('eventStats', i, js.eventEngine.lastComputed, native.eventEngine.lastComputed);
+    }
+    if (JSON.stringify(jsEvent) !== JSON.stringify(nativeEvent)) note('events', i, jsEvent, nativeEvent);
+    if (!sameStats(js.transitionEngine.lastComputed, native.transitionEngine.lastComputed)) {
+      note('transitionStats', i, js.transitionEngine.lastComputed, native.transitionEngine.lastComputed);
+    }
+    if (JSON.stringify(jsTransition) !== JSON.stringify(nativeTransition)) note('transitions', i, jsTransition, nativeTransition);
+
+    if (i % RATE_READ_EVERY !== 0) continue;
+    const a = jsRates.totals(arrivals[i]);
+    const b = windows.rates(arrivals[i]);
+    if (a.buyVol !== b.buyVol || a.sellVol !== b.sellVol || a.buyCount !== b.buyCount || a.sellCount !== b.sellCount) {
+      note('rates', i, a, b);
+    }
+  }
+
+  console.log(`${events} flow events, ${transitions} transitions`);
+  const total = Object.values(mismatches).reduce((sum, n) => sum + n, 0);
+  if (total === 0) {
+    console.log('✓ Native windows match the JS engines on every trade');
+  } else {
+    console.log('✗ Mismatches:', mismatches);
+    console.log('  first:', JSON.stringify(firstMismatch));
+  }
+  return total;
+}
+
+function time(label, trades, run) {
+  const started = process.hrtime.bigint();
+  run();
+  const ms = Number(process.hrtime.bigint() - started) / 1e6;
+  console.log(`${label.padEnd(26)} ${ms.toFixed(1).padStart(8)} ms  ${(trades.length / ms / 1000).toFixed(2).padStart(6)} M trades/s`);
+}
+
+function benchmark(trades, arrivals, config) {
+  time('JS windows', trades, () => {
+    const e = makeEngines(config);
+    const rates = new JsRates();
+    for (let i = 0; i < trades.length; i++) {
+      e.eventEngine.ingest(trades[i]);
+      e.transitionEngine.ingest(trades[i]);
+      rates.add(arrivals[i], trades[i].side, trades[i].volume);
+      if (i % RATE_READ_EVERY === 0) rates.totals(arrivals[i]);
+    }
+  });
+
+  time('native windows', trades, () => {
+    const e = makeEngines(config);
+    const windows = makeWindows(e);
+    for (let i = 0; i < trades.length; i++) {
+      const ts = windows.ingest(trades[i], arrivals[i]);
+      windows.eventFor(e.eventEngine, ts);
+      windows.transitionFor(e.transitionEngine, ts);
+      if (i % RATE_READ_EVERY === 0) windows.rates(arrivals[i]);
+    }
+  });
+
+  const ts = new Float64Array(trades.length);
+  const volume = new Float64Array(trades.length);
+  const sides = new Uint8Array(trades.length);
+  for (let i = 0; i < trades.length; i++) {
+    ts[i] = trades[i].timestamp;
+    volume[i] = trades[i].volume;
+    sides[i] = trades[i].side === 'ASK' ? 1 : 0;
+  }
+  time('native batch (stats only)', trades, () => {
+    const windows = makeWindows(makeEngines(config));
+    windows.engines.ingestBatch(ts, volume, sides, arrivals[arrivals.length - 1] || 0);
+  });
+}
+
+function main(args) {
+  if (!NativeEngines.create()) {
+    console.error(`Addon not built: ${NativeEngines.loadError ? NativeEngines.loadError.message : 'not found'}`);
+    process.exit(1);
+  }
+
+  const trades = loadTrades(args);
+  const arrivals = arrivalTimes(trades, Number(option(args, '--speed', 20)));
+  const windowMs = Number(option(args, '--window', 300));
+  const metric = option(args, '--metric', 'volume');
+  const config = {
+    event: { windowMs, dominanceMetric: metric },
+    transition: { windowMs, dominanceMetric: metric }
+  };
+
+  const mismatches = compare(trades, arrivals, config);
+  benchmark(trades, arrivals, config);
+  process.exit(mismatches === 0 ? 0 : 2);
+}
+
+main(process.argv.slice(2));
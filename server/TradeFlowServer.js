@@ -4,10 +4,23 @@
 const net = require('net');
 const WebSocket = require('ws');
 const fs = require('fs');
+const { WireDecoder, encodeResumeRequest, encodeFootprintRequest, encodeFilterRequest, encodeSubscribeRequest, HEARTBEAT_REPLY } = require('../components/tradeflow-wire');
+const { LatencyRecorder, nowMicros } = require('../components/latency-stats');
+const { MulticastReceiver } = require('./tradeflow-multicast');
 
 const CONFIG = {
     TCP_PORT: 9999,
-    WS_PORT: 8080
+    TCP_HOST: '127.0.0.1',  // '0.0.0.0' to accept an exporter on another machine (study input TCP Host)
+    WS_PORT: 8080,
+    FORWARD_QUOTES: false,  // Relay the exporter's bid/ask updates (Quotes input on the study)
+    FORWARD_FOOTPRINT: false,  // Relay volume-at-price updates (Footprint input on the study)
+    EXPORTER_FILTER: null,  // e.g. { minVolume: 10, stream: 'both' }: smaller ticks are left out at the exporter (TCP)
+    SUBSCRIBE_SYMBOLS: null,  // e.g. ['ESZ5', 'NQH6']: only these charts send (hub mode, TCP)
+    MULTICAST_GROUP: null,  // e.g. '239.255.70.70' to also receive the UDP Multicast transport
+    MULTICAST_PORT: 9999,   // The study's TCP Port input
+    MULTICAST_INTERFACE: null,  // Local address to join the group on (null = system default)
+    LATENCY_REPORT_MS: 10000,  // Hop percentiles, when the exporter sends timing stamps
+    WARM_START_MS: 300000  // Recent trades replayed to app clients that connect later (exporter warm start plus live ticks; 0 = off)
 };
 
 const RECORDING_CONFIG = {
@@ -21,11 +34,44 @@ class SocketTickReader {
         this.wsServer = null;
         this.wsClients = new Set();
         this.tcpServer = null;
-        this.sierraChartSocket = null;
+        // One per chart, or a single one when the exporter's hub mode
+        // multiplexes every symbol over one connection
+        this.sierraChartSockets = new Set();
+        this.multicast = null;
         this.tickCount = 0;
-        this.lastSequence = 0;
-        this.buffer = '';
+        this.lastSequenceBySymbol = new Map();  // Sequence numbers are per symbol
         this.recordedTrades = [];
+
+        // Latest exporter timing stamps per symbol, applied to the ticks of
+        // the batch that follows them
+        this.batchTimingBySymbol = new Map();
+        this.latency = new LatencyRecorder();
+        this.latencyTimer = null;
+
+        // Recent trades per symbol in the shape broadcast to clients, oldest
+        // first from head; a client that connects gets them as a snapshot
+        this.recentTradesBySymbol = new Map();  // sym -> { trades, head }
+        this.snapshotBySymbol = new Map();      // Exporter warm start being received
+    }
+
+    // Decodes JSON lines or binary frames (detected per connection).
+    // Heartbeats are answered on the connection they came from.
+    createDecoder(socket) {
+        return new WireDecoder({
+            onTick: (tick) => this.handleTick(tick),
+            onSummary: (summary) => this.handleSummary(summary),
+            onAggregate: (aggregate) => this.handleAggregate(aggregate),
+            onStats: (stats) => this.handleStats(stats),
+            onTiming: (timing) => this.handleTiming(timing),
+            onQuote: CONFIG.FORWARD_QUOTES ? (quote) => this.handleQuote(quote) : undefined,
+            onFootprint: CONFIG.FORWARD_FOOTPRINT ? (footprint) => this.handleFootprint(footprint) : undefined,
+            onTradeEvent: (event) => this.handleTradeEvent(event),
+            onSnapshot: (snapshot) => this.handleSnapshot(snapshot),
+            onSnapshotEnd: (end) => this.handleSnapshotEnd(end),
+            onHeartbeat: () => socket.write(HEARTBEAT_REPLY),
+            onSymbol: (def) => console.log(`✓ Symbol ${def.id}: ${def.name} (tick size ${def.tickSize})`),
+            onError: (err) => console.error('❌', err.message)
+        });
     }
     
     // Start WebSocket server for Electron app
@@ -35,6 +81,20 @@ class SocketTickReader {
         this.wsServer.on('connection', (ws) => {
             console.log('✓ Electron app connected to WebSocket');
             this.wsClients.add(ws);
+
+            // Warm the new client's engines with the recent tape
+            this.recentTradesBySymbol.forEach((recent, symbol) => {
+                if (recent.trades.length > recent.head) {
+                    ws.send(JSON.stringify({ type: 'snapshot', data: { symbol, trades: recent.trades.slice(recent.head) } }));
+                }
+            });
+
+            // A new client starts from the whole ladder; the others just
+            // see one snapshot more
+            if (CONFIG.FORWARD_FOOTPRINT) {
+                this.sierraChartSockets.forEach(socket => socket.write(encodeFootprintRequest()));
+                if (this.multicast) this.multicast.requestFootprint();
+            }
             
             ws.on('close', () => {
                 console.log('✗ Electron app disconnected');
@@ -45,19 +105,36 @@ class SocketTickReader {
         console.log(`✓ WebSocket server listening on port ${CONFIG.WS_PORT}`);
     }
     
-    // Broadcast tick to Electron clients
+    // Broadcast tick to Electron clients. With exporter timing, the trade
+    // carries lat: { tq, tx, rx, fx } in microseconds (exporter enqueue and
+    // send, relay receive and forward) for the app to extend.
     broadcast(tick) {
-        const message = JSON.stringify({
-            type: 'trade',
-            data: {
-                timestamp: tick.ts,
-                price: tick.p,
-                volume: tick.v,
-                side: tick.s,
-                symbol: tick.sym
-            }
-        });
-        
+        const data = {
+            timestamp: tick.ts,
+            price: tick.p,
+            volume: tick.v,
+            side: tick.s,
+            symbol: tick.sym
+        };
+        if (tick.us !== undefined) data.timestampUs = tick.us;
+        if (tick.n > 1) data.prints = tick.n;
+
+        // A copy: lat below belongs to this forward only, not to later replays
+        this.rememberTrades(tick.sym, [{ ...data }]);
+
+        const timing = this.batchTimingBySymbol.get(tick.sym);
+        if (timing && tick.seq >= timing.seq0 && tick.seq <= timing.seq1) {
+            const fx = nowMicros();
+            data.lat = { tq: timing.tq, tx: timing.tx, rx: timing.rx, fx };
+            this.latency.record('relay', fx - timing.rx);
+        }
+
+        const message = JSON.stringify({ type: 'trade', data });
+        this.sendToClients(message);
+    }
+
+    // Sends one serialized message to every connected Electron client
+    sendToClients(message) {
         this.wsClients.forEach(client => {
             if (client.readyState === WebSocket.OPEN) {
                 client.send(message);
@@ -65,20 +142,64 @@ class SocketTickReader {
         });
     }
     
+    // Keeps the last WARM_START_MS of trades (by trade time) for clients
+    // that connect later. Snapshot trades no newer than the last one kept
+    // are already there.
+    rememberTrades(symbol, trades, fromSnapshot = false) {
+        if (!(CONFIG.WARM_START_MS > 0)) return;
+
+        let recent = this.recentTradesBySymbol.get(symbol);
+        if (!recent) {
+            recent = { trades: [], head: 0 };
+            this.recentTradesBySymbol.set(symbol, recent);
+        }
+
+        const list = recent.trades;
+        const micros = (trade) => trade.timestampUs ?? trade.timestamp * 1000;
+        const lastUs = list.length > recent.head ? micros(list[list.length - 1]) : -Infinity;
+        for (const trade of trades) {
+            if (fromSnapshot && micros(trade) <= lastUs) continue;
+            list.push(trade);
+        }
+
+        const newest = list.length > 0 ? list[list.length - 1].timestamp : 0;
+        while (recent.head < list.length && list[recent.head].timestamp < newest - CONFIG.WARM_START_MS) recent.head++;
+        if (recent.head > 4096 && recent.head * 2 > list.length) {
+            list.splice(0, recent.head);
+            recent.head = 0;
+        }
+    }
+
     // Start TCP server to receive from Sierra Chart
     startTCPServer() {
         this.tcpServer = net.createServer((socket) => {
             console.log('✓ Sierra Chart connected from', socket.remoteAddress);
             
-            this.sierraChartSocket = socket;
+            const decoder = this.createDecoder(socket);
+            this.sierraChartSockets.add(socket);
+
+            // The filter goes first so the resend is filtered too
+            if (CONFIG.SUBSCRIBE_SYMBOLS) {
+                socket.write(encodeSubscribeRequest(CONFIG.SUBSCRIBE_SYMBOLS));
+            }
+            if (CONFIG.EXPORTER_FILTER) {
+                socket.write(encodeFilterRequest(CONFIG.EXPORTER_FILTER));
+            }
+
+            // Ask for whatever was sent after our last tick of each symbol
+            // (lost with the previous connection) before live ticks resume
+            socket.write(encodeResumeRequest(this.lastSequenceBySymbol));
             
             socket.on('data', (data) => {
-                this.handleData(data);
+                this.handleData(decoder, data);
             });
             
             socket.on('end', () => {
                 console.log('✗ Sierra Chart disconnected');
-                this.sierraChartSocket = null;
+            });
+
+            socket.on('close', () => {
+                this.sierraChartSockets.delete(socket);
             });
             
             socket.on('error', (err) => {
@@ -86,63 +207,161 @@ class SocketTickReader {
             });
         });
         
-        this.tcpServer.listen(CONFIG.TCP_PORT, '127.0.0.1', () => {
+        this.tcpServer.listen(CONFIG.TCP_PORT, CONFIG.TCP_HOST, () => {
             console.log(`✓ TCP server listening on port ${CONFIG.TCP_PORT}`);
             console.log('  Waiting for Sierra Chart ACSIL study to connect...\n');
         });
     }
     
+    // Same handlers as a TCP connection; the receiver puts ticks back in
+    // sequence order and fills gaps, so they arrive here as if from TCP
+    startMulticastReceiver() {
+        this.multicast = new MulticastReceiver({
+            group: CONFIG.MULTICAST_GROUP,
+            port: CONFIG.MULTICAST_PORT,
+            iface: CONFIG.MULTICAST_INTERFACE
+        }, {
+            onTick: (tick) => this.handleTick(tick),
+            onSummary: (summary) => this.handleSummary(summary),
+            onAggregate: (aggregate) => this.handleAggregate(aggregate),
+            onStats: (stats) => this.handleStats(stats),
+            onTiming: (timing) => this.handleTiming(timing),
+            onQuote: CONFIG.FORWARD_QUOTES ? (quote) => this.handleQuote(quote) : undefined,
+            onFootprint: CONFIG.FORWARD_FOOTPRINT ? (footprint) => this.handleFootprint(footprint) : undefined,
+            onTradeEvent: (event) => this.handleTradeEvent(event),
+            onSnapshot: (snapshot) => this.handleSnapshot(snapshot),
+            onSnapshotEnd: (end) => this.handleSnapshotEnd(end),
+            onGap: (gap) => console.warn(`⚠️  ${gap.sym}: ticks ${gap.from}-${gap.to} lost on multicast`),
+            onListening: () => console.log(`✓ Joined multicast group ${CONFIG.MULTICAST_GROUP}:${CONFIG.MULTICAST_PORT}`),
+            onError: (err) => console.error('❌', err.message)
+        });
+        this.multicast.start();
+    }
+
     // Handle incoming data
-    handleData(data) {
-        // Append to buffer
-        this.buffer += data.toString('utf8');
+    handleData(decoder, data) {
+        decoder.push(data);
+    }
+
+    // Reports a gap in a symbol's sequence, then records where it now ends
+    checkSequence(symbol, firstSeq, lastSeq) {
+        const lastSequence = this.lastSequenceBySymbol.get(symbol) || 0;
+        // A min-volume filter leaves sequence numbers out on purpose
+        const filtered = CONFIG.EXPORTER_FILTER && CONFIG.EXPORTER_FILTER.minVolume > 0;
+        if (lastSequence > 0 && firstSeq !== lastSequence + 1 && !filtered) {
+            const missed = firstSeq - lastSequence - 1;
+            console.log(`⚠️  ${symbol}: missed ${missed} ticks (seq gap: ${lastSequence} → ${firstSeq})`);
+        }
+
+        this.lastSequenceBySymbol.set(symbol, lastSeq);
+    }
+
+    handleTick(tick) {
+        // Log first 10 ticks with full structure
+        if (this.tickCount < 10) {
+            console.log(`\n✓ Tick ${this.tickCount + 1} (full data):`);
+            console.log(JSON.stringify(tick, null, 2));
+        }
         
-        // Process complete lines
-        let newlineIndex;
-        while ((newlineIndex = this.buffer.indexOf('\n')) !== -1) {
-            const line = this.buffer.substring(0, newlineIndex).trim();
-            this.buffer = this.buffer.substring(newlineIndex + 1);
-            
-            if (!line) continue;
-            
-            try {
-                const tick = JSON.parse(line);
-                
-                // Log first 10 ticks with full structure
-                if (this.tickCount < 10) {
-                    console.log(`\n✓ Tick ${this.tickCount + 1} (full data):`);
-                    console.log(JSON.stringify(tick, null, 2));
-                }
-                
-                // Record to CSV if enabled
-                if (RECORDING_CONFIG.ENABLED && this.recordedTrades.length < RECORDING_CONFIG.MAX_TRADES) {
-                    this.recordedTrades.push(tick);
-                    if (this.recordedTrades.length === RECORDING_CONFIG.MAX_TRADES) {
-                        this.saveRecording();
-                    }
-                }
-                
-                // Check sequence
-                if (this.lastSequence > 0 && tick.seq !== this.lastSequence + 1) {
-                    const missed = tick.seq - this.lastSequence - 1;
-                    console.log(`⚠️  Missed ${missed} ticks (seq gap: ${this.lastSequence} → ${tick.seq})`);
-                }
-                
-                this.lastSequence = tick.seq;
-                this.tickCount++;
-                
-                // Broadcast to Electron
-                this.broadcast(tick);
-                
-                // Log periodically
-                if (this.tickCount % 100 === 0) {
-                    console.log(`📊 Processed ${this.tickCount} ticks (seq: ${tick.seq}) - ${tick.s} ${tick.v} @ ${tick.p}`);
-                }
-                
-            } catch (err) {
-                console.error('❌ Failed to parse:', line);
+        // Record to CSV if enabled
+        if (RECORDING_CONFIG.ENABLED && this.recordedTrades.length < RECORDING_CONFIG.MAX_TRADES) {
+            this.recordedTrades.push(tick);
+            if (this.recordedTrades.length === RECORDING_CONFIG.MAX_TRADES) {
+                this.saveRecording();
             }
         }
+        
+        // Check sequence
+        this.checkSequence(tick.sym, tick.seq, tick.seq);
+        this.tickCount++;
+        
+        // Broadcast to Electron
+        this.broadcast(tick);
+        
+        // Log periodically
+        if (this.tickCount % 100 === 0) {
+            console.log(`📊 Processed ${this.tickCount} ticks (seq: ${tick.seq}) - ${tick.s} ${tick.v} @ ${tick.p}`);
+        }
+    }
+    
+    // Account for a coalesced range so it is not reported as missed
+    handleSummary(summary) {
+        this.checkSequence(summary.sym, summary.seq0, summary.seq1);
+        console.log(`⚠️  Exporter coalesced ${summary.n} ticks (seq ${summary.seq0}-${summary.seq1}): BID ${summary.bv} / ASK ${summary.av}`);
+
+        const message = JSON.stringify({ type: 'summary', data: summary });
+        this.sendToClients(message);
+    }
+    
+    // Rolling-window totals computed by the exporter; forwarded as-is
+    handleAggregate(aggregate) {
+        const message = JSON.stringify({ type: 'aggregate', data: aggregate });
+        this.sendToClients(message);
+    }
+    
+    // Stamps for the batch that follows; the exporter hops are measured here
+    handleTiming(timing) {
+        timing.rx = nowMicros();
+        this.batchTimingBySymbol.set(timing.sym, timing);
+        this.latency.record('exporter', timing.tx - timing.tq);
+        this.latency.record('exporter→relay', timing.rx - timing.tx);
+    }
+
+    reportLatency() {
+        if (this.latency.hops.size === 0) return;
+        console.log(`⏱️  Latency (last samples per hop):\n${this.latency.format()}`);
+    }
+
+    // Exporter instrumentation: shown on the console and forwarded to clients
+    handleStats(stats) {
+        const kbPerSec = stats.ms > 0 ? (stats.bytes / 1024) * 1000 / stats.ms : 0;
+        console.log(`📊 ${stats.sym || '?'}: ${stats.calls} calls, p50 ${stats.p50}us p99 ${stats.p99}us max ${stats.max}us, ` +
+            `${stats.ticks} ticks (max ${stats.tpc}/call), ${kbPerSec.toFixed(1)} KB/s, backlog ${stats.backlog} B, ` +
+            `${stats.wb} would-block, ${stats.conn} connects, ${stats.dropped} dropped, ${stats.merged || 0} merged prints`);
+
+        const message = JSON.stringify({ type: 'stats', data: stats });
+        this.sendToClients(message);
+    }
+    
+    // Bid/ask changes; clients keep the last value of each field per symbol
+    handleQuote(quote) {
+        const message = JSON.stringify({ type: 'quote', data: quote });
+        this.sendToClients(message);
+    }
+    
+    // Volume-at-price changes; clients apply them with FootprintBook
+    handleFootprint(footprint) {
+        const message = JSON.stringify({ type: 'footprint', data: footprint });
+        this.sendToClients(message);
+    }
+    
+    // Exporter warm start (Warm Start input on the study): the recent trades
+    // of a symbol, in parts, ahead of its live ticks
+    handleSnapshot(snapshot) {
+        const parts = this.snapshotBySymbol.get(snapshot.sym) || [];
+        for (const trade of snapshot.trades) {
+            parts.push({ timestamp: trade.ts, timestampUs: trade.us, price: trade.p, volume: trade.v, side: trade.s, symbol: snapshot.sym });
+        }
+        this.snapshotBySymbol.set(snapshot.sym, parts);
+    }
+
+    // The snapshot is complete: keep it and warm up the connected clients
+    handleSnapshotEnd(end) {
+        const trades = this.snapshotBySymbol.get(end.sym) || [];
+        this.snapshotBySymbol.delete(end.sym);
+        console.log(`✓ ${end.sym}: warm start with ${trades.length} recent trades`);
+        if (trades.length === 0) return;
+
+        this.rememberTrades(end.sym, trades, true);
+        const message = JSON.stringify({ type: 'snapshot', data: { symbol: end.sym, trades } });
+        this.sendToClients(message);
+    }
+    
+    // Sweeps and block trades (Events input on the study), sent the moment
+    // they complete so the app can cue them ahead of the ticks
+    handleTradeEvent(event) {
+        const message = JSON.stringify({ type: 'event', data: event });
+        this.sendToClients(message);
     }
     
     // Save recorded trades to CSV
@@ -171,6 +390,13 @@ class SocketTickReader {
         
         this.startWebSocketServer();
         this.startTCPServer();
+        if (CONFIG.MULTICAST_GROUP) {
+            this.startMulticastReceiver();
+        }
+
+        if (CONFIG.LATENCY_REPORT_MS > 0) {
+            this.latencyTimer = setInterval(() => this.reportLatency(), CONFIG.LATENCY_REPORT_MS);
+        }
     }
     
     stop() {
@@ -179,8 +405,13 @@ class SocketTickReader {
             this.saveRecording();
         }
         
-        if (this.sierraChartSocket) {
-            this.sierraChartSocket.end();
+        if (this.latencyTimer) {
+            clearInterval(this.latencyTimer);
+        }
+
+        this.sierraChartSockets.forEach(socket => socket.end());
+        if (this.multicast) {
+            this.multicast.stop();
         }
         if (this.tcpServer) {
             this.tcpServer.close();
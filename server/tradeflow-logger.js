@@ -1,5 +1,5 @@
 // tradeflow-logger.js
-// Continuous tick logger for Sierra Chart ACSIL -> TCP newline-delimited JSON
+// Continuous tick logger for Sierra Chart ACSIL -> TCP (newline-delimited JSON or binary frames)
 // Logs until you stop the process (Ctrl+C).
 //
 // Output folder: C:\TradeFlowData
@@ -10,13 +10,22 @@
 const net = require('net');
 const fs = require('fs');
 const path = require('path');
+const { WireDecoder, encodeResumeRequest, encodeFilterRequest, encodeSubscribeRequest, HEARTBEAT_REPLY } = require('../components/tradeflow-wire');
+const { MulticastReceiver } = require('./tradeflow-multicast');
 
 const CONFIG = {
   TCP_PORT: 9999,
-  HOST: '127.0.0.1',
+  HOST: '127.0.0.1', // '0.0.0.0' to accept an exporter on another machine
 
   OUTPUT_DIR: 'C:\\TradeFlowData',
   WRITE_CSV: false, // set true if you also want a CSV alongside JSONL
+  LOG_QUOTES: false, // set true to also capture bid/ask updates (Quotes input on the study)
+  LOG_FOOTPRINT: false, // set true to also capture volume-at-price updates (Footprint input on the study)
+  EXPORTER_FILTER: null, // e.g. { minVolume: 10 }: only log ticks of at least 10 contracts (filtered at the exporter)
+  SUBSCRIBE_SYMBOLS: null, // e.g. ['ESZ5']: only log these charts (hub mode)
+  MULTICAST_GROUP: null, // e.g. '239.255.70.70' to also log the UDP Multicast transport
+  MULTICAST_PORT: 9999, // the study's TCP Port input
+  MULTICAST_INTERFACE: null, // local address to join the group on (null = system default)
 
   FLUSH_EVERY_LINES: 500,   // fsync every N lines for safety (0 = never)
   STATS_EVERY_MS: 5000      // console stats interval
@@ -42,11 +51,12 @@ function timestampForFilename(d = new Date()) {
 class TradeFlowLogger {
   constructor() {
     this.tcpServer = null;
-    this.buffer = '';
+    this.multicast = null;
 
     this.tickCount = 0;
     this.lastSeqBySymbol = new Map();
     this.gapCount = 0;
+    this.coalescedCount = 0;
 
     this.jsonlStream = null;
     this.csvStream = null;
@@ -81,8 +91,26 @@ class TradeFlowLogger {
 
     this.tcpServer = net.createServer((socket) => {
       console.log(`✓ Sierra Chart connected from ${socket.remoteAddress}`);
+      // One decoder per connection: each chart (or the exporter hub) is its own stream
+      const decoder = new WireDecoder({
+        onTick: (tick) => this.processTick(tick),
+        onSummary: (summary) => this.processTick(summary),
+        onAggregate: (aggregate) => this.processAggregate(aggregate),
+        onQuote: CONFIG.LOG_QUOTES ? (quote) => this.processQuote(quote) : undefined,
+        onFootprint: CONFIG.LOG_FOOTPRINT ? (footprint) => this.processFootprint(footprint) : undefined,
+        onTradeEvent: (event) => this.processTradeEvent(event),
+        onHeartbeat: () => socket.write(HEARTBEAT_REPLY)
+        // A partial/garbled line is just skipped
+      });
+
+      // Filter before resuming, so the resend is filtered too
+      if (CONFIG.SUBSCRIBE_SYMBOLS) socket.write(encodeSubscribeRequest(CONFIG.SUBSCRIBE_SYMBOLS));
+      if (CONFIG.EXPORTER_FILTER) socket.write(encodeFilterRequest(CONFIG.EXPORTER_FILTER));
 
-      socket.on('data', (data) => this.handleData(data));
+      // Recover the ticks the last connection lost, so the log has no gap
+      socket.write(encodeResumeRequest(this.lastSeqBySymbol));
+
+      socket.on('data', (data) => this.handleData(decoder, data));
       socket.on('end', () => console.log('✗ Sierra Chart disconnected'));
       socket.on('error', (err) => console.error('Socket error:', err.message));
     });
@@ -97,42 +125,60 @@ class TradeFlowLogger {
       console.log('Waiting for Sierra Chart ACSIL study to connect...\n');
     });
 
+    if (CONFIG.MULTICAST_GROUP) this.startMulticast();
+
     this.statsTimer = setInterval(() => this.printStats(), CONFIG.STATS_EVERY_MS);
   }
 
-  handleData(data) {
-    this.buffer += data.toString('utf8');
-
-    let newlineIndex;
-    while ((newlineIndex = this.buffer.indexOf('\n')) !== -1) {
-      const line = this.buffer.substring(0, newlineIndex).trim();
-      this.buffer = this.buffer.substring(newlineIndex + 1);
-
-      if (!line) continue;
-
-      let tick;
-      try {
-        tick = JSON.parse(line);
-      } catch {
-        // If a partial/garbled line gets through, just skip it.
-        continue;
+  // Ticks come out in sequence order with gaps refilled; a gap the exporter
+  // could not fill is counted like one seen on TCP
+  startMulticast() {
+    this.multicast = new MulticastReceiver(
+      { group: CONFIG.MULTICAST_GROUP, port: CONFIG.MULTICAST_PORT, iface: CONFIG.MULTICAST_INTERFACE },
+      {
+        onTick: (tick) => this.processTick(tick),
+        onSummary: (summary) => this.processTick(summary),
+        onAggregate: (aggregate) => this.processAggregate(aggregate),
+        onQuote: CONFIG.LOG_QUOTES ? (quote) => this.processQuote(quote) : undefined,
+        onFootprint: CONFIG.LOG_FOOTPRINT ? (footprint) => this.processFootprint(footprint) : undefined,
+        onTradeEvent: (event) => this.processTradeEvent(event),
+        onListening: () => console.log(`✓ Joined multicast group ${CONFIG.MULTICAST_GROUP}:${CONFIG.MULTICAST_PORT}`),
+        onError: (err) => console.error('Multicast error:', err.message)
       }
+    );
+    this.multicast.start();
+  }
 
-      this.processTick(tick);
-    }
+  handleData(decoder, data) {
+    decoder.push(data);
   }
 
   processTick(tick) {
     // Expecting: { seq, ts, p, v, s, sym }
+    // or a coalesced range: { type: 'summary', seq0, seq1, n, ... }
     const sym = tick.sym || 'UNKNOWN';
-    const seq = Number(tick.seq);
+    const isSummary = tick.type === 'summary';
+    const seq = Number(isSummary ? tick.seq0 : tick.seq);
 
-    // Basic sequence gap tracking per symbol
+    // Basic sequence gap tracking per symbol (a min-volume filter skips numbers on purpose)
     const last = this.lastSeqBySymbol.get(sym);
-    if (Number.isFinite(seq) && Number.isFinite(last) && seq !== last + 1) {
+    const filtered = CONFIG.EXPORTER_FILTER && CONFIG.EXPORTER_FILTER.minVolume > 0;
+    if (!filtered && Number.isFinite(seq) && Number.isFinite(last) && seq !== last + 1) {
       const missed = seq - last - 1;
       if (missed > 0) this.gapCount += missed;
     }
+
+    if (isSummary) {
+      const seq1 = Number(tick.seq1);
+      if (Number.isFinite(seq1)) this.lastSeqBySymbol.set(sym, seq1);
+      this.coalescedCount += Number(tick.n) || 0;
+
+      // Keep the summary in the JSONL so the capture shows what was coalesced
+      this.jsonlStream.write(JSON.stringify(tick) + '\n');
+      this.linesSinceFlush++;
+      return;
+    }
+
     if (Number.isFinite(seq)) this.lastSeqBySymbol.set(sym, seq);
 
     // Write JSONL (fast, append-only)
@@ -159,6 +205,30 @@ class TradeFlowLogger {
     this.tickCount++;
   }
 
+  // Aggregates carry no sequence numbers; keep them in the capture as-is
+  processAggregate(aggregate) {
+    this.jsonlStream.write(JSON.stringify(aggregate) + '\n');
+    this.linesSinceFlush++;
+  }
+
+  // Changes-only quote records; replaying them in order rebuilds the inside market
+  processQuote(quote) {
+    this.jsonlStream.write(JSON.stringify(quote) + '\n');
+    this.linesSinceFlush++;
+  }
+
+  // Changed price levels, with a snapshot (k: 1) after each connect
+  processFootprint(footprint) {
+    this.jsonlStream.write(JSON.stringify(footprint) + '\n');
+    this.linesSinceFlush++;
+  }
+
+  // Sweeps and block trades (e: 'sweep' | 'block'), kept alongside the ticks that made them
+  processTradeEvent(event) {
+    this.jsonlStream.write(JSON.stringify(event) + '\n');
+    this.linesSinceFlush++;
+  }
+
   printStats() {
     const elapsedSec = (Date.now() - this.startTime) / 1000;
     const tps = elapsedSec > 0 ? this.tickCount / elapsedSec : 0;
@@ -168,7 +238,7 @@ class TradeFlowLogger {
     const symText = symbols.length ? symbols.join(', ') : '(none yet)';
 
     console.log(
-      `📊 ticks=${this.tickCount}  tps=${tps.toFixed(1)}  gaps=${this.gapCount}  symbols=${symText}`
+      `📊 ticks=${this.tickCount}  tps=${tps.toFixed(1)}  gaps=${this.gapCount}  coalesced=${this.coalescedCount}  symbols=${symText}`
     );
   }
 
@@ -177,6 +247,7 @@ class TradeFlowLogger {
     clearInterval(this.statsTimer);
 
     if (this.tcpServer) this.tcpServer.close();
+    if (this.multicast) this.multicast.stop();
 
     const closeStream = (s) =>
       new Promise((resolve) => {
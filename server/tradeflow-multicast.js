@@ -0,0 +1,304 @@
+// tradeflow-multicast.js
+// Receiver for the exporter's UDP Multicast transport (datagram layout:
+// acsil/TradeFlowMulticast.h). Joins the group, decodes each datagram and
+// hands ticks on in sequence order per symbol, with the same handlers as a
+// WireDecoder. A gap in a symbol's sequence holds its later ticks back and
+// asks the exporter, by unicast, for the missing ones; if they do not come
+// the gap is reported through onGap and skipped.
+
+const dgram = require('dgram');
+const { WireDecoder, encodeFootprintRequest } = require('../components/tradeflow-wire');
+
+// Resend requests for one symbol are repeated at most this often
+const RESEND_INTERVAL_MS = 100;
+
+// A gap still open after this long is given up on
+const GAP_TIMEOUT_MS = 500;
+
+// Ticks held behind one gap; past this the gap is given up on at once
+const MAX_HELD_TICKS = 50000;
+
+// A source (exporter) silent for this long is forgotten
+const SOURCE_IDLE_MS = 60000;
+
+const CHECK_INTERVAL_MS = 50;
+
+class MulticastReceiver {
+  // options: { group, port, iface }
+  // handlers: WireDecoder handlers, plus onGap({ sym, from, to }) for ticks
+  // given up on and onListening()
+  constructor(options, handlers = {}) {
+    this.group = options.group;
+    this.port = options.port;
+    this.iface = options.iface || undefined;
+    this.handlers = handlers;
+
+    this.socket = null;
+    this.timer = null;
+    this.sources = new Map();   // "address/sourceId" -> source
+
+    this.stats = { datagrams: 0, lostDatagrams: 0, duplicates: 0, resendRequests: 0, gaps: 0 };
+  }
+
+  start() {
+    this.socket = dgram.createSocket({ type: 'udp4', reuseAddr: true });
+    this.socket.on('message', (msg, rinfo) => this.handleDatagram(msg, rinfo));
+    this.socket.on('error', (err) => this._emit('onError', err));
+    this.socket.bind(this.port, () => {
+      this.socket.addMembership(this.group, this.iface);
+      this._emit('onListening');
+    });
+
+    this.timer = setInterval(() => this.checkGaps(Date.now()), CHECK_INTERVAL_MS);
+  }
+
+  stop() {
+    clearInterval(this.timer);
+    this.timer = null;
+    if (this.socket) this.socket.close();
+    this.socket = null;
+    this.sources.clear();
+  }
+
+  // Asks every exporter on the group for a footprint snapshot of sym (every
+  // symbol if omitted); it arrives on the group for all receivers
+  requestFootprint(sym) {
+    for (const source of this.sources.values()) {
+      this._send(source, encodeFootprintRequest(sym));
+    }
+  }
+
+  handleDatagram(msg, rinfo) {
+    const source = this._sourceFor(msg, rinfo);
+    if (!source) return;
+
+    const packet = source.decoder.pushDatagram(msg);
+    if (!packet) return;
+
+    this.stats.datagrams++;
+    source.lastHeard = Date.now();
+    source.retransmitPort = packet.retransmitPort;
+
+    if (!packet.retransmit) {
+      if (source.packetSeq > 0 && packet.packetSeq > source.packetSeq + 1) {
+        this.stats.lostDatagrams += packet.packetSeq - source.packetSeq - 1;
+      }
+      if (packet.packetSeq > source.packetSeq) source.packetSeq = packet.packetSeq;
+    }
+  }
+
+  // Sends any resend requests due and gives up on gaps open too long
+  checkGaps(now) {
+    for (const [key, source] of this.sources) {
+      if (now - source.lastHeard > SOURCE_IDLE_MS) {
+        this.sources.delete(key);
+        continue;
+      }
+
+      for (const [sym, state] of source.symbols) {
+        if (state.gapSince === 0) continue;
+
+        if (now - state.gapSince >= GAP_TIMEOUT_MS || state.held.length > MAX_HELD_TICKS) {
+          this._skipGap(source, sym, state);
+        } else if (now - state.requestedAt >= RESEND_INTERVAL_MS) {
+          this._requestResend(source, sym, state, now);
+        }
+      }
+    }
+  }
+
+  // The source is keyed by sender address and source ID, so an exporter
+  // restart (new source ID) starts over with fresh symbol state
+  _sourceFor(msg, rinfo) {
+    if (msg.length < 12) return null;
+    const key = `${rinfo.address}/${msg.readUInt32LE(8)}`;
+
+    let source = this.sources.get(key);
+    if (!source) {
+      source = {
+        address: rinfo.address,
+        retransmitPort: 0,
+        packetSeq: 0,
+        lastHeard: Date.now(),
+        symbols: new Map(),     // sym -> { last, held, gapSince, requestedAt, target }
+        decoder: null
+      };
+      source.decoder = this._createDecoder(source);
+      this.sources.set(key, source);
+    }
+    return source;
+  }
+
+  _createDecoder(source) {
+    const h = this.handlers;
+    return new WireDecoder({
+      onTick: (tick) => this._onTick(source, tick),
+      onSummary: (summary) => this._onSummary(source, summary),
+      onSequence: (sequence) => this._onSequence(source, sequence),
+      onAggregate: h.onAggregate,
+      onQuote: h.onQuote,
+      onFootprint: h.onFootprint,
+      onTradeEvent: h.onTradeEvent,
+      onStats: h.onStats,
+      onTiming: h.onTiming,
+      onSymbol: h.onSymbol,
+      onError: h.onError
+    });
+  }
+
+  _state(source, sym) {
+    let state = source.symbols.get(sym);
+    if (!state) {
+      state = { last: 0, held: [], gapSince: 0, requestedAt: 0, target: 0 };
+      source.symbols.set(sym, state);
+    }
+    return state;
+  }
+
+  _onTick(source, tick) {
+    const state = this._state(source, tick.sym);
+    const seq = tick.seq;
+
+    // Sequence 1 after later ones: the chart restarted its numbering
+    if (seq === 1 && state.last > 1) this._reset(state);
+
+    if (state.last === 0 || seq === state.last + 1) {
+      this._deliver(state, tick, seq);
+      this._drain(source, tick.sym, state);
+      return;
+    }
+    if (seq <= state.last) {
+      this.stats.duplicates++;
+      return;
+    }
+
+    // Ahead of a gap: hold it until the gap fills
+    this._hold(state, tick, seq);
+    this._openGap(source, tick.sym, state, seq - 1);
+  }
+
+  // Coalesced ticks cover seq0..seq1 and are not resent
+  _onSummary(source, summary) {
+    const state = this._state(source, summary.sym);
+    if (summary.seq1 <= state.last) {
+      this.stats.duplicates++;
+      return;
+    }
+    if (state.last === 0 || summary.seq0 <= state.last + 1) {
+      this._deliver(state, summary, summary.seq1);
+      this._drain(source, summary.sym, state);
+      return;
+    }
+    this._hold(state, summary, summary.seq1, summary.seq0);
+    this._openGap(source, summary.sym, state, summary.seq0 - 1);
+  }
+
+  // Announced newest sequence: ticks up to it that never came are missing
+  _onSequence(source, sequence) {
+    const state = this._state(source, sequence.sym);
+    if (state.last === 0) {
+      // Joined mid-stream: start after the announced tick
+      state.last = sequence.seq;
+      return;
+    }
+    if (sequence.seq > state.last) this._openGap(source, sequence.sym, state, sequence.seq);
+  }
+
+  _deliver(state, message, lastSeq) {
+    state.last = lastSeq;
+    if (message.type === 'summary') this._emit('onSummary', message);
+    else this._emit('onTick', message);
+  }
+
+  // held is kept sorted by first sequence; entries are { first, last, message }
+  _hold(state, message, lastSeq, firstSeq = lastSeq) {
+    const held = state.held;
+    let i = held.length;
+    while (i > 0 && held[i - 1].first > firstSeq) i--;
+    if (i > 0 && held[i - 1].first === firstSeq) {
+      this.stats.duplicates++;
+      return;
+    }
+    held.splice(i, 0, { first: firstSeq, last: lastSeq, message });
+  }
+
+  // Delivers held ticks that now follow on; closes the gap once none are
+  // missing. A later run still missing is asked for at once, with its own
+  // timeout.
+  _drain(source, sym, state) {
+    const held = state.held;
+    let n = 0;
+    while (n < held.length && held[n].first <= state.last + 1) {
+      if (held[n].last > state.last) this._deliver(state, held[n].message, held[n].last);
+      else this.stats.duplicates++;
+      n++;
+    }
+    if (n > 0) held.splice(0, n);
+
+    if (state.gapSince === 0) return;
+    if (held.length === 0 && state.last >= state.target) {
+      state.gapSince = 0;
+      state.target = 0;
+    } else if (n > 0) {
+      const now = Date.now();
+      state.gapSince = now;
+      this._requestResend(source, sym, state, now);
+    }
+  }
+
+  _openGap(source, sym, state, target) {
+    if (target > state.target) state.target = target;
+    if (state.gapSince !== 0) return;
+
+    const now = Date.now();
+    state.gapSince = now;
+    this._requestResend(source, sym, state, now);
+  }
+
+  // Asks for the ticks after the last delivered one, up to the first held
+  _requestResend(source, sym, state, now) {
+    const to = state.held.length ? state.held[0].first - 1 : state.target;
+    state.requestedAt = now;
+    this.stats.resendRequests++;
+    this._send(source, JSON.stringify({ type: 'resume', sym, seq: state.last, to }) + '\n');
+  }
+
+  // Gives up on the first missing run and carries on with the ticks held
+  // behind it
+  _skipGap(source, sym, state) {
+    const from = state.last + 1;
+    const to = state.held.length ? state.held[0].first - 1 : state.target;
+    this.stats.gaps++;
+    this._emit('onGap', { sym, from, to });
+
+    state.last = to;
+    if (state.held.length === 0) {
+      state.gapSince = 0;
+      state.target = 0;
+      return;
+    }
+    this._drain(source, sym, state);
+  }
+
+  _reset(state) {
+    state.last = 0;
+    state.held = [];
+    state.gapSince = 0;
+    state.requestedAt = 0;
+    state.target = 0;
+  }
+
+  _send(source, line) {
+    if (!this.socket || !source.retransmitPort) return;
+    this.socket.send(line, source.retransmitPort, source.address, (err) => {
+      if (err) this._emit('onError', err);
+    });
+  }
+
+  _emit(name, value) {
+    const handler = this.handlers[name];
+    if (handler) handler(value);
+  }
+}
+
+module.exports = { MulticastReceiver };
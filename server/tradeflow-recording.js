@@ -0,0 +1,243 @@
+// tradeflow-recording.js
+// Reader for the tick recordings written by the exporter's recorder
+// (layout: acsil/TradeFlowRecorder.h). Segments are read with positioned
+// reads, so a recording can be opened while it is still being written.
+// Ticks come out in the relay's JSON shape: { seq, ts, p, v, s, sym }.
+//
+// Run: node tradeflow-recording.js <segment.tfr | directory> [--from <ms>] [--csv <out.csv>]
+// Prints a summary of each segment. With --csv the ticks are written in the
+// CSV playback format (timestamp,price,volume,side).
+
+const fs = require('fs');
+const path = require('path');
+
+const RECORDING_MAGIC = 0x52544654;   // "TFTR"
+const RECORDING_VERSION = 1;
+const HEADER_BYTES = 160;
+const TICK_SIZE = 32;
+const INDEX_ENTRY_SIZE = 16;
+const SIDE_ASK = 1;
+
+const RECORDING_EXTENSION = '.tfr';
+const INDEX_EXTENSION = '.tfi';
+
+// Ticks read per positioned read when streaming
+const READ_CHUNK_TICKS = 8192;
+
+const TWO_POW_32 = 4294967296;
+
+// Little-endian int64 as a Number (exact up to 2^53)
+function readInt64(buffer, offset) {
+  return buffer.readInt32LE(offset + 4) * TWO_POW_32 + buffer.readUInt32LE(offset);
+}
+
+function readUInt64(buffer, offset) {
+  return buffer.readUInt32LE(offset + 4) * TWO_POW_32 + buffer.readUInt32LE(offset);
+}
+
+function parseHeader(buffer) {
+  if (buffer.length < HEADER_BYTES || buffer.readUInt32LE(0) !== RECORDING_MAGIC) {
+    throw new Error('Not a TradeFlow recording');
+  }
+
+  const version = buffer.readUInt16LE(4);
+  if (version !== RECORDING_VERSION) {
+    throw new Error(`Unsupported recording version ${version}`);
+  }
+
+  const symbolEnd = buffer.indexOf(0, 96);
+  const decimals = buffer.readUInt8(88);
+  return {
+    version,
+    headerSize: buffer.readUInt32LE(8),
+    recordSize: buffer.readUInt32LE(12),
+    recordCount: readUInt64(buffer, 16),
+    capacity: readUInt64(buffer, 24),
+    firstTs: readInt64(buffer, 32),
+    lastTs: readInt64(buffer, 40),
+    firstSeq: readInt64(buffer, 48),
+    lastSeq: readInt64(buffer, 56),
+    created: readInt64(buffer, 64),
+    tickSize: buffer.readDoubleLE(72),
+    segment: buffer.readUInt32LE(80),
+    indexIntervalMs: buffer.readUInt32LE(84),
+    decimals,
+    scale: Math.pow(10, decimals),
+    symbol: buffer.toString('latin1', 96, symbolEnd >= 96 && symbolEnd < 160 ? symbolEnd : 160)
+  };
+}
+
+class RecordingSegment {
+  // recover: also count records written after the last commit (after a crash
+  // they may be intact; preallocated space past them reads as zeros)
+  constructor(filePath, { recover = false } = {}) {
+    this.path = filePath;
+    this.fd = fs.openSync(filePath, 'r');
+
+    const headerBuffer = Buffer.alloc(HEADER_BYTES);
+    fs.readSync(this.fd, headerBuffer, 0, HEADER_BYTES, 0);
+    this.header = parseHeader(headerBuffer);
+
+    this.count = this.header.recordCount;
+    if (recover) this.count = this._recoverCount();
+
+    this.index = this._loadIndex();
+  }
+
+  close() {
+    if (this.fd !== null) fs.closeSync(this.fd);
+    this.fd = null;
+  }
+
+  // Reads up to n ticks starting at record position start
+  readTicks(start, n) {
+    const end = Math.min(this.count, start + n);
+    if (start >= end) return [];
+
+    const buffer = Buffer.alloc((end - start) * this.header.recordSize);
+    const bytes = fs.readSync(this.fd, buffer, 0, buffer.length, this._offset(start));
+
+    const ticks = [];
+    for (let o = 0; o + TICK_SIZE <= bytes; o += this.header.recordSize) {
+      ticks.push(this._decodeTick(buffer, o));
+    }
+    return ticks;
+  }
+
+  // Calls onTick for every tick at or after fromTs (all ticks if omitted)
+  forEach(onTick, fromTs) {
+    let position = fromTs !== undefined ? this.seek(fromTs) : 0;
+    while (position < this.count) {
+      const ticks = this.readTicks(position, READ_CHUNK_TICKS);
+      if (ticks.length === 0) break;
+      for (const tick of ticks) onTick(tick);
+      position += ticks.length;
+    }
+  }
+
+  // Position of the first record at or after ts: the index narrows it to one
+  // index interval, which is then scanned
+  seek(ts) {
+    let position = 0;
+    if (this.index.length > 0) {
+      let low = 0;
+      let high = this.index.length;
+      while (low < high) {
+        const mid = (low + high) >> 1;
+        if (this.index[mid].ts < ts) low = mid + 1;
+        else high = mid;
+      }
+      position = low > 0 ? this.index[low - 1].record : 0;
+    }
+
+    while (position < this.count) {
+      const ticks = this.readTicks(position, READ_CHUNK_TICKS);
+      if (ticks.length === 0) break;
+      for (let i = 0; i < ticks.length; i++) {
+        if (ticks[i].ts >= ts) return position + i;
+      }
+      position += ticks.length;
+    }
+    return this.count;
+  }
+
+  _offset(position) {
+    return this.header.headerSize + position * this.header.recordSize;
+  }
+
+  _decodeTick(buffer, o) {
+    const h = this.header;
+    return {
+      seq: readInt64(buffer, o),
+      ts: readInt64(buffer, o + 8),
+      p: Math.round(buffer.readInt32LE(o + 16) * h.tickSize * h.scale) / h.scale,
+      v: buffer.readUInt32LE(o + 20),
+      s: buffer.readUInt8(o + 26) === SIDE_ASK ? 'ASK' : 'BID',
+      sym: h.symbol
+    };
+  }
+
+  _recoverCount() {
+    const fileRecords = Math.floor((fs.fstatSync(this.fd).size - this.header.headerSize) / this.header.recordSize);
+    const limit = Math.min(fileRecords, this.header.capacity);
+    const sequence = Buffer.alloc(8);
+
+    let count = this.header.recordCount;
+    while (count < limit) {
+      fs.readSync(this.fd, sequence, 0, 8, this._offset(count));
+      if (readInt64(sequence, 0) === 0) break;
+      count++;
+    }
+    return count;
+  }
+
+  _loadIndex() {
+    const indexPath = this.path.slice(0, -RECORDING_EXTENSION.length) + INDEX_EXTENSION;
+    if (!fs.existsSync(indexPath)) return [];
+
+    const buffer = fs.readFileSync(indexPath);
+    const entries = [];
+    for (let o = 0; o + INDEX_ENTRY_SIZE <= buffer.length; o += INDEX_ENTRY_SIZE) {
+      const record = readUInt64(buffer, o + 8);
+      if (record >= this.count) break;
+      entries.push({ ts: readInt64(buffer, o), record });
+    }
+    return entries;
+  }
+}
+
+// Segment files in a directory (or the one file given), in recording order
+function listSegments(target) {
+  if (!fs.statSync(target).isDirectory()) return [target];
+
+  return fs.readdirSync(target)
+    .filter((name) => name.endsWith(RECORDING_EXTENSION))
+    .sort()
+    .map((name) => path.join(target, name));
+}
+
+function main(args) {
+  const target = args[0];
+  if (!target) {
+    console.error('Usage: node tradeflow-recording.js <segment.tfr | directory> [--from <ms>] [--csv <out.csv>]');
+    process.exit(1);
+  }
+
+  const fromIndex = args.indexOf('--from');
+  const fromTs = fromIndex >= 0 ? Number(args[fromIndex + 1]) : undefined;
+  const csvIndex = args.indexOf('--csv');
+  const csv = csvIndex >= 0 ? fs.createWriteStream(args[csvIndex + 1]) : null;
+  if (csv) csv.write('timestamp,price,volume,side\n');
+
+  let total = 0;
+  for (const file of listSegments(target)) {
+    const segment = new RecordingSegment(file, { recover: true });
+    const h = segment.header;
+    const uncommitted = segment.count - h.recordCount;
+    console.log(
+      `${path.basename(file)}: ${h.symbol} #${h.segment}, ${segment.count} ticks` +
+      (uncommitted > 0 ? ` (${uncommitted} past the last commit)` : '') +
+      (h.firstTs ? `, ${new Date(h.firstTs).toISOString()} - ${new Date(h.lastTs).toISOString()}` : '') +
+      `, ${segment.index.length} index entries`
+    );
+
+    if (csv) {
+      segment.forEach((t) => {
+        csv.write(`${t.ts},${t.p.toFixed(h.decimals)},${t.v},${t.s}\n`);
+        total++;
+      }, fromTs);
+    }
+    segment.close();
+  }
+
+  if (csv) {
+    csv.end();
+    console.log(`✓ Wrote ${total} ticks to ${args[csvIndex + 1]}`);
+  }
+}
+
+if (require.main === module) {
+  main(process.argv.slice(2));
+}
+
+module.exports = { RecordingSegment, listSegments, parseHeader };